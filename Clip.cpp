@@ -9,151 +9,155 @@
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <climits>
+#include <cfloat>
 
 #include "audioconfig.h"
 #include "Clip.h"
-#include "simplepeakdetector.h"
-#include "wavfilereader.h"
+#include "peakscanner.h"
+#include "audiosource.h"
+#include "analysisgraph.h"
 #include "mathutils.h"
+#include "clipsnapshot.h"
+#include "stftframecache.h"
 
-#define TIME_RELATIVE_TOLERANCE (1.0 / (DEFAULT_SAMPLE_RATE * 10))
-#define TIME_ABSOLUTE_TOLERANCE (1.0 / (DEFAULT_SAMPLE_RATE * 10))
+// Limits of the times converted to positions, beyond them positions don't fit in a SamplePosition
+// or a BeatPosition anymore. Whether a position is within the range of the warp markers is only
+// decided once it is converted.
+#define MAX_SAMPLE_POSITION	1.8e19
+#define MAX_BEAT_TIME		(9.2e18 / WarpMarker::BEAT_POSITIONS_PER_SECOND)
 
-WarpMarker::WarpMarker(double sampleTime, double beatTime)
-: m_SampleTime(sampleTime), m_BeatTime(beatTime) 
-{
-	m_SampleIndex = MathUtils::Round(sampleTime * DEFAULT_SAMPLE_RATE);
-}
+// Relative error of the positions computed from times, a few ulps
+#define POSITION_RELATIVE_ERROR	(4 * DBL_EPSILON)
 
-WarpMarker::WarpMarker(unsigned int sampleIndex, double beatTime)
-: m_SampleIndex(sampleIndex), m_BeatTime(beatTime)
+BeatPosition WarpMarker::ToBeatPosition(double beatTime)
 {
-	
+	return static_cast<BeatPosition>(floor(beatTime * BEAT_POSITIONS_PER_SECOND + 0.5));
 }
-bool WarpMarker::operator==(const WarpMarker& rhs) const
+
+// Finds, in warpMarkers, the warp markers bounding position, see 
+// AClip::FindBoundingWarpMarkersForSamplePosition
+template <typename _Position>
+static bool FindBoundingWarpMarkers(const std::map<_Position, WarpMarker*>& warpMarkers, _Position position, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker)
 {
-	if (this == &rhs)
+	if (warpMarkers.size() < 2)
 	{
-		return true;
+		// we need at least 2 bounding warp markers in the clip
+		// They should have been created after loading the audio data by calling AClip::AddDefaultWarpMarkers()
+		return false;
 	}
-	
-	return	m_SampleIndex	== rhs.m_SampleIndex	&& 
-			m_BeatTime		== rhs.m_BeatTime		&&
-			m_SampleTime	== rhs.m_SampleTime;
-}
 
-AClip::~AClip()
-{	
-	// deallocate WarpMarker instances
-	std::map<unsigned int, WarpMarker*>::iterator itWarpMarkers = m_SampleIndexToWarpMarker.begin();
-	std::map<unsigned int, WarpMarker*>::iterator itWarpMarkersEnd = m_SampleIndexToWarpMarker.end();
-	for (; itWarpMarkers != itWarpMarkersEnd; ++itWarpMarkers)
+	typename std::map<_Position, WarpMarker*>::const_iterator itHighBoundWarpMarker = warpMarkers.upper_bound(position);
+	if (itHighBoundWarpMarker == warpMarkers.begin())
 	{
-		WarpMarker* warpMarkerToDelete = itWarpMarkers->second;
-		if (warpMarkerToDelete)
+		// Before the first warp marker
+		return false;
+	}
+
+	if (itHighBoundWarpMarker == warpMarkers.end())
+	{
+		if (warpMarkers.rbegin()->first != position)
 		{
-			delete warpMarkerToDelete;
-			itWarpMarkers->second = 0;
+			// After the last warp marker
+			return false;
 		}
+
+		--itHighBoundWarpMarker;
 	}
 
-	// Then it's safe to clear both maps
-	m_SampleIndexToWarpMarker.clear();
-	m_BeatTimeToWarpMarker.clear();
+	typename std::map<_Position, WarpMarker*>::const_iterator itLowBoundWarpMarker = itHighBoundWarpMarker;
+	--itLowBoundWarpMarker;
+
+	lowBoundMarker = *itLowBoundWarpMarker->second;
+	highBoundMarker = *itHighBoundWarpMarker->second;
+	return true;
 }
 
-bool AClip::SampleIndexKeyAlreadyExists(unsigned int sampleIndex) const
+// Integer part of position, which is known to be positive, as a SamplePosition or a 
+// BeatPosition. Positions computed from times are off by a few ulps, so the time of a warp
+// marker may give a position just below it: positions that close to the next integer are
+// rounded up to it, otherwise the time of the first warp marker wouldn't be converted.
+template <typename _Position>
+static _Position GetIntegerPosition(double position)
 {
-	// A simple find might not be sufficient here to insure that our data is valid
-	// Adding two warp markers to adjacent samples, or samples that are very close 
-	// to each other in the physical signal may not be a good idea...
-	std::map<unsigned int, WarpMarker*>::const_iterator itSampleIndexToWarpMarker = m_SampleIndexToWarpMarker.find(sampleIndex);
-	if (itSampleIndexToWarpMarker != m_SampleIndexToWarpMarker.end())
-	{
-		return true;
-	}
-
-	return false;
+	return static_cast<_Position>(position * (1.0 + POSITION_RELATIVE_ERROR));
 }
 
-	
-bool AClip::BeatTimeKeyAlreadyExists(double beatTime) const
+AClip::~AClip()
 {	
-	// As for AClip::SampleIndexKeyAlreadyExists, it could be necessary to perform a less naive test to
-	// determine if a beat time keu already exists. Moreover, due to floating point arithmetics, the user 
-	// code which calls this method might use a beatTime value that is slightly different but should point to the 
-	// same warp marker.
-	std::map<double, WarpMarker*>::const_iterator itBeatTimeToWarpMarker = m_BeatTimeToWarpMarker.find(beatTime);
-	if (itBeatTimeToWarpMarker != m_BeatTimeToWarpMarker.end())
-	{
-		return true;
-	}
-
-	return false;
+	ClearWarpMarkers();
+	delete m_StftFrameCache;
 }
 
-bool AClip::ValidateWarpMarkerForAdd(const WarpMarker& warpMarkerToAdd)
-{		
-	double sampleTimeToAdd = warpMarkerToAdd.GetSampleTime();
-	double beatTimeToAdd = warpMarkerToAdd.GetBeatTime();
-	
-	// Check that sample time for the warp marker to be added is within bounds of the physical signal
-	// Beat time can't be negative, as it doesn't make sense to warp "in the past", but we could want 
-	// to warp to any time in the future
-	if (sampleTimeToAdd < 0.0 || 
-		(!MathUtils::AlmostEqualWithTolerance(sampleTimeToAdd, GetDuration(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE) && sampleTimeToAdd > GetDuration()) || 
-		beatTimeToAdd < 0.0)
+StftFrameCache& AClip::GetStftFrameCache()
+{
+	if (!m_StftFrameCache)
 	{
-		return false;
+		m_StftFrameCache = new StftFrameCache(*this);
 	}
 
-	if (m_SampleIndexToWarpMarker.empty() && m_BeatTimeToWarpMarker.empty())
-	{
-		// We're about to add the first warp marker, all necessary checks are done
-		return true;
-	}
+	return *m_StftFrameCache;
+}
 
-	if (SampleIndexKeyAlreadyExists(warpMarkerToAdd.GetSampleIndex()))
+void AClip::ClearStftFrames()
+{
+	if (m_StftFrameCache)
 	{
-		return false;
+		m_StftFrameCache->Clear();
 	}
+}
 
-	if (BeatTimeKeyAlreadyExists(warpMarkerToAdd.GetBeatTime()))
-	{
-		return false;
-	}	
-
-	WarpMarker lowBoundWarpMarkerSampleTime;
-	WarpMarker highBoundWarpMarkerSampleTime;
-	if (!FindBoundingWarpMarkersForSampleTime(warpMarkerToAdd.GetSampleTime(), lowBoundWarpMarkerSampleTime, highBoundWarpMarkerSampleTime))
+void AClip::ClearWarpMarkers()
+{
+	// deallocate WarpMarker instances
+	std::map<SamplePosition, WarpMarker*>::iterator itWarpMarkers = m_SamplePositionToWarpMarker.begin();
+	std::map<SamplePosition, WarpMarker*>::iterator itWarpMarkersEnd = m_SamplePositionToWarpMarker.end();
+	for (; itWarpMarkers != itWarpMarkersEnd; ++itWarpMarkers)
 	{
-		// We're adding our warp marker outside of two bouding warp markers, all necessary checks are done
-		return true;
+		WarpMarker* warpMarkerToDelete = itWarpMarkers->second;
+		if (warpMarkerToDelete)
+		{
+			delete warpMarkerToDelete;
+			itWarpMarkers->second = 0;
+		}
 	}
 
-	WarpMarker lowBoundWarpMarkerBeatTime;
-	WarpMarker highBoundWarpMarkerBeatTime;
-	if (!FindBoundingWarpMarkersForBeatTime(warpMarkerToAdd.GetBeatTime(), lowBoundWarpMarkerBeatTime, highBoundWarpMarkerBeatTime))
+	// Then it's safe to clear both maps
+	m_SamplePositionToWarpMarker.clear();
+	m_BeatPositionToWarpMarker.clear();
+	m_LowAndHighBoundWarpMarkersCacheIsValid = false;
+}
+
+bool AClip::ValidateWarpMarkerForAdd(const WarpMarker& warpMarkerToAdd)
+{		
+	SamplePosition samplePositionToAdd = warpMarkerToAdd.GetSamplePosition();
+	BeatPosition beatPositionToAdd = warpMarkerToAdd.GetBeatPosition();
+	
+	// Check that the sample for the warp marker to be added is within bounds of the physical signal
+	// Beat time can't be negative, as it doesn't make sense to warp "in the past", but we could want 
+	// to warp to any time in the future
+	if (samplePositionToAdd > m_AudioInfo.m_NbSamples || beatPositionToAdd < 0)
 	{
-		// We're adding our warp marker within bouding warp markers regarding sample time, but not beat time, 
-		// there's something wrong.
 		return false;
 	}
 
-	if (lowBoundWarpMarkerBeatTime != lowBoundWarpMarkerSampleTime || highBoundWarpMarkerBeatTime != highBoundWarpMarkerSampleTime)
+	// The warp markers found just after and just before the new one, in sample order, must also
+	// be after and before it in beat order, so that warp markers never cross each other. This
+	// also rejects the warp markers using the sample or the beat position of an existing one.
+	std::map<SamplePosition, WarpMarker*>::const_iterator itNextWarpMarker = m_SamplePositionToWarpMarker.lower_bound(samplePositionToAdd);
+	if (itNextWarpMarker != m_SamplePositionToWarpMarker.end() &&
+		(itNextWarpMarker->first == samplePositionToAdd || itNextWarpMarker->second->GetBeatPosition() <= beatPositionToAdd))
 	{
-		// The two bounding warp markers we found when searching using beat time as search criteria are different
-		// than those we found when using sample time as search criteria, there's something wrong
 		return false;
 	}
 
-	if (MathUtils::AlmostEqualWithTolerance(sampleTimeToAdd, lowBoundWarpMarkerSampleTime.GetSampleTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE)	||
-		MathUtils::AlmostEqualWithTolerance(sampleTimeToAdd, highBoundWarpMarkerSampleTime.GetSampleTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE)	||
-		MathUtils::AlmostEqualWithTolerance(beatTimeToAdd, lowBoundWarpMarkerSampleTime.GetBeatTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE)		||
-		MathUtils::AlmostEqualWithTolerance(beatTimeToAdd, lowBoundWarpMarkerSampleTime.GetBeatTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE))
+	if (itNextWarpMarker != m_SamplePositionToWarpMarker.begin())
 	{
-		// The warp marker we're trying to add is too similar to existing ones, so let's not add it
-		return false;
+		std::map<SamplePosition, WarpMarker*>::const_iterator itPreviousWarpMarker = itNextWarpMarker;
+		if ((--itPreviousWarpMarker)->second->GetBeatPosition() >= beatPositionToAdd)
+		{
+			return false;
+		}
 	}
 	
 	return true;
@@ -161,20 +165,21 @@ bool AClip::ValidateWarpMarkerForAdd(const WarpMarker& warpMarkerToAdd)
 
 bool AClip::AddDefaultWarpMarkers()
 {    
-	// First default warp marker at clip's first sample
-    if (!AddWarpMarker(0.0, 0.0))
-	{
-		return false;
-	}
-    
-    // Second default warp marker at end of clip
 	if (!AudioInfo::CheckAudioInfo(m_AudioInfo))
     {
 		return false;
 	}
 
-	double duration = GetDuration();
-	if (!AddWarpMarker(duration, duration))
+	// First default warp marker at clip's first sample
+	if (!AddWarpMarker(WarpMarker(0, 0)))
+	{
+		return false;
+	}
+    
+    // Second default warp marker at end of clip, at the exact beat position of its duration
+	SamplePosition nbSamples = m_AudioInfo.m_NbSamples;
+	BeatPosition duration = static_cast<BeatPosition>(nbSamples) * WarpMarker::BEAT_POSITIONS_PER_SECOND / m_AudioInfo.m_SampleRate;
+	if (!AddWarpMarker(WarpMarker(nbSamples, duration)))
 	{
 		return false;
 	}
@@ -184,353 +189,560 @@ bool AClip::AddDefaultWarpMarkers()
 
 bool AClip::GetFirstWarpMarker(WarpMarker& outFirstWarpMarker) const
 {
-	if (m_SampleIndexToWarpMarker.empty())
+	if (m_SamplePositionToWarpMarker.empty())
 	{
 		return false;
 	}
 
-	outFirstWarpMarker = *(m_SampleIndexToWarpMarker.begin()->second);
+	outFirstWarpMarker = *(m_SamplePositionToWarpMarker.begin()->second);
 	return true;
 }
 
 bool AClip::GetLastWarpMarker(WarpMarker& outLastWarpMarker) const
 {
-	if (m_SampleIndexToWarpMarker.empty())
+	if (m_SamplePositionToWarpMarker.empty())
 	{
 		return false;
 	}
 
-	outLastWarpMarker = *(m_SampleIndexToWarpMarker.rbegin()->second);	
+	outLastWarpMarker = *(m_SamplePositionToWarpMarker.rbegin()->second);	
 	return true;
 }
 
+void AClip::GetWarpMarkers(std::vector<WarpMarker>& outWarpMarkers) const
+{
+	outWarpMarkers.clear();
+	outWarpMarkers.reserve(m_SamplePositionToWarpMarker.size());
+
+	std::map<SamplePosition, WarpMarker*>::const_iterator itWarpMarkers = m_SamplePositionToWarpMarker.begin();
+	for (; itWarpMarkers != m_SamplePositionToWarpMarker.end(); ++itWarpMarkers)
+	{
+		if (itWarpMarkers->second)
+		{
+			outWarpMarkers.push_back(*itWarpMarkers->second);
+		}
+	}
+}
+
 bool AClip::AddWarpMarker(double sampleTime, double beatTime)
 {
-	if (!MathUtils::IsValidTime(sampleTime) || !MathUtils::IsValidTime(beatTime))
+	if (!MathUtils::IsValidTime(sampleTime) || !MathUtils::IsValidTime(beatTime) || !AudioInfo::CheckAudioInfo(m_AudioInfo))
 	{
 		return false;
 	}
 
-	WarpMarker* warpMarkerToAdd = new WarpMarker(sampleTime, beatTime);
-	
-	if (!ValidateWarpMarkerForAdd(*warpMarkerToAdd))
+	// Out of range times are rejected before they are rounded to positions, which could overflow
+	double samplePosition = floor(sampleTime * m_AudioInfo.m_SampleRate + 0.5);
+	if (!(samplePosition >= 0.0 && samplePosition <= m_AudioInfo.m_NbSamples && beatTime >= 0.0 && beatTime < MAX_BEAT_TIME))
+	{
+		return false;
+	}
+
+	return AddWarpMarker(WarpMarker(static_cast<SamplePosition>(samplePosition), WarpMarker::ToBeatPosition(beatTime)));
+}
+
+bool AClip::AddWarpMarker(const WarpMarker& warpMarker)
+{
+	if (!ValidateWarpMarkerForAdd(warpMarker))
 	{
 		return false;
 	}
 		
-	m_SampleIndexToWarpMarker[warpMarkerToAdd->GetSampleIndex()] = warpMarkerToAdd; 
-	m_BeatTimeToWarpMarker[beatTime] = warpMarkerToAdd; 
+	WarpMarker* warpMarkerToAdd = new WarpMarker(warpMarker);
+	m_SamplePositionToWarpMarker[warpMarkerToAdd->GetSamplePosition()] = warpMarkerToAdd; 
+	m_BeatPositionToWarpMarker[warpMarkerToAdd->GetBeatPosition()] = warpMarkerToAdd; 
 
 	m_LowAndHighBoundWarpMarkersCacheIsValid = false;
 
 	return true;
 }
 
-
-bool AClip::FindBoundingWarpMarkersForSampleIndex(unsigned int sampleIndex, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker)
-{    
-    if (m_SampleIndexToWarpMarker.size() < 2)
-    {
-        // we need at least 2 bounding warp markers in the clip to find those
-        // bounding the sample at "sampleIndex"
-        // They should have been created after loading the audio data by calling AClip::AddDefaultWarpMarkers()
-        return false;
-    }
-    
-    // First, find low bound warp marker
-	std::map<unsigned int, WarpMarker*>::iterator itJustAfterLowBoundWarpMarker = m_SampleIndexToWarpMarker.lower_bound(sampleIndex);
-	if (itJustAfterLowBoundWarpMarker == m_SampleIndexToWarpMarker.end())
+bool AClip::AppendWarpMarker(const WarpMarker& warpMarker)
+{
+	if (warpMarker.GetSamplePosition() > m_AudioInfo.m_NbSamples || warpMarker.GetBeatPosition() < 0)
 	{
 		return false;
 	}
 
-	std::map<unsigned int, WarpMarker*>::iterator itLowBoundWarpMarkerCandidate;
-	if (itJustAfterLowBoundWarpMarker == m_SampleIndexToWarpMarker.begin() ||
-		itJustAfterLowBoundWarpMarker->second && itJustAfterLowBoundWarpMarker->second->GetSampleIndex() == sampleIndex)
+	if (!m_SamplePositionToWarpMarker.empty())
 	{
-		itLowBoundWarpMarkerCandidate = itJustAfterLowBoundWarpMarker;
+		const WarpMarker* lastWarpMarker = m_SamplePositionToWarpMarker.rbegin()->second;
+		if (warpMarker.GetSamplePosition() <= lastWarpMarker->GetSamplePosition() || warpMarker.GetBeatPosition() <= lastWarpMarker->GetBeatPosition())
+		{
+			return false;
+		}
 	}
-	else
+
+	// Inserting with end() as a hint doesn't search the maps when the key is after all the others
+	WarpMarker* warpMarkerToAdd = new WarpMarker(warpMarker);
+	m_SamplePositionToWarpMarker.insert(m_SamplePositionToWarpMarker.end(), std::make_pair(warpMarkerToAdd->GetSamplePosition(), warpMarkerToAdd));
+	m_BeatPositionToWarpMarker.insert(m_BeatPositionToWarpMarker.end(), std::make_pair(warpMarkerToAdd->GetBeatPosition(), warpMarkerToAdd));
+
+	// The cached bounding warp markers are still bounding the same interval
+	return true;
+}
+
+bool AClip::RemoveLastWarpMarker()
+{
+	if (m_SamplePositionToWarpMarker.empty())
 	{
-		itLowBoundWarpMarkerCandidate = --itJustAfterLowBoundWarpMarker;
+		return false;
 	}
 
-	WarpMarker* lowBoundWarpMarkerFound = itLowBoundWarpMarkerCandidate->second;
-	if (!lowBoundWarpMarkerFound)
+	std::map<SamplePosition, WarpMarker*>::iterator itLastWarpMarker = --m_SamplePositionToWarpMarker.end();
+	WarpMarker* warpMarkerToDelete = itLastWarpMarker->second;
+	if (m_LowAndHighBoundWarpMarkersCacheIsValid && m_CurrentCachedHighBoundWarpMarker == *warpMarkerToDelete)
 	{
-		return false;
+		m_LowAndHighBoundWarpMarkersCacheIsValid = false;
 	}
 
-	unsigned int lowBoundWarpMarkerSampleIndex = lowBoundWarpMarkerFound->GetSampleIndex();
-    if (lowBoundWarpMarkerSampleIndex > sampleIndex)
+	m_SamplePositionToWarpMarker.erase(itLastWarpMarker);
+	m_BeatPositionToWarpMarker.erase(--m_BeatPositionToWarpMarker.end());
+	delete warpMarkerToDelete;
+
+	return true;
+}
+
+bool AClip::FindBoundingWarpMarkersForSamplePosition(SamplePosition samplePosition, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker) const
+{    
+	return FindBoundingWarpMarkers(m_SamplePositionToWarpMarker, samplePosition, lowBoundMarker, highBoundMarker);
+}
+
+bool AClip::FindBoundingWarpMarkersForBeatPosition(BeatPosition beatPosition, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker) const
+{
+	return FindBoundingWarpMarkers(m_BeatPositionToWarpMarker, beatPosition, lowBoundMarker, highBoundMarker);
+}
+
+//----------------------------------------------------------------------------------------
+
+double AClip::InterpolateSampleTime(double beatPosition, const WarpMarker& lowBoundMarker, const WarpMarker& highBoundMarker) const
+{
+	double samplePosition = MathUtils::LinearMap(	beatPosition, 
+													static_cast<double>(lowBoundMarker.GetBeatPosition()), static_cast<double>(highBoundMarker.GetBeatPosition()), 
+													static_cast<double>(lowBoundMarker.GetSamplePosition()), static_cast<double>(highBoundMarker.GetSamplePosition()));
+	return samplePosition / m_AudioInfo.m_SampleRate;
+}
+
+double AClip::InterpolateBeatTime(double samplePosition, const WarpMarker& lowBoundMarker, const WarpMarker& highBoundMarker)
+{
+	double beatPosition = MathUtils::LinearMap(	samplePosition, 
+												static_cast<double>(lowBoundMarker.GetSamplePosition()), static_cast<double>(highBoundMarker.GetSamplePosition()), 
+												static_cast<double>(lowBoundMarker.GetBeatPosition()), static_cast<double>(highBoundMarker.GetBeatPosition()));
+	return beatPosition / WarpMarker::BEAT_POSITIONS_PER_SECOND;
+}
+
+// Times are converted to positions before looking up the bounding warp markers, and the 
+// fractional part of the positions is only used by the interpolation between them. The
+// cached warp markers are used up to, but not on, the high bound one: past it, positions
+// are interpolated between it and the next warp marker.
+
+double AClip::BeatToSampleTime(double BeatTime)
+{
+	double beatPosition = BeatTime * WarpMarker::BEAT_POSITIONS_PER_SECOND;
+	if (!(beatPosition >= 0.0 && BeatTime < MAX_BEAT_TIME))
 	{
-		return false;		
+		return 0.0;
 	}
 
-	lowBoundMarker = *lowBoundWarpMarkerFound;
-	    
-	// Then find high boung warp marker
-	std::map<unsigned int, WarpMarker*>::const_iterator itFoundHighBoundWarpMarker = m_SampleIndexToWarpMarker.upper_bound(sampleIndex);
-	if (itFoundHighBoundWarpMarker == m_SampleIndexToWarpMarker.end())
+	BeatPosition integerBeatPosition = GetIntegerPosition<BeatPosition>(beatPosition);
+	if (!m_LowAndHighBoundWarpMarkersCacheIsValid ||
+		integerBeatPosition < m_CurrentCachedLowBoundWarpMarker.GetBeatPosition() ||
+		integerBeatPosition >= m_CurrentCachedHighBoundWarpMarker.GetBeatPosition())
 	{
-		return false;
+		m_LowAndHighBoundWarpMarkersCacheIsValid = FindBoundingWarpMarkersForBeatPosition(integerBeatPosition, m_CurrentCachedLowBoundWarpMarker, m_CurrentCachedHighBoundWarpMarker);
+		if (!m_LowAndHighBoundWarpMarkersCacheIsValid)
+		{
+			return 0.0;
+		}
 	}
 
-	WarpMarker* highBoundWarpMarkerFound = itFoundHighBoundWarpMarker->second;
-	if (!highBoundWarpMarkerFound)
+	return InterpolateSampleTime(beatPosition, m_CurrentCachedLowBoundWarpMarker, m_CurrentCachedHighBoundWarpMarker);
+}
+
+//----------------------------------------------------------------------------------------
+
+double AClip::SampleToBeatTime(double SampleTime)
+{
+	double samplePosition = SampleTime * m_AudioInfo.m_SampleRate;
+	if (!(samplePosition >= 0.0 && samplePosition < MAX_SAMPLE_POSITION))
 	{
-		return false;
+		return 0.0;
 	}
 
-	unsigned int highBoundWarpMarkerSampleIndex = highBoundWarpMarkerFound->GetSampleIndex();
-	if (highBoundWarpMarkerSampleIndex <= sampleIndex)
+	SamplePosition integerSamplePosition = GetIntegerPosition<SamplePosition>(samplePosition);
+	if (!m_LowAndHighBoundWarpMarkersCacheIsValid ||
+		integerSamplePosition < m_CurrentCachedLowBoundWarpMarker.GetSamplePosition() ||
+		integerSamplePosition >= m_CurrentCachedHighBoundWarpMarker.GetSamplePosition())
+	{
+		m_LowAndHighBoundWarpMarkersCacheIsValid = FindBoundingWarpMarkersForSamplePosition(integerSamplePosition, m_CurrentCachedLowBoundWarpMarker, m_CurrentCachedHighBoundWarpMarker);
+		if (!m_LowAndHighBoundWarpMarkersCacheIsValid)
+		{
+			return 0.0;
+		}
+	}
+
+	return InterpolateBeatTime(samplePosition, m_CurrentCachedLowBoundWarpMarker, m_CurrentCachedHighBoundWarpMarker);
+}
+
+bool AClip::FindSampleTime(double beatTime, double& outSampleTime) const
+{
+	double beatPosition = beatTime * WarpMarker::BEAT_POSITIONS_PER_SECOND;
+	WarpMarker lowBoundMarker, highBoundMarker;
+	if (!(beatPosition >= 0.0 && beatTime < MAX_BEAT_TIME) ||
+		!FindBoundingWarpMarkersForBeatPosition(GetIntegerPosition<BeatPosition>(beatPosition), lowBoundMarker, highBoundMarker))
 	{
 		return false;
-	}	
-    
-	highBoundMarker = *highBoundWarpMarkerFound;
+	}
 
+	outSampleTime = InterpolateSampleTime(beatPosition, lowBoundMarker, highBoundMarker);
 	return true;
 }
 
-bool AClip::FindBoundingWarpMarkersForSampleTime(double sampleTime, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker)
+bool AClip::FindBeatTime(double sampleTime, double& outBeatTime) const
 {
-	unsigned int sampleIndex = MathUtils::Round(sampleTime * DEFAULT_SAMPLE_RATE);
-	return FindBoundingWarpMarkersForSampleIndex(sampleIndex, lowBoundMarker, highBoundMarker);
+	double samplePosition = sampleTime * m_AudioInfo.m_SampleRate;
+	WarpMarker lowBoundMarker, highBoundMarker;
+	if (!(samplePosition >= 0.0 && samplePosition < MAX_SAMPLE_POSITION) ||
+		!FindBoundingWarpMarkersForSamplePosition(GetIntegerPosition<SamplePosition>(samplePosition), lowBoundMarker, highBoundMarker))
+	{
+		return false;
+	}
+
+	outBeatTime = InterpolateBeatTime(samplePosition, lowBoundMarker, highBoundMarker);
+	return true;
 }
 
-bool AClip::FindBoundingWarpMarkersForBeatTime(double beatTime, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker)
-{
-	if (m_BeatTimeToWarpMarker.size() < 2)
+bool AClip::LoadDataFromFile(const std::string& filePath)
+{            
+    if (!(filePath.substr(filePath.length() - 5, 4).compare(std::string(".wav"))))
     {
-        // we need at least 2 bounding warp markers in the clip to find those
-        // bounding the beat time at "beatTime"
-        // They should have been created after loading the audio data by calling AClip::AddDefaultWarpMarkers()
+        std::cerr << ".wav extension missing, loading the file as Wav file anyway..." << std::endl;
         return false;
     }
-    
-    // First, find low bound warp marker
-	std::map<double, WarpMarker*>::iterator itJustAfterLowBoundWarpMarkerCandidate = m_BeatTimeToWarpMarker.lower_bound(beatTime);
-	if (itJustAfterLowBoundWarpMarkerCandidate == m_BeatTimeToWarpMarker.end())
+
+    AudioSource* audioSource = AudioSource::Open(filePath);
+    if (!audioSource)
+    {
+        return false;
+    }
+
+	bool loaded = LoadDataFromSource(*audioSource, filePath);
+	delete audioSource;
+
+	return loaded;
+}
+
+// Feed the mono samples of a source to the peak scanner, the waveform overview and the
+// resident samples of a clip, as extractors of its analysis graph
+class PeakScannerExtractor : public FeatureExtractor
+{
+private:
+	PeakScanner&	m_PeakScanner;
+
+public:
+	explicit PeakScannerExtractor(PeakScanner& peakScanner) : m_PeakScanner(peakScanner) {}
+
+	virtual void Reset(const AudioInfo& /*audioInfo*/) {}
+	virtual void Process(const float* /*interleavedSamples*/, const float* monoSamples, unsigned int nbFrames) { m_PeakScanner.Process(monoSamples, nbFrames); }
+	virtual void Finish() { m_PeakScanner.Finish(); }
+};
+
+class WaveformOverviewExtractor : public FeatureExtractor
+{
+private:
+	WaveformOverview&	m_WaveformOverview;
+
+public:
+	explicit WaveformOverviewExtractor(WaveformOverview& waveformOverview) : m_WaveformOverview(waveformOverview) {}
+
+	virtual void Reset(const AudioInfo& /*audioInfo*/) {}
+	virtual void Process(const float* /*interleavedSamples*/, const float* monoSamples, unsigned int nbFrames) { m_WaveformOverview.Process(monoSamples, nbFrames); }
+	virtual void Finish() { m_WaveformOverview.Finish(); }
+};
+
+class SampleStoreExtractor : public FeatureExtractor
+{
+private:
+	SampleStore&	m_SampleStore;
+
+public:
+	explicit SampleStoreExtractor(SampleStore& sampleStore) : m_SampleStore(sampleStore) {}
+
+	virtual void Reset(const AudioInfo& /*audioInfo*/) {}
+	virtual void Process(const float* /*interleavedSamples*/, const float* monoSamples, unsigned int nbFrames) { m_SampleStore.Process(monoSamples, nbFrames); }
+	virtual void Finish() {}
+};
+
+bool AClip::LoadDataFromSource(AudioSource& audioSource, const std::string& filePath)
+{
+	if (!AudioInfo::CheckAudioInfo(audioSource.GetAudioInfo()))
 	{
 		return false;
 	}
 
-	std::map<double, WarpMarker*>::iterator itLowBoundWarpMarker;
-	std::map<double, WarpMarker*>::iterator lowestBound = m_BeatTimeToWarpMarker.begin();
+    m_FilePath = filePath;
+    m_AudioInfo = audioSource.GetAudioInfo();
+	ClearStftFrames();
 
-	if (itJustAfterLowBoundWarpMarkerCandidate == lowestBound ||
-		itJustAfterLowBoundWarpMarkerCandidate->second && MathUtils::AlmostEqualWithTolerance(itJustAfterLowBoundWarpMarkerCandidate->second->GetBeatTime(), beatTime, TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE))
+	// Peaks are written by the detector straight into foundPeaks, already offset to their
+	// position in the clip, so that no per-window container is ever allocated
+	std::vector<Peak> foundPeaks;
+	PeakVectorSink foundPeaksSink(foundPeaks);
+	PeakScanner peakScanner(m_PeakDetector, m_AudioInfo, foundPeaksSink);
+
+	m_WaveformOverview.Reset(m_AudioInfo.m_SampleRate);
+	m_ResidentSamples.Reset(m_ResidentSampleFormat, m_AudioInfo.m_NbSamples);
+
+	// The samples are read once for the clip and the extractors of the user, sources with more
+	// than one channel being mixed down to mono once for all of them
+	PeakScannerExtractor peakScannerExtractor(peakScanner);
+	WaveformOverviewExtractor waveformOverviewExtractor(m_WaveformOverview);
+	SampleStoreExtractor sampleStoreExtractor(m_ResidentSamples);
+
+	AnalysisGraph analysisGraph;
+	analysisGraph.AddExtractor(&peakScannerExtractor);
+	if (m_BuildWaveformOverview)
 	{
-		itLowBoundWarpMarker = itJustAfterLowBoundWarpMarkerCandidate;
+		analysisGraph.AddExtractor(&waveformOverviewExtractor);
 	}
-	else
-	{
-		itLowBoundWarpMarker = --itJustAfterLowBoundWarpMarkerCandidate;
-	}	
 
-	WarpMarker* lowBoundWarpMarkerFound = itLowBoundWarpMarker->second;
-	if (!lowBoundWarpMarkerFound)
+	if (m_ResidentSampleFormat != SampleStore::FORMAT_NONE)
 	{
-		return false;
+		analysisGraph.AddExtractor(&sampleStoreExtractor);
 	}
 
-	double lowBoundWarpMarkerBeatTime = lowBoundWarpMarkerFound->GetBeatTime();
-	if (lowBoundWarpMarkerBeatTime > beatTime && !MathUtils::AlmostEqualWithTolerance(lowBoundWarpMarkerBeatTime, beatTime, TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE))
+	for (size_t extractorIndex = 0; extractorIndex < m_FeatureExtractors.size(); ++extractorIndex)
 	{
-		return false;		
+		analysisGraph.AddExtractor(m_FeatureExtractors[extractorIndex]);
 	}
 
-	lowBoundMarker = *lowBoundWarpMarkerFound;
-	    
-	// Then find high boung warp marker
-	std::map<double, WarpMarker*>::iterator itFoundHighBoundWarpMarker = m_BeatTimeToWarpMarker.upper_bound(beatTime);
-	if (itFoundHighBoundWarpMarker == m_BeatTimeToWarpMarker.end())
+	bool loaded = analysisGraph.Run(audioSource);
+    
+	m_Peaks.swap(foundPeaks);
+	m_BPMCached = false;
+
+    return loaded;
+}
+
+bool AClip::LoadDataFromSamples(const AudioInfo& audioInfo, const float* samples, const std::string& filePath)
+{
+	if (!AudioInfo::CheckAudioInfo(audioInfo) || (audioInfo.m_NbSamples && !samples))
 	{
 		return false;
 	}
-	
-	WarpMarker* highBoundWarpMarkerFound = itFoundHighBoundWarpMarker->second;
-	if (!highBoundWarpMarkerFound)
+
+	m_AudioInfo = audioInfo;
+	m_FilePath = filePath;
+	ClearStftFrames();
+
+	std::vector<Peak> foundPeaks;
+	PeakVectorSink foundPeaksSink(foundPeaks);
+	PeakScanner::ScanSamples(m_PeakDetector, m_AudioInfo, samples, m_AudioInfo.m_NbSamples, foundPeaksSink);
+
+	m_WaveformOverview.Reset(m_AudioInfo.m_SampleRate);
+	if (m_BuildWaveformOverview)
 	{
-		return false;
+		m_WaveformOverview.Process(samples, m_AudioInfo.m_NbSamples);
+		m_WaveformOverview.Finish();
 	}
 
-	double highBoundWarpMarkerBeatTime = highBoundWarpMarkerFound->GetBeatTime();
-	if (highBoundWarpMarkerBeatTime < beatTime || MathUtils::AlmostEqualWithTolerance(highBoundWarpMarkerBeatTime, beatTime, TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE))
+	m_ResidentSamples.Reset(m_ResidentSampleFormat, m_AudioInfo.m_NbSamples);
+	m_ResidentSamples.Process(samples, m_AudioInfo.m_NbSamples);
+
+	// The samples in memory are mixed down already
+	AudioInfo monoAudioInfo = m_AudioInfo;
+	monoAudioInfo.m_NumChannels = 1;
+	for (size_t extractorIndex = 0; extractorIndex < m_FeatureExtractors.size(); ++extractorIndex)
 	{
-		return false;
-	}	
-    
-	highBoundMarker = *highBoundWarpMarkerFound;
+		m_FeatureExtractors[extractorIndex]->Reset(monoAudioInfo);
+		m_FeatureExtractors[extractorIndex]->Process(samples, samples, m_AudioInfo.m_NbSamples);
+		m_FeatureExtractors[extractorIndex]->Finish();
+	}
 
-	return true;	
+	m_Peaks.swap(foundPeaks);
+	m_BPMCached = false;
+
+	return true;
 }
 
-//----------------------------------------------------------------------------------------
+void AClip::LoadDataFromClip(const AClip& sourceClip)
+{
+	m_AudioInfo			= sourceClip.m_AudioInfo;
+	m_FilePath			= sourceClip.m_FilePath;
+	m_Peaks				= sourceClip.m_Peaks;
+	m_WaveformOverview	= sourceClip.m_WaveformOverview;
+	m_BPMCached			= sourceClip.m_BPMCached;
+	m_BPMCachedValue	= sourceClip.m_BPMCachedValue;
+	ClearStftFrames();
+
+	// Resident samples are converted to the format of this clip
+	m_ResidentSamples.Reset(m_ResidentSampleFormat, 0);
+	m_ResidentSamples.CopyFrom(sourceClip.m_ResidentSamples);
+}
 
-double AClip::BeatToSampleTime(double BeatTime)
+void AClip::SetResidentSampleFormat(SampleStore::Format format)
 {
-    bool foundBoundingMarkers = false;
-	WarpMarker lowBoundMarker, highBoundMarker;
+	m_ResidentSampleFormat = format;
+	if (m_ResidentSamples.GetFormat() == format)
+	{
+		return;
+	}
+
+	SampleStore convertedSamples;
+	convertedSamples.Reset(format, 0);
+	convertedSamples.CopyFrom(m_ResidentSamples);
+	m_ResidentSamples.Swap(convertedSamples);
+
+	// Frames computed from the samples in the previous format would differ
+	ClearStftFrames();
+}
 
-	if (m_LowAndHighBoundWarpMarkersCacheIsValid)
+bool AClip::LoadDataFromSnapshot(const ClipSnapshot& snapshot)
+{
+	if (!snapshot.IsOpen())
 	{
-		if ((BeatTime > m_CurrentCachedLowBoundWarpMarker.GetBeatTime() || MathUtils::AlmostEqualWithTolerance(BeatTime, m_CurrentCachedLowBoundWarpMarker.GetBeatTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE)) &&
-			BeatTime < m_CurrentCachedHighBoundWarpMarker.GetBeatTime())
-		{
-			lowBoundMarker = m_CurrentCachedLowBoundWarpMarker;
-			highBoundMarker = m_CurrentCachedHighBoundWarpMarker;
-			foundBoundingMarkers = true;
-		}
+		return false;
 	}
 
-	if (!foundBoundingMarkers)
+	const ClipSnapshot::Header& header = snapshot.GetHeader();
+	m_AudioInfo.m_SampleRate	= header.m_SampleRate;
+	m_AudioInfo.m_BitsPerSample	= header.m_BitsPerSample;
+	m_AudioInfo.m_NumChannels	= header.m_NumChannels;
+	m_AudioInfo.m_NbSamples		= header.m_NbSamples;
+	m_FilePath					= snapshot.GetFilePath();
+	ClearStftFrames();
+
+	m_Peaks.clear();
+	m_Peaks.reserve(snapshot.GetNbPeaks());
+	const ClipSnapshot::PeakRecord* peakRecords = snapshot.GetPeaks();
+	for (size_t peakIndex = 0; peakIndex < snapshot.GetNbPeaks(); ++peakIndex)
 	{
-		foundBoundingMarkers = FindBoundingWarpMarkersForBeatTime(BeatTime, lowBoundMarker, highBoundMarker);
+		m_Peaks.push_back(Peak(peakRecords[peakIndex].m_PeakSampleIndex, peakRecords[peakIndex].m_AttackSampleIndex));
 	}
 
-    if (foundBoundingMarkers)
-    {        
-		m_CurrentCachedLowBoundWarpMarker = lowBoundMarker;
-		m_CurrentCachedHighBoundWarpMarker = highBoundMarker;
-		m_LowAndHighBoundWarpMarkersCacheIsValid = true;
-
-		double linearMappedSampleTime = MathUtils::LinearMap(	BeatTime, 
-																lowBoundMarker.GetBeatTime(), highBoundMarker.GetBeatTime(), 
-																lowBoundMarker.GetSampleTime(), highBoundMarker.GetSampleTime());
-        return linearMappedSampleTime;
-    }
+	// Warp markers are sorted, so each one is inserted at the end of the maps in constant time
+	ClearWarpMarkers();
+	const ClipSnapshot::WarpMarkerRecord* warpMarkerRecords = snapshot.GetWarpMarkers();
+	for (size_t warpMarkerIndex = 0; warpMarkerIndex < snapshot.GetNbWarpMarkers(); ++warpMarkerIndex)
+	{
+		WarpMarker* warpMarker = new WarpMarker(warpMarkerRecords[warpMarkerIndex].m_SamplePosition, warpMarkerRecords[warpMarkerIndex].m_BeatPosition);
+		m_SamplePositionToWarpMarker.insert(m_SamplePositionToWarpMarker.end(), std::make_pair(warpMarker->GetSamplePosition(), warpMarker));
+		m_BeatPositionToWarpMarker.insert(m_BeatPositionToWarpMarker.end(), std::make_pair(warpMarker->GetBeatPosition(), warpMarker));
+	}
 
-    return 0.0;
-}
+	m_WaveformOverview.Reset(m_AudioInfo.m_SampleRate);
+	m_ResidentSamples.Reset(m_ResidentSampleFormat, 0);
+	m_BPMCached = false;
 
+	return true;
+}
 
-//----------------------------------------------------------------------------------------
+static bool PeakIsBefore(const Peak& peak, unsigned int sampleIndex)
+{
+	return peak.GetPeakSampleIndex() < sampleIndex;
+}
 
-double AClip::SampleToBeatTime(double SampleTime)
+void AClip::ReanalyzeWindows(	const float* scanSamples, unsigned int scanFirstSampleIndex, unsigned int scanEndSampleIndex,
+								unsigned int peaksFirstSampleIndex, unsigned int peaksEndSampleIndex)
 {
-	bool foundBoundingMarkers = false;
-	WarpMarker lowBoundMarker, highBoundMarker;
+	std::vector<Peak> foundPeaks;
+	PeakVectorSink foundPeaksSink(foundPeaks);
+	PeakScanner peakScanner(m_PeakDetector, m_AudioInfo, foundPeaksSink, scanFirstSampleIndex);
+	peakScanner.Process(scanSamples, scanEndSampleIndex - scanFirstSampleIndex);
+	peakScanner.Finish();
 
-	if (m_LowAndHighBoundWarpMarkersCacheIsValid)
+	std::vector<Peak>::iterator itFirstPeak = std::lower_bound(m_Peaks.begin(), m_Peaks.end(), peaksFirstSampleIndex, PeakIsBefore);
+	std::vector<Peak>::iterator itEndPeak = peaksEndSampleIndex == UINT_MAX ? 
+												m_Peaks.end() : 
+												std::lower_bound(itFirstPeak, m_Peaks.end(), peaksEndSampleIndex, PeakIsBefore);
+
+	// Overwrite the peaks that are replaced, then insert or erase the difference
+	size_t nbReplacedPeaks = itEndPeak - itFirstPeak;
+	size_t nbCopiedPeaks = std::min(nbReplacedPeaks, foundPeaks.size());
+	itFirstPeak = std::copy(foundPeaks.begin(), foundPeaks.begin() + nbCopiedPeaks, itFirstPeak);
+	if (nbCopiedPeaks < nbReplacedPeaks)
 	{
-		if ((SampleTime > m_CurrentCachedLowBoundWarpMarker.GetSampleTime() || MathUtils::AlmostEqualWithTolerance(SampleTime, m_CurrentCachedLowBoundWarpMarker.GetSampleTime(), TIME_RELATIVE_TOLERANCE, TIME_ABSOLUTE_TOLERANCE)) &&
-			SampleTime < m_CurrentCachedHighBoundWarpMarker.GetSampleTime())
-		{
-			lowBoundMarker = m_CurrentCachedLowBoundWarpMarker;
-			highBoundMarker = m_CurrentCachedHighBoundWarpMarker;
-			foundBoundingMarkers = true;
-		}
+		m_Peaks.erase(itFirstPeak, itFirstPeak + (nbReplacedPeaks - nbCopiedPeaks));
 	}
-	
-	if (!foundBoundingMarkers)
-	{		
-		foundBoundingMarkers = FindBoundingWarpMarkersForSampleTime(SampleTime, lowBoundMarker, highBoundMarker);		
+	else
+	{
+		m_Peaks.insert(itFirstPeak, foundPeaks.begin() + nbCopiedPeaks, foundPeaks.end());
 	}
 
-	if (foundBoundingMarkers)
-	{
-		m_CurrentCachedLowBoundWarpMarker = lowBoundMarker;
-		m_CurrentCachedHighBoundWarpMarker = highBoundMarker;
-		m_LowAndHighBoundWarpMarkersCacheIsValid = true;
+	m_BPMCached = false;
+	ClearStftFrames();
 
-		double linearMappedBeatTime = MathUtils::LinearMap(	SampleTime, 
-															lowBoundMarker.GetSampleTime(), highBoundMarker.GetSampleTime(), 
-															lowBoundMarker.GetBeatTime(), highBoundMarker.GetBeatTime());
-		return linearMappedBeatTime;
+	if (!m_WaveformOverview.IsEmpty())
+	{
+		m_WaveformOverview.Update(scanFirstSampleIndex, scanSamples, scanEndSampleIndex - scanFirstSampleIndex);
 	}
 
-    return 0.0;
+	if (!m_ResidentSamples.IsEmpty())
+	{
+		m_ResidentSamples.Update(scanFirstSampleIndex, scanSamples, scanEndSampleIndex - scanFirstSampleIndex);
+	}
 }
 
-bool AClip::LoadDataFromFile(const std::string& filePath)
-{            
-    if (!(filePath.substr(filePath.length() - 5, 4).compare(std::string(".wav"))))
-    {
-        std::cerr << ".wav extension missing, loading the file as Wav file anyway..." << std::endl;
-        return false;
-    }
-
-    std::ifstream wavInputStream(filePath.c_str(), std::ifstream::in | std::ios::binary);
-    if (!wavInputStream)
-    {
-        return false;
-    }
-    
-    bool wavFormatOk = WavFileReader::ReadFormat(wavInputStream, m_AudioInfo);
-    if (!wavFormatOk)
-    {
-        return false;
-    }
+bool AClip::ReanalyzeRange(const float* samples, unsigned int firstSampleIndex, unsigned int endSampleIndex)
+{
+	if (!samples || firstSampleIndex >= endSampleIndex || firstSampleIndex >= m_AudioInfo.m_NbSamples)
+	{
+		return false;
+	}
 
-    if (m_AudioInfo.m_NumChannels > 1)
-    {
-        std::cerr << "More than one channel is not supported at this time." << std::endl;
-    }    
-	
-	const unsigned int INPUT_WINDOW_SIZE	= SimplePeakDetector::INPUT_WINDOW_SIZE;
-	const unsigned int INPUT_WINDOW_OFFSET	= SimplePeakDetector::INPUT_WINDOW_OFFSET;
-	
-	float samples[INPUT_WINDOW_SIZE];
-	memset(samples, 0, INPUT_WINDOW_SIZE * sizeof(float));
+	unsigned int scanFirstSampleIndex, scanEndSampleIndex, peaksFirstSampleIndex, peaksEndSampleIndex;
+	PeakScanner::GetWindowsCoveringRange(	firstSampleIndex, endSampleIndex, m_AudioInfo.m_NbSamples, 
+											scanFirstSampleIndex, scanEndSampleIndex, 
+											peaksFirstSampleIndex, peaksEndSampleIndex);
 
-	unsigned int samplesLeftToRead = m_AudioInfo.m_NbSamples;
-	unsigned int samplesRead = 0;
+	ReanalyzeWindows(samples + scanFirstSampleIndex, scanFirstSampleIndex, scanEndSampleIndex, peaksFirstSampleIndex, peaksEndSampleIndex);
+	return true;
+}
 
-	// First, read a full "window" of samples to feed the peak detector
-	if (!WavFileReader::ReadSamples(wavInputStream, m_AudioInfo, 
-									samplesLeftToRead > INPUT_WINDOW_SIZE ? INPUT_WINDOW_SIZE : samplesLeftToRead, 
-									samples, samplesRead))
+bool AClip::ReanalyzeFileRange(unsigned int firstSampleIndex, unsigned int endSampleIndex)
+{
+	if (m_FilePath.empty() || firstSampleIndex >= endSampleIndex)
 	{
 		return false;
 	}
 
-	// Make sure samplesRead is consistent
-	assert(INPUT_WINDOW_SIZE - samplesRead >= 0);
-	if (samplesRead < INPUT_WINDOW_SIZE)
+	if (firstSampleIndex >= m_AudioInfo.m_NbSamples)
 	{
-		// Pad the "samples" array with 0 doubles in case we read less than a full window		
-		memset(samples + samplesRead, 0, (INPUT_WINDOW_SIZE - samplesRead) * sizeof(float));
+		return false;
 	}
-	
-	// Detect peaks for the first chunk of samples
-	std::vector<Peak> foundPeaks;
-	if (m_PeakDetector)
+
+	AudioSource* audioSource = AudioSource::Open(m_FilePath);
+	if (!audioSource)
 	{
-		m_PeakDetector->GetPeaks(samples, INPUT_WINDOW_SIZE, m_AudioInfo, foundPeaks);
+		return false;
 	}
 
-	samplesLeftToRead -= samplesRead;
-	
-	// Until there's no samples left to read, move the "window" of samples forward in the data by INPUT_WINDOW_OFFSET samples
-	// This way, we make sure that we don't miss any peak that would have overlapped two adjacent windows
-	while (samplesLeftToRead && WavFileReader::ReadSamples(	wavInputStream, m_AudioInfo, 
-															(samplesLeftToRead > INPUT_WINDOW_SIZE - INPUT_WINDOW_OFFSET) ? INPUT_WINDOW_SIZE - INPUT_WINDOW_OFFSET : samplesLeftToRead, 
-															samples + INPUT_WINDOW_OFFSET, samplesRead))
+	AudioInfo audioInfo = audioSource->GetAudioInfo();
+	if (audioInfo.m_NbSamples != m_AudioInfo.m_NbSamples || audioInfo.m_SampleRate != m_AudioInfo.m_SampleRate)
 	{
-		if (m_PeakDetector)
-		{
-			std::vector<Peak> peaksFoundInCurrentWindow;
-			m_PeakDetector->GetPeaks(samples, INPUT_WINDOW_SIZE, m_AudioInfo, peaksFoundInCurrentWindow);
-			std::for_each(peaksFoundInCurrentWindow.begin(), peaksFoundInCurrentWindow.end(), Peak::OffsetByFunctor(m_AudioInfo.m_NbSamples - samplesLeftToRead));
-			std::copy(peaksFoundInCurrentWindow.begin(), peaksFoundInCurrentWindow.end(), std::insert_iterator<std::vector<Peak> >(foundPeaks, foundPeaks.end()));
-		}
-
-		memcpy(samples, samples + (INPUT_WINDOW_SIZE - INPUT_WINDOW_OFFSET), SimplePeakDetector::INPUT_WINDOW_OFFSET);
-		samplesLeftToRead -= samplesRead;		
+		// Positions of the peaks and warp markers can't be kept, start over. Loading doesn't
+		// touch the warp markers, which could be past the new end of the clip.
+		delete audioSource;
+		ClearWarpMarkers();
+		return LoadDataFromFile(m_FilePath) && AddDefaultWarpMarkers();
 	}
-    
-	m_Peaks = foundPeaks;
 
-	wavInputStream.close();	
+	unsigned int scanFirstSampleIndex, scanEndSampleIndex, peaksFirstSampleIndex, peaksEndSampleIndex;
+	PeakScanner::GetWindowsCoveringRange(	firstSampleIndex, endSampleIndex, m_AudioInfo.m_NbSamples, 
+											scanFirstSampleIndex, scanEndSampleIndex, 
+											peaksFirstSampleIndex, peaksEndSampleIndex);
 
-	if (samplesLeftToRead == 0)
+	std::vector<float> scanSamples(scanEndSampleIndex - scanFirstSampleIndex);
+	bool scanSamplesRead = audioSource->ReadMonoRange(scanFirstSampleIndex, scanEndSampleIndex, &scanSamples[0]);
+	delete audioSource;
+
+	if (!scanSamplesRead)
 	{
-		return true;
+		return false;
 	}
 
-    return false;    
+	ReanalyzeWindows(&scanSamples[0], scanFirstSampleIndex, scanEndSampleIndex, peaksFirstSampleIndex, peaksEndSampleIndex);
+	return true;
 }
 
 bool AClip::ComputeBPM(const std::vector<Peak>& peaks, double& outBpmCount) const
@@ -610,7 +822,7 @@ double AClip::GetDuration() const
 		return 0.0;
 	}
 
-	return m_AudioInfo.m_NbSamples / m_AudioInfo.m_SampleRate;
+	return static_cast<double>(m_AudioInfo.m_NbSamples) / m_AudioInfo.m_SampleRate;
 }
 
 //****************************************************************************************
@@ -9,37 +9,55 @@
 
 #include <vector>
 #include <map>
+#include <string>
 
 #include "audioformats.h"
 #include "peakdetector.h"
+#include "waveformoverview.h"
+#include "samplestore.h"
+
+class AudioSource;
+class ClipSnapshot;
+class FeatureExtractor;
+class StftFrameCache;
 
 //========================================================================================
 
+// Time in the set, in WarpMarker::BEAT_POSITIONS_PER_SECOND units
+typedef long long BeatPosition;
+
 /**
  *	A WarpMarker instance matches a sample found at sample time seconds in the clip it belongs to with
  *	the time at beatTime seconds in the set.
+ *	Both are stored as integers: the position of the sample in the clip, and the beat time in 
+ *	BEAT_POSITIONS_PER_SECOND units. Every common sample rate is a whole number of these units
+ *	per sample, so beat positions matching samples are exact. Warp markers are compared, sorted 
+ *	and looked up without any floating point tolerance.
  */
 class WarpMarker
 {
 public:
-    // It's alright to use 0.0 as a default value since it is defined as all bits set to 
-	// zero by the IEEE-754 standard.
-	WarpMarker() : m_SampleIndex(0), m_SampleTime(0.0), m_BeatTime(0.0) {}
-    WarpMarker(double sampleTime, double beatTime);
-	WarpMarker(unsigned int sampleIndex, double beatTime);
+	// 1/705600000 of a second, 64 bits of them cover about 400 years
+	static const BeatPosition BEAT_POSITIONS_PER_SECOND = 705600000;
+
+	WarpMarker() : m_SamplePosition(0), m_BeatPosition(0) {}
+	WarpMarker(SamplePosition samplePosition, BeatPosition beatPosition) : m_SamplePosition(samplePosition), m_BeatPosition(beatPosition) {}
 
-	bool operator==(const WarpMarker& rhs) const;
+	bool operator==(const WarpMarker& rhs) const { return m_SamplePosition == rhs.m_SamplePosition && m_BeatPosition == rhs.m_BeatPosition; }
 	bool operator!=(const WarpMarker& rhs) const { return !operator==(rhs); }
 
-    double GetBeatTime() const { return m_BeatTime; }
-    
-	double			GetSampleTime()		const		{ return m_SampleTime;							}
-	unsigned int	GetSampleIndex()	const		{ return m_SampleIndex;							}	
+	SamplePosition	GetSamplePosition()	const		{ return m_SamplePosition;	}
+	BeatPosition	GetBeatPosition()	const		{ return m_BeatPosition;	}
+
+	double GetSampleTime(unsigned int sampleRate) const { return static_cast<double>(m_SamplePosition) / sampleRate; }
+	double GetBeatTime() const { return static_cast<double>(m_BeatPosition) / BEAT_POSITIONS_PER_SECOND; }
+
+	// Nearest beat position of beatTime seconds, which must not be negative
+	static BeatPosition ToBeatPosition(double beatTime);
 
 private:
-    unsigned int	m_SampleIndex;
-	double			m_SampleTime;
-    double			m_BeatTime;
+	SamplePosition	m_SamplePosition;
+	BeatPosition	m_BeatPosition;
 };
 
 /**
@@ -49,10 +67,12 @@ class AClip
 {
 private:
     AudioInfo               m_AudioInfo;   	    	
+	std::string				m_FilePath;
 
-	// We use warp markers to match a sample time with a beat time, and conversely			
-	std::map<unsigned int,	WarpMarker*>	m_SampleIndexToWarpMarker;
-	std::map<double,		WarpMarker*>	m_BeatTimeToWarpMarker;
+	// We use warp markers to match a sample time with a beat time, and conversely. Both maps
+	// are in the same order, since warp markers can't cross each other.
+	std::map<SamplePosition,	WarpMarker*>	m_SamplePositionToWarpMarker;
+	std::map<BeatPosition,		WarpMarker*>	m_BeatPositionToWarpMarker;
 
 	// When calling SampleToBeatTime or BeatToSampleTime repeatedly over lots of subsequent samples,
 	// we try to cache the last found warp marker so that we don't iterate over
@@ -64,27 +84,38 @@ private:
 	// this points to memory allocated by the user, do not handle its deallocation
 	PeakDetector*           m_PeakDetector;
     std::vector<Peak>       m_Peaks;
+
+	// Fed in the same pass as the peak detector, allocated by the user as well
+	std::vector<FeatureExtractor*>	m_FeatureExtractors;
+
+	// Built while loading the clip's samples, only if m_BuildWaveformOverview is set
+	bool					m_BuildWaveformOverview;
+	WaveformOverview		m_WaveformOverview;
+
+	// Samples kept in memory while loading the clip, in m_ResidentSampleFormat
+	SampleStore::Format		m_ResidentSampleFormat;
+	SampleStore				m_ResidentSamples;
+
+	// Created the first time spectral features are asked for, cleared when the samples change
+	StftFrameCache*			m_StftFrameCache;
 	
 	// When getting the BPM value, we first try to use a cached value
 	// If none is present, then we use our peak detector to approximate it
 	bool					m_BPMCached;
 	double					m_BPMCachedValue;
     	
-	// Returns true if a warp marker which similar sample index already 
-	// exists in this AClip instance
-	bool SampleIndexKeyAlreadyExists(unsigned int sampleIndex) const;
-	
-	// Returns true if a warp marker which similar beat time already 
-	// exists in this AClip instance	
-	bool BeatTimeKeyAlreadyExists(double sampleIndex) const;
-
 	// SampleToBeatTime and BeatToSampleTime both try to find bounding warp markers to 
 	// perform a linear interpolation
-	// They return true if a pair of bounding warp markers could be found, storing them in lowBoundMarker and highBoundMarker    
-	bool FindBoundingWarpMarkersForBeatTime(double beatTime, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker);
-    
-	bool FindBoundingWarpMarkersForSampleIndex(unsigned int sampleIndex, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker);
-	bool FindBoundingWarpMarkersForSampleTime(double sampleTime, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker);
+	// They return true if a pair of bounding warp markers could be found, storing them in lowBoundMarker and highBoundMarker.
+	// The last warp marker bounds the interval before it, so that the whole range covered by
+	// the warp markers, both ends included, can be converted.
+	bool FindBoundingWarpMarkersForSamplePosition(SamplePosition samplePosition, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker) const;
+	bool FindBoundingWarpMarkersForBeatPosition(BeatPosition beatPosition, WarpMarker& lowBoundMarker, WarpMarker& highBoundMarker) const;
+
+	// Linear interpolations between two bounding warp markers, of a sample or beat position
+	// which can have a fractional part. They return times in seconds.
+	double InterpolateSampleTime(double beatPosition, const WarpMarker& lowBoundMarker, const WarpMarker& highBoundMarker) const;
+	static double InterpolateBeatTime(double samplePosition, const WarpMarker& lowBoundMarker, const WarpMarker& highBoundMarker);
 
 	// Returns true if data in warpMarkerToAdd is consistent, false otherwise
 	bool ValidateWarpMarkerForAdd(const WarpMarker& warpMarkerToAdd);
@@ -98,12 +129,24 @@ private:
 	bool GetLastWarpMarker(WarpMarker& outLastWarpMarker) const;
 	
 	bool ComputeBPM(const std::vector<Peak>& peaks, double& outBpmCount) const;
+
+	// Rescans the samples [scanFirstSampleIndex, scanEndSampleIndex) of the clip, given in scanSamples,
+	// and replaces the peaks in [peaksFirstSampleIndex, peaksEndSampleIndex) by the ones found,
+	// see PeakScanner::GetWindowsCoveringRange
+	void ReanalyzeWindows(	const float* scanSamples, unsigned int scanFirstSampleIndex, unsigned int scanEndSampleIndex,
+							unsigned int peaksFirstSampleIndex, unsigned int peaksEndSampleIndex);
+
+	// Forgets the transforms of the previous samples of the clip, if any
+	void ClearStftFrames();
 		
 public:
 
     // ...
     AClip::AClip() 
         :   m_PeakDetector(0),
+			m_BuildWaveformOverview(false),
+			m_ResidentSampleFormat(SampleStore::FORMAT_NONE),
+			m_StftFrameCache(0),
             m_BPMCached(false),
 			m_BPMCachedValue(0.0),
 			m_LowAndHighBoundWarpMarkersCacheIsValid(false)
@@ -112,11 +155,44 @@ public:
 
 	~AClip();
 
-	// Fill internal data structures with content from file
-	// Feeds the peak detector, too. 
+	// Fill internal data structures with content from file, WAV or FLAC, see AudioSource::Open.
+	// Feeds the peak detector, too. Files with several channels are analyzed mixed down to mono.
 	// Returns true if the file could successfully be read, false otherwise
 	// Limitation: filePath must be an absolutePath
     bool LoadDataFromFile(const std::string& filePath);
+
+	// Same as LoadDataFromFile, reading the samples from audioSource block by block. filePath
+	// is the file they are read from, if any.
+	bool LoadDataFromSource(AudioSource& audioSource, const std::string& filePath = std::string());
+
+	// Same as LoadDataFromFile, with samples that were already decoded in memory. 
+	// filePath is the file they were decoded from, if any.
+	bool LoadDataFromSamples(const AudioInfo& audioInfo, const float* samples, const std::string& filePath = std::string());
+
+	// Reuses the audio information and the peaks of a clip loaded from the same source, 
+	// without reading or analyzing anything. Warp markers are not copied.
+	void LoadDataFromClip(const AClip& sourceClip);
+
+	// Restores the audio information, file path, warp markers and peaks saved in a snapshot, 
+	// replacing the current ones and the current waveform overview. Nothing is read from the 
+	// file or analyzed, and the warp markers are added in bulk, without the checks done by 
+	// AddWarpMarker, since they were valid when they were saved.
+	bool LoadDataFromSnapshot(const ClipSnapshot& snapshot);
+
+	// Refreshes the analysis of the clip after the samples in [firstSampleIndex, endSampleIndex) 
+	// were edited, without changing the length of the clip. Only the analysis windows covering 
+	// that range are rescanned and their peaks are spliced into the existing ones, the result 
+	// is the same as reloading the whole clip. The BPM and the waveform overview are updated.
+	// samples are all the samples of the clip, after the edit.
+	bool ReanalyzeRange(const float* samples, unsigned int firstSampleIndex, unsigned int endSampleIndex);
+
+	// Same as ReanalyzeRange, rereading only the samples needed from the file the clip was loaded
+	// from. If the length or the sample rate of the file changed, the whole file is reloaded and
+	// the warp markers are replaced by the default ones.
+	bool ReanalyzeFileRange(unsigned int firstSampleIndex, unsigned int endSampleIndex);
+
+	// Path of the file the clip was loaded from, empty if it wasn't loaded from a file
+	const std::string& GetFilePath() const { return m_FilePath; }
     
     // Convert a position in the sample that is given
     // in beat time to sample time (in seconds).
@@ -125,24 +201,83 @@ public:
     // Convert a position in the sample that is given
     // in sample time (in seconds) to beat time.
     double SampleToBeatTime(double SampleTime);
+
+	// Same conversions as BeatToSampleTime and SampleToBeatTime, but they neither use nor 
+	// update the bounding warp markers cache, so they can be called concurrently.
+	// They return false if no bounding warp markers could be found.
+	bool FindSampleTime(double beatTime, double& outSampleTime) const;
+	bool FindBeatTime(double sampleTime, double& outBeatTime) const;
     
 	// Add default warp markers for beginning and end of clip
     bool AddDefaultWarpMarkers();
 
+	// Deletes all the warp markers of the clip
+	void ClearWarpMarkers();
+
 	// Add a warp marker that matches the sample found at sample time seconds in the clip with
-	// the time at beatTime seconds in the set
+	// the time at beatTime seconds in the set. sampleTime is rounded to the nearest sample, and
+	// beatTime to the nearest beat position.
 	bool AddWarpMarker(double sampleTime, double beatTime);
 
+	// Same as above, with exact positions
+	bool AddWarpMarker(const WarpMarker& warpMarker);
+
+	// Adds a warp marker after all the others, both in sample and in beat order, in amortized
+	// constant time whatever the number of warp markers. Fails if it isn't after all of them.
+	bool AppendWarpMarker(const WarpMarker& warpMarker);
+
+	// Removes the last warp marker, in amortized constant time. The bounding warp markers 
+	// cache is only invalidated if it uses that warp marker.
+	bool RemoveLastWarpMarker();
+
+	// Gets a copy of all the warp markers of the clip, sorted by sample position, which is also
+	// the order of their beat positions
+	void GetWarpMarkers(std::vector<WarpMarker>& outWarpMarkers) const;
+
 	// Set the peak detector instance used to detect onsets in the instance's associated
 	// signal
 	void SetPeakDetector(PeakDetector* peakDetector) { m_PeakDetector = peakDetector; }
 
+	// Adds an extractor fed with the samples of the next loads, in the same pass as the peak
+	// detection, see AnalysisGraph. Clips loaded from samples in memory feed them as a mono
+	// source. Its results are read from the extractor once the clip is loaded.
+	void AddFeatureExtractor(FeatureExtractor* featureExtractor) { m_FeatureExtractors.push_back(featureExtractor); }
+	void ClearFeatureExtractors() { m_FeatureExtractors.clear(); }
+
 	// Get the number of bets per minute in bpmCount, returns true if it managed 
 	// to actually figure it out, false otherwise
 	bool GetBPM(double& bpmCount);       
 	
 	// Get duration of a clip in second
 	double GetDuration() const;
+
+	// Peaks found by the peak detector when loading the clip, sorted by sample index
+	const std::vector<Peak>& GetPeaks() const { return m_Peaks; }
+
+	const AudioInfo& GetAudioInfo() const { return m_AudioInfo; }
+
+	// When set, the next loads also build a waveform overview of the clip, in the same pass
+	// as the peak detection
+	void SetBuildWaveformOverview(bool buildWaveformOverview) { m_BuildWaveformOverview = buildWaveformOverview; }
+
+	// Empty unless SetBuildWaveformOverview(true) was called before loading the clip
+	const WaveformOverview& GetWaveformOverview() const { return m_WaveformOverview; }
+
+	// When set to another format than SampleStore::FORMAT_NONE, the next loads also keep the
+	// samples of the clip, mixed down to mono, in memory in that format, so that they can be
+	// read again without decoding the file. Samples already kept are converted to the new 
+	// format, or released with SampleStore::FORMAT_NONE. Clips loaded from a snapshot have no
+	// samples to keep.
+	void SetResidentSampleFormat(SampleStore::Format format);
+
+	// Empty unless SetResidentSampleFormat was called before loading the clip
+	const SampleStore& GetResidentSamples() const { return m_ResidentSamples; }
+
+	// Short time Fourier transforms of the clip, shared by its spectral features, see
+	// ChromaKeyEstimator and SpectralOnsetDetector. Frames are computed from the resident
+	// samples if the clip keeps them, otherwise from its file, and are forgotten by every load
+	// or reanalysis of the clip.
+	StftFrameCache& GetStftFrameCache();
 };
 
 
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <new>
+
+#include "analysisgraph.h"
+#include "audiosource.h"
+
+AnalysisGraph::AnalysisGraph()
+	:	m_Parallel(true)
+{
+}
+
+bool AnalysisGraph::ReadBlock(AudioSource& audioSource, unsigned int firstFrameIndex, unsigned int nbFrames, unsigned int bufferIndex)
+{
+	const unsigned int nbChannels = audioSource.GetAudioInfo().m_NumChannels;
+	if (nbChannels <= 1)
+	{
+		return audioSource.ReadRange(firstFrameIndex, firstFrameIndex + nbFrames, &m_MonoSamples[bufferIndex][0]);
+	}
+
+	if (!audioSource.ReadRange(firstFrameIndex, firstFrameIndex + nbFrames, &m_InterleavedSamples[bufferIndex][0]))
+	{
+		return false;
+	}
+
+	AudioSource::MixDown(&m_InterleavedSamples[bufferIndex][0], nbFrames, nbChannels, &m_MonoSamples[bufferIndex][0]);
+	return true;
+}
+
+bool AnalysisGraph::Run(AudioSource& audioSource)
+{
+	const AudioInfo audioInfo = audioSource.GetAudioInfo();
+	const int nbExtractors = static_cast<int>(m_Extractors.size());
+	for (int extractorIndex = 0; extractorIndex < nbExtractors; ++extractorIndex)
+	{
+		m_Extractors[extractorIndex]->Reset(audioInfo);
+	}
+
+	// Buffers are sized once, so that nothing is allocated while blocks are processed
+	for (unsigned int bufferIndex = 0; bufferIndex < 2; ++bufferIndex)
+	{
+		m_MonoSamples[bufferIndex].resize(BLOCK_SIZE);
+		if (audioInfo.m_NumChannels > 1)
+		{
+			m_InterleavedSamples[bufferIndex].resize(static_cast<size_t>(BLOCK_SIZE) * audioInfo.m_NumChannels);
+		}
+	}
+
+	const unsigned int nbFrames = audioInfo.m_NbSamples;
+	const unsigned int blockSize = BLOCK_SIZE;
+	unsigned int firstFrameIndex = 0;
+	unsigned int bufferIndex = 0;
+	bool blockRead = !nbFrames || ReadBlock(audioSource, 0, std::min(blockSize, nbFrames), bufferIndex);
+	while (blockRead && firstFrameIndex < nbFrames)
+	{
+		const unsigned int nbBlockFrames = std::min(blockSize, nbFrames - firstFrameIndex);
+		const unsigned int nextFirstFrameIndex = firstFrameIndex + nbBlockFrames;
+		const unsigned int nbNextBlockFrames = std::min(blockSize, nbFrames - nextFirstFrameIndex);
+		const float* monoSamples = &m_MonoSamples[bufferIndex][0];
+		const float* interleavedSamples = audioInfo.m_NumChannels > 1 ? &m_InterleavedSamples[bufferIndex][0] : monoSamples;
+
+		// Task 0 decodes the next block in the other buffers, the other ones run an extractor each.
+		// An exception can't leave a parallel region, running out of memory is rethrown after it.
+		bool nextBlockRead = true;
+		int nbOutOfMemoryTasks = 0;
+		#pragma omp parallel for schedule(dynamic, 1) if (m_Parallel && nbExtractors > 0)
+		for (int taskIndex = 0; taskIndex <= nbExtractors; ++taskIndex)
+		{
+			try
+			{
+				if (taskIndex)
+				{
+					m_Extractors[taskIndex - 1]->Process(interleavedSamples, monoSamples, nbBlockFrames);
+				}
+				else if (nbNextBlockFrames)
+				{
+					nextBlockRead = ReadBlock(audioSource, nextFirstFrameIndex, nbNextBlockFrames, 1 - bufferIndex);
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				#pragma omp atomic
+				++nbOutOfMemoryTasks;
+			}
+		}
+
+		if (nbOutOfMemoryTasks)
+		{
+			throw std::bad_alloc();
+		}
+
+		firstFrameIndex = nextFirstFrameIndex;
+		bufferIndex = 1 - bufferIndex;
+		blockRead = nextBlockRead;
+	}
+
+	for (int extractorIndex = 0; extractorIndex < nbExtractors; ++extractorIndex)
+	{
+		m_Extractors[extractorIndex]->Finish();
+	}
+
+	return firstFrameIndex == nbFrames;
+}
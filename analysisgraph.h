@@ -0,0 +1,72 @@
+#ifndef ANALYSISGRAPH_H_
+#define ANALYSISGRAPH_H_
+
+#include <vector>
+
+#include "audioformats.h"
+
+class AudioSource;
+
+/**
+ *	A FeatureExtractor computes a feature of a clip, like its loudness, from its samples fed
+ *	block by block, in order. Extractors keep their results, and are read once fed.
+ */
+class FeatureExtractor
+{
+public:
+	virtual ~FeatureExtractor() {}
+
+	// Prepares the extractor for the samples of a new source, forgetting the previous one
+	virtual void Reset(const AudioInfo& audioInfo) = 0;
+
+	// Feeds the next nbFrames frames: interleavedSamples holds the samples of all channels,
+	// nbFrames * m_NumChannels values, and monoSamples the same frames mixed down to mono.
+	// Both are the same buffer for mono sources.
+	virtual void Process(const float* interleavedSamples, const float* monoSamples, unsigned int nbFrames) = 0;
+
+	// Called once all the frames have been fed
+	virtual void Finish() = 0;
+};
+
+/**
+ *	An AnalysisGraph reads a source once and feeds each block it reads to any number of
+ *	extractors, so that extracting N features costs a single decode instead of N.
+ *	Blocks are decoded and mixed down once for all extractors. While the extractors process a
+ *	block, on as many threads as OpenMP gives, the next block is decoded. Each extractor
+ *	still gets all the blocks in order, from one thread at a time, so its results don't
+ *	depend on the number of threads.
+ */
+class AnalysisGraph
+{
+public:
+	static const unsigned int BLOCK_SIZE = 16384;
+
+	AnalysisGraph();
+
+	// Adds an extractor fed by the next runs. It isn't owned by the graph.
+	void AddExtractor(FeatureExtractor* featureExtractor) { m_Extractors.push_back(featureExtractor); }
+	void ClearExtractors() { m_Extractors.clear(); }
+	size_t GetNbExtractors() const { return m_Extractors.size(); }
+
+	// When not set, blocks are decoded and extractors run one after the other, on the calling thread
+	void SetParallel(bool parallel) { m_Parallel = parallel; }
+
+	// Resets the extractors, feeds them all the samples of audioSource and finishes them.
+	// Returns false if the source couldn't be read up to its end, in which case the extractors
+	// are finished with the samples read so far. Throws std::bad_alloc on the calling thread if
+	// the source or an extractor ran out of memory, the extractors aren't finished then.
+	bool Run(AudioSource& audioSource);
+
+private:
+	std::vector<FeatureExtractor*>	m_Extractors;
+	bool							m_Parallel;
+
+	// Blocks being processed and decoded, see Run
+	std::vector<float>				m_InterleavedSamples[2];
+	std::vector<float>				m_MonoSamples[2];
+
+	// Decodes nbFrames frames starting at firstFrameIndex in the buffers at bufferIndex
+	bool ReadBlock(AudioSource& audioSource, unsigned int firstFrameIndex, unsigned int nbFrames, unsigned int bufferIndex);
+};
+
+#endif // ANALYSISGRAPH_H_
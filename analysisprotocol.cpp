@@ -0,0 +1,120 @@
+#include <cstring>
+
+#include "analysisprotocol.h"
+
+void MessageWriter::WriteUInt8(unsigned int value)
+{
+	m_Bytes.push_back(static_cast<char>(value));
+}
+
+void MessageWriter::WriteUInt16(unsigned int value)
+{
+	m_Bytes.push_back(static_cast<char>(value));
+	m_Bytes.push_back(static_cast<char>(value >> 8));
+}
+
+void MessageWriter::WriteUInt32(unsigned int value)
+{
+	for (unsigned int byteIndex = 0; byteIndex < 4; ++byteIndex)
+	{
+		m_Bytes.push_back(static_cast<char>(value >> (byteIndex * 8)));
+	}
+}
+
+void MessageWriter::WriteDouble(double value)
+{
+	unsigned long long bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	for (unsigned int byteIndex = 0; byteIndex < 8; ++byteIndex)
+	{
+		m_Bytes.push_back(static_cast<char>(bits >> (byteIndex * 8)));
+	}
+}
+
+void MessageWriter::WriteString(const std::string& value)
+{
+	// Longer strings are truncated, no path is that long
+	size_t length = value.length() < 0xFFFF ? value.length() : 0xFFFF;
+	WriteUInt16(static_cast<unsigned int>(length));
+	m_Bytes.insert(m_Bytes.end(), value.begin(), value.begin() + length);
+}
+
+bool MessageReader::ReadBytes(size_t nbBytes, unsigned long long& outValue)
+{
+	if (m_Size - m_Offset < nbBytes)
+	{
+		return false;
+	}
+
+	outValue = 0;
+	for (size_t byteIndex = 0; byteIndex < nbBytes; ++byteIndex)
+	{
+		outValue |= static_cast<unsigned long long>(static_cast<unsigned char>(m_Bytes[m_Offset + byteIndex])) << (byteIndex * 8);
+	}
+
+	m_Offset += nbBytes;
+	return true;
+}
+
+bool MessageReader::ReadUInt8(unsigned int& outValue)
+{
+	unsigned long long value = 0;
+	if (!ReadBytes(1, value))
+	{
+		return false;
+	}
+
+	outValue = static_cast<unsigned int>(value);
+	return true;
+}
+
+bool MessageReader::ReadUInt16(unsigned int& outValue)
+{
+	unsigned long long value = 0;
+	if (!ReadBytes(2, value))
+	{
+		return false;
+	}
+
+	outValue = static_cast<unsigned int>(value);
+	return true;
+}
+
+bool MessageReader::ReadUInt32(unsigned int& outValue)
+{
+	unsigned long long value = 0;
+	if (!ReadBytes(4, value))
+	{
+		return false;
+	}
+
+	outValue = static_cast<unsigned int>(value);
+	return true;
+}
+
+bool MessageReader::ReadDouble(double& outValue)
+{
+	unsigned long long bits = 0;
+	if (!ReadBytes(8, bits))
+	{
+		return false;
+	}
+
+	memcpy(&outValue, &bits, sizeof(outValue));
+	return true;
+}
+
+bool MessageReader::ReadString(std::string& outValue)
+{
+	size_t offset = m_Offset;
+	unsigned int length = 0;
+	if (!ReadUInt16(length) || GetRemainingSize() < length)
+	{
+		m_Offset = offset;
+		return false;
+	}
+
+	outValue.assign(m_Bytes + m_Offset, length);
+	m_Offset += length;
+	return true;
+}
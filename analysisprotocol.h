@@ -0,0 +1,109 @@
+#ifndef ANALYSISPROTOCOL_H_
+#define ANALYSISPROTOCOL_H_
+
+#include <string>
+#include <vector>
+
+/**
+ *	Binary protocol spoken between the analysis daemon and its clients, see AnalysisService.
+ *	Each message is sent as its size in bytes, on 4 bytes, followed by its content. Integers
+ *	and doubles are little endian, strings are their length on 2 bytes followed by their
+ *	characters. A client sends a request and waits for its response before sending the next
+ *	one on the same connection.
+ *
+ *	Requests start with their type on 1 byte, responses with their status on 1 byte; unless
+ *	the status is STATUS_OK, nothing follows it. Then:
+ *	 - REQUEST_ANALYZE: file path, detector parameters (see below), 1 byte set to 1 to get the
+ *	   peaks. Response: sample rate (u32), number of samples (u32), duration (double), BPM
+ *	   (double, 0 if it couldn't be found), number of peaks (u32), then if they were asked for,
+ *	   the sample index of each peak (u32).
+ *	 - REQUEST_GET_BPM: file path, detector parameters. Response: BPM (double), or
+ *	   STATUS_NO_BPM.
+ *	 - REQUEST_CONVERT_TIMES: file path, direction (u8, see Direction), number of warp markers
+ *	   added to the default ones (u32), each as a sample time and a beat time in seconds
+ *	   (doubles), number of times (u32), the times (doubles). Response: number of times (u32),
+ *	   the converted times (doubles), negative where a time is outside of the clip.
+ *	 - REQUEST_SHUTDOWN: nothing. Response: nothing. The daemon stops accepting connections.
+ *	Detector parameters are a byte set to 0 for the default parameters, or to 1 followed by
+ *	the low pass frequency, the release time, the trigger on and off thresholds (doubles) and
+ *	the decimation factor (u32), see SimplePeakDetector::Parameters.
+ */
+class AnalysisProtocol
+{
+public:
+	// Messages bigger than this are rejected
+	static const unsigned int MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+	enum RequestType
+	{
+		REQUEST_ANALYZE			= 1,
+		REQUEST_GET_BPM			= 2,
+		REQUEST_CONVERT_TIMES	= 3,
+		REQUEST_SHUTDOWN		= 4
+	};
+
+	enum Status
+	{
+		STATUS_OK				= 0,
+		STATUS_INVALID_REQUEST	= 1,	// Unknown type, truncated request or invalid parameters
+		STATUS_FILE_ERROR		= 2,	// The file couldn't be read or analyzed
+		STATUS_NO_BPM			= 3,
+		STATUS_WARP_ERROR		= 4		// A warp marker couldn't be added
+	};
+
+	enum Direction
+	{
+		BEAT_TO_SAMPLE_TIME		= 0,
+		SAMPLE_TO_BEAT_TIME		= 1
+	};
+};
+
+/**
+ *	Appends the fields of a message to a buffer, in the encoding of AnalysisProtocol
+ */
+class MessageWriter
+{
+private:
+	std::vector<char>&	m_Bytes;
+
+	MessageWriter& operator=(const MessageWriter&);
+
+public:
+	// Clears bytes, and writes the next fields to it
+	explicit MessageWriter(std::vector<char>& bytes) : m_Bytes(bytes) { m_Bytes.clear(); }
+
+	void WriteUInt8(unsigned int value);
+	void WriteUInt16(unsigned int value);
+	void WriteUInt32(unsigned int value);
+	void WriteDouble(double value);
+	void WriteString(const std::string& value);
+};
+
+/**
+ *	Reads the fields of a message one after the other. Each Read method returns false, and
+ *	leaves its output unchanged, if the message ends before the field does.
+ */
+class MessageReader
+{
+private:
+	const char*	m_Bytes;
+	size_t		m_Size;
+	size_t		m_Offset;
+
+	bool ReadBytes(size_t nbBytes, unsigned long long& outValue);
+
+public:
+	MessageReader(const char* bytes, size_t size) : m_Bytes(bytes), m_Size(size), m_Offset(0) {}
+	explicit MessageReader(const std::vector<char>& bytes) : m_Bytes(bytes.empty() ? 0 : &bytes[0]), m_Size(bytes.size()), m_Offset(0) {}
+
+	bool ReadUInt8(unsigned int& outValue);
+	bool ReadUInt16(unsigned int& outValue);
+	bool ReadUInt32(unsigned int& outValue);
+	bool ReadDouble(double& outValue);
+	bool ReadString(std::string& outValue);
+
+	// Number of bytes left to read
+	size_t GetRemainingSize() const { return m_Size - m_Offset; }
+};
+
+#endif // ANALYSISPROTOCOL_H_
@@ -0,0 +1,412 @@
+#include <cassert>
+
+#include "analysisservice.h"
+#include "analysisprotocol.h"
+#include "audiosource.h"
+#include "session.h"
+#include "Clip.h"
+
+bool AnalysisService::AnalysisKey::operator<(const AnalysisKey& other) const
+{
+	if (m_FileKey != other.m_FileKey)
+	{
+		return m_FileKey < other.m_FileKey;
+	}
+
+	// Parameters are compared field by field, in the order of their declaration
+	const SimplePeakDetector::Parameters& parameters = m_Parameters;
+	const SimplePeakDetector::Parameters& otherParameters = other.m_Parameters;
+	if (parameters.m_LowPassFrequency != otherParameters.m_LowPassFrequency)		return parameters.m_LowPassFrequency < otherParameters.m_LowPassFrequency;
+	if (parameters.m_ReleaseTime != otherParameters.m_ReleaseTime)					return parameters.m_ReleaseTime < otherParameters.m_ReleaseTime;
+	if (parameters.m_TriggerOnThreshold != otherParameters.m_TriggerOnThreshold)	return parameters.m_TriggerOnThreshold < otherParameters.m_TriggerOnThreshold;
+	if (parameters.m_TriggerOffThreshold != otherParameters.m_TriggerOffThreshold)	return parameters.m_TriggerOffThreshold < otherParameters.m_TriggerOffThreshold;
+	if (parameters.m_Arithmetic != otherParameters.m_Arithmetic)					return parameters.m_Arithmetic < otherParameters.m_Arithmetic;
+	return parameters.m_DecimationFactor < otherParameters.m_DecimationFactor;
+}
+
+AnalysisService::AnalysisService(size_t decodedAudioBudget, size_t maxNbAnalyses)
+	:	m_MaxNbAnalyses(maxNbAnalyses),
+		m_DecodedAudioCache(decodedAudioBudget),
+		m_ShutdownRequested(false)
+{
+}
+
+AnalysisService::~AnalysisService()
+{
+	Analyses::iterator itAnalyses = m_Analyses.begin();
+	Analyses::iterator itAnalysesEnd = m_Analyses.end();
+	for (; itAnalyses != itAnalysesEnd; ++itAnalyses)
+	{
+		delete itAnalyses->second.m_Clip;
+		itAnalyses->second.m_Clip = 0;
+	}
+}
+
+size_t AnalysisService::GetNbAnalyses() const
+{
+	size_t nbAnalyses = 0;
+	#pragma omp critical (AnalysisServiceAnalyses)
+	nbAnalyses = m_Analyses.size();
+	return nbAnalyses;
+}
+
+size_t AnalysisService::GetDecodedAudioSize() const
+{
+	size_t size = 0;
+	#pragma omp critical (AnalysisServiceDecodedAudio)
+	size = m_DecodedAudioCache.GetSize();
+	return size;
+}
+
+const AnalysisService::Analysis* AnalysisService::AcquireAnalysis(const AnalysisKey& key)
+{
+	const Analysis* analysis = 0;
+	#pragma omp critical (AnalysisServiceAnalyses)
+	{
+		Analyses::iterator itAnalysis = m_Analyses.find(key);
+		if (itAnalysis != m_Analyses.end())
+		{
+			// Move the analysis at the most recently used end of the list
+			m_LeastRecentlyUsed.splice(m_LeastRecentlyUsed.end(), m_LeastRecentlyUsed, itAnalysis->second.m_ItLeastRecentlyUsed);
+			++itAnalysis->second.m_NbAcquisitions;
+			analysis = &itAnalysis->second;
+		}
+	}
+
+	if (analysis)
+	{
+		return analysis;
+	}
+
+	// Decode the file, unless its samples are still in the cache
+	const DecodedAudio* decodedAudio = 0;
+	#pragma omp critical (AnalysisServiceDecodedAudio)
+	{
+		if (m_DecodedAudioCache.Contains(key.m_FileKey))
+		{
+			decodedAudio = m_DecodedAudioCache.Acquire(key.m_FileKey);
+		}
+	}
+
+	if (!decodedAudio)
+	{
+		DecodedAudio* newDecodedAudio = new DecodedAudio;
+		newDecodedAudio->m_FilePath = key.m_FileKey;
+		if (!AudioSource::ReadFile(key.m_FileKey, newDecodedAudio->m_AudioInfo, newDecodedAudio->m_Samples))
+		{
+			delete newDecodedAudio;
+			return 0;
+		}
+
+		#pragma omp critical (AnalysisServiceDecodedAudio)
+		decodedAudio = m_DecodedAudioCache.Add(newDecodedAudio);
+	}
+
+	// Each analysis has its own detector, detectors keep state while they run
+	SimplePeakDetector peakDetector(key.m_Parameters);
+	Analysis newAnalysis;
+	newAnalysis.m_Clip		= new AClip;
+	newAnalysis.m_HasBPM	= false;
+	newAnalysis.m_BPM		= 0.0;
+	newAnalysis.m_NbAcquisitions = 1;
+
+	newAnalysis.m_Clip->SetPeakDetector(&peakDetector);
+	bool analyzed = newAnalysis.m_Clip->LoadDataFromSamples(decodedAudio->m_AudioInfo,
+															decodedAudio->m_Samples.empty() ? 0 : &decodedAudio->m_Samples[0],
+															key.m_FileKey) &&
+					newAnalysis.m_Clip->AddDefaultWarpMarkers();
+	newAnalysis.m_HasBPM = analyzed && newAnalysis.m_Clip->GetBPM(newAnalysis.m_BPM);
+	newAnalysis.m_Clip->SetPeakDetector(0);
+
+	#pragma omp critical (AnalysisServiceDecodedAudio)
+	m_DecodedAudioCache.Release(decodedAudio);
+
+	if (!analyzed)
+	{
+		delete newAnalysis.m_Clip;
+		return 0;
+	}
+
+	bool inserted = false;
+	#pragma omp critical (AnalysisServiceAnalyses)
+	{
+		std::pair<Analyses::iterator, bool> insertion = m_Analyses.insert(std::make_pair(key, newAnalysis));
+		inserted = insertion.second;
+
+		Analysis& insertedAnalysis = insertion.first->second;
+		if (inserted)
+		{
+			insertedAnalysis.m_ItLeastRecentlyUsed = m_LeastRecentlyUsed.insert(m_LeastRecentlyUsed.end(), key);
+			EvictAnalysesUntilWithinBudget();
+		}
+		else
+		{
+			m_LeastRecentlyUsed.splice(m_LeastRecentlyUsed.end(), m_LeastRecentlyUsed, insertedAnalysis.m_ItLeastRecentlyUsed);
+			++insertedAnalysis.m_NbAcquisitions;
+		}
+
+		analysis = &insertedAnalysis;
+	}
+
+	if (!inserted)
+	{
+		// Another thread analyzed the file meanwhile
+		delete newAnalysis.m_Clip;
+	}
+
+	return analysis;
+}
+
+void AnalysisService::ReleaseAnalysis(const AnalysisKey& key)
+{
+	#pragma omp critical (AnalysisServiceAnalyses)
+	{
+		Analyses::iterator itAnalysis = m_Analyses.find(key);
+		assert(itAnalysis != m_Analyses.end() && itAnalysis->second.m_NbAcquisitions);
+		if (itAnalysis != m_Analyses.end() && itAnalysis->second.m_NbAcquisitions)
+		{
+			--itAnalysis->second.m_NbAcquisitions;
+
+			// There may have been too many analyses because this one was in use
+			EvictAnalysesUntilWithinBudget();
+		}
+	}
+}
+
+void AnalysisService::EvictAnalysesUntilWithinBudget()
+{
+	std::list<AnalysisKey>::iterator itLeastRecentlyUsed = m_LeastRecentlyUsed.begin();
+	while (m_Analyses.size() > m_MaxNbAnalyses && itLeastRecentlyUsed != m_LeastRecentlyUsed.end())
+	{
+		Analyses::iterator itAnalysis = m_Analyses.find(*itLeastRecentlyUsed);
+		assert(itAnalysis != m_Analyses.end());
+
+		if (itAnalysis->second.m_NbAcquisitions)
+		{
+			// Being read, try the next least recently used analysis
+			++itLeastRecentlyUsed;
+			continue;
+		}
+
+		delete itAnalysis->second.m_Clip;
+		m_Analyses.erase(itAnalysis);
+		itLeastRecentlyUsed = m_LeastRecentlyUsed.erase(itLeastRecentlyUsed);
+	}
+}
+
+bool AnalysisService::ReadAnalysisKey(MessageReader& request, AnalysisKey& outKey)
+{
+	std::string filePath;
+	unsigned int hasParameters = 0;
+	if (!request.ReadString(filePath) || filePath.empty() || !request.ReadUInt8(hasParameters))
+	{
+		return false;
+	}
+
+	outKey.m_FileKey = Session::GetSourceFileKey(filePath);
+	outKey.m_Parameters = SimplePeakDetector::Parameters();
+	if (hasParameters)
+	{
+		SimplePeakDetector::Parameters& parameters = outKey.m_Parameters;
+		if (!request.ReadDouble(parameters.m_LowPassFrequency) ||
+			!request.ReadDouble(parameters.m_ReleaseTime) ||
+			!request.ReadDouble(parameters.m_TriggerOnThreshold) ||
+			!request.ReadDouble(parameters.m_TriggerOffThreshold) ||
+			!request.ReadUInt32(parameters.m_DecimationFactor))
+		{
+			return false;
+		}
+	}
+
+	return outKey.m_Parameters.IsValid();
+}
+
+void AnalysisService::HandleRequest(const std::vector<char>& request, std::vector<char>& outResponse)
+{
+	MessageReader requestReader(request);
+	unsigned int requestType = 0;
+	if (!requestReader.ReadUInt8(requestType))
+	{
+		requestType = 0;
+	}
+
+	switch (requestType)
+	{
+	case AnalysisProtocol::REQUEST_ANALYZE:
+		HandleAnalyze(requestReader, outResponse);
+		break;
+
+	case AnalysisProtocol::REQUEST_GET_BPM:
+		HandleGetBPM(requestReader, outResponse);
+		break;
+
+	case AnalysisProtocol::REQUEST_CONVERT_TIMES:
+		HandleConvertTimes(requestReader, outResponse);
+		break;
+
+	case AnalysisProtocol::REQUEST_SHUTDOWN:
+		m_ShutdownRequested = true;
+		MessageWriter(outResponse).WriteUInt8(AnalysisProtocol::STATUS_OK);
+		break;
+
+	default:
+		MessageWriter(outResponse).WriteUInt8(AnalysisProtocol::STATUS_INVALID_REQUEST);
+		break;
+	}
+}
+
+void AnalysisService::HandleAnalyze(MessageReader& request, std::vector<char>& outResponse)
+{
+	MessageWriter response(outResponse);
+
+	AnalysisKey key;
+	unsigned int withPeaks = 0;
+	if (!ReadAnalysisKey(request, key) || !request.ReadUInt8(withPeaks) || request.GetRemainingSize())
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_INVALID_REQUEST);
+		return;
+	}
+
+	const Analysis* analysis = AcquireAnalysis(key);
+	if (!analysis)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_FILE_ERROR);
+		return;
+	}
+
+	const AudioInfo& audioInfo = analysis->m_Clip->GetAudioInfo();
+	const std::vector<Peak>& peaks = analysis->m_Clip->GetPeaks();
+	response.WriteUInt8(AnalysisProtocol::STATUS_OK);
+	response.WriteUInt32(audioInfo.m_SampleRate);
+	response.WriteUInt32(audioInfo.m_NbSamples);
+	response.WriteDouble(analysis->m_Clip->GetDuration());
+	response.WriteDouble(analysis->m_HasBPM ? analysis->m_BPM : 0.0);
+	response.WriteUInt32(static_cast<unsigned int>(peaks.size()));
+	if (withPeaks)
+	{
+		outResponse.reserve(outResponse.size() + peaks.size() * 4);
+		for (size_t peakIndex = 0; peakIndex < peaks.size(); ++peakIndex)
+		{
+			response.WriteUInt32(peaks[peakIndex].GetPeakSampleIndex());
+		}
+	}
+
+	ReleaseAnalysis(key);
+}
+
+void AnalysisService::HandleGetBPM(MessageReader& request, std::vector<char>& outResponse)
+{
+	MessageWriter response(outResponse);
+
+	AnalysisKey key;
+	if (!ReadAnalysisKey(request, key) || request.GetRemainingSize())
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_INVALID_REQUEST);
+		return;
+	}
+
+	const Analysis* analysis = AcquireAnalysis(key);
+	if (!analysis)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_FILE_ERROR);
+		return;
+	}
+
+	if (analysis->m_HasBPM)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_OK);
+		response.WriteDouble(analysis->m_BPM);
+	}
+	else
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_NO_BPM);
+	}
+
+	ReleaseAnalysis(key);
+}
+
+void AnalysisService::HandleConvertTimes(MessageReader& request, std::vector<char>& outResponse)
+{
+	MessageWriter response(outResponse);
+
+	// Conversions don't depend on the detector, any analysis of the file will do
+	std::string filePath;
+	unsigned int direction = 0;
+	unsigned int nbWarpMarkers = 0;
+	if (!request.ReadString(filePath) || filePath.empty() || !request.ReadUInt8(direction) ||
+		direction > AnalysisProtocol::SAMPLE_TO_BEAT_TIME || !request.ReadUInt32(nbWarpMarkers) ||
+		request.GetRemainingSize() / 16 < nbWarpMarkers)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_INVALID_REQUEST);
+		return;
+	}
+
+	std::vector<double> warpMarkerTimes(nbWarpMarkers * 2);
+	for (size_t timeIndex = 0; timeIndex < warpMarkerTimes.size(); ++timeIndex)
+	{
+		request.ReadDouble(warpMarkerTimes[timeIndex]);
+	}
+
+	unsigned int nbTimes = 0;
+	if (!request.ReadUInt32(nbTimes) || request.GetRemainingSize() != static_cast<size_t>(nbTimes) * 8)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_INVALID_REQUEST);
+		return;
+	}
+
+	AnalysisKey key;
+	key.m_FileKey = Session::GetSourceFileKey(filePath);
+	const Analysis* analysis = AcquireAnalysis(key);
+	if (!analysis)
+	{
+		response.WriteUInt8(AnalysisProtocol::STATUS_FILE_ERROR);
+		return;
+	}
+
+	// The analyzed clip is shared, warp markers are added to a copy of it, which doesn't need
+	// the analysis anymore
+	const AClip* clip = analysis->m_Clip;
+	AClip warpedClip;
+	if (nbWarpMarkers)
+	{
+		warpedClip.LoadDataFromClip(*analysis->m_Clip);
+		ReleaseAnalysis(key);
+		analysis = 0;
+		clip = &warpedClip;
+
+		if (!warpedClip.AddDefaultWarpMarkers())
+		{
+			response.WriteUInt8(AnalysisProtocol::STATUS_WARP_ERROR);
+			return;
+		}
+
+		for (unsigned int warpMarkerIndex = 0; warpMarkerIndex < nbWarpMarkers; ++warpMarkerIndex)
+		{
+			if (!warpedClip.AddWarpMarker(warpMarkerTimes[warpMarkerIndex * 2], warpMarkerTimes[warpMarkerIndex * 2 + 1]))
+			{
+				response.WriteUInt8(AnalysisProtocol::STATUS_WARP_ERROR);
+				return;
+			}
+		}
+	}
+
+	response.WriteUInt8(AnalysisProtocol::STATUS_OK);
+	response.WriteUInt32(nbTimes);
+	outResponse.reserve(outResponse.size() + static_cast<size_t>(nbTimes) * 8);
+	for (unsigned int timeIndex = 0; timeIndex < nbTimes; ++timeIndex)
+	{
+		double time = 0.0;
+		request.ReadDouble(time);
+
+		double convertedTime = -1.0;
+		bool converted =	direction == AnalysisProtocol::BEAT_TO_SAMPLE_TIME ?
+							clip->FindSampleTime(time, convertedTime) :
+							clip->FindBeatTime(time, convertedTime);
+		response.WriteDouble(converted ? convertedTime : -1.0);
+	}
+
+	if (analysis)
+	{
+		ReleaseAnalysis(key);
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef ANALYSISSERVICE_H_
+#define ANALYSISSERVICE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+
+#include "decodedaudiocache.h"
+#include "simplepeakdetector.h"
+
+class AClip;
+class MessageReader;
+
+/**
+ *	An AnalysisService answers the requests of AnalysisProtocol, keeping what it computes for
+ *	the next ones: each file is analyzed once per set of detector parameters, and the clips
+ *	it gives are kept, with their BPM, up to a number of analyses. Beyond it, the least 
+ *	recently used ones that no request is reading are evicted first. Decoded samples are
+ *	kept in a DecodedAudioCache, within a budget, so that analyzing a file again with other
+ *	parameters doesn't decode it again.
+ *	Requests can be handled by any number of threads at the same time. Files are decoded and
+ *	analyzed outside of any lock, so two threads asking for the same analysis at the same
+ *	time may both compute it, the first one done is kept.
+ */
+class AnalysisService
+{
+private:
+	// A file analyzed with given detector parameters
+	struct AnalysisKey
+	{
+		std::string						m_FileKey;		// See Session::GetSourceFileKey
+		SimplePeakDetector::Parameters	m_Parameters;
+
+		bool operator<(const AnalysisKey& other) const;
+	};
+
+	// The clip and its BPM are never modified once added, so that they can be read without
+	// locking while the analysis is acquired
+	struct Analysis
+	{
+		AClip*	m_Clip;			// With its default warp markers
+		bool	m_HasBPM;
+		double	m_BPM;
+
+		unsigned int						m_NbAcquisitions;
+		std::list<AnalysisKey>::iterator	m_ItLeastRecentlyUsed;
+	};
+
+	typedef std::map<AnalysisKey, Analysis> Analyses;
+
+	size_t					m_MaxNbAnalyses;
+	Analyses				m_Analyses;
+	DecodedAudioCache		m_DecodedAudioCache;
+	volatile bool			m_ShutdownRequested;
+
+	// Keys of m_Analyses, least recently used first
+	std::list<AnalysisKey>	m_LeastRecentlyUsed;
+
+	// Returns the analysis of a file, analyzing it if needed, or 0 if it can't be analyzed.
+	// Every analysis returned must be released once the request is done reading it.
+	const Analysis* AcquireAnalysis(const AnalysisKey& key);
+	void ReleaseAnalysis(const AnalysisKey& key);
+
+	// Must be called in the AnalysisServiceAnalyses critical section
+	void EvictAnalysesUntilWithinBudget();
+
+	// Reads the file path and detector parameters of a request
+	static bool ReadAnalysisKey(MessageReader& request, AnalysisKey& outKey);
+
+	void HandleAnalyze(MessageReader& request, std::vector<char>& outResponse);
+	void HandleGetBPM(MessageReader& request, std::vector<char>& outResponse);
+	void HandleConvertTimes(MessageReader& request, std::vector<char>& outResponse);
+
+	// Analyses own their clips, the service can't be copied
+	AnalysisService(const AnalysisService&);
+	AnalysisService& operator=(const AnalysisService&);
+
+public:
+	// decodedAudioBudget is the maximum number of bytes of decoded samples kept in memory, 
+	// maxNbAnalyses the maximum number of analyses
+	AnalysisService(size_t decodedAudioBudget, size_t maxNbAnalyses);
+	~AnalysisService();
+
+	// Handles the request message, and writes the response message in outResponse
+	void HandleRequest(const std::vector<char>& request, std::vector<char>& outResponse);
+
+	// True once a REQUEST_SHUTDOWN was handled
+	bool IsShutdownRequested() const { return m_ShutdownRequested; }
+
+	// Number of analyses kept, and number of bytes of decoded samples
+	size_t GetNbAnalyses() const;
+	size_t GetDecodedAudioSize() const;
+};
+
+#endif // ANALYSISSERVICE_H_
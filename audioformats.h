@@ -1,6 +1,13 @@
 #ifndef AUDIOFORMATS_H_
 #define AUDIOFORMATS_H_
 
+// Position of a sample in a clip. 32 bits only cover about 27 hours at 44.1 kHz, which is
+// not enough for archived long-form recordings.
+typedef unsigned long long SamplePosition;
+
+// Position of a byte in a file. Compressed files can also be larger than 4 GB.
+typedef unsigned long long ByteOffset;
+
 /**
  * AudioInfo instances store informations related to the actual sound data associated to 
  * instances of AClip, such as:
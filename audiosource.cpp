@@ -0,0 +1,141 @@
+#include <fstream>
+#include <algorithm>
+
+#include "audiosource.h"
+#include "wavaudiosource.h"
+#include "flacaudiosource.h"
+
+// Number of samples ReadFileChannels decodes at once, before splitting their channels
+#define READ_FILE_BLOCK_SIZE 65536
+
+bool AudioSource::ReadMonoRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+{
+	const unsigned int nbChannels = GetAudioInfo().m_NumChannels;
+	if (nbChannels <= 1)
+	{
+		return ReadRange(firstSampleIndex, endSampleIndex, outSamples);
+	}
+
+	if (firstSampleIndex >= endSampleIndex)
+	{
+		return false;
+	}
+
+	m_InterleavedSamples.resize(static_cast<size_t>(endSampleIndex - firstSampleIndex) * nbChannels);
+	if (!ReadRange(firstSampleIndex, endSampleIndex, &m_InterleavedSamples[0]))
+	{
+		return false;
+	}
+
+	MixDown(&m_InterleavedSamples[0], endSampleIndex - firstSampleIndex, nbChannels, outSamples);
+	return true;
+}
+
+void AudioSource::MixDown(const float* interleavedSamples, unsigned int nbFrames, unsigned int nbChannels, float* outSamples)
+{
+	const float scale = 1.0f / nbChannels;
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		float sum = 0.0f;
+		for (unsigned int channelIndex = 0; channelIndex < nbChannels; ++channelIndex)
+		{
+			sum += *interleavedSamples++;
+		}
+
+		outSamples[frameIndex] = sum * scale;
+	}
+}
+
+AudioSource* AudioSource::Open(const std::string& filePath)
+{
+	std::ifstream inputStream(filePath.c_str(), std::ifstream::in | std::ios::binary);
+	if (!inputStream)
+	{
+		return 0;
+	}
+
+	// Formats are recognized from their content, not from the extension of the file
+	bool isFlacFile = FlacAudioSource::IsFlacStream(inputStream);
+	inputStream.close();
+
+	if (isFlacFile)
+	{
+		FlacAudioSource* flacAudioSource = new FlacAudioSource;
+		if (!flacAudioSource->Open(filePath))
+		{
+			delete flacAudioSource;
+			return 0;
+		}
+
+		return flacAudioSource;
+	}
+
+	WavAudioSource* wavAudioSource = new WavAudioSource;
+	if (!wavAudioSource->Open(filePath))
+	{
+		delete wavAudioSource;
+		return 0;
+	}
+
+	return wavAudioSource;
+}
+
+bool AudioSource::ReadFile(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples)
+{
+	AudioSource* audioSource = Open(filePath);
+	if (!audioSource)
+	{
+		return false;
+	}
+
+	outAudioInfo = audioSource->GetAudioInfo();
+	outSamples.resize(outAudioInfo.m_NbSamples);
+
+	bool samplesRead = !outAudioInfo.m_NbSamples || audioSource->ReadMonoRange(0, outAudioInfo.m_NbSamples, &outSamples[0]);
+	delete audioSource;
+
+	return samplesRead;
+}
+
+bool AudioSource::ReadFileChannels(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples)
+{
+	AudioSource* audioSource = Open(filePath);
+	if (!audioSource)
+	{
+		return false;
+	}
+
+	outAudioInfo = audioSource->GetAudioInfo();
+	const unsigned int nbSamples = outAudioInfo.m_NbSamples;
+	const unsigned int nbChannels = outAudioInfo.m_NumChannels;
+	outSamples.resize(static_cast<size_t>(nbSamples) * nbChannels);
+
+	bool samplesRead = true;
+	if (nbChannels == 1)
+	{
+		samplesRead = !nbSamples || audioSource->ReadRange(0, nbSamples, &outSamples[0]);
+	}
+	else
+	{
+		std::vector<float> interleavedSamples(static_cast<size_t>(std::min(nbSamples, static_cast<unsigned int>(READ_FILE_BLOCK_SIZE))) * nbChannels);
+		for (unsigned int firstSampleIndex = 0; samplesRead && firstSampleIndex < nbSamples; firstSampleIndex += READ_FILE_BLOCK_SIZE)
+		{
+			const unsigned int nbBlockSamples = std::min(nbSamples - firstSampleIndex, static_cast<unsigned int>(READ_FILE_BLOCK_SIZE));
+			samplesRead = audioSource->ReadRange(firstSampleIndex, firstSampleIndex + nbBlockSamples, &interleavedSamples[0]);
+
+			for (unsigned int channelIndex = 0; samplesRead && channelIndex < nbChannels; ++channelIndex)
+			{
+				const float* interleavedSample = &interleavedSamples[channelIndex];
+				float* channelSamples = &outSamples[static_cast<size_t>(channelIndex) * nbSamples + firstSampleIndex];
+				for (unsigned int sampleIndex = 0; sampleIndex < nbBlockSamples; ++sampleIndex, interleavedSample += nbChannels)
+				{
+					channelSamples[sampleIndex] = *interleavedSample;
+				}
+			}
+		}
+	}
+
+	delete audioSource;
+
+	return samplesRead;
+}
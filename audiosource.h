@@ -0,0 +1,51 @@
+#ifndef AUDIOSOURCE_H_
+#define AUDIOSOURCE_H_
+
+#include <string>
+#include <vector>
+
+#include "audioformats.h"
+
+/**
+ *	An AudioSource gives random access to the samples of an audio file: any range of samples
+ *	can be decoded without decoding what comes before it, in a time proportional to the length
+ *	of the range. Samples of all channels are interleaved, as in the file.
+ *	Each backend finds the position of a sample its own way: uncompressed formats compute it,
+ *	compressed ones look it up in a SeekTable.
+ */
+class AudioSource
+{
+private:
+	std::vector<float>	m_InterleavedSamples;
+
+public:
+	virtual ~AudioSource() {}
+
+	virtual const AudioInfo& GetAudioInfo() const = 0;
+
+	// Decodes the samples [firstSampleIndex, endSampleIndex) in outSamples, which must have room
+	// for (endSampleIndex - firstSampleIndex) * m_NumChannels values.
+	// Returns false if the range is empty, goes past the end of the source, or can't be read.
+	virtual bool ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples) = 0;
+
+	// Same as ReadRange, mixing all channels down to a single one, which is what the analysis
+	// works on. outSamples must have room for (endSampleIndex - firstSampleIndex) values.
+	bool ReadMonoRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples);
+
+	// Mixes nbFrames frames of nbChannels interleaved samples down to mono, averaging the channels
+	static void MixDown(const float* interleavedSamples, unsigned int nbFrames, unsigned int nbChannels, float* outSamples);
+
+	// Opens the file at filePath with the backend matching its format, WAV or FLAC. Returns 0 if
+	// the format isn't supported or the file couldn't be opened, otherwise the caller owns the
+	// returned source.
+	static AudioSource* Open(const std::string& filePath);
+
+	// Decodes a whole file at once, mixed down to mono
+	static bool ReadFile(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples);
+
+	// Decodes a whole file at once, keeping its channels, one after the other in outSamples: 
+	// the m_NbSamples samples of the first channel, then the ones of the second, and so on
+	static bool ReadFileChannels(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples);
+};
+
+#endif // AUDIOSOURCE_H_
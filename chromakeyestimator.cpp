@@ -0,0 +1,155 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "chromakeyestimator.h"
+
+#define MIN_CHROMA_FREQUENCY	65.0
+#define MAX_CHROMA_FREQUENCY	2093.0
+
+// Frames whose chroma is below this magnitude are silences, see StftFrames
+#define MIN_FRAME_MAGNITUDE		1e-4
+
+// Krumhansl-Kessler key profiles, tonic first
+static const double MAJOR_PROFILE[ChromaKeyEstimator::NB_PITCH_CLASSES] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+static const double MINOR_PROFILE[ChromaKeyEstimator::NB_PITCH_CLASSES] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+
+static const char* const PITCH_CLASS_NAMES[ChromaKeyEstimator::NB_PITCH_CLASSES] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+ChromaKeyEstimator::ChromaKeyEstimator()
+	:	m_Key(0),
+		m_IsMinor(false),
+		m_KeyCorrelation(0.0)
+{
+	std::fill(m_Chroma, m_Chroma + NB_PITCH_CLASSES, 0.0);
+}
+
+bool ChromaKeyEstimator::Estimate(StftFrameCache& frameCache, const StftConfiguration& configuration)
+{
+	std::fill(m_Chroma, m_Chroma + NB_PITCH_CLASSES, 0.0);
+	m_Key = 0;
+	m_IsMinor = false;
+	m_KeyCorrelation = 0.0;
+
+	const StftFrames* frames = frameCache.Acquire(configuration);
+	if (!frames)
+	{
+		return false;
+	}
+
+	// Pitch class of each bin in the chroma range, MIDI note 69 being A4
+	const unsigned int nbBins = frames->GetNbBins();
+	unsigned int firstBinIndex = nbBins;
+	unsigned int endBinIndex = 0;
+	std::vector<unsigned int> pitchClasses(nbBins);
+	for (unsigned int binIndex = 1; binIndex < nbBins; ++binIndex)
+	{
+		double frequency = frames->GetBinFrequency(binIndex);
+		if (frequency < MIN_CHROMA_FREQUENCY || frequency >= MAX_CHROMA_FREQUENCY)
+		{
+			continue;
+		}
+
+		firstBinIndex = std::min(firstBinIndex, binIndex);
+		endBinIndex = binIndex + 1;
+		int note = static_cast<int>(floor(12.0 * log(frequency / 440.0) / log(2.0) + 69.5));
+		pitchClasses[binIndex] = static_cast<unsigned int>(note % NB_PITCH_CLASSES);
+	}
+
+	std::vector<float> magnitudes(nbBins);
+	for (unsigned int frameIndex = 0; frameIndex < frames->GetNbFrames(); ++frameIndex)
+	{
+		frames->GetMagnitudes(frameIndex, &magnitudes[0]);
+
+		double frameChroma[NB_PITCH_CLASSES] = { 0.0 };
+		for (unsigned int binIndex = firstBinIndex; binIndex < endBinIndex; ++binIndex)
+		{
+			frameChroma[pitchClasses[binIndex]] += magnitudes[binIndex];
+		}
+
+		double maxMagnitude = *std::max_element(frameChroma, frameChroma + NB_PITCH_CLASSES);
+		if (maxMagnitude < MIN_FRAME_MAGNITUDE)
+		{
+			continue;
+		}
+
+		for (unsigned int pitchClass = 0; pitchClass < NB_PITCH_CLASSES; ++pitchClass)
+		{
+			m_Chroma[pitchClass] += frameChroma[pitchClass] / maxMagnitude;
+		}
+	}
+
+	frameCache.Release(frames);
+
+	double maxChroma = *std::max_element(m_Chroma, m_Chroma + NB_PITCH_CLASSES);
+	if (maxChroma <= 0.0)
+	{
+		// Silent clip, no key
+		return true;
+	}
+
+	for (unsigned int pitchClass = 0; pitchClass < NB_PITCH_CLASSES; ++pitchClass)
+	{
+		m_Chroma[pitchClass] /= maxChroma;
+	}
+
+	m_KeyCorrelation = -2.0;
+	for (unsigned int key = 0; key < NB_PITCH_CLASSES; ++key)
+	{
+		double majorCorrelation = GetCorrelation(MAJOR_PROFILE, key);
+		if (majorCorrelation > m_KeyCorrelation)
+		{
+			m_Key = key;
+			m_IsMinor = false;
+			m_KeyCorrelation = majorCorrelation;
+		}
+
+		double minorCorrelation = GetCorrelation(MINOR_PROFILE, key);
+		if (minorCorrelation > m_KeyCorrelation)
+		{
+			m_Key = key;
+			m_IsMinor = true;
+			m_KeyCorrelation = minorCorrelation;
+		}
+	}
+
+	return true;
+}
+
+double ChromaKeyEstimator::GetCorrelation(const double* profile, unsigned int key) const
+{
+	double chromaMean = 0.0;
+	double profileMean = 0.0;
+	for (unsigned int pitchClass = 0; pitchClass < NB_PITCH_CLASSES; ++pitchClass)
+	{
+		chromaMean += m_Chroma[pitchClass];
+		profileMean += profile[pitchClass];
+	}
+
+	chromaMean /= NB_PITCH_CLASSES;
+	profileMean /= NB_PITCH_CLASSES;
+
+	double covariance = 0.0;
+	double chromaVariance = 0.0;
+	double profileVariance = 0.0;
+	for (unsigned int pitchClass = 0; pitchClass < NB_PITCH_CLASSES; ++pitchClass)
+	{
+		double chromaDeviation = m_Chroma[pitchClass] - chromaMean;
+		double profileDeviation = profile[(pitchClass + NB_PITCH_CLASSES - key) % NB_PITCH_CLASSES] - profileMean;
+		covariance += chromaDeviation * profileDeviation;
+		chromaVariance += chromaDeviation * chromaDeviation;
+		profileVariance += profileDeviation * profileDeviation;
+	}
+
+	if (chromaVariance <= 0.0)
+	{
+		return 0.0;
+	}
+
+	return covariance / sqrt(chromaVariance * profileVariance);
+}
+
+std::string ChromaKeyEstimator::GetKeyName() const
+{
+	return std::string(PITCH_CLASS_NAMES[m_Key]) + (m_IsMinor ? " minor" : " major");
+}
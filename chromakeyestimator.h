@@ -0,0 +1,50 @@
+#ifndef CHROMAKEYESTIMATOR_H_
+#define CHROMAKEYESTIMATOR_H_
+
+#include <string>
+
+#include "stftframecache.h"
+
+/**
+ *	A ChromaKeyEstimator estimates the key of a clip from its chroma: the magnitudes of the
+ *	bins from 65 Hz to 2093 Hz (C2 to C7) summed into the 12 pitch classes of the nearest
+ *	equal tempered note, A4 at 440 Hz. The chroma of each frame is normalized so that loud
+ *	passages don't outweigh quiet ones, silent frames being left out, and the key is the one
+ *	of the 24 major and minor Krumhansl-Kessler profiles the mean chroma correlates best with.
+ *	Frames come from a StftFrameCache, so the estimator shares its transform with the other
+ *	spectral features of the clip.
+ */
+class ChromaKeyEstimator
+{
+public:
+	static const unsigned int NB_PITCH_CLASSES = 12;
+
+	ChromaKeyEstimator();
+
+	// Returns false if the frames can't be computed, see StftFrameCache::Acquire
+	bool Estimate(StftFrameCache& frameCache, const StftConfiguration& configuration = StftConfiguration());
+
+	// Mean normalized chroma, C first, all 0.0 if the clip is silent
+	const double* GetChroma() const { return m_Chroma; }
+
+	// Pitch class of the tonic, 0 for C to 11 for B, and the mode of the key
+	unsigned int GetKey() const { return m_Key; }
+	bool IsMinor() const { return m_IsMinor; }
+
+	// Pearson correlation between the chroma and the profile of the key, from -1.0 to 1.0
+	double GetKeyCorrelation() const { return m_KeyCorrelation; }
+
+	// As "C major" or "F# minor"
+	std::string GetKeyName() const;
+
+private:
+	double			m_Chroma[NB_PITCH_CLASSES];
+	unsigned int	m_Key;
+	bool			m_IsMinor;
+	double			m_KeyCorrelation;
+
+	// Of the chroma with profile rotated to have its tonic on key
+	double GetCorrelation(const double* profile, unsigned int key) const;
+};
+
+#endif // CHROMAKEYESTIMATOR_H_
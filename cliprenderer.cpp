@@ -0,0 +1,74 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "cliprenderer.h"
+#include "resampler.h"
+#include "Clip.h"
+
+// Index of the first output sample played at or after beatPosition, clamped to [0, nbOutputSamples]
+static unsigned int GetFirstOutputIndex(BeatPosition beatPosition, double startBeatTime, unsigned int outputRate, unsigned int nbOutputSamples)
+{
+	double outputIndex = ceil((static_cast<double>(beatPosition) / WarpMarker::BEAT_POSITIONS_PER_SECOND - startBeatTime) * outputRate);
+	if (outputIndex <= 0.0)
+	{
+		return 0;
+	}
+
+	return outputIndex >= nbOutputSamples ? nbOutputSamples : static_cast<unsigned int>(outputIndex);
+}
+
+bool ClipRenderer::Render(	const AClip& clip, const float* clipSamples, unsigned int outputRate, double startBeatTime, 
+							unsigned int nbOutputSamples, float* outSamples)
+{
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	if (!AudioInfo::CheckAudioInfo(audioInfo) || !outputRate || !outSamples || (audioInfo.m_NbSamples && !clipSamples))
+	{
+		return false;
+	}
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+	if (warpMarkers.size() < 2)
+	{
+		return false;
+	}
+
+	std::fill(outSamples, outSamples + nbOutputSamples, 0.0f);
+
+	for (size_t warpMarkerIndex = 0; warpMarkerIndex + 1 < warpMarkers.size(); ++warpMarkerIndex)
+	{
+		const WarpMarker& lowBoundMarker = warpMarkers[warpMarkerIndex];
+		const WarpMarker& highBoundMarker = warpMarkers[warpMarkerIndex + 1];
+
+		// Output samples played from this warp marker up to the next one, the last warp marker
+		// itself being played by the last interval
+		unsigned int firstOutputIndex = GetFirstOutputIndex(lowBoundMarker.GetBeatPosition(), startBeatTime, outputRate, nbOutputSamples);
+		unsigned int endOutputIndex = GetFirstOutputIndex(highBoundMarker.GetBeatPosition(), startBeatTime, outputRate, nbOutputSamples);
+		if (warpMarkerIndex + 2 == warpMarkers.size() && endOutputIndex < nbOutputSamples && 
+			(startBeatTime + static_cast<double>(endOutputIndex) / outputRate) * WarpMarker::BEAT_POSITIONS_PER_SECOND <= highBoundMarker.GetBeatPosition())
+		{
+			++endOutputIndex;
+		}
+
+		if (firstOutputIndex >= endOutputIndex)
+		{
+			continue;
+		}
+
+		// Clip samples per beat position, and per output sample
+		double samplesPerBeatPosition = 
+			static_cast<double>(highBoundMarker.GetSamplePosition() - lowBoundMarker.GetSamplePosition()) / 
+			static_cast<double>(highBoundMarker.GetBeatPosition() - lowBoundMarker.GetBeatPosition());
+		double inputStep = samplesPerBeatPosition * WarpMarker::BEAT_POSITIONS_PER_SECOND / outputRate;
+
+		double firstBeatPosition = (startBeatTime + static_cast<double>(firstOutputIndex) / outputRate) * WarpMarker::BEAT_POSITIONS_PER_SECOND;
+		double firstPosition =	static_cast<double>(lowBoundMarker.GetSamplePosition()) + 
+								(firstBeatPosition - lowBoundMarker.GetBeatPosition()) * samplesPerBeatPosition;
+
+		PolyphaseResampler::ResampleAtPositions(clipSamples, audioInfo.m_NbSamples, firstPosition, inputStep, 
+												endOutputIndex - firstOutputIndex, outSamples + firstOutputIndex);
+	}
+
+	return true;
+}
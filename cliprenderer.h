@@ -0,0 +1,26 @@
+#ifndef CLIPRENDERER_H_
+#define CLIPRENDERER_H_
+
+class AClip;
+
+/**
+ *	A ClipRenderer produces the audio of a clip as it plays in the set, at the sample rate of
+ *	the set: warped by its warp markers, and converted from its own sample rate.
+ *	Both are done in a single resampling pass: between two warp markers, the position in the
+ *	clip is a linear function of the time in the set, so each output sample is read at its 
+ *	exact position in the clip through an interpolated ResamplerFilter. The filter of each 
+ *	interval between warp markers is chosen for its playback speed, to prevent aliasing when 
+ *	the clip is played faster.
+ */
+class ClipRenderer
+{
+public:
+	// Renders nbOutputSamples samples of clip at outputRate, starting at startBeatTime seconds 
+	// of the set after the start of the clip, in outSamples. clipSamples are the samples of a
+	// channel of the clip, see DecodedAudio::GetChannel. Times before the first warp marker, or 
+	// after the last one, are silent. The clip must have warp markers.
+	static bool Render(	const AClip& clip, const float* clipSamples, unsigned int outputRate, double startBeatTime, 
+						unsigned int nbOutputSamples, float* outSamples);
+};
+
+#endif // CLIPRENDERER_H_
@@ -0,0 +1,198 @@
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "clipslicer.h"
+#include "Clip.h"
+#include "audiosource.h"
+#include "wavfilewriter.h"
+
+#define DEFAULT_NB_BEATS_PER_SLICE		1
+#define DEFAULT_PEAK_SNAP_TOLERANCE		0.03	// in seconds
+
+// Number of samples read from the source at once
+#define EXPORT_BLOCK_SIZE				16384
+
+ClipSlicer::Options::Options()
+	:	m_NbBeatsPerSlice(DEFAULT_NB_BEATS_PER_SLICE),
+		m_BPM(0.0),
+		m_PeakSnapTolerance(DEFAULT_PEAK_SNAP_TOLERANCE)
+{
+}
+
+static bool PeakIsBefore(const Peak& peak, unsigned int sampleIndex)
+{
+	return peak.GetPeakSampleIndex() < sampleIndex;
+}
+
+// Returns the sample index of the peak closest to sampleIndex, or sampleIndex if no peak is 
+// closer than toleranceNbSamples
+static unsigned int SnapToPeak(const std::vector<Peak>& peaks, unsigned int sampleIndex, unsigned int toleranceNbSamples)
+{
+	std::vector<Peak>::const_iterator itNextPeak = std::lower_bound(peaks.begin(), peaks.end(), sampleIndex, PeakIsBefore);
+
+	unsigned int snappedSampleIndex = sampleIndex;
+	unsigned int snapDistance = toleranceNbSamples + 1;
+	if (itNextPeak != peaks.end() && itNextPeak->GetPeakSampleIndex() - sampleIndex < snapDistance)
+	{
+		snappedSampleIndex = itNextPeak->GetPeakSampleIndex();
+		snapDistance = snappedSampleIndex - sampleIndex;
+	}
+
+	if (itNextPeak != peaks.begin())
+	{
+		--itNextPeak;
+		if (sampleIndex - itNextPeak->GetPeakSampleIndex() < snapDistance)
+		{
+			snappedSampleIndex = itNextPeak->GetPeakSampleIndex();
+		}
+	}
+
+	return snappedSampleIndex;
+}
+
+bool ClipSlicer::GetSliceBoundaries(AClip& clip, const Options& options, std::vector<unsigned int>& outSampleIndices)
+{
+	outSampleIndices.clear();
+
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	if (!AudioInfo::CheckAudioInfo(audioInfo) || !audioInfo.m_NbSamples || !options.m_NbBeatsPerSlice || options.m_PeakSnapTolerance < 0.0)
+	{
+		return false;
+	}
+
+	double bpm = options.m_BPM;
+	if (bpm <= 0.0 && (!clip.GetBPM(bpm) || bpm <= 0.0))
+	{
+		return false;
+	}
+
+	// The grid starts at the first onset, what comes before it is a slice of its own
+	const std::vector<Peak>& peaks = clip.GetPeaks();
+	double gridStartSampleTime = peaks.empty() ? 0.0 : static_cast<double>(peaks.front().GetPeakSampleIndex()) / audioInfo.m_SampleRate;
+
+	double gridStartBeatTime = 0.0;
+	if (!clip.FindBeatTime(gridStartSampleTime, gridStartBeatTime))
+	{
+		return false;
+	}
+
+	const double sliceBeatDuration = 60.0 / bpm * options.m_NbBeatsPerSlice;
+	const unsigned int toleranceNbSamples = static_cast<unsigned int>(options.m_PeakSnapTolerance * audioInfo.m_SampleRate + 0.5);
+
+	outSampleIndices.push_back(0);
+
+	// The grid goes on as long as the warp markers map it into the clip. Use an integer counter 
+	// so that rounding errors don't accumulate over long clips.
+	for (unsigned int sliceIndex = 0; ; ++sliceIndex)
+	{
+		double sampleTime = 0.0;
+		if (!clip.FindSampleTime(gridStartBeatTime + sliceIndex * sliceBeatDuration, sampleTime))
+		{
+			break;
+		}
+
+		unsigned int sampleIndex = static_cast<unsigned int>(floor(sampleTime * audioInfo.m_SampleRate + 0.5));
+		if (sampleIndex >= audioInfo.m_NbSamples)
+		{
+			break;
+		}
+
+		sampleIndex = SnapToPeak(peaks, sampleIndex, toleranceNbSamples);
+
+		// Snapping can bring two boundaries together, slices are never empty
+		if (sampleIndex > outSampleIndices.back())
+		{
+			outSampleIndices.push_back(sampleIndex);
+		}
+	}
+
+	outSampleIndices.push_back(audioInfo.m_NbSamples);
+	return true;
+}
+
+unsigned int ClipSlicer::ExportSlices(AClip& clip, const Options& options, const std::string& outputPathPrefix)
+{
+	std::vector<unsigned int> sliceBoundaries;
+	if (clip.GetFilePath().empty() || !GetSliceBoundaries(clip, options, sliceBoundaries))
+	{
+		return 0;
+	}
+
+	AudioSource* audioSource = AudioSource::Open(clip.GetFilePath());
+	if (!audioSource)
+	{
+		return 0;
+	}
+
+	// The file must still be the one the clip was analyzed from
+	const AudioInfo& audioInfo = audioSource->GetAudioInfo();
+	if (audioInfo.m_NbSamples != clip.GetAudioInfo().m_NbSamples || audioInfo.m_SampleRate != clip.GetAudioInfo().m_SampleRate)
+	{
+		delete audioSource;
+		return 0;
+	}
+
+	// Slices are contiguous, so reading them one after the other reads the source in order,
+	// once. Blocks straddling two slices are simply read in two parts.
+	std::vector<float> samples(EXPORT_BLOCK_SIZE * audioInfo.m_NumChannels);
+	WavFileWriter sliceWriter;
+	unsigned int nbSlices = 0;
+	bool exported = true;
+	for (size_t sliceIndex = 0; exported && sliceIndex + 1 < sliceBoundaries.size(); ++sliceIndex)
+	{
+		std::ostringstream slicePath;
+		slicePath << outputPathPrefix << "_" << std::setw(3) << std::setfill('0') << sliceIndex << ".wav";
+
+		exported = sliceWriter.Open(slicePath.str(), audioInfo.m_SampleRate, audioInfo.m_NumChannels);
+
+		unsigned int sliceEndSampleIndex = sliceBoundaries[sliceIndex + 1];
+		unsigned int firstSampleIndex = sliceBoundaries[sliceIndex];
+		while (exported && firstSampleIndex < sliceEndSampleIndex)
+		{
+			unsigned int nbSamplesToRead = std::min(static_cast<unsigned int>(EXPORT_BLOCK_SIZE), sliceEndSampleIndex - firstSampleIndex);
+			exported =	audioSource->ReadRange(firstSampleIndex, firstSampleIndex + nbSamplesToRead, &samples[0]) &&
+						sliceWriter.WriteSamples(&samples[0], nbSamplesToRead);
+
+			firstSampleIndex += nbSamplesToRead;
+		}
+
+		if (sliceWriter.Close() && exported)
+		{
+			++nbSlices;
+		}
+		else
+		{
+			exported = false;
+		}
+	}
+
+	delete audioSource;
+	return exported ? nbSlices : 0;
+}
+
+bool ClipSlicer::ExportClips(const std::vector<AClip*>& clips, const Options& options, const std::vector<std::string>& outputPathPrefixes, 
+							 std::vector<unsigned int>& outNbSlices)
+{
+	outNbSlices.assign(clips.size(), 0);
+	if (outputPathPrefixes.size() != clips.size())
+	{
+		return false;
+	}
+
+	// Each clip is read from its own source and only touches its own slices
+	const int nbClips = static_cast<int>(clips.size());
+	int nbFailedClips = 0;
+	#pragma omp parallel for schedule(dynamic) reduction(+:nbFailedClips)
+	for (int clipIndex = 0; clipIndex < nbClips; ++clipIndex)
+	{
+		outNbSlices[clipIndex] = ExportSlices(*clips[clipIndex], options, outputPathPrefixes[clipIndex]);
+		if (!outNbSlices[clipIndex])
+		{
+			++nbFailedClips;
+		}
+	}
+
+	return !nbFailedClips;
+}
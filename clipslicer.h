@@ -0,0 +1,45 @@
+#ifndef CLIPSLICER_H_
+#define CLIPSLICER_H_
+
+#include <string>
+#include <vector>
+
+class AClip;
+
+/**
+ *	A ClipSlicer cuts clips at their beats, or bars, and exports each slice to its own WAV 
+ *	file, with all the channels of the source.
+ *	Slice boundaries are laid out on a grid of beats in the set time of the clip, starting at 
+ *	its first detected peak, and converted to samples through its warp markers. Each boundary
+ *	is then moved to the closest detected peak, if there is one close enough, so that slices
+ *	start right on their onset even when the warp markers are slightly off.
+ *	The source file is read only once, in order, whatever the number of slices.
+ */
+class ClipSlicer
+{
+public:
+	struct Options
+	{
+		unsigned int	m_NbBeatsPerSlice;		// 1 to cut at each beat, 4 to cut at each bar of 4/4
+		double			m_BPM;					// Tempo of the grid, 0 uses the tempo detected in the clip
+		double			m_PeakSnapTolerance;	// Maximum distance a boundary is moved to meet a peak, in seconds
+
+		Options();
+	};
+
+	// Gets the sample indices at which the clip is cut in outSampleIndices, sorted, starting 
+	// with 0 and ending with the number of samples of the clip. The clip must have warp markers.
+	static bool GetSliceBoundaries(AClip& clip, const Options& options, std::vector<unsigned int>& outSampleIndices);
+
+	// Writes the slices of the clip to outputPathPrefix followed by "_<slice index>.wav", 
+	// reading the file the clip was loaded from. Returns the number of slices written, 0 on error.
+	static unsigned int ExportSlices(AClip& clip, const Options& options, const std::string& outputPathPrefix);
+
+	// Exports the slices of several clips in parallel, each to its own path prefix. Clips 
+	// must be different instances. Gets the number of slices of each clip in outNbSlices.
+	// Returns true if all clips could be exported.
+	static bool ExportClips(const std::vector<AClip*>& clips, const Options& options, const std::vector<std::string>& outputPathPrefixes, 
+							std::vector<unsigned int>& outNbSlices);
+};
+
+#endif // CLIPSLICER_H_
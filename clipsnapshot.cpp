@@ -0,0 +1,256 @@
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+#include "clipsnapshot.h"
+#include "Clip.h"
+
+#define CLIP_SNAPSHOT_MAGIC		"SBCS"
+
+// Sections start on multiples of this, so that their records can be used in place
+#define CLIP_SNAPSHOT_ALIGNMENT	8
+
+// The layout of the records is the file format, make sure the compiler didn't pad them
+typedef char HeaderSizeCheck[sizeof(ClipSnapshot::Header) == 64 ? 1 : -1];
+typedef char WarpMarkerRecordSizeCheck[sizeof(ClipSnapshot::WarpMarkerRecord) == 16 ? 1 : -1];
+typedef char PeakRecordSizeCheck[sizeof(ClipSnapshot::PeakRecord) == 8 ? 1 : -1];
+
+static unsigned long long AlignOffset(unsigned long long offset)
+{
+	return (offset + CLIP_SNAPSHOT_ALIGNMENT - 1) / CLIP_SNAPSHOT_ALIGNMENT * CLIP_SNAPSHOT_ALIGNMENT;
+}
+
+// Returns true if the array of nbRecords records of recordSize bytes at offset ends within size bytes
+static bool SectionFits(unsigned long long offset, unsigned long long nbRecords, unsigned long long recordSize, size_t size)
+{
+	return	offset % CLIP_SNAPSHOT_ALIGNMENT == 0	&& 
+			offset <= size							&& 
+			nbRecords <= (size - offset) / recordSize;
+}
+
+ClipSnapshot::ClipSnapshot()
+	:	m_Header(0),
+		m_FilePath(0),
+		m_WarpMarkers(0),
+		m_Peaks(0)
+{
+}
+
+bool ClipSnapshot::Open(const void* data, size_t size)
+{
+	m_Header = 0;
+
+	const char* bytes = static_cast<const char*>(data);
+	if (!bytes || reinterpret_cast<size_t>(bytes) % CLIP_SNAPSHOT_ALIGNMENT || size < sizeof(Header))
+	{
+		return false;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(bytes);
+	if (memcmp(header->m_Magic, CLIP_SNAPSHOT_MAGIC, 4) || header->m_Version != VERSION || !header->m_SampleRate)
+	{
+		return false;
+	}
+
+	if (!SectionFits(header->m_FilePathOffset, header->m_FilePathLength, 1, size)							||
+		!SectionFits(header->m_WarpMarkersOffset, header->m_NbWarpMarkers, sizeof(WarpMarkerRecord), size)	||
+		!SectionFits(header->m_PeaksOffset, header->m_NbPeaks, sizeof(PeakRecord), size))
+	{
+		return false;
+	}
+
+	// Warp markers and peaks are used without any further check, so they must be in order and
+	// within the clip
+	const WarpMarkerRecord* warpMarkers = reinterpret_cast<const WarpMarkerRecord*>(bytes + header->m_WarpMarkersOffset);
+	if (header->m_NbWarpMarkers && (warpMarkers[0].m_BeatPosition < 0 || warpMarkers[header->m_NbWarpMarkers - 1].m_SamplePosition > header->m_NbSamples))
+	{
+		return false;
+	}
+
+	for (unsigned long long warpMarkerIndex = 1; warpMarkerIndex < header->m_NbWarpMarkers; ++warpMarkerIndex)
+	{
+		if (warpMarkers[warpMarkerIndex].m_SamplePosition	<= warpMarkers[warpMarkerIndex - 1].m_SamplePosition ||
+			warpMarkers[warpMarkerIndex].m_BeatPosition		<= warpMarkers[warpMarkerIndex - 1].m_BeatPosition)
+		{
+			return false;
+		}
+	}
+
+	const PeakRecord* peaks = reinterpret_cast<const PeakRecord*>(bytes + header->m_PeaksOffset);
+	for (unsigned long long peakIndex = 0; peakIndex < header->m_NbPeaks; ++peakIndex)
+	{
+		if (peaks[peakIndex].m_PeakSampleIndex		>= header->m_NbSamples				||
+			peaks[peakIndex].m_AttackSampleIndex	> peaks[peakIndex].m_PeakSampleIndex	||
+			(peakIndex && peaks[peakIndex].m_PeakSampleIndex < peaks[peakIndex - 1].m_PeakSampleIndex))
+		{
+			return false;
+		}
+	}
+
+	m_Header		= header;
+	m_FilePath		= bytes + header->m_FilePathOffset;
+	m_WarpMarkers	= warpMarkers;
+	m_Peaks			= peaks;
+
+	return true;
+}
+
+std::string ClipSnapshot::GetFilePath() const
+{
+	return std::string(m_FilePath, m_Header->m_FilePathLength);
+}
+
+static void WritePadding(std::ostream& outputStream, unsigned long long currentOffset, unsigned long long alignedOffset)
+{
+	static const char padding[CLIP_SNAPSHOT_ALIGNMENT] = { 0 };
+	outputStream.write(padding, static_cast<std::streamsize>(alignedOffset - currentOffset));
+}
+
+bool ClipSnapshot::Write(const AClip& clip, std::ostream& outputStream)
+{
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	const std::string& filePath = clip.GetFilePath();
+	const std::vector<Peak>& peaks = clip.GetPeaks();
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_Magic, CLIP_SNAPSHOT_MAGIC, 4);
+	header.m_Version			= VERSION;
+	header.m_SampleRate			= audioInfo.m_SampleRate;
+	header.m_BitsPerSample		= audioInfo.m_BitsPerSample;
+	header.m_NumChannels		= audioInfo.m_NumChannels;
+	header.m_NbSamples			= audioInfo.m_NbSamples;
+	header.m_FilePathLength		= static_cast<unsigned int>(filePath.length());
+	header.m_NbWarpMarkers		= warpMarkers.size();
+	header.m_NbPeaks			= peaks.size();
+	header.m_FilePathOffset		= sizeof(Header);
+	header.m_WarpMarkersOffset	= AlignOffset(header.m_FilePathOffset + header.m_FilePathLength);
+	header.m_PeaksOffset		= AlignOffset(header.m_WarpMarkersOffset + header.m_NbWarpMarkers * sizeof(WarpMarkerRecord));
+
+	outputStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	outputStream.write(filePath.data(), header.m_FilePathLength);
+	WritePadding(outputStream, header.m_FilePathOffset + header.m_FilePathLength, header.m_WarpMarkersOffset);
+
+	std::vector<WarpMarkerRecord> warpMarkerRecords(warpMarkers.size());
+	for (size_t warpMarkerIndex = 0; warpMarkerIndex < warpMarkers.size(); ++warpMarkerIndex)
+	{
+		WarpMarkerRecord& warpMarkerRecord = warpMarkerRecords[warpMarkerIndex];
+		warpMarkerRecord.m_SamplePosition	= warpMarkers[warpMarkerIndex].GetSamplePosition();
+		warpMarkerRecord.m_BeatPosition		= warpMarkers[warpMarkerIndex].GetBeatPosition();
+	}
+
+	if (!warpMarkerRecords.empty())
+	{
+		outputStream.write(reinterpret_cast<const char*>(&warpMarkerRecords[0]), warpMarkerRecords.size() * sizeof(WarpMarkerRecord));
+	}
+
+	// Warp marker records are 8 bytes multiples, peaks follow them right away
+	std::vector<PeakRecord> peakRecords(peaks.size());
+	for (size_t peakIndex = 0; peakIndex < peaks.size(); ++peakIndex)
+	{
+		peakRecords[peakIndex].m_PeakSampleIndex	= peaks[peakIndex].GetPeakSampleIndex();
+		peakRecords[peakIndex].m_AttackSampleIndex	= peaks[peakIndex].GetAttackSampleIndex();
+	}
+
+	if (!peakRecords.empty())
+	{
+		outputStream.write(reinterpret_cast<const char*>(&peakRecords[0]), peakRecords.size() * sizeof(PeakRecord));
+	}
+
+	return outputStream.good();
+}
+
+static void WriteJsonString(std::ostream& outputStream, const std::string& value)
+{
+	outputStream << '"';
+	for (std::string::const_iterator itChars = value.begin(); itChars != value.end(); ++itChars)
+	{
+		unsigned char c = static_cast<unsigned char>(*itChars);
+		if (c == '"' || c == '\\')
+		{
+			outputStream << '\\' << *itChars;
+		}
+		else if (c < 0x20)
+		{
+			outputStream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned int>(c) << std::dec << std::setfill(' ');
+		}
+		else
+		{
+			outputStream << *itChars;
+		}
+	}
+
+	outputStream << '"';
+}
+
+bool ClipSnapshot::WriteJson(const AClip& clip, std::ostream& outputStream)
+{
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	const std::vector<Peak>& peaks = clip.GetPeaks();
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+
+	outputStream << "{\n  \"version\": " << VERSION << ",\n  \"filePath\": ";
+	WriteJsonString(outputStream, clip.GetFilePath());
+	outputStream	<< ",\n  \"audioInfo\": { \"sampleRate\": " << audioInfo.m_SampleRate 
+					<< ", \"bitsPerSample\": " << audioInfo.m_BitsPerSample
+					<< ", \"numChannels\": " << audioInfo.m_NumChannels 
+					<< ", \"nbSamples\": " << audioInfo.m_NbSamples << " },\n";
+
+	// Warp markers are written as exact positions, beat positions are in beatPositionsPerSecond units
+	outputStream << "  \"beatPositionsPerSecond\": " << WarpMarker::BEAT_POSITIONS_PER_SECOND << ",\n  \"warpMarkers\": [";
+	for (size_t warpMarkerIndex = 0; warpMarkerIndex < warpMarkers.size(); ++warpMarkerIndex)
+	{
+		outputStream	<< (warpMarkerIndex ? ",\n    " : "\n    ")
+						<< "{ \"samplePosition\": " << warpMarkers[warpMarkerIndex].GetSamplePosition() 
+						<< ", \"beatPosition\": " << warpMarkers[warpMarkerIndex].GetBeatPosition() << " }";
+	}
+
+	outputStream << (warpMarkers.empty() ? "],\n" : "\n  ],\n");
+
+	// Peaks are [peak sample index, attack sample index] pairs, to keep large clips compact
+	outputStream << "  \"peaks\": [";
+	for (size_t peakIndex = 0; peakIndex < peaks.size(); ++peakIndex)
+	{
+		outputStream	<< (peakIndex ? ", " : "") 
+						<< "[" << peaks[peakIndex].GetPeakSampleIndex() << ", " << peaks[peakIndex].GetAttackSampleIndex() << "]";
+	}
+
+	outputStream << "]\n}\n";
+
+	return outputStream.good();
+}
+
+bool ClipSnapshot::ReadFile(const std::string& filePath, std::vector<unsigned long long>& outData, size_t& outSize)
+{
+	outSize = 0;
+
+	std::ifstream inputStream(filePath.c_str(), std::ifstream::in | std::ios::binary);
+	if (!inputStream)
+	{
+		return false;
+	}
+
+	inputStream.seekg(0, std::ios::end);
+	std::streamoff fileSize = inputStream.tellg();
+	inputStream.seekg(0, std::ios::beg);
+	if (fileSize <= 0)
+	{
+		return false;
+	}
+
+	// A vector of 64 bits values is aligned for any of the records
+	outData.resize(static_cast<size_t>((fileSize + sizeof(unsigned long long) - 1) / sizeof(unsigned long long)));
+	inputStream.read(reinterpret_cast<char*>(&outData[0]), fileSize);
+	if (!inputStream)
+	{
+		return false;
+	}
+
+	outSize = static_cast<size_t>(fileSize);
+	return true;
+}
@@ -0,0 +1,88 @@
+#ifndef CLIPSNAPSHOT_H_
+#define CLIPSNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+class AClip;
+
+/**
+ *	A ClipSnapshot is the saved state of an AClip: its AudioInfo, source file path, warp markers
+ *	and peaks, so that a project can be reopened without analyzing its files again.
+ *	The binary format is made of a fixed size header followed by the arrays of warp markers and 
+ *	peaks, all little endian and aligned on 8 bytes. Once a snapshot file is in memory, read at 
+ *	once or mapped, its arrays are used in place: opening it only checks the header, and that the
+ *	warp markers and peaks are sorted and within the clip, nothing is copied.
+ *	Snapshots can also be exported to JSON, for other tools.
+ */
+class ClipSnapshot
+{
+public:
+	static const unsigned int VERSION = 2;
+
+	struct Header
+	{
+		char				m_Magic[4];
+		unsigned int		m_Version;
+		unsigned int		m_SampleRate;
+		unsigned short		m_BitsPerSample;
+		unsigned short		m_NumChannels;
+		unsigned int		m_NbSamples;
+		unsigned int		m_FilePathLength;
+		unsigned long long	m_NbWarpMarkers;
+		unsigned long long	m_NbPeaks;
+		unsigned long long	m_FilePathOffset;		// All offsets are from the start of the header
+		unsigned long long	m_WarpMarkersOffset;
+		unsigned long long	m_PeaksOffset;
+	};
+
+	// Sorted by sample position, which is also the order of their beat positions, see WarpMarker
+	struct WarpMarkerRecord
+	{
+		unsigned long long	m_SamplePosition;
+		long long			m_BeatPosition;
+	};
+
+	// Sorted by peak sample index, attacks don't start after their peak
+	struct PeakRecord
+	{
+		unsigned int		m_PeakSampleIndex;
+		unsigned int		m_AttackSampleIndex;
+	};
+
+	ClipSnapshot();
+
+	// Makes the snapshot use the size bytes at data, which must be aligned on 8 bytes and stay 
+	// valid as long as the snapshot is used. Returns false if they aren't a valid snapshot.
+	bool Open(const void* data, size_t size);
+
+	bool IsOpen() const { return m_Header != 0; }
+
+	const Header& GetHeader() const { return *m_Header; }
+	std::string GetFilePath() const;
+
+	size_t GetNbWarpMarkers() const							{ return static_cast<size_t>(m_Header->m_NbWarpMarkers); }
+	const WarpMarkerRecord* GetWarpMarkers() const			{ return m_WarpMarkers; }
+
+	size_t GetNbPeaks() const								{ return static_cast<size_t>(m_Header->m_NbPeaks); }
+	const PeakRecord* GetPeaks() const						{ return m_Peaks; }
+
+	// Writes the snapshot of clip
+	static bool Write(const AClip& clip, std::ostream& outputStream);
+
+	// Writes the same content as a JSON object
+	static bool WriteJson(const AClip& clip, std::ostream& outputStream);
+
+	// Reads a whole snapshot file in outData with a single read, in a buffer suitably aligned to
+	// be opened
+	static bool ReadFile(const std::string& filePath, std::vector<unsigned long long>& outData, size_t& outSize);
+
+private:
+	const Header*			m_Header;
+	const char*				m_FilePath;
+	const WarpMarkerRecord*	m_WarpMarkers;
+	const PeakRecord*		m_Peaks;
+};
+
+#endif // CLIPSNAPSHOT_H_
@@ -0,0 +1,153 @@
+#include <cassert>
+#include <algorithm>
+
+#include "decodedaudiocache.h"
+#include "audiosource.h"
+
+void DecodedAudio::MixDown(std::vector<float>& outSamples) const
+{
+	const unsigned int nbSamples = m_AudioInfo.m_NbSamples;
+	outSamples.resize(nbSamples);
+	if (m_NbChannels == 1)
+	{
+		std::copy(m_Samples.begin(), m_Samples.end(), outSamples.begin());
+		return;
+	}
+
+	// Channels are summed in the same order as AudioSource::MixDown does
+	const float scale = 1.0f / m_NbChannels;
+	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		float sum = 0.0f;
+		for (unsigned int channelIndex = 0; channelIndex < m_NbChannels; ++channelIndex)
+		{
+			sum += m_Samples[static_cast<size_t>(channelIndex) * nbSamples + sampleIndex];
+		}
+
+		outSamples[sampleIndex] = sum * scale;
+	}
+}
+
+DecodedAudioCache::DecodedAudioCache(size_t budget, bool keepChannels)
+	:	m_Budget(budget),
+		m_Size(0),
+		m_KeepChannels(keepChannels)
+{
+}
+
+DecodedAudioCache::~DecodedAudioCache()
+{
+	CacheEntries::iterator itEntries = m_Entries.begin();
+	CacheEntries::iterator itEntriesEnd = m_Entries.end();
+	for (; itEntries != itEntriesEnd; ++itEntries)
+	{
+		// Users must release what they acquire before destroying the cache
+		assert(itEntries->second.m_NbAcquisitions == 0);
+		delete itEntries->second.m_DecodedAudio;
+	}
+}
+
+const DecodedAudio* DecodedAudioCache::Acquire(const std::string& filePath)
+{
+	CacheEntries::iterator itEntry = m_Entries.find(filePath);
+	if (itEntry != m_Entries.end())
+	{
+		// Move the file at the most recently used end of the list
+		m_LeastRecentlyUsed.splice(m_LeastRecentlyUsed.end(), m_LeastRecentlyUsed, itEntry->second.m_ItLeastRecentlyUsed);
+		++itEntry->second.m_NbAcquisitions;
+		return itEntry->second.m_DecodedAudio;
+	}
+
+	DecodedAudio* decodedAudio = new DecodedAudio;
+	decodedAudio->m_FilePath = filePath;
+	bool decoded =	m_KeepChannels ?
+					AudioSource::ReadFileChannels(filePath, decodedAudio->m_AudioInfo, decodedAudio->m_Samples) :
+					AudioSource::ReadFile(filePath, decodedAudio->m_AudioInfo, decodedAudio->m_Samples);
+	if (!decoded)
+	{
+		delete decodedAudio;
+		return 0;
+	}
+
+	decodedAudio->m_NbChannels = m_KeepChannels ? decodedAudio->m_AudioInfo.m_NumChannels : 1;
+
+	return Add(decodedAudio);
+}
+
+const DecodedAudio* DecodedAudioCache::Add(DecodedAudio* decodedAudio)
+{
+	assert(decodedAudio->m_NbChannels == (m_KeepChannels ? decodedAudio->m_AudioInfo.m_NumChannels : 1));
+
+	const std::string& filePath = decodedAudio->m_FilePath;
+	CacheEntries::iterator itEntry = m_Entries.find(filePath);
+	if (itEntry != m_Entries.end())
+	{
+		// Decoded meanwhile by someone else, keep the copy already shared
+		delete decodedAudio;
+		return Acquire(itEntry->first);
+	}
+
+	CacheEntry entry;
+	entry.m_DecodedAudio			= decodedAudio;
+	entry.m_NbAcquisitions			= 1;
+	entry.m_ItLeastRecentlyUsed		= m_LeastRecentlyUsed.insert(m_LeastRecentlyUsed.end(), filePath);
+	m_Entries[filePath] = entry;
+
+	m_Size += decodedAudio->GetSize();
+	EvictUntilWithinBudget();
+
+	return decodedAudio;
+}
+
+void DecodedAudioCache::Release(const DecodedAudio* decodedAudio)
+{
+	if (!decodedAudio)
+	{
+		return;
+	}
+
+	CacheEntries::iterator itEntry = m_Entries.find(decodedAudio->m_FilePath);
+	if (itEntry == m_Entries.end() || itEntry->second.m_DecodedAudio != decodedAudio || !itEntry->second.m_NbAcquisitions)
+	{
+		assert(false);
+		return;
+	}
+
+	--itEntry->second.m_NbAcquisitions;
+
+	// The cache may have been over budget because this file was in use
+	EvictUntilWithinBudget();
+}
+
+bool DecodedAudioCache::Contains(const std::string& filePath) const
+{
+	return m_Entries.find(filePath) != m_Entries.end();
+}
+
+void DecodedAudioCache::SetBudget(size_t budget)
+{
+	m_Budget = budget;
+	EvictUntilWithinBudget();
+}
+
+void DecodedAudioCache::EvictUntilWithinBudget()
+{
+	std::list<std::string>::iterator itLeastRecentlyUsed = m_LeastRecentlyUsed.begin();
+	while (m_Size > m_Budget && itLeastRecentlyUsed != m_LeastRecentlyUsed.end())
+	{
+		CacheEntries::iterator itEntry = m_Entries.find(*itLeastRecentlyUsed);
+		assert(itEntry != m_Entries.end());
+
+		if (itEntry->second.m_NbAcquisitions)
+		{
+			// In use, try the next least recently used file
+			++itLeastRecentlyUsed;
+			continue;
+		}
+
+		m_Size -= itEntry->second.m_DecodedAudio->GetSize();
+		delete itEntry->second.m_DecodedAudio;
+		m_Entries.erase(itEntry);
+		itLeastRecentlyUsed = m_LeastRecentlyUsed.erase(itLeastRecentlyUsed);
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef DECODEDAUDIOCACHE_H_
+#define DECODEDAUDIOCACHE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+
+#include "audioformats.h"
+
+/**
+ *	Samples of a whole audio file, decoded in memory, mixed down to mono or with all its
+ *	channels, see DecodedAudioCache
+ */
+struct DecodedAudio
+{
+	std::string			m_FilePath;
+	AudioInfo			m_AudioInfo;
+
+	// m_NbChannels channels one after the other, m_AudioInfo.m_NbSamples samples each: a
+	// single one when the file is mixed down to mono, m_AudioInfo.m_NumChannels otherwise
+	unsigned int		m_NbChannels;
+	std::vector<float>	m_Samples;
+
+	DecodedAudio() : m_NbChannels(1) {}
+
+	// Samples of a channel, 0 if the file is empty
+	const float* GetChannel(unsigned int channelIndex) const { return m_Samples.empty() ? 0 : &m_Samples[static_cast<size_t>(channelIndex) * m_AudioInfo.m_NbSamples]; }
+
+	// Mixes the channels down to mono in outSamples, giving the same samples as 
+	// AudioSource::ReadFile
+	void MixDown(std::vector<float>& outSamples) const;
+
+	size_t GetSize() const { return m_Samples.size() * sizeof(float); }
+};
+
+/**
+ *	A DecodedAudioCache keeps decoded audio files in memory, within a budget in bytes, so that
+ *	clips using the same files share a single decoded copy. Files are mixed down to mono, which
+ *	is what the analysis works on, unless the cache keeps their channels for playing them.
+ *	When the budget is exceeded, the least recently used files are evicted first. Files that
+ *	are acquired can't be evicted until they're released, so the budget can be exceeded
+ *	temporarily if all the files are in use.
+ *	A DecodedAudioCache isn't thread safe, but the DecodedAudio instances it returns can be
+ *	read concurrently until they're released.
+ */
+class DecodedAudioCache
+{
+private:
+	struct CacheEntry
+	{
+		DecodedAudio*						m_DecodedAudio;
+		unsigned int						m_NbAcquisitions;
+		std::list<std::string>::iterator	m_ItLeastRecentlyUsed;
+	};
+
+	typedef std::map<std::string, CacheEntry> CacheEntries;
+
+	size_t					m_Budget;
+	size_t					m_Size;
+	bool					m_KeepChannels;
+	CacheEntries			m_Entries;
+
+	// Keys of m_Entries, least recently used first
+	std::list<std::string>	m_LeastRecentlyUsed;
+
+	void EvictUntilWithinBudget();
+
+public:
+	explicit DecodedAudioCache(size_t budget, bool keepChannels = false);
+	~DecodedAudioCache();
+
+	// Returns the decoded samples of the file at filePath, mixed down to mono or with all its
+	// channels, decoding it if it isn't in the cache yet. Returns 0 if the file couldn't be
+	// decoded.
+	// Every successful call must be matched by a call to Release.
+	const DecodedAudio* Acquire(const std::string& filePath);
+	void Release(const DecodedAudio* decodedAudio);
+
+	// Adds audio decoded by the caller, so that it can be decoded without holding the cache,
+	// and returns it acquired, as Acquire does. The cache takes ownership of decodedAudio, which
+	// must be mixed down to mono or not as the cache keeps them. If its file is already in the
+	// cache, decodedAudio is deleted and the cached copy returned.
+	const DecodedAudio* Add(DecodedAudio* decodedAudio);
+
+	// Returns true if the file at filePath is currently in the cache
+	bool Contains(const std::string& filePath) const;
+
+	bool KeepsChannels() const { return m_KeepChannels; }
+
+	// Changing the budget evicts files immediately if needed
+	void SetBudget(size_t budget);
+	size_t GetBudget() const { return m_Budget; }
+
+	// Number of bytes of decoded samples currently in the cache
+	size_t GetSize() const { return m_Size; }
+};
+
+#endif // DECODEDAUDIOCACHE_H_
@@ -0,0 +1,198 @@
+#include <cmath>
+#include <algorithm>
+
+#include "driftanalyzer.h"
+#include "mathutils.h"
+
+#define DEFAULT_NB_BEATS_PER_BAR				4
+#define DEFAULT_MAX_BEAT_DEVIATION				0.25	// Peaks further than a quarter of a beat from the grid are off-beat
+#define DEFAULT_MIN_CORRECTION					0.005	// in seconds
+#define DEFAULT_MIN_NB_PEAKS_PER_CORRECTION		2
+
+DriftAnalyzer::Options::Options()
+	:	m_BPM(0.0),
+		m_GridOffset(0.0),
+		m_NbBeatsPerBar(DEFAULT_NB_BEATS_PER_BAR),
+		m_MaxBeatDeviation(DEFAULT_MAX_BEAT_DEVIATION),
+		m_MinCorrection(DEFAULT_MIN_CORRECTION),
+		m_MinNbPeaksPerCorrection(DEFAULT_MIN_NB_PEAKS_PER_CORRECTION)
+{
+}
+
+bool DriftAnalyzer::Options::IsValid() const
+{
+	return	m_BPM				> 0.0	&&
+			m_NbBeatsPerBar		> 0		&&
+			m_MaxBeatDeviation	> 0.0	&&
+			m_MaxBeatDeviation	<= 0.5	&&
+			m_MinCorrection		>= 0.0;
+}
+
+// Running sums giving a Deviation
+class DeviationAccumulator
+{
+private:
+	unsigned int	m_NbPeaks;
+	double			m_Sum;
+	double			m_SumOfSquares;
+	double			m_MaxDeviation;
+
+public:
+	DeviationAccumulator() { Reset(); }
+
+	void Reset()
+	{
+		m_NbPeaks		= 0;
+		m_Sum			= 0.0;
+		m_SumOfSquares	= 0.0;
+		m_MaxDeviation	= 0.0;
+	}
+
+	void Add(double deviation)
+	{
+		++m_NbPeaks;
+		m_Sum			+= deviation;
+		m_SumOfSquares	+= deviation * deviation;
+		m_MaxDeviation	= std::max(m_MaxDeviation, fabs(deviation));
+	}
+
+	void Get(DriftAnalyzer::Deviation& outDeviation) const
+	{
+		outDeviation.m_NbPeaks			= m_NbPeaks;
+		outDeviation.m_MeanDeviation	= m_NbPeaks ? m_Sum / m_NbPeaks : 0.0;
+		outDeviation.m_RmsDeviation		= m_NbPeaks ? sqrt(m_SumOfSquares / m_NbPeaks) : 0.0;
+		outDeviation.m_MaxDeviation		= m_MaxDeviation;
+	}
+};
+
+// Appends the drift of a bar to the report, with its corrective warp marker if it needs one.
+// anchorFits is false if the marker wouldn't fit between the existing ones.
+static void AddBarDrift(unsigned int barIndex, const DeviationAccumulator& barDeviation, const WarpMarker& anchorWarpMarker, bool anchorFits, 
+						const DriftAnalyzer::Options& options, DriftAnalyzer::Report& inOutReport)
+{
+	DriftAnalyzer::BarDrift barDrift;
+	barDeviation.Get(barDrift);
+	barDrift.m_BarIndex = barIndex;
+	inOutReport.m_Bars.push_back(barDrift);
+
+	if (anchorFits && barDrift.m_NbPeaks >= options.m_MinNbPeaksPerCorrection && fabs(barDrift.m_MeanDeviation) >= options.m_MinCorrection)
+	{
+		inOutReport.m_SuggestedWarpMarkers.push_back(anchorWarpMarker);
+	}
+}
+
+bool DriftAnalyzer::Analyze(const AClip& clip, const Options& options, Report& outReport)
+{
+	outReport = Report();
+
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	if (!options.IsValid() || !AudioInfo::CheckAudioInfo(audioInfo))
+	{
+		return false;
+	}
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+	if (warpMarkers.size() < 2)
+	{
+		return false;
+	}
+
+	const double beatDuration = 60.0 / options.m_BPM;
+	const double maxDeviation = options.m_MaxBeatDeviation * beatDuration;
+
+	DeviationAccumulator clipDeviation, barDeviation;
+	unsigned int barIndex = 0;
+	bool barStarted = false;
+
+	// First on-beat peak of the current bar, put on its beat
+	WarpMarker anchorWarpMarker;
+	bool anchorFits = false;
+
+	// Both peaks and warp markers are sorted by sample position: the warp markers around a peak 
+	// are found by moving forward from those of the previous peak
+	const std::vector<Peak>& peaks = clip.GetPeaks();
+	size_t lowBoundIndex = 0;
+	for (std::vector<Peak>::const_iterator itPeaks = peaks.begin(); itPeaks != peaks.end(); ++itPeaks)
+	{
+		SamplePosition samplePosition = itPeaks->GetPeakSampleIndex();
+		if (samplePosition < warpMarkers.front().GetSamplePosition())
+		{
+			continue;
+		}
+
+		while (lowBoundIndex + 2 < warpMarkers.size() && warpMarkers[lowBoundIndex + 1].GetSamplePosition() <= samplePosition)
+		{
+			++lowBoundIndex;
+		}
+
+		const WarpMarker& lowBoundMarker = warpMarkers[lowBoundIndex];
+		const WarpMarker& highBoundMarker = warpMarkers[lowBoundIndex + 1];
+		if (samplePosition > highBoundMarker.GetSamplePosition())
+		{
+			break;
+		}
+
+		++outReport.m_NbPeaks;
+
+		double beatTime = MathUtils::LinearMap(	static_cast<double>(samplePosition), 
+												static_cast<double>(lowBoundMarker.GetSamplePosition()), static_cast<double>(highBoundMarker.GetSamplePosition()), 
+												lowBoundMarker.GetBeatTime(), highBoundMarker.GetBeatTime());
+
+		double gridBeatIndex = floor((beatTime - options.m_GridOffset) / beatDuration + 0.5);
+		double gridBeatTime = options.m_GridOffset + gridBeatIndex * beatDuration;
+		double deviation = beatTime - gridBeatTime;
+		if (gridBeatIndex < 0.0 || fabs(deviation) > maxDeviation)
+		{
+			continue;
+		}
+
+		unsigned int peakBarIndex = static_cast<unsigned int>(gridBeatIndex) / options.m_NbBeatsPerBar;
+		if (!barStarted || peakBarIndex != barIndex)
+		{
+			if (barStarted)
+			{
+				AddBarDrift(barIndex, barDeviation, anchorWarpMarker, anchorFits, options, outReport);
+			}
+
+			barStarted	= true;
+			barIndex	= peakBarIndex;
+			barDeviation.Reset();
+
+			// A marker on an existing one, or moving the beat past its neighbours, can't be added
+			anchorWarpMarker = WarpMarker(samplePosition, WarpMarker::ToBeatPosition(gridBeatTime));
+			anchorFits =	anchorWarpMarker.GetSamplePosition()	> lowBoundMarker.GetSamplePosition()	&& anchorWarpMarker.GetSamplePosition()	< highBoundMarker.GetSamplePosition()	&&
+							anchorWarpMarker.GetBeatPosition()		> lowBoundMarker.GetBeatPosition()		&& anchorWarpMarker.GetBeatPosition()	< highBoundMarker.GetBeatPosition();
+		}
+
+		barDeviation.Add(deviation);
+		clipDeviation.Add(deviation);
+	}
+
+	if (barStarted)
+	{
+		AddBarDrift(barIndex, barDeviation, anchorWarpMarker, anchorFits, options, outReport);
+	}
+
+	clipDeviation.Get(outReport.m_Deviation);
+	return true;
+}
+
+bool DriftAnalyzer::AnalyzeClips(const std::vector<const AClip*>& clips, const Options& options, std::vector<Report>& outReports)
+{
+	outReports.resize(clips.size());
+
+	// Clips are only read, and each report is written by a single thread
+	const int nbClips = static_cast<int>(clips.size());
+	int nbFailedClips = 0;
+	#pragma omp parallel for schedule(dynamic) reduction(+:nbFailedClips)
+	for (int clipIndex = 0; clipIndex < nbClips; ++clipIndex)
+	{
+		if (!Analyze(*clips[clipIndex], options, outReports[clipIndex]))
+		{
+			++nbFailedClips;
+		}
+	}
+
+	return !nbFailedClips;
+}
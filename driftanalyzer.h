@@ -0,0 +1,71 @@
+#ifndef DRIFTANALYZER_H_
+#define DRIFTANALYZER_H_
+
+#include <vector>
+
+#include "Clip.h"
+
+/**
+ *	A DriftAnalyzer checks how well the warp markers of a clip put its detected peaks on the 
+ *	beat grid of the set. Each peak is mapped to set time through the warp markers, and its 
+ *	deviation from the closest beat of the grid is measured. Deviations are summarized per bar,
+ *	and corrective warp markers are suggested for the bars that drift.
+ *	Peaks and warp markers are both sorted by sample time, so they are merged in a single pass:
+ *	the cost is linear in the number of peaks and markers.
+ */
+class DriftAnalyzer
+{
+public:
+	struct Options
+	{
+		double			m_BPM;					// Tempo of the grid, in beats per minute of set time
+		double			m_GridOffset;			// Set time of the first beat of the grid, in seconds
+		unsigned int	m_NbBeatsPerBar;
+		double			m_MaxBeatDeviation;		// Fraction of a beat beyond which peaks are off-beat, and ignored
+		double			m_MinCorrection;		// Mean deviation of a bar, in seconds, from which it gets a corrective marker
+		unsigned int	m_MinNbPeaksPerCorrection;	// Number of on-beat peaks a bar needs to get a corrective marker
+
+		Options();
+
+		// Returns true if the options can be used by an analysis
+		bool IsValid() const;
+	};
+
+	// Deviations are in seconds of set time, positive when peaks come after their beat
+	struct Deviation
+	{
+		unsigned int	m_NbPeaks;				// On-beat peaks
+		double			m_MeanDeviation;
+		double			m_RmsDeviation;
+		double			m_MaxDeviation;			// Largest absolute deviation
+
+		Deviation() : m_NbPeaks(0), m_MeanDeviation(0.0), m_RmsDeviation(0.0), m_MaxDeviation(0.0) {}
+	};
+
+	struct BarDrift : public Deviation
+	{
+		unsigned int	m_BarIndex;				// Position of the bar in the grid, from m_GridOffset
+	};
+
+	struct Report
+	{
+		unsigned int			m_NbPeaks;					// Peaks located between the first and the last warp markers
+		Deviation				m_Deviation;				// Of all on-beat peaks
+		std::vector<BarDrift>	m_Bars;						// Bars with at least one on-beat peak, in order
+		
+		// Each puts the first on-beat peak of a drifting bar right on its beat. They fit between
+		// the existing warp markers, and can be added as is.
+		std::vector<WarpMarker>	m_SuggestedWarpMarkers;
+
+		Report() : m_NbPeaks(0) {}
+	};
+
+	// Analyzes a clip with warp markers. It is only read, so the same clip can be analyzed by 
+	// several threads.
+	static bool Analyze(const AClip& clip, const Options& options, Report& outReport);
+
+	// Analyzes several clips in parallel. Returns true if all clips could be analyzed.
+	static bool AnalyzeClips(const std::vector<const AClip*>& clips, const Options& options, std::vector<Report>& outReports);
+};
+
+#endif // DRIFTANALYZER_H_
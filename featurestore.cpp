@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "featurestore.h"
+#include "mathutils.h"
+#include "streamutils.h"
+
+const char PeakColumnStore::MAGIC[4] = { 'S', 'B', 'P', 'K' };
+
+void VarintColumn::Append(SamplePosition value)
+{
+	while (value >= 0x80)
+	{
+		m_Bytes.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+
+	m_Bytes.push_back(static_cast<unsigned char>(value));
+}
+
+bool VarintColumn::Read(size_t& inOutOffset, SamplePosition& outValue) const
+{
+	SamplePosition value = 0;
+	unsigned int shift = 0;
+	size_t offset = inOutOffset;
+
+	while (offset < m_Bytes.size() && shift < 64)
+	{
+		unsigned char byte = m_Bytes[offset++];
+		value |= static_cast<SamplePosition>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			outValue = value;
+			inOutOffset = offset;
+			return true;
+		}
+
+		shift += 7;
+	}
+
+	return false;
+}
+
+bool PeakColumnStore::Cursor::Next(SamplePosition& outPeakPosition, SamplePosition& outAttackPosition)
+{
+	if (!m_Store || m_PeakIndex >= m_Store->m_NbPeaks)
+	{
+		return false;
+	}
+
+	SamplePosition delta = 0;
+	if (!m_Store->m_PositionDeltas.Read(m_PositionsOffset, delta))
+	{
+		return false;
+	}
+
+	SamplePosition attackLead = 0;
+	if (!m_Store->m_AttackLeadsAllZero && !m_Store->m_AttackLeads.Read(m_AttacksOffset, attackLead))
+	{
+		return false;
+	}
+
+	m_PreviousPeakPosition += delta;
+	++m_PeakIndex;
+
+	outPeakPosition = m_PreviousPeakPosition;
+	outAttackPosition = m_PreviousPeakPosition - attackLead;
+
+	return true;
+}
+
+PeakColumnStore::PeakColumnStore()
+{
+	m_SampleRate = 0;
+	Clear();
+}
+
+void PeakColumnStore::Clear()
+{
+	m_NbPeaks				= 0;
+	m_LastPeakPosition		= 0;
+	m_AttackLeadsAllZero	= true;
+
+	m_PositionDeltas.Clear();
+	m_AttackLeads.Clear();
+	m_SparseIndex.clear();
+}
+
+void PeakColumnStore::AddSparseIndexEntry(SamplePosition peakPosition)
+{
+	SparseIndexEntry entry;
+	entry.m_PeakPosition			= peakPosition;
+	entry.m_PreviousPeakPosition	= m_LastPeakPosition;
+	entry.m_PeakIndex				= m_NbPeaks;
+	entry.m_PositionsOffset			= m_PositionDeltas.GetSize();
+	entry.m_AttacksOffset			= m_AttackLeads.GetSize();
+
+	m_SparseIndex.push_back(entry);
+}
+
+bool PeakColumnStore::Append(SamplePosition peakPosition, SamplePosition attackPosition)
+{
+	if ((m_NbPeaks && peakPosition < m_LastPeakPosition) || attackPosition > peakPosition)
+	{
+		return false;
+	}
+
+	if (m_NbPeaks % SPARSE_INDEX_INTERVAL == 0)
+	{
+		AddSparseIndexEntry(peakPosition);
+	}
+
+	SamplePosition attackLead = peakPosition - attackPosition;
+	if (attackLead && m_AttackLeadsAllZero)
+	{
+		// First attack that isn't on its peak, materialize the leads of the previous peaks.
+		// Zeros are single bytes, so the offsets stored in the sparse index are the peak indices.
+		for (size_t peakIndex = 0; peakIndex < m_NbPeaks; ++peakIndex)
+		{
+			m_AttackLeads.Append(0);
+		}
+
+		for (size_t entryIndex = 0; entryIndex < m_SparseIndex.size(); ++entryIndex)
+		{
+			m_SparseIndex[entryIndex].m_AttacksOffset = m_SparseIndex[entryIndex].m_PeakIndex;
+		}
+
+		m_AttackLeadsAllZero = false;
+	}
+
+	m_PositionDeltas.Append(peakPosition - m_LastPeakPosition);
+	if (!m_AttackLeadsAllZero)
+	{
+		m_AttackLeads.Append(attackLead);
+	}
+
+	m_LastPeakPosition = peakPosition;
+	++m_NbPeaks;
+
+	return true;
+}
+
+bool PeakColumnStore::Append(const std::vector<Peak>& peaks)
+{
+	std::vector<Peak>::const_iterator itPeaks = peaks.begin();
+	std::vector<Peak>::const_iterator itPeaksEnd = peaks.end();
+	for (; itPeaks != itPeaksEnd; ++itPeaks)
+	{
+		if (!Append(*itPeaks))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t PeakColumnStore::GetEncodedSize() const
+{
+	return m_PositionDeltas.GetSize() + m_AttackLeads.GetSize() + m_SparseIndex.size() * sizeof(SparseIndexEntry);
+}
+
+PeakColumnStore::Cursor PeakColumnStore::Begin() const
+{
+	Cursor cursor;
+	cursor.m_Store = this;
+
+	return cursor;
+}
+
+struct SparseIndexEntryPositionLess
+{
+	template <typename _Entry>
+	bool operator()(const _Entry& entry, SamplePosition position) const
+	{
+		return entry.m_PeakPosition < position;
+	}
+};
+
+PeakColumnStore::Cursor PeakColumnStore::Seek(SamplePosition position) const
+{
+	Cursor cursor = Begin();
+	if (m_SparseIndex.empty())
+	{
+		return cursor;
+	}
+
+	// Find the last indexed peak located before position, then decode from there
+	std::vector<SparseIndexEntry>::const_iterator itEntry = std::lower_bound(m_SparseIndex.begin(), m_SparseIndex.end(), position, SparseIndexEntryPositionLess());
+	if (itEntry != m_SparseIndex.begin())
+	{
+		--itEntry;
+	}
+
+	cursor.m_PeakIndex				= itEntry->m_PeakIndex;
+	cursor.m_PositionsOffset		= itEntry->m_PositionsOffset;
+	cursor.m_AttacksOffset			= itEntry->m_AttacksOffset;
+	cursor.m_PreviousPeakPosition	= itEntry->m_PreviousPeakPosition;
+
+	Cursor candidate = cursor;
+	SamplePosition peakPosition = 0;
+	SamplePosition attackPosition = 0;
+	while (candidate.Next(peakPosition, attackPosition) && peakPosition < position)
+	{
+		cursor = candidate;
+	}
+
+	return cursor;
+}
+
+bool PeakColumnStore::SeekTime(double time, Cursor& outCursor) const
+{
+	if (!m_SampleRate || time < 0.0)
+	{
+		return false;
+	}
+
+	outCursor = Seek(static_cast<SamplePosition>(MathUtils::Round(time * m_SampleRate)));
+	return true;
+}
+
+bool PeakColumnStore::Decode(std::vector<Peak>& outPeaks) const
+{
+	outPeaks.reserve(outPeaks.size() + m_NbPeaks);
+
+	Cursor cursor = Begin();
+	SamplePosition peakPosition = 0;
+	SamplePosition attackPosition = 0;
+	while (cursor.Next(peakPosition, attackPosition))
+	{
+		if (peakPosition > UINT_MAX)
+		{
+			return false;
+		}
+
+		outPeaks.push_back(Peak(static_cast<unsigned int>(peakPosition), static_cast<unsigned int>(attackPosition)));
+	}
+
+	return true;
+}
+
+bool PeakColumnStore::Write(std::ostream& outputStream) const
+{
+	outputStream.write(MAGIC, 4);
+	StreamUtils::WriteUInt64(outputStream, VERSION);
+	StreamUtils::WriteUInt64(outputStream, m_SampleRate);
+	StreamUtils::WriteUInt64(outputStream, m_NbPeaks);
+	StreamUtils::WriteUInt64(outputStream, m_PositionDeltas.GetSize());
+	StreamUtils::WriteUInt64(outputStream, m_AttackLeads.GetSize());
+
+	if (m_PositionDeltas.GetSize())
+	{
+		outputStream.write(reinterpret_cast<const char*>(&m_PositionDeltas.GetBytes()[0]), m_PositionDeltas.GetSize());
+	}
+
+	if (m_AttackLeads.GetSize())
+	{
+		outputStream.write(reinterpret_cast<const char*>(&m_AttackLeads.GetBytes()[0]), m_AttackLeads.GetSize());
+	}
+
+	return outputStream.good();
+}
+
+bool PeakColumnStore::Read(std::istream& inputStream)
+{
+	Clear();
+
+	char magic[4];
+	inputStream.read(magic, 4);
+	if (!inputStream || memcmp(magic, MAGIC, 4))
+	{
+		return false;
+	}
+
+	SamplePosition version = 0, sampleRate = 0, nbPeaks = 0, positionsSize = 0, attacksSize = 0;
+	if (!StreamUtils::ReadUInt64(inputStream, version)			|| version != VERSION						||
+		!StreamUtils::ReadUInt64(inputStream, sampleRate)		|| sampleRate > UINT_MAX					||
+		!StreamUtils::ReadUInt64(inputStream, nbPeaks)			||
+		!StreamUtils::ReadUInt64(inputStream, positionsSize)	|| positionsSize < nbPeaks					||
+		!StreamUtils::ReadUInt64(inputStream, attacksSize)		|| (attacksSize && attacksSize < nbPeaks))
+	{
+		return false;
+	}
+
+	// Each column is rejected if it's larger than what's left of the stream
+	if (!StreamUtils::ReadBytes(inputStream, positionsSize, m_PositionDeltas.GetBytes()) || !StreamUtils::ReadBytes(inputStream, attacksSize, m_AttackLeads.GetBytes()))
+	{
+		Clear();
+		return false;
+	}
+
+	m_SampleRate			= static_cast<unsigned int>(sampleRate);
+	m_NbPeaks				= static_cast<size_t>(nbPeaks);
+	m_AttackLeadsAllZero	= (attacksSize == 0);
+
+	if (!RebuildSparseIndex())
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool PeakColumnStore::RebuildSparseIndex()
+{
+	m_SparseIndex.clear();
+
+	Cursor cursor = Begin();
+	for (size_t peakIndex = 0; peakIndex < m_NbPeaks; ++peakIndex)
+	{
+		Cursor peakStart = cursor;
+		SamplePosition peakPosition = 0;
+		SamplePosition attackPosition = 0;
+		if (!cursor.Next(peakPosition, attackPosition))
+		{
+			return false;
+		}
+
+		if (peakIndex % SPARSE_INDEX_INTERVAL == 0)
+		{
+			SparseIndexEntry entry;
+			entry.m_PeakPosition			= peakPosition;
+			entry.m_PreviousPeakPosition	= peakStart.m_PreviousPeakPosition;
+			entry.m_PeakIndex				= peakIndex;
+			entry.m_PositionsOffset			= peakStart.m_PositionsOffset;
+			entry.m_AttacksOffset			= peakStart.m_AttacksOffset;
+
+			m_SparseIndex.push_back(entry);
+		}
+	}
+
+	m_LastPeakPosition = cursor.m_PreviousPeakPosition;
+
+	// Trailing bytes mean the columns don't match the peak count
+	return cursor.m_PositionsOffset == m_PositionDeltas.GetSize() && (m_AttackLeadsAllZero || cursor.m_AttacksOffset == m_AttackLeads.GetSize());
+}
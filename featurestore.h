@@ -0,0 +1,134 @@
+#ifndef FEATURESTORE_H_
+#define FEATURESTORE_H_
+
+#include <vector>
+#include <istream>
+#include <ostream>
+
+#include "audioformats.h"
+#include "soundfeatures.h"
+
+/**
+ *	A VarintColumn stores a sequence of unsigned 64 bits values as LEB128 varints: 7 bits per
+ *	byte, high bit set when more bytes follow. Small values take a single byte.
+ */
+class VarintColumn
+{
+private:
+	std::vector<unsigned char>	m_Bytes;
+
+public:
+	void Clear() { m_Bytes.clear(); }
+
+	void Append(SamplePosition value);
+
+	// Decodes the value starting at byte offset inOutOffset and moves inOutOffset past it.
+	// Returns false if the column ends in the middle of a value.
+	bool Read(size_t& inOutOffset, SamplePosition& outValue) const;
+
+	size_t GetSize() const { return m_Bytes.size(); }
+
+	const std::vector<unsigned char>& GetBytes() const { return m_Bytes; }
+	std::vector<unsigned char>& GetBytes() { return m_Bytes; }
+};
+
+/**
+ *	A PeakColumnStore keeps peaks sorted by sample position in a compact columnar layout,
+ *	which is the same in memory and on disk:
+ *	 - the positions column holds the difference between each peak position and the previous
+ *	   one, varint encoded. At usual tempos that's 2 or 3 bytes per peak.
+ *	 - the attack column holds how many samples before its peak each attack starts. Peak
+ *	   detectors that don't locate attacks report them on the peak itself, so as long as all
+ *	   values are zero the column isn't materialized at all.
+ *	Positions are 64 bits. A sparse index keeps the absolute position and column offsets of
+ *	every SPARSE_INDEX_INTERVAL-th peak, so that seeking to a given time only decodes at most
+ *	SPARSE_INDEX_INTERVAL peaks.
+ *	Other onset features can be added later as additional columns.
+ */
+class PeakColumnStore
+{
+public:
+	static const unsigned int SPARSE_INDEX_INTERVAL = 64;
+
+	// On-disk format
+	static const char MAGIC[4];
+	static const unsigned int VERSION = 1;
+
+	// Reads peaks sequentially from a PeakColumnStore
+	class Cursor
+	{
+	private:
+		friend class PeakColumnStore;
+
+		const PeakColumnStore*	m_Store;
+		size_t					m_PeakIndex;
+		size_t					m_PositionsOffset;
+		size_t					m_AttacksOffset;
+		SamplePosition			m_PreviousPeakPosition;
+
+	public:
+		Cursor() : m_Store(0), m_PeakIndex(0), m_PositionsOffset(0), m_AttacksOffset(0), m_PreviousPeakPosition(0) {}
+
+		// Gets the next peak. Returns false when there's no peak left.
+		bool Next(SamplePosition& outPeakPosition, SamplePosition& outAttackPosition);
+	};
+
+	PeakColumnStore();
+
+	void Clear();
+
+	// Sample rate used to convert times in seconds to sample positions
+	void SetSampleRate(unsigned int sampleRate) { m_SampleRate = sampleRate; }
+	unsigned int GetSampleRate() const { return m_SampleRate; }
+
+	// Appends a peak. Peaks must be appended in increasing order of peak position and attacks
+	// can't start after their peak. Returns false if that's not the case.
+	bool Append(SamplePosition peakPosition, SamplePosition attackPosition);
+	bool Append(const Peak& peak) { return Append(peak.GetPeakSampleIndex(), peak.GetAttackSampleIndex()); }
+	bool Append(const std::vector<Peak>& peaks);
+
+	size_t GetNbPeaks() const { return m_NbPeaks; }
+
+	// Number of bytes used by the encoded columns and the sparse index
+	size_t GetEncodedSize() const;
+
+	// Returns a cursor on the first peak of the store
+	Cursor Begin() const;
+
+	// Returns a cursor on the first peak located at or after position
+	Cursor Seek(SamplePosition position) const;
+
+	// Same as Seek, with a time in seconds. Returns false if the sample rate is unknown.
+	bool SeekTime(double time, Cursor& outCursor) const;
+
+	// Decodes all the peaks in outPeaks. Returns false if a position doesn't fit in a Peak.
+	bool Decode(std::vector<Peak>& outPeaks) const;
+
+	// Writes/reads the store in its on-disk format. The sparse index isn't written, it is
+	// rebuilt while reading.
+	bool Write(std::ostream& outputStream) const;
+	bool Read(std::istream& inputStream);
+
+private:
+	struct SparseIndexEntry
+	{
+		SamplePosition	m_PeakPosition;
+		SamplePosition	m_PreviousPeakPosition;
+		size_t			m_PeakIndex;
+		size_t			m_PositionsOffset;
+		size_t			m_AttacksOffset;
+	};
+
+	unsigned int					m_SampleRate;
+	size_t							m_NbPeaks;
+	SamplePosition					m_LastPeakPosition;
+	VarintColumn					m_PositionDeltas;
+	VarintColumn					m_AttackLeads;
+	bool							m_AttackLeadsAllZero;
+	std::vector<SparseIndexEntry>	m_SparseIndex;
+
+	void AddSparseIndexEntry(SamplePosition peakPosition);
+	bool RebuildSparseIndex();
+};
+
+#endif // FEATURESTORE_H_
@@ -0,0 +1,133 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+
+#include "fft.h"
+
+bool Fft::IsValidSize(unsigned int size)
+{
+	return size >= 4 && !(size & (size - 1));
+}
+
+Fft::Fft(unsigned int size)
+	:	m_Size(size)
+{
+	const unsigned int nbValues = m_Size / 2;
+
+	unsigned int nbBits = 0;
+	while ((1u << nbBits) < nbValues)
+	{
+		++nbBits;
+	}
+
+	m_BitReversedIndices.resize(nbValues);
+	for (unsigned int index = 0; index < nbValues; ++index)
+	{
+		unsigned int reversedIndex = 0;
+		for (unsigned int bitIndex = 0; bitIndex < nbBits; ++bitIndex)
+		{
+			reversedIndex |= ((index >> bitIndex) & 1) << (nbBits - 1 - bitIndex);
+		}
+
+		m_BitReversedIndices[index] = reversedIndex;
+	}
+
+	// Forward transforms turn by -2 pi k / n, hence the negative sines
+	m_Cosines.resize(nbValues / 2);
+	m_Sines.resize(nbValues / 2);
+	for (unsigned int twiddleIndex = 0; twiddleIndex < nbValues / 2; ++twiddleIndex)
+	{
+		double angle = 2.0 * M_PI * twiddleIndex / nbValues;
+		m_Cosines[twiddleIndex] = static_cast<float>(cos(angle));
+		m_Sines[twiddleIndex] = static_cast<float>(-sin(angle));
+	}
+
+	m_SplitCosines.resize(nbValues / 2 + 1);
+	m_SplitSines.resize(nbValues / 2 + 1);
+	for (unsigned int binIndex = 0; binIndex <= nbValues / 2; ++binIndex)
+	{
+		double angle = 2.0 * M_PI * binIndex / m_Size;
+		m_SplitCosines[binIndex] = static_cast<float>(cos(angle));
+		m_SplitSines[binIndex] = static_cast<float>(-sin(angle));
+	}
+}
+
+void Fft::ForwardComplex(float* real, float* imaginary) const
+{
+	const unsigned int nbValues = m_Size / 2;
+	for (unsigned int index = 0; index < nbValues; ++index)
+	{
+		unsigned int reversedIndex = m_BitReversedIndices[index];
+		if (reversedIndex > index)
+		{
+			std::swap(real[index], real[reversedIndex]);
+			std::swap(imaginary[index], imaginary[reversedIndex]);
+		}
+	}
+
+	for (unsigned int halfLength = 1; halfLength < nbValues; halfLength *= 2)
+	{
+		const unsigned int twiddleStep = nbValues / (2 * halfLength);
+		for (unsigned int twiddleIndex = 0; twiddleIndex < halfLength; ++twiddleIndex)
+		{
+			const float twiddleReal = m_Cosines[twiddleIndex * twiddleStep];
+			const float twiddleImaginary = m_Sines[twiddleIndex * twiddleStep];
+			for (unsigned int firstIndex = twiddleIndex; firstIndex < nbValues; firstIndex += 2 * halfLength)
+			{
+				const unsigned int secondIndex = firstIndex + halfLength;
+				float turnedReal = twiddleReal * real[secondIndex] - twiddleImaginary * imaginary[secondIndex];
+				float turnedImaginary = twiddleReal * imaginary[secondIndex] + twiddleImaginary * real[secondIndex];
+				real[secondIndex] = real[firstIndex] - turnedReal;
+				imaginary[secondIndex] = imaginary[firstIndex] - turnedImaginary;
+				real[firstIndex] += turnedReal;
+				imaginary[firstIndex] += turnedImaginary;
+			}
+		}
+	}
+}
+
+void Fft::Forward(const float* samples, float* outReal, float* outImaginary) const
+{
+	const unsigned int nbValues = m_Size / 2;
+	for (unsigned int index = 0; index < nbValues; ++index)
+	{
+		outReal[index] = samples[2 * index];
+		outImaginary[index] = samples[2 * index + 1];
+	}
+
+	ForwardComplex(outReal, outImaginary);
+
+	// Bin k of the even samples is E = (Z[k] + conj(Z[n/2 - k])) / 2, of the odd ones
+	// O = (Z[k] - conj(Z[n/2 - k])) / 2i. Bin k is then E + W^k O, and bin n/2 - k the
+	// conjugate of E - W^k O, so both are computed at once, in place.
+	const float firstReal = outReal[0];
+	const float firstImaginary = outImaginary[0];
+	outReal[0] = firstReal + firstImaginary;
+	outImaginary[0] = 0.0f;
+	outReal[nbValues] = firstReal - firstImaginary;
+	outImaginary[nbValues] = 0.0f;
+
+	for (unsigned int binIndex = 1; binIndex <= nbValues / 2; ++binIndex)
+	{
+		const unsigned int mirrorIndex = nbValues - binIndex;
+		const float valueReal = outReal[binIndex];
+		const float valueImaginary = outImaginary[binIndex];
+		const float mirrorReal = outReal[mirrorIndex];
+		const float mirrorImaginary = -outImaginary[mirrorIndex];
+
+		const float evenReal = 0.5f * (valueReal + mirrorReal);
+		const float evenImaginary = 0.5f * (valueImaginary + mirrorImaginary);
+		const float oddReal = 0.5f * (valueImaginary - mirrorImaginary);
+		const float oddImaginary = -0.5f * (valueReal - mirrorReal);
+
+		const float twiddleReal = m_SplitCosines[binIndex];
+		const float twiddleImaginary = m_SplitSines[binIndex];
+		const float turnedReal = twiddleReal * oddReal - twiddleImaginary * oddImaginary;
+		const float turnedImaginary = twiddleReal * oddImaginary + twiddleImaginary * oddReal;
+
+		outReal[binIndex] = evenReal + turnedReal;
+		outImaginary[binIndex] = evenImaginary + turnedImaginary;
+		outReal[mirrorIndex] = evenReal - turnedReal;
+		outImaginary[mirrorIndex] = turnedImaginary - evenImaginary;
+	}
+}
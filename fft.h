@@ -0,0 +1,46 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <vector>
+
+/**
+ *	An Fft computes the discrete Fourier transform of blocks of real samples, of a power of two
+ *	size. The transform of N real samples is computed as a complex transform of N/2 values, the
+ *	even samples as real parts and the odd ones as imaginary parts, whose bins are then split.
+ *	The complex transform is an iterative radix-2 one, with precomputed twiddle factors.
+ *	An Fft isn't modified by the transforms, so one instance can be used by several threads.
+ */
+class Fft
+{
+public:
+	// size must be a power of two, from 4
+	explicit Fft(unsigned int size);
+
+	unsigned int GetSize() const { return m_Size; }
+
+	// Number of bins of the transform of GetSize() real samples, from 0 to the Nyquist frequency
+	unsigned int GetNbBins() const { return m_Size / 2 + 1; }
+
+	// Transforms GetSize() samples into GetNbBins() bins, outReal and outImaginary must have room
+	// for that many values. They are used as scratch memory too, so they can't be samples.
+	void Forward(const float* samples, float* outReal, float* outImaginary) const;
+
+	static bool IsValidSize(unsigned int size);
+
+private:
+	unsigned int				m_Size;
+
+	// Of the complex transform of m_Size / 2 values
+	std::vector<unsigned int>	m_BitReversedIndices;
+	std::vector<float>			m_Cosines;
+	std::vector<float>			m_Sines;
+
+	// Twiddle factors splitting the complex transform into the real one
+	std::vector<float>			m_SplitCosines;
+	std::vector<float>			m_SplitSines;
+
+	// In place transform of m_Size / 2 complex values
+	void ForwardComplex(float* real, float* imaginary) const;
+};
+
+#endif // FFT_H_
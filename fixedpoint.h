@@ -0,0 +1,78 @@
+#ifndef FIXEDPOINT_H_
+#define FIXEDPOINT_H_
+
+#include <cmath>
+#include <climits>
+
+/**
+ *	A FixedPoint is a signed number in Q format: a 32 bits integer whose _FractionalBits low 
+ *	bits are the fractional part. It supports the few operations the peak detectors need, so 
+ *	that they can be instantiated on targets without a floating point unit. Products are 
+ *	computed on 64 bits and rounded to the nearest value, conversions from double saturate.
+ */
+template <unsigned int _FractionalBits>
+class FixedPoint
+{
+private:
+	int		m_Value;
+
+public:
+	FixedPoint() : m_Value(0) {}
+
+	explicit FixedPoint(double value)
+	{
+		double scaledValue = floor(value * (1 << _FractionalBits) + 0.5);
+		if (scaledValue >= INT_MAX)
+		{
+			m_Value = INT_MAX;
+		}
+		else if (scaledValue <= -INT_MAX)
+		{
+			m_Value = -INT_MAX;
+		}
+		else
+		{
+			m_Value = static_cast<int>(scaledValue);
+		}
+	}
+
+	static FixedPoint FromRaw(int value)
+	{
+		FixedPoint fixedPoint;
+		fixedPoint.m_Value = value;
+		return fixedPoint;
+	}
+
+	int GetRaw() const { return m_Value; }
+	double ToDouble() const { return static_cast<double>(m_Value) / (1 << _FractionalBits); }
+
+	FixedPoint operator+(FixedPoint rhs) const { return FromRaw(m_Value + rhs.m_Value); }
+	FixedPoint operator-(FixedPoint rhs) const { return FromRaw(m_Value - rhs.m_Value); }
+	FixedPoint operator-() const { return FromRaw(-m_Value); }
+
+	FixedPoint operator*(FixedPoint rhs) const
+	{
+		long long product = static_cast<long long>(m_Value) * rhs.m_Value;
+		return FromRaw(static_cast<int>((product + (1LL << (_FractionalBits - 1))) >> _FractionalBits));
+	}
+
+	FixedPoint& operator+=(FixedPoint rhs) { m_Value += rhs.m_Value; return *this; }
+	FixedPoint& operator-=(FixedPoint rhs) { m_Value -= rhs.m_Value; return *this; }
+	FixedPoint& operator*=(FixedPoint rhs) { return *this = *this * rhs; }
+
+	bool operator<(FixedPoint rhs) const	{ return m_Value < rhs.m_Value; }
+	bool operator>(FixedPoint rhs) const	{ return m_Value > rhs.m_Value; }
+	bool operator<=(FixedPoint rhs) const	{ return m_Value <= rhs.m_Value; }
+	bool operator>=(FixedPoint rhs) const	{ return m_Value >= rhs.m_Value; }
+	bool operator==(FixedPoint rhs) const	{ return m_Value == rhs.m_Value; }
+	bool operator!=(FixedPoint rhs) const	{ return m_Value != rhs.m_Value; }
+};
+
+// Found by argument dependent lookup, so that templates can call fabs on any number type
+template <unsigned int _FractionalBits>
+inline FixedPoint<_FractionalBits> fabs(FixedPoint<_FractionalBits> value)
+{
+	return value.GetRaw() < 0 ? -value : value;
+}
+
+#endif // FIXEDPOINT_H_
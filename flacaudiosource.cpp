@@ -0,0 +1,1111 @@
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "flacaudiosource.h"
+
+#define FLAC_MAX_BITS_PER_SAMPLE	24
+#define FLAC_MAX_LPC_ORDER			32
+
+#define FLAC_METADATA_STREAMINFO	0
+#define FLAC_METADATA_SEEKTABLE		3
+
+// Parts of a parallel decode are at least this long, so that opening their stream is negligible
+#define PARALLEL_DECODE_MIN_SEGMENT_SIZE (1 << 18)
+
+// Size of the blocks the file is read in
+#define READ_CHUNK_SIZE (1 << 20)
+
+static std::string s_SeekTableCacheDirectory;
+
+static unsigned int CountLeadingZeros(unsigned long long value)
+{
+#if defined(_MSC_VER)
+	unsigned long bitIndex;
+	if (_BitScanReverse(&bitIndex, static_cast<unsigned long>(value >> 32)))
+	{
+		return 31 - bitIndex;
+	}
+
+	_BitScanReverse(&bitIndex, static_cast<unsigned long>(value));
+	return 63 - bitIndex;
+#else
+	return __builtin_clzll(value);
+#endif
+}
+
+/**
+ *	Tables of the CRC-8 protecting frame headers and of the CRC-16 protecting whole frames,
+ *	built once before main so that concurrent decodes can share them.
+ */
+struct FlacCrcTables
+{
+	unsigned char	m_Crc8[256];
+	unsigned short	m_Crc16[256];
+
+	FlacCrcTables()
+	{
+		for (unsigned int byte = 0; byte < 256; ++byte)
+		{
+			unsigned int crc8 = byte;
+			unsigned int crc16 = byte << 8;
+			for (unsigned int bitIndex = 0; bitIndex < 8; ++bitIndex)
+			{
+				crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+				crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+			}
+
+			m_Crc8[byte] = static_cast<unsigned char>(crc8);
+			m_Crc16[byte] = static_cast<unsigned short>(crc16);
+		}
+	}
+
+	unsigned int ComputeCrc8(const unsigned char* bytes, size_t nbBytes) const
+	{
+		unsigned int crc = 0;
+		for (size_t byteIndex = 0; byteIndex < nbBytes; ++byteIndex)
+		{
+			crc = m_Crc8[crc ^ bytes[byteIndex]];
+		}
+
+		return crc;
+	}
+
+	unsigned int ComputeCrc16(const unsigned char* bytes, size_t nbBytes) const
+	{
+		unsigned int crc = 0;
+		for (size_t byteIndex = 0; byteIndex < nbBytes; ++byteIndex)
+		{
+			crc = ((crc << 8) ^ m_Crc16[(crc >> 8) ^ bytes[byteIndex]]) & 0xFFFF;
+		}
+
+		return crc;
+	}
+};
+
+static const FlacCrcTables s_FlacCrcTables;
+
+/**
+ *	Reads a FLAC bitstream, most significant bit first. Bits are served from a 64 bits cache,
+ *	refilled a byte at a time. Reading past the end of the buffer returns zero bits, the caller
+ *	checks IsPastEnd once it's done.
+ */
+class FlacBitReader
+{
+private:
+	const unsigned char*	m_Bytes;
+	size_t					m_NbBytes;
+	size_t					m_NextByteIndex;
+	unsigned long long		m_Cache;			// Next bits to read, left aligned
+	unsigned int			m_NbCachedBits;
+
+	void Refill()
+	{
+		while (m_NbCachedBits <= 56)
+		{
+			unsigned long long byte = m_NextByteIndex < m_NbBytes ? m_Bytes[m_NextByteIndex] : 0;
+			m_Cache |= byte << (56 - m_NbCachedBits);
+			m_NbCachedBits += 8;
+			++m_NextByteIndex;
+		}
+	}
+
+public:
+	FlacBitReader(const unsigned char* bytes, size_t nbBytes)
+		:	m_Bytes(bytes),
+			m_NbBytes(nbBytes),
+			m_NextByteIndex(0),
+			m_Cache(0),
+			m_NbCachedBits(0)
+	{
+		Refill();
+	}
+
+	// nbBits must be at most 32
+	unsigned int ReadBits(unsigned int nbBits)
+	{
+		if (!nbBits)
+		{
+			return 0;
+		}
+
+		if (m_NbCachedBits < nbBits)
+		{
+			Refill();
+		}
+
+		unsigned int value = static_cast<unsigned int>(m_Cache >> (64 - nbBits));
+		m_Cache <<= nbBits;
+		m_NbCachedBits -= nbBits;
+		return value;
+	}
+
+	int ReadSignedBits(unsigned int nbBits)
+	{
+		unsigned int value = ReadBits(nbBits);
+		if (nbBits && nbBits < 32 && (value >> (nbBits - 1)))
+		{
+			value |= ~0u << nbBits;
+		}
+
+		return static_cast<int>(value);
+	}
+
+	// Reads zero bits up to the next one bit, and returns how many there were
+	unsigned int ReadUnary()
+	{
+		unsigned int nbZeros = 0;
+		for (;;)
+		{
+			// Bits after the cached ones are always zero
+			if (m_Cache)
+			{
+				unsigned int nbLeadingZeros = CountLeadingZeros(m_Cache);
+				m_Cache = nbLeadingZeros < 63 ? m_Cache << (nbLeadingZeros + 1) : 0;
+				m_NbCachedBits -= nbLeadingZeros + 1;
+				return nbZeros + nbLeadingZeros;
+			}
+
+			nbZeros += m_NbCachedBits;
+			m_NbCachedBits = 0;
+			if (IsPastEnd())
+			{
+				return nbZeros;
+			}
+
+			Refill();
+		}
+	}
+
+	void AlignToByte()
+	{
+		ReadBits(m_NbCachedBits % 8);
+	}
+
+	size_t GetBitPosition() const { return m_NextByteIndex * 8 - m_NbCachedBits; }
+	size_t GetBytePosition() const { return GetBitPosition() / 8; }
+	bool IsPastEnd() const { return GetBitPosition() > m_NbBytes * 8; }
+};
+
+struct FlacFrameHeader
+{
+	unsigned int	m_BlockSize;
+	unsigned int	m_ChannelAssignment;
+	unsigned int	m_BitsPerSample;
+	SamplePosition	m_Number;				// Frame number, or first sample with variable block sizes
+	bool			m_VariableBlockSize;
+	size_t			m_Size;
+};
+
+// Parses and checks the header of the frame at the start of bytes
+static bool ReadFrameHeader(const unsigned char* bytes, size_t nbBytes, const FlacAudioSource::StreamInfo& streamInfo, FlacFrameHeader& outHeader)
+{
+	if (nbBytes < 6 || bytes[0] != 0xFF || (bytes[1] & 0xFE) != 0xF8)
+	{
+		return false;
+	}
+
+	FlacBitReader bitReader(bytes, nbBytes);
+	bitReader.ReadBits(15);
+	outHeader.m_VariableBlockSize = bitReader.ReadBits(1) != 0;
+
+	unsigned int blockSizeCode		= bitReader.ReadBits(4);
+	unsigned int sampleRateCode		= bitReader.ReadBits(4);
+	outHeader.m_ChannelAssignment	= bitReader.ReadBits(4);
+	unsigned int sampleSizeCode		= bitReader.ReadBits(3);
+	if (bitReader.ReadBits(1) || !blockSizeCode || sampleRateCode == 15 || sampleSizeCode == 3 || outHeader.m_ChannelAssignment > 10)
+	{
+		return false;
+	}
+
+	// Frame or sample number, coded like UTF-8 characters on up to 7 bytes
+	unsigned int firstByte = bitReader.ReadBits(8);
+	unsigned int nbLeadingOnes = 0;
+	while (nbLeadingOnes < 8 && (firstByte & (0x80 >> nbLeadingOnes)))
+	{
+		++nbLeadingOnes;
+	}
+
+	if (nbLeadingOnes == 1 || nbLeadingOnes == 8)
+	{
+		return false;
+	}
+
+	unsigned int nbContinuationBytes = nbLeadingOnes ? nbLeadingOnes - 1 : 0;
+	outHeader.m_Number = firstByte & (nbLeadingOnes ? 0x7F >> nbLeadingOnes : 0x7F);
+	for (unsigned int byteIndex = 0; byteIndex < nbContinuationBytes; ++byteIndex)
+	{
+		unsigned int continuationByte = bitReader.ReadBits(8);
+		if ((continuationByte & 0xC0) != 0x80)
+		{
+			return false;
+		}
+
+		outHeader.m_Number = (outHeader.m_Number << 6) | (continuationByte & 0x3F);
+	}
+
+	if (blockSizeCode == 1)
+	{
+		outHeader.m_BlockSize = 192;
+	}
+	else if (blockSizeCode <= 5)
+	{
+		outHeader.m_BlockSize = 576 << (blockSizeCode - 2);
+	}
+	else if (blockSizeCode == 6)
+	{
+		outHeader.m_BlockSize = bitReader.ReadBits(8) + 1;
+	}
+	else if (blockSizeCode == 7)
+	{
+		outHeader.m_BlockSize = bitReader.ReadBits(16) + 1;
+	}
+	else
+	{
+		outHeader.m_BlockSize = 256 << (blockSizeCode - 8);
+	}
+
+	// Samples are always converted at the rate of the stream, only skip the rate of the frame
+	if (sampleRateCode == 12)
+	{
+		bitReader.ReadBits(8);
+	}
+	else if (sampleRateCode == 13 || sampleRateCode == 14)
+	{
+		bitReader.ReadBits(16);
+	}
+
+	static const unsigned int BITS_PER_SAMPLE_BY_CODE[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+	outHeader.m_BitsPerSample = sampleSizeCode ? BITS_PER_SAMPLE_BY_CODE[sampleSizeCode] : streamInfo.m_BitsPerSample;
+
+	size_t crcBytePosition = bitReader.GetBytePosition();
+	unsigned int crc = bitReader.ReadBits(8);
+	if (bitReader.IsPastEnd() || crc != s_FlacCrcTables.ComputeCrc8(bytes, crcBytePosition))
+	{
+		return false;
+	}
+
+	unsigned int nbChannels = outHeader.m_ChannelAssignment < 8 ? outHeader.m_ChannelAssignment + 1 : 2;
+	if (nbChannels != streamInfo.m_NbChannels || outHeader.m_BitsPerSample != streamInfo.m_BitsPerSample || outHeader.m_BlockSize > streamInfo.m_MaxBlockSize)
+	{
+		return false;
+	}
+
+	outHeader.m_Size = bitReader.GetBytePosition();
+	return true;
+}
+
+// Returns true if the frame of header is the one starting at sampleIndex
+static bool IsFrameAt(const FlacFrameHeader& header, SamplePosition sampleIndex, const FlacAudioSource::StreamInfo& streamInfo)
+{
+	// Fixed block size streams number their frames, all of m_MaxBlockSize samples but the last
+	return header.m_VariableBlockSize ? header.m_Number == sampleIndex : header.m_Number * streamInfo.m_MaxBlockSize == sampleIndex;
+}
+
+// Decodes the residual of a predicted subframe in outSamples[order, blockSize)
+static bool DecodeResidual(FlacBitReader& bitReader, unsigned int blockSize, unsigned int order, int* outSamples)
+{
+	unsigned int codingMethod = bitReader.ReadBits(2);
+	if (codingMethod > 1)
+	{
+		return false;
+	}
+
+	unsigned int riceParameterNbBits	= codingMethod ? 5 : 4;
+	unsigned int escapeCode				= codingMethod ? 31 : 15;
+
+	unsigned int partitionOrder = bitReader.ReadBits(4);
+	unsigned int partitionSize = blockSize >> partitionOrder;
+	if ((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+	{
+		return false;
+	}
+
+	unsigned int sampleIndex = order;
+	for (unsigned int partitionIndex = 0; partitionIndex < (1u << partitionOrder); ++partitionIndex)
+	{
+		unsigned int partitionEndSampleIndex = (partitionIndex + 1) * partitionSize;
+		unsigned int riceParameter = bitReader.ReadBits(riceParameterNbBits);
+		if (riceParameter == escapeCode)
+		{
+			// Unencoded partition, each sample is stored on the same number of bits
+			unsigned int nbBits = bitReader.ReadBits(5);
+			for (; sampleIndex < partitionEndSampleIndex; ++sampleIndex)
+			{
+				outSamples[sampleIndex] = bitReader.ReadSignedBits(nbBits);
+			}
+		}
+		else
+		{
+			for (; sampleIndex < partitionEndSampleIndex; ++sampleIndex)
+			{
+				unsigned int value = (bitReader.ReadUnary() << riceParameter) | bitReader.ReadBits(riceParameter);
+				outSamples[sampleIndex] = static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+			}
+		}
+
+		if (bitReader.IsPastEnd())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void RestoreFixedPrediction(unsigned int blockSize, unsigned int order, int* inOutSamples)
+{
+	int* samples = inOutSamples;
+	switch (order)
+	{
+	case 1:
+		for (unsigned int sampleIndex = 1; sampleIndex < blockSize; ++sampleIndex)
+		{
+			samples[sampleIndex] += samples[sampleIndex - 1];
+		}
+		break;
+
+	case 2:
+		for (unsigned int sampleIndex = 2; sampleIndex < blockSize; ++sampleIndex)
+		{
+			samples[sampleIndex] += 2 * samples[sampleIndex - 1] - samples[sampleIndex - 2];
+		}
+		break;
+
+	case 3:
+		for (unsigned int sampleIndex = 3; sampleIndex < blockSize; ++sampleIndex)
+		{
+			samples[sampleIndex] += 3 * (samples[sampleIndex - 1] - samples[sampleIndex - 2]) + samples[sampleIndex - 3];
+		}
+		break;
+
+	case 4:
+		for (unsigned int sampleIndex = 4; sampleIndex < blockSize; ++sampleIndex)
+		{
+			samples[sampleIndex] += 4 * (samples[sampleIndex - 1] + samples[sampleIndex - 3]) - 6 * samples[sampleIndex - 2] - samples[sampleIndex - 4];
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void RestoreLpcPrediction(unsigned int blockSize, unsigned int order, const int* coefficients, int shift, int* inOutSamples)
+{
+	for (unsigned int sampleIndex = order; sampleIndex < blockSize; ++sampleIndex)
+	{
+		long long prediction = 0;
+		const int* previousSample = inOutSamples + sampleIndex - 1;
+		for (unsigned int coefficientIndex = 0; coefficientIndex < order; ++coefficientIndex)
+		{
+			prediction += static_cast<long long>(coefficients[coefficientIndex]) * previousSample[-static_cast<int>(coefficientIndex)];
+		}
+
+		inOutSamples[sampleIndex] += static_cast<int>(prediction >> shift);
+	}
+}
+
+static bool DecodeSubframe(FlacBitReader& bitReader, unsigned int blockSize, unsigned int bitsPerSample, int* outSamples)
+{
+	if (bitReader.ReadBits(1))
+	{
+		return false;
+	}
+
+	unsigned int type = bitReader.ReadBits(6);
+
+	// Low bits that are zero in all the samples of the subframe aren't stored
+	unsigned int nbWastedBits = 0;
+	if (bitReader.ReadBits(1))
+	{
+		nbWastedBits = bitReader.ReadUnary() + 1;
+		if (nbWastedBits >= bitsPerSample)
+		{
+			return false;
+		}
+
+		bitsPerSample -= nbWastedBits;
+	}
+
+	if (type == 0)
+	{
+		std::fill(outSamples, outSamples + blockSize, bitReader.ReadSignedBits(bitsPerSample));
+	}
+	else if (type == 1)
+	{
+		for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+		{
+			outSamples[sampleIndex] = bitReader.ReadSignedBits(bitsPerSample);
+		}
+	}
+	else if (type >= 8 && type <= 12)
+	{
+		unsigned int order = type - 8;
+		if (order > blockSize)
+		{
+			return false;
+		}
+
+		for (unsigned int sampleIndex = 0; sampleIndex < order; ++sampleIndex)
+		{
+			outSamples[sampleIndex] = bitReader.ReadSignedBits(bitsPerSample);
+		}
+
+		if (!DecodeResidual(bitReader, blockSize, order, outSamples))
+		{
+			return false;
+		}
+
+		RestoreFixedPrediction(blockSize, order, outSamples);
+	}
+	else if (type >= 32)
+	{
+		unsigned int order = (type & 31) + 1;
+		if (order > blockSize)
+		{
+			return false;
+		}
+
+		for (unsigned int sampleIndex = 0; sampleIndex < order; ++sampleIndex)
+		{
+			outSamples[sampleIndex] = bitReader.ReadSignedBits(bitsPerSample);
+		}
+
+		unsigned int precision = bitReader.ReadBits(4) + 1;
+		int shift = bitReader.ReadSignedBits(5);
+		if (precision == 16 || shift < 0)
+		{
+			return false;
+		}
+
+		int coefficients[FLAC_MAX_LPC_ORDER];
+		for (unsigned int coefficientIndex = 0; coefficientIndex < order; ++coefficientIndex)
+		{
+			coefficients[coefficientIndex] = bitReader.ReadSignedBits(precision);
+		}
+
+		if (!DecodeResidual(bitReader, blockSize, order, outSamples))
+		{
+			return false;
+		}
+
+		RestoreLpcPrediction(blockSize, order, coefficients, shift, outSamples);
+	}
+	else
+	{
+		return false;
+	}
+
+	if (nbWastedBits)
+	{
+		for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+		{
+			outSamples[sampleIndex] <<= nbWastedBits;
+		}
+	}
+
+	return !bitReader.IsPastEnd();
+}
+
+// Decodes the frame at the start of bytes in outChannels, which has room for the largest block
+// of each channel, one channel after the other. Gets the size of the frame in outHeader.
+static bool DecodeFrame(const unsigned char* bytes, size_t nbBytes, const FlacAudioSource::StreamInfo& streamInfo,
+						std::vector<int>& outChannels, FlacFrameHeader& outHeader)
+{
+	if (!ReadFrameHeader(bytes, nbBytes, streamInfo, outHeader))
+	{
+		return false;
+	}
+
+	FlacBitReader bitReader(bytes + outHeader.m_Size, nbBytes - outHeader.m_Size);
+	unsigned int blockSize = outHeader.m_BlockSize;
+	unsigned int channelAssignment = outHeader.m_ChannelAssignment;
+	for (unsigned int channelIndex = 0; channelIndex < streamInfo.m_NbChannels; ++channelIndex)
+	{
+		// Side channels take one more bit
+		bool isSideChannel =	(channelAssignment == 8 && channelIndex == 1)	||
+								(channelAssignment == 9 && channelIndex == 0)	||
+								(channelAssignment == 10 && channelIndex == 1);
+		unsigned int bitsPerSample = outHeader.m_BitsPerSample + (isSideChannel ? 1 : 0);
+		if (!DecodeSubframe(bitReader, blockSize, bitsPerSample, &outChannels[channelIndex * streamInfo.m_MaxBlockSize]))
+		{
+			return false;
+		}
+	}
+
+	bitReader.AlignToByte();
+	size_t crcBytePosition = outHeader.m_Size + bitReader.GetBytePosition();
+	unsigned int crc = bitReader.ReadBits(16);
+	if (bitReader.IsPastEnd() || crc != s_FlacCrcTables.ComputeCrc16(bytes, crcBytePosition))
+	{
+		return false;
+	}
+
+	outHeader.m_Size = crcBytePosition + 2;
+
+	// Undo the stereo decorrelation
+	int* left = &outChannels[0];
+	int* right = &outChannels[streamInfo.m_MaxBlockSize];
+	if (channelAssignment == 8)
+	{
+		for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+		{
+			right[sampleIndex] = left[sampleIndex] - right[sampleIndex];
+		}
+	}
+	else if (channelAssignment == 9)
+	{
+		for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+		{
+			left[sampleIndex] += right[sampleIndex];
+		}
+	}
+	else if (channelAssignment == 10)
+	{
+		for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+		{
+			int mid = (left[sampleIndex] << 1) | (right[sampleIndex] & 1);
+			int side = right[sampleIndex];
+			left[sampleIndex] = (mid + side) >> 1;
+			right[sampleIndex] = (mid - side) >> 1;
+		}
+	}
+
+	return true;
+}
+
+/**
+ *	Reads a file forward from a given position, keeping at least a given number of bytes
+ *	available after the current one, so that a whole frame can always be parsed in place.
+ */
+class FlacStreamBuffer
+{
+private:
+	std::istream&				m_InputStream;
+	std::vector<unsigned char>	m_Bytes;
+	size_t						m_Position;
+	size_t						m_End;
+	ByteOffset					m_FileOffset;		// Position in the file of m_Bytes[0]
+	size_t						m_ReadSize;
+	bool						m_EndOfFile;
+
+public:
+	// The file is read by blocks of readSize bytes, or more if a frame needs it
+	FlacStreamBuffer(std::istream& inputStream, ByteOffset fileOffset, size_t readSize)
+		:	m_InputStream(inputStream),
+			m_Position(0),
+			m_End(0),
+			m_FileOffset(fileOffset),
+			m_ReadSize(readSize),
+			m_EndOfFile(false)
+	{
+		m_InputStream.clear();
+		m_InputStream.seekg(static_cast<std::streamoff>(fileOffset));
+	}
+
+	// Makes sure nbBytes bytes are available after the current position, unless the file ends
+	// before. Returns the number of bytes available.
+	size_t Fill(size_t nbBytes)
+	{
+		if (m_End - m_Position >= nbBytes || m_EndOfFile)
+		{
+			return m_End - m_Position;
+		}
+
+		// Move the bytes left at the start of the buffer, then read after them
+		std::copy(m_Bytes.begin() + m_Position, m_Bytes.begin() + m_End, m_Bytes.begin());
+		m_FileOffset += m_Position;
+		m_End -= m_Position;
+		m_Position = 0;
+
+		size_t size = std::max(nbBytes, m_ReadSize);
+		if (m_Bytes.size() < size)
+		{
+			m_Bytes.resize(size);
+		}
+
+		m_InputStream.read(reinterpret_cast<char*>(&m_Bytes[m_End]), static_cast<std::streamsize>(m_Bytes.size() - m_End));
+		m_End += static_cast<size_t>(m_InputStream.gcount());
+		m_EndOfFile = !m_InputStream;
+
+		return m_End - m_Position;
+	}
+
+	const unsigned char* GetBytes() const { return &m_Bytes[m_Position]; }
+	ByteOffset GetFileOffset() const { return m_FileOffset + m_Position; }
+	void Skip(size_t nbBytes) { m_Position += nbBytes; }
+};
+
+// Upper bound of the size of a frame of the stream, reached by frames of unencoded samples
+static size_t GetMaxFrameSize(const FlacAudioSource::StreamInfo& streamInfo)
+{
+	size_t maxSubframeSize = (static_cast<size_t>(streamInfo.m_MaxBlockSize) * (streamInfo.m_BitsPerSample + 1) + 7) / 8 + 8;
+	return std::max(static_cast<size_t>(streamInfo.m_MaxFrameSize), maxSubframeSize * streamInfo.m_NbChannels + 32);
+}
+
+// Skips the ID3v2 tag some tools put before the FLAC stream
+static void SkipId3Tag(std::istream& inputStream)
+{
+	std::streampos startPosition = inputStream.tellg();
+
+	unsigned char header[10];
+	inputStream.read(reinterpret_cast<char*>(header), 10);
+	if (!inputStream || memcmp(header, "ID3", 3))
+	{
+		inputStream.clear();
+		inputStream.seekg(startPosition);
+		return;
+	}
+
+	// The size is stored on 4 bytes of 7 bits, and doesn't include the header and footer
+	std::streamoff tagSize = (header[6] << 21) | (header[7] << 14) | (header[8] << 7) | header[9];
+	if (header[5] & 0x10)
+	{
+		tagSize += 10;
+	}
+
+	inputStream.seekg(tagSize, std::ios::cur);
+}
+
+FlacAudioSource::FlacAudioSource()
+	:	m_FirstFrameOffset(0),
+		m_FileSize(0),
+		m_SeekTableScanned(false)
+{
+	memset(&m_StreamInfo, 0, sizeof(m_StreamInfo));
+	m_LastDecodedFrame.m_NbSamples = 0;
+}
+
+bool FlacAudioSource::IsFlacStream(std::istream& inputStream)
+{
+	SkipId3Tag(inputStream);
+
+	char magicBuff[5];
+	inputStream.read(magicBuff, 4);
+	magicBuff[4] = '\0';
+	return inputStream && !strcmp(magicBuff, "fLaC");
+}
+
+void FlacAudioSource::SetSeekTableCacheDirectory(const std::string& directory)
+{
+	s_SeekTableCacheDirectory = directory;
+}
+
+const std::string& FlacAudioSource::GetSeekTableCacheDirectory()
+{
+	return s_SeekTableCacheDirectory;
+}
+
+bool FlacAudioSource::Open(const std::string& filePath)
+{
+	Close();
+
+	m_InputStream.open(filePath.c_str(), std::ifstream::in | std::ios::binary);
+	if (!m_InputStream)
+	{
+		return false;
+	}
+
+	m_FilePath = filePath;
+	m_InputStream.seekg(0, std::ios::end);
+	m_FileSize = static_cast<ByteOffset>(m_InputStream.tellg());
+	m_InputStream.seekg(0, std::ios::beg);
+
+	if (!IsFlacStream(m_InputStream) || !ReadMetadata())
+	{
+		Close();
+		return false;
+	}
+
+	if (m_SeekTable.IsEmpty() && !ReadCachedSeekTable() && !ScanFrames())
+	{
+		Close();
+		return false;
+	}
+
+	m_AudioInfo.m_SampleRate	= m_StreamInfo.m_SampleRate;
+	m_AudioInfo.m_BitsPerSample	= static_cast<unsigned short>(m_StreamInfo.m_BitsPerSample);
+	m_AudioInfo.m_NumChannels	= static_cast<unsigned short>(m_StreamInfo.m_NbChannels);
+	m_AudioInfo.m_NbSamples		= static_cast<unsigned int>(m_StreamInfo.m_NbSamples);
+
+	return true;
+}
+
+void FlacAudioSource::Close()
+{
+	if (m_InputStream.is_open())
+	{
+		m_InputStream.close();
+	}
+
+	m_InputStream.clear();
+	m_FilePath.clear();
+	memset(&m_StreamInfo, 0, sizeof(m_StreamInfo));
+	m_AudioInfo = AudioInfo();
+	m_SeekTable.Clear();
+	m_LastDecodedFrame.m_NbSamples = 0;
+	m_FirstFrameOffset = 0;
+	m_FileSize = 0;
+	m_SeekTableScanned = false;
+}
+
+bool FlacAudioSource::ReadMetadata()
+{
+	bool streamInfoRead = false;
+	bool lastBlock = false;
+	while (!lastBlock)
+	{
+		unsigned char blockHeader[4];
+		m_InputStream.read(reinterpret_cast<char*>(blockHeader), 4);
+		if (!m_InputStream)
+		{
+			return false;
+		}
+
+		lastBlock = (blockHeader[0] & 0x80) != 0;
+		unsigned int blockType = blockHeader[0] & 0x7F;
+		unsigned int blockSize = (blockHeader[1] << 16) | (blockHeader[2] << 8) | blockHeader[3];
+
+		if (blockType == FLAC_METADATA_STREAMINFO)
+		{
+			unsigned char streamInfo[34];
+			if (blockSize != 34 || !m_InputStream.read(reinterpret_cast<char*>(streamInfo), 34))
+			{
+				return false;
+			}
+
+			m_StreamInfo.m_MinBlockSize		= (streamInfo[0] << 8) | streamInfo[1];
+			m_StreamInfo.m_MaxBlockSize		= (streamInfo[2] << 8) | streamInfo[3];
+			m_StreamInfo.m_MaxFrameSize		= (streamInfo[7] << 16) | (streamInfo[8] << 8) | streamInfo[9];
+			m_StreamInfo.m_SampleRate		= (streamInfo[10] << 12) | (streamInfo[11] << 4) | (streamInfo[12] >> 4);
+			m_StreamInfo.m_NbChannels		= ((streamInfo[12] >> 1) & 0x07) + 1;
+			m_StreamInfo.m_BitsPerSample	= (((streamInfo[12] & 0x01) << 4) | (streamInfo[13] >> 4)) + 1;
+			m_StreamInfo.m_NbSamples		= 0;
+			for (unsigned int byteIndex = 13; byteIndex < 18; ++byteIndex)
+			{
+				m_StreamInfo.m_NbSamples = (m_StreamInfo.m_NbSamples << 8) | streamInfo[byteIndex];
+			}
+
+			m_StreamInfo.m_NbSamples &= 0xFFFFFFFFFULL;
+			streamInfoRead = true;
+		}
+		else if (blockType == FLAC_METADATA_SEEKTABLE && streamInfoRead)
+		{
+			if (!ReadSeekTableBlock(blockSize))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			m_InputStream.seekg(blockSize, std::ios::cur);
+		}
+	}
+
+	m_FirstFrameOffset = static_cast<ByteOffset>(m_InputStream.tellg());
+
+	// Streams of unknown length, or whose length doesn't fit in an AudioInfo, aren't supported
+	if (!streamInfoRead																		||
+		!m_StreamInfo.m_SampleRate || !m_StreamInfo.m_NbSamples || m_StreamInfo.m_NbSamples > UINT_MAX	||
+		m_StreamInfo.m_MaxBlockSize < 16 || m_StreamInfo.m_BitsPerSample < 4 || m_StreamInfo.m_BitsPerSample > FLAC_MAX_BITS_PER_SAMPLE)
+	{
+		return false;
+	}
+
+	// Offsets of the SEEKTABLE block are relative to the first frame
+	if (!m_SeekTable.IsEmpty())
+	{
+		SeekTable seekTable;
+		seekTable.AddSeekPoint(0, m_FirstFrameOffset);
+		const std::vector<SeekTable::SeekPoint>& seekPoints = m_SeekTable.GetSeekPoints();
+		for (size_t seekPointIndex = 0; seekPointIndex < seekPoints.size(); ++seekPointIndex)
+		{
+			const SeekTable::SeekPoint& seekPoint = seekPoints[seekPointIndex];
+			if (seekPoint.m_SampleIndex && seekPoint.m_SampleIndex < m_StreamInfo.m_NbSamples)
+			{
+				seekTable.AddSeekPoint(seekPoint.m_SampleIndex, m_FirstFrameOffset + seekPoint.m_ByteOffset);
+			}
+		}
+
+		m_SeekTable = seekTable;
+		m_SeekTable.SetSource(m_FileSize, m_StreamInfo.m_NbSamples);
+	}
+
+	return true;
+}
+
+bool FlacAudioSource::ReadSeekTableBlock(unsigned int blockSize)
+{
+	// Points are sorted by sample number, placeholders at the end have all bits set
+	const unsigned int SEEK_POINT_SIZE = 18;
+	bool seekPointsSorted = true;
+	for (unsigned int seekPointIndex = 0; seekPointIndex < blockSize / SEEK_POINT_SIZE; ++seekPointIndex)
+	{
+		unsigned char seekPoint[SEEK_POINT_SIZE];
+		if (!m_InputStream.read(reinterpret_cast<char*>(seekPoint), SEEK_POINT_SIZE))
+		{
+			return false;
+		}
+
+		SamplePosition sampleIndex = 0;
+		ByteOffset byteOffset = 0;
+		for (unsigned int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		{
+			sampleIndex = (sampleIndex << 8) | seekPoint[byteIndex];
+			byteOffset = (byteOffset << 8) | seekPoint[8 + byteIndex];
+		}
+
+		// Keep the points as they are for now, they're offset once the first frame is found
+		if (sampleIndex != ~0ULL && seekPointsSorted)
+		{
+			seekPointsSorted = m_SeekTable.AddSeekPoint(sampleIndex, byteOffset);
+		}
+	}
+
+	// A table that isn't sorted is ignored
+	if (!seekPointsSorted)
+	{
+		m_SeekTable.Clear();
+	}
+
+	m_InputStream.seekg(blockSize % SEEK_POINT_SIZE, std::ios::cur);
+	return true;
+}
+
+bool FlacAudioSource::ReadCachedSeekTable()
+{
+	if (s_SeekTableCacheDirectory.empty())
+	{
+		return false;
+	}
+
+	std::ifstream cacheInputStream(SeekTable::GetCacheFilePath(s_SeekTableCacheDirectory, m_FilePath).c_str(), std::ifstream::in | std::ios::binary);
+	if (!cacheInputStream || !m_SeekTable.Read(cacheInputStream, m_FileSize) || m_SeekTable.GetNbSamples() != m_StreamInfo.m_NbSamples)
+	{
+		m_SeekTable.Clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool FlacAudioSource::ScanFrames()
+{
+	m_SeekTable.Clear();
+	m_SeekTableScanned = false;
+
+	// Frames are found by looking for the next frame header after the current one: a sync code,
+	// a valid header with the right CRC-8, and the expected frame or sample number. No sample
+	// is decoded.
+	size_t maxFrameSize = GetMaxFrameSize(m_StreamInfo);
+	FlacStreamBuffer streamBuffer(m_InputStream, m_FirstFrameOffset, READ_CHUNK_SIZE);
+
+	SamplePosition sampleIndex = 0;
+	SamplePosition frameIndex = 0;
+	while (sampleIndex < m_StreamInfo.m_NbSamples)
+	{
+		size_t nbAvailableBytes = streamBuffer.Fill(maxFrameSize + 32);
+
+		FlacFrameHeader header;
+		if (!ReadFrameHeader(streamBuffer.GetBytes(), nbAvailableBytes, m_StreamInfo, header) ||
+			header.m_Number != (header.m_VariableBlockSize ? sampleIndex : frameIndex))
+		{
+			return false;
+		}
+
+		m_SeekTable.AddSeekPoint(sampleIndex, streamBuffer.GetFileOffset());
+		sampleIndex += header.m_BlockSize;
+		++frameIndex;
+
+		if (sampleIndex >= m_StreamInfo.m_NbSamples)
+		{
+			break;
+		}
+
+		const unsigned char* bytes = streamBuffer.GetBytes();
+		size_t nextFramePosition = header.m_Size;
+		FlacFrameHeader nextHeader;
+		for (; nextFramePosition + 1 < nbAvailableBytes; ++nextFramePosition)
+		{
+			if (bytes[nextFramePosition] == 0xFF && (bytes[nextFramePosition + 1] & 0xFE) == 0xF8	&&
+				ReadFrameHeader(bytes + nextFramePosition, nbAvailableBytes - nextFramePosition, m_StreamInfo, nextHeader)	&&
+				nextHeader.m_Number == (nextHeader.m_VariableBlockSize ? sampleIndex : frameIndex))
+			{
+				break;
+			}
+		}
+
+		if (nextFramePosition + 1 >= nbAvailableBytes)
+		{
+			return false;
+		}
+
+		streamBuffer.Skip(nextFramePosition);
+	}
+
+	m_SeekTable.SetSource(m_FileSize, m_StreamInfo.m_NbSamples);
+	m_SeekTableScanned = true;
+
+	// The cache is only an optimization, it doesn't matter if it can't be written
+	if (!s_SeekTableCacheDirectory.empty())
+	{
+		std::ofstream cacheOutputStream(SeekTable::GetCacheFilePath(s_SeekTableCacheDirectory, m_FilePath).c_str(), std::ofstream::out | std::ios::binary);
+		if (cacheOutputStream)
+		{
+			m_SeekTable.Write(cacheOutputStream);
+		}
+	}
+
+	return true;
+}
+
+void FlacAudioSource::ConvertFrame(const DecodedFrame& frame, SamplePosition firstSampleIndex, SamplePosition endSampleIndex, float* outSamples) const
+{
+	const unsigned int nbChannels = m_StreamInfo.m_NbChannels;
+	const float scale = 1.0f / (1 << (m_StreamInfo.m_BitsPerSample - 1));
+
+	SamplePosition convertFirstSampleIndex = std::max(frame.m_FirstSampleIndex, firstSampleIndex);
+	SamplePosition convertEndSampleIndex = std::min(frame.m_FirstSampleIndex + frame.m_NbSamples, endSampleIndex);
+	for (SamplePosition sampleIndex = convertFirstSampleIndex; sampleIndex < convertEndSampleIndex; ++sampleIndex)
+	{
+		size_t frameSampleIndex = static_cast<size_t>(sampleIndex - frame.m_FirstSampleIndex);
+		float* outSample = outSamples + static_cast<size_t>(sampleIndex - firstSampleIndex) * nbChannels;
+		for (unsigned int channelIndex = 0; channelIndex < nbChannels; ++channelIndex)
+		{
+			outSample[channelIndex] = frame.m_Samples[channelIndex * m_StreamInfo.m_MaxBlockSize + frameSampleIndex] * scale;
+		}
+	}
+}
+
+bool FlacAudioSource::DecodeFrom(	std::istream& inputStream, const SeekTable::SeekPoint& startFrame,
+									SamplePosition firstSampleIndex, SamplePosition endSampleIndex, float* outSamples,
+									DecodedFrame& outLastFrame) const
+{
+	size_t maxFrameSize = GetMaxFrameSize(m_StreamInfo);
+
+	// Don't read much more than the range needs, even uncompressed
+	size_t rangeSize = static_cast<size_t>(endSampleIndex - startFrame.m_SampleIndex) * m_StreamInfo.m_NbChannels * (m_StreamInfo.m_BitsPerSample + 7) / 8;
+	FlacStreamBuffer streamBuffer(inputStream, startFrame.m_ByteOffset, std::min(rangeSize + maxFrameSize, static_cast<size_t>(READ_CHUNK_SIZE)));
+
+	outLastFrame.m_Samples.resize(static_cast<size_t>(m_StreamInfo.m_MaxBlockSize) * m_StreamInfo.m_NbChannels);
+	outLastFrame.m_NbSamples = 0;
+	outLastFrame.m_NextFrame = startFrame;
+	while (outLastFrame.m_NextFrame.m_SampleIndex < endSampleIndex)
+	{
+		size_t nbAvailableBytes = streamBuffer.Fill(maxFrameSize);
+
+		FlacFrameHeader header;
+		if (!DecodeFrame(streamBuffer.GetBytes(), nbAvailableBytes, m_StreamInfo, outLastFrame.m_Samples, header) ||
+			!IsFrameAt(header, outLastFrame.m_NextFrame.m_SampleIndex, m_StreamInfo))
+		{
+			outLastFrame.m_NbSamples = 0;
+			return false;
+		}
+
+		streamBuffer.Skip(header.m_Size);
+
+		outLastFrame.m_FirstSampleIndex				= outLastFrame.m_NextFrame.m_SampleIndex;
+		outLastFrame.m_NbSamples					= header.m_BlockSize;
+		outLastFrame.m_NextFrame.m_SampleIndex		+= header.m_BlockSize;
+		outLastFrame.m_NextFrame.m_ByteOffset		= streamBuffer.GetFileOffset();
+
+		ConvertFrame(outLastFrame, firstSampleIndex, endSampleIndex, outSamples);
+	}
+
+	return true;
+}
+
+bool FlacAudioSource::ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+{
+	if (!m_InputStream.is_open() || !outSamples || firstSampleIndex >= endSampleIndex || endSampleIndex > m_AudioInfo.m_NbSamples)
+	{
+		return false;
+	}
+
+	if (DecodeRange(firstSampleIndex, endSampleIndex, outSamples))
+	{
+		return true;
+	}
+
+	// A seek point of the SEEKTABLE block or of the cached table may not be where it says, scan
+	// the frames of the file to find where they really are, and try again once from there
+	m_LastDecodedFrame.m_NbSamples = 0;
+	if (m_SeekTableScanned || !ScanFrames())
+	{
+		return false;
+	}
+
+	return DecodeRange(firstSampleIndex, endSampleIndex, outSamples);
+}
+
+bool FlacAudioSource::DecodeRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+{
+	SeekTable::SeekPoint firstSeekPoint;
+	if (!m_SeekTable.FindSeekPoint(firstSampleIndex, firstSeekPoint))
+	{
+		return false;
+	}
+
+	if (endSampleIndex - firstSampleIndex < PARALLEL_DECODE_MIN_NB_SAMPLES)
+	{
+		// When ranges are read one after the other, carry on from the last decoded frame
+		// instead of going back to a seek point
+		DecodedFrame& lastFrame = m_LastDecodedFrame;
+		if (lastFrame.m_NbSamples && firstSampleIndex >= lastFrame.m_FirstSampleIndex)
+		{
+			if (firstSampleIndex < lastFrame.m_NextFrame.m_SampleIndex)
+			{
+				ConvertFrame(lastFrame, firstSampleIndex, endSampleIndex, outSamples);
+				if (endSampleIndex <= lastFrame.m_NextFrame.m_SampleIndex)
+				{
+					return true;
+				}
+			}
+
+			if (firstSeekPoint.m_SampleIndex <= lastFrame.m_NextFrame.m_SampleIndex)
+			{
+				firstSeekPoint = lastFrame.m_NextFrame;
+			}
+		}
+
+		return DecodeFrom(m_InputStream, firstSeekPoint, firstSampleIndex, endSampleIndex, outSamples, lastFrame);
+	}
+
+	// Split the range at seek points, and decode the parts in parallel
+	std::vector<SeekTable::SeekPoint> segmentSeekPoints(1, firstSeekPoint);
+	const std::vector<SeekTable::SeekPoint>& seekPoints = m_SeekTable.GetSeekPoints();
+	for (size_t seekPointIndex = 0; seekPointIndex < seekPoints.size() && seekPoints[seekPointIndex].m_SampleIndex < endSampleIndex; ++seekPointIndex)
+	{
+		if (seekPoints[seekPointIndex].m_SampleIndex >= segmentSeekPoints.back().m_SampleIndex + PARALLEL_DECODE_MIN_SEGMENT_SIZE)
+		{
+			segmentSeekPoints.push_back(seekPoints[seekPointIndex]);
+		}
+	}
+
+	const int nbSegments = static_cast<int>(segmentSeekPoints.size());
+	const unsigned int nbChannels = m_StreamInfo.m_NbChannels;
+	int nbFailedSegments = 0;
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int segmentIndex = 0; segmentIndex < nbSegments; ++segmentIndex)
+	{
+		SamplePosition segmentFirstSampleIndex = std::max(static_cast<SamplePosition>(firstSampleIndex), segmentSeekPoints[segmentIndex].m_SampleIndex);
+		SamplePosition segmentEndSampleIndex = segmentIndex + 1 < nbSegments ? segmentSeekPoints[segmentIndex + 1].m_SampleIndex : endSampleIndex;
+
+		std::ifstream segmentInputStream(m_FilePath.c_str(), std::ifstream::in | std::ios::binary);
+		float* segmentOutSamples = outSamples + static_cast<size_t>(segmentFirstSampleIndex - firstSampleIndex) * nbChannels;
+		DecodedFrame segmentLastFrame;
+		if (!segmentInputStream || !DecodeFrom(segmentInputStream, segmentSeekPoints[segmentIndex], segmentFirstSampleIndex, segmentEndSampleIndex, segmentOutSamples, segmentLastFrame))
+		{
+			#pragma omp atomic
+			++nbFailedSegments;
+		}
+	}
+
+	return nbFailedSegments == 0;
+}
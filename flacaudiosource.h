@@ -0,0 +1,118 @@
+#ifndef FLACAUDIOSOURCE_H_
+#define FLACAUDIOSOURCE_H_
+
+#include <fstream>
+#include <vector>
+
+#include "audiosource.h"
+#include "seektable.h"
+
+/**
+ *	A FlacAudioSource decodes a FLAC file directly, with no external library and no temporary
+ *	WAV file. All the subframe types of the format are supported (constant, verbatim, fixed and
+ *	LPC predictors), as well as stereo decorrelation, for up to 8 channels of up to 24 bits.
+ *
+ *	FLAC frames can only be decoded from their start, so ranges are decoded from the closest
+ *	frame before them found in a SeekTable. The table comes from, in this order:
+ *	 - the SEEKTABLE metadata block of the file, written by most encoders,
+ *	 - a table cached by a previous open, if a cache directory was set,
+ *	 - a scan of the frame headers of the file, which doesn't decode any sample and whose
+ *	   result is then cached, if a cache directory was set.
+ *	Every decoded frame must carry the number expected at its position. If it doesn't, the
+ *	table from the file or from the cache was wrong: the frames are scanned again and the
+ *	range is decoded from the scanned table.
+ *	Long ranges are split at seek points and their parts decoded in parallel, each by its own
+ *	thread with its own file stream.
+ */
+class FlacAudioSource : public AudioSource
+{
+public:
+	// Format of the stream, from its STREAMINFO metadata block
+	struct StreamInfo
+	{
+		unsigned int	m_MinBlockSize;
+		unsigned int	m_MaxBlockSize;
+		unsigned int	m_MaxFrameSize;		// 0 when unknown
+		unsigned int	m_SampleRate;
+		unsigned int	m_NbChannels;
+		unsigned int	m_BitsPerSample;
+		SamplePosition	m_NbSamples;
+	};
+
+private:
+	std::string		m_FilePath;
+	std::ifstream	m_InputStream;
+	StreamInfo		m_StreamInfo;
+	AudioInfo		m_AudioInfo;
+	SeekTable		m_SeekTable;
+
+	// Position of the first frame in the file
+	ByteOffset		m_FirstFrameOffset;
+	ByteOffset		m_FileSize;
+
+	// True once m_SeekTable comes from a scan of this file
+	bool			m_SeekTableScanned;
+
+	// A decoded frame, and the position of the one following it
+	struct DecodedFrame
+	{
+		std::vector<int>		m_Samples;		// Channels one after the other, m_MaxBlockSize samples each
+		SamplePosition			m_FirstSampleIndex;
+		unsigned int			m_NbSamples;
+		SeekTable::SeekPoint	m_NextFrame;
+	};
+
+	// Last frame decoded by ReadRange, so that consecutive ranges don't decode it twice
+	DecodedFrame	m_LastDecodedFrame;
+
+	bool ReadMetadata();
+	bool ReadSeekTableBlock(unsigned int blockSize);
+	bool ReadCachedSeekTable();
+	bool ScanFrames();
+
+	// Decodes a range from m_SeekTable, as is
+	bool DecodeRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples);
+
+	// Decodes the samples [firstSampleIndex, endSampleIndex) in outSamples, starting from the
+	// frame at startFrame, and keeps the last frame decoded in outLastFrame. Fails if a frame
+	// doesn't start at the sample its position in the range implies. Doesn't change the 
+	// state of the source, so that parts of a range can be decoded concurrently with different 
+	// input streams.
+	bool DecodeFrom(std::istream& inputStream, const SeekTable::SeekPoint& startFrame, 
+					SamplePosition firstSampleIndex, SamplePosition endSampleIndex, float* outSamples,
+					DecodedFrame& outLastFrame) const;
+
+	// Converts the samples of frame in [firstSampleIndex, endSampleIndex) to interleaved floats,
+	// outSamples being where firstSampleIndex goes
+	void ConvertFrame(const DecodedFrame& frame, SamplePosition firstSampleIndex, SamplePosition endSampleIndex, float* outSamples) const;
+
+	// Sources own their file stream, they can't be copied
+	FlacAudioSource(const FlacAudioSource&);
+	FlacAudioSource& operator=(const FlacAudioSource&);
+
+public:
+	// Below this number of samples, a range isn't worth decoding with several threads
+	static const unsigned int PARALLEL_DECODE_MIN_NB_SAMPLES = 1 << 20;
+
+	FlacAudioSource();
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	virtual const AudioInfo& GetAudioInfo() const { return m_AudioInfo; }
+	virtual bool ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples);
+
+	const StreamInfo& GetStreamInfo() const { return m_StreamInfo; }
+	const SeekTable& GetSeekTable() const { return m_SeekTable; }
+
+	// Returns true if the stream starts like a FLAC file
+	static bool IsFlacStream(std::istream& inputStream);
+
+	// Directory where the seek tables of files without a SEEKTABLE block are cached, so that
+	// they aren't scanned again by the next opens. Empty by default, tables are then never
+	// cached. Must be set before sources are opened.
+	static void SetSeekTableCacheDirectory(const std::string& directory);
+	static const std::string& GetSeekTableCacheDirectory();
+};
+
+#endif // FLACAUDIOSOURCE_H_
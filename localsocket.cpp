@@ -0,0 +1,353 @@
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+typedef int SOCKET;
+#define INVALID_SOCKET	(-1)
+#define closesocket		close
+#endif
+
+#include "localsocket.h"
+
+// Don't raise SIGPIPE when writing to a connection closed by the other end, fail instead
+#ifdef MSG_NOSIGNAL
+#define LOCAL_SOCKET_SEND_FLAGS	MSG_NOSIGNAL
+#else
+#define LOCAL_SOCKET_SEND_FLAGS	0
+#endif
+
+static const size_t INVALID_HANDLE = static_cast<size_t>(INVALID_SOCKET);
+
+#ifdef _WIN32
+static bool StartWinsock()
+{
+	static bool winsockStarted = false;
+	bool started;
+
+	#pragma omp critical (LocalSocketStartup)
+	{
+		if (!winsockStarted)
+		{
+			WSADATA wsaData;
+			winsockStarted = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+		}
+
+		started = winsockStarted;
+	}
+
+	return started;
+}
+
+// Windows addresses are ports of the loopback interface
+static bool GetSocketAddress(const std::string& address, sockaddr_in& outAddress)
+{
+	int port = atoi(address.c_str());
+	if (port <= 0 || port > 65535 || !StartWinsock())
+	{
+		return false;
+	}
+
+	memset(&outAddress, 0, sizeof(outAddress));
+	outAddress.sin_family		= AF_INET;
+	outAddress.sin_addr.s_addr	= htonl(INADDR_LOOPBACK);
+	outAddress.sin_port			= htons(static_cast<unsigned short>(port));
+	return true;
+}
+
+static SOCKET CreateSocket()
+{
+	return socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+}
+
+// Requests are small and wait for their response, don't delay them
+static void SetSocketOptions(SOCKET socketHandle)
+{
+	BOOL noDelay = TRUE;
+	setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+}
+#else
+static bool GetSocketAddress(const std::string& address, sockaddr_un& outAddress)
+{
+	memset(&outAddress, 0, sizeof(outAddress));
+	if (address.empty() || address.length() >= sizeof(outAddress.sun_path))
+	{
+		return false;
+	}
+
+	outAddress.sun_family = AF_UNIX;
+	memcpy(outAddress.sun_path, address.c_str(), address.length());
+	return true;
+}
+
+static SOCKET CreateSocket()
+{
+	return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+static void SetSocketOptions(SOCKET /*socketHandle*/)
+{
+}
+
+// Removes the socket file at address if it was left by a listener that is gone. Fails if the
+// path is any other kind of file, or if a listener still answers there.
+static bool RemoveStaleSocketFile(const std::string& address, const sockaddr_un& socketAddress)
+{
+	struct stat fileStatus;
+	if (lstat(address.c_str(), &fileStatus) != 0)
+	{
+		return errno == ENOENT;
+	}
+
+	if (!S_ISSOCK(fileStatus.st_mode))
+	{
+		return false;
+	}
+
+	SOCKET socketHandle = CreateSocket();
+	if (socketHandle == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	bool inUse = connect(socketHandle, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) == 0;
+	closesocket(socketHandle);
+	if (inUse)
+	{
+		return false;
+	}
+
+	return unlink(address.c_str()) == 0 || errno == ENOENT;
+}
+#endif
+
+LocalSocket::LocalSocket()
+	:	m_Handle(INVALID_HANDLE)
+{
+}
+
+LocalSocket::~LocalSocket()
+{
+	Close();
+}
+
+bool LocalSocket::IsOpen() const
+{
+	return m_Handle != INVALID_HANDLE;
+}
+
+bool LocalSocket::Listen(const std::string& address, unsigned int backlog)
+{
+	Close();
+
+#ifdef _WIN32
+	sockaddr_in socketAddress;
+#else
+	sockaddr_un socketAddress;
+#endif
+	if (!GetSocketAddress(address, socketAddress))
+	{
+		return false;
+	}
+
+#ifndef _WIN32
+	if (!RemoveStaleSocketFile(address, socketAddress))
+	{
+		return false;
+	}
+#endif
+
+	SOCKET socketHandle = CreateSocket();
+	if (socketHandle == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	if (bind(socketHandle, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0 ||
+		listen(socketHandle, static_cast<int>(backlog)) != 0)
+	{
+		closesocket(socketHandle);
+		return false;
+	}
+
+	m_Handle = static_cast<size_t>(socketHandle);
+#ifndef _WIN32
+	m_ListenPath = address;
+#endif
+	return true;
+}
+
+bool LocalSocket::Accept(LocalSocket& outConnection)
+{
+	outConnection.Close();
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	SOCKET socketHandle = accept(static_cast<SOCKET>(m_Handle), 0, 0);
+	if (socketHandle == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	SetSocketOptions(socketHandle);
+	outConnection.m_Handle = static_cast<size_t>(socketHandle);
+	return true;
+}
+
+bool LocalSocket::Connect(const std::string& address)
+{
+	Close();
+
+#ifdef _WIN32
+	sockaddr_in socketAddress;
+#else
+	sockaddr_un socketAddress;
+#endif
+	if (!GetSocketAddress(address, socketAddress))
+	{
+		return false;
+	}
+
+	SOCKET socketHandle = CreateSocket();
+	if (socketHandle == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	if (connect(socketHandle, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0)
+	{
+		closesocket(socketHandle);
+		return false;
+	}
+
+	SetSocketOptions(socketHandle);
+	m_Handle = static_cast<size_t>(socketHandle);
+	return true;
+}
+
+void LocalSocket::Close()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	closesocket(static_cast<SOCKET>(m_Handle));
+	m_Handle = INVALID_HANDLE;
+
+#ifndef _WIN32
+	if (!m_ListenPath.empty())
+	{
+		unlink(m_ListenPath.c_str());
+		m_ListenPath.clear();
+	}
+#endif
+}
+
+bool LocalSocket::Send(const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size)
+	{
+		int chunkSize = size < INT_MAX ? static_cast<int>(size) : INT_MAX;
+		int nbSentBytes = static_cast<int>(send(static_cast<SOCKET>(m_Handle), bytes, chunkSize, LOCAL_SOCKET_SEND_FLAGS));
+		if (nbSentBytes <= 0)
+		{
+#ifndef _WIN32
+			if (nbSentBytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+#endif
+			return false;
+		}
+
+		bytes += nbSentBytes;
+		size -= nbSentBytes;
+	}
+
+	return true;
+}
+
+bool LocalSocket::Receive(void* data, size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+	while (size)
+	{
+		int chunkSize = size < INT_MAX ? static_cast<int>(size) : INT_MAX;
+		int nbReceivedBytes = static_cast<int>(recv(static_cast<SOCKET>(m_Handle), bytes, chunkSize, 0));
+		if (nbReceivedBytes <= 0)
+		{
+#ifndef _WIN32
+			if (nbReceivedBytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+#endif
+			return false;
+		}
+
+		bytes += nbReceivedBytes;
+		size -= nbReceivedBytes;
+	}
+
+	return true;
+}
+
+bool LocalSocket::WriteMessage(const std::vector<char>& message)
+{
+	if (static_cast<unsigned long long>(message.size()) > 0xFFFFFFFFull)
+	{
+		return false;
+	}
+
+	// The size and the message are copied together, so that they're sent in a single packet
+	std::vector<char> bytes(4 + message.size());
+	for (unsigned int byteIndex = 0; byteIndex < 4; ++byteIndex)
+	{
+		bytes[byteIndex] = static_cast<char>(message.size() >> (byteIndex * 8));
+	}
+
+	if (!message.empty())
+	{
+		memcpy(&bytes[4], &message[0], message.size());
+	}
+
+	return Send(&bytes[0], bytes.size());
+}
+
+bool LocalSocket::ReadMessage(std::vector<char>& outMessage, size_t maxSize)
+{
+	unsigned char sizeBytes[4];
+	if (!Receive(sizeBytes, 4))
+	{
+		return false;
+	}
+
+	size_t size = 0;
+	for (unsigned int byteIndex = 0; byteIndex < 4; ++byteIndex)
+	{
+		size |= static_cast<size_t>(sizeBytes[byteIndex]) << (byteIndex * 8);
+	}
+
+	if (size > maxSize)
+	{
+		return false;
+	}
+
+	outMessage.resize(size);
+	return !size || Receive(&outMessage[0], size);
+}
@@ -0,0 +1,58 @@
+#ifndef LOCALSOCKET_H_
+#define LOCALSOCKET_H_
+
+#include <string>
+#include <vector>
+
+/**
+ *	A LocalSocket is a stream socket between processes of the same machine. On POSIX systems
+ *	it is a Unix domain socket, and addresses are socket file paths. Windows has no Unix
+ *	domain sockets before Windows 10, so there it is a TCP socket on the loopback interface,
+ *	and addresses are port numbers.
+ *	Sockets are closed when destroyed. They can't be copied, but a listening socket can be
+ *	used by several threads accepting connections at the same time.
+ */
+class LocalSocket
+{
+private:
+	// A SOCKET on Windows, a file descriptor elsewhere
+	size_t		m_Handle;
+
+	// Path of the socket file created by Listen, removed when the socket is closed
+	std::string	m_ListenPath;
+
+	LocalSocket(const LocalSocket&);
+	LocalSocket& operator=(const LocalSocket&);
+
+public:
+	LocalSocket();
+	~LocalSocket();
+
+	bool IsOpen() const;
+
+	// Starts listening for connections at address. On POSIX systems, a socket file left at that
+	// path by a previous listener is replaced. Fails if the path is another kind of file, or if
+	// a listener still answers there.
+	bool Listen(const std::string& address, unsigned int backlog);
+
+	// Waits for the next connection to a listening socket, and opens outConnection on it
+	bool Accept(LocalSocket& outConnection);
+
+	// Connects to the socket listening at address
+	bool Connect(const std::string& address);
+
+	void Close();
+
+	// Sends or receives exactly size bytes. Receive returns false if the connection is closed
+	// before they're all received.
+	bool Send(const void* data, size_t size);
+	bool Receive(void* data, size_t size);
+
+	// Sends a message prefixed by its size, on 4 bytes, little endian, in a single write
+	bool WriteMessage(const std::vector<char>& message);
+
+	// Receives a message sent by WriteMessage. Fails if it is bigger than maxSize.
+	bool ReadMessage(std::vector<char>& outMessage, size_t maxSize);
+};
+
+#endif // LOCALSOCKET_H_
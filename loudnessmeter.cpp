@@ -0,0 +1,256 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+
+#include "loudnessmeter.h"
+
+#define ABSOLUTE_GATE				-70.0	// LUFS
+#define INTEGRATED_RELATIVE_GATE	-10.0	// LU
+#define RANGE_RELATIVE_GATE			-20.0	// LU
+#define NB_MOMENTARY_SUB_BLOCKS		4		// 400 ms
+#define NB_SHORT_TERM_SUB_BLOCKS	30		// 3 s
+#define SURROUND_CHANNEL_WEIGHT		1.41
+
+LoudnessMeter::LoudnessMeter()
+	:	m_SampleRate(0),
+		m_NbChannels(0),
+		m_SubBlockSum(0.0),
+		m_SubBlockStartFrame(0),
+		m_SubBlockEndFrame(0),
+		m_NbFrames(0)
+{
+}
+
+double LoudnessMeter::ToLoudness(double meanSquare)
+{
+	return -0.691 + 10.0 * log10(meanSquare);
+}
+
+double LoudnessMeter::ToMeanSquare(double loudness)
+{
+	return pow(10.0, (loudness + 0.691) / 10.0);
+}
+
+// The analog prototypes of the two stages of BS.1770, which gives their coefficients at
+// 48 kHz only, are mapped to the sample rate with the bilinear transform
+void LoudnessMeter::ComputeFilters()
+{
+	Biquad shelfFilter = Biquad();
+	{
+		const double frequency = 1681.974450955533;
+		const double gain = 3.999843853973347;	// dB
+		const double q = 0.7071752369554196;
+		const double k = tan(M_PI * frequency / m_SampleRate);
+		const double vh = pow(10.0, gain / 20.0);
+		const double vb = pow(vh, 0.4996667741545416);
+		const double a0 = 1.0 + k / q + k * k;
+		shelfFilter.m_B0 = (vh + vb * k / q + k * k) / a0;
+		shelfFilter.m_B1 = 2.0 * (k * k - vh) / a0;
+		shelfFilter.m_B2 = (vh - vb * k / q + k * k) / a0;
+		shelfFilter.m_A1 = 2.0 * (k * k - 1.0) / a0;
+		shelfFilter.m_A2 = (1.0 - k / q + k * k) / a0;
+	}
+
+	Biquad highPassFilter = Biquad();
+	{
+		const double frequency = 38.13547087602444;
+		const double q = 0.5003270373238773;
+		const double k = tan(M_PI * frequency / m_SampleRate);
+		const double a0 = 1.0 + k / q + k * k;
+		highPassFilter.m_B0 = 1.0;
+		highPassFilter.m_B1 = -2.0;
+		highPassFilter.m_B2 = 1.0;
+		highPassFilter.m_A1 = 2.0 * (k * k - 1.0) / a0;
+		highPassFilter.m_A2 = (1.0 - k / q + k * k) / a0;
+	}
+
+	m_ShelfFilters.assign(m_NbChannels, shelfFilter);
+	m_HighPassFilters.assign(m_NbChannels, highPassFilter);
+}
+
+void LoudnessMeter::Reset(const AudioInfo& audioInfo)
+{
+	m_SampleRate = audioInfo.m_SampleRate;
+	m_NbChannels = audioInfo.m_NumChannels;
+	ComputeFilters();
+
+	m_ChannelWeights.assign(m_NbChannels, 1.0);
+	if (m_NbChannels == 6)
+	{
+		m_ChannelWeights[3] = 0.0;
+		m_ChannelWeights[4] = SURROUND_CHANNEL_WEIGHT;
+		m_ChannelWeights[5] = SURROUND_CHANNEL_WEIGHT;
+	}
+
+	m_SubBlockSum = 0.0;
+	m_SubBlockStartFrame = 0;
+	m_SubBlockEndFrame = m_SampleRate / 10;
+	m_NbFrames = 0;
+	m_SubBlockSums.clear();
+	m_SubBlockNbFrames.clear();
+	m_MomentaryMeanSquares.clear();
+	m_ShortTermMeanSquares.clear();
+}
+
+void LoudnessMeter::Process(const float* interleavedSamples, const float* /*monoSamples*/, unsigned int nbFrames)
+{
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		double frameSum = 0.0;
+		for (unsigned int channelIndex = 0; channelIndex < m_NbChannels; ++channelIndex)
+		{
+			double weighted = m_HighPassFilters[channelIndex].Process(m_ShelfFilters[channelIndex].Process(*interleavedSamples++));
+			frameSum += m_ChannelWeights[channelIndex] * weighted * weighted;
+		}
+
+		m_SubBlockSum += frameSum;
+		if (++m_NbFrames == m_SubBlockEndFrame)
+		{
+			CloseSubBlock();
+		}
+	}
+}
+
+void LoudnessMeter::Finish()
+{
+	// The last, partial, sub-block doesn't complete any block, it is left out
+}
+
+void LoudnessMeter::CloseSubBlock()
+{
+	m_SubBlockSums.push_back(m_SubBlockSum);
+	m_SubBlockNbFrames.push_back(static_cast<unsigned int>(m_SubBlockEndFrame - m_SubBlockStartFrame));
+	m_SubBlockSum = 0.0;
+
+	// Sub-blocks end on the frame nearest below each 100 ms, so that they don't drift
+	const size_t nbSubBlocks = m_SubBlockSums.size();
+	m_SubBlockStartFrame = m_SubBlockEndFrame;
+	m_SubBlockEndFrame = (nbSubBlocks + 1) * static_cast<unsigned long long>(m_SampleRate) / 10;
+
+	if (nbSubBlocks >= NB_MOMENTARY_SUB_BLOCKS)
+	{
+		m_MomentaryMeanSquares.push_back(GetMeanSquare(NB_MOMENTARY_SUB_BLOCKS));
+	}
+
+	if (nbSubBlocks >= NB_SHORT_TERM_SUB_BLOCKS)
+	{
+		m_ShortTermMeanSquares.push_back(GetMeanSquare(NB_SHORT_TERM_SUB_BLOCKS));
+	}
+}
+
+double LoudnessMeter::GetMeanSquare(size_t nbSubBlocks) const
+{
+	double sum = 0.0;
+	unsigned long long nbFrames = 0;
+	for (size_t subBlockIndex = m_SubBlockSums.size() - nbSubBlocks; subBlockIndex < m_SubBlockSums.size(); ++subBlockIndex)
+	{
+		sum += m_SubBlockSums[subBlockIndex];
+		nbFrames += m_SubBlockNbFrames[subBlockIndex];
+	}
+
+	return nbFrames ? sum / nbFrames : 0.0;
+}
+
+bool LoudnessMeter::GetIntegratedLoudness(double& outLoudness) const
+{
+	// Blocks are averaged on their mean squares, not on their loudness
+	const double absoluteGate = ToMeanSquare(ABSOLUTE_GATE);
+	double sum = 0.0;
+	size_t nbBlocks = 0;
+	for (size_t blockIndex = 0; blockIndex < m_MomentaryMeanSquares.size(); ++blockIndex)
+	{
+		if (m_MomentaryMeanSquares[blockIndex] > absoluteGate)
+		{
+			sum += m_MomentaryMeanSquares[blockIndex];
+			++nbBlocks;
+		}
+	}
+
+	if (!nbBlocks)
+	{
+		return false;
+	}
+
+	const double relativeGate = std::max(absoluteGate, ToMeanSquare(ToLoudness(sum / nbBlocks) + INTEGRATED_RELATIVE_GATE));
+	sum = 0.0;
+	nbBlocks = 0;
+	for (size_t blockIndex = 0; blockIndex < m_MomentaryMeanSquares.size(); ++blockIndex)
+	{
+		if (m_MomentaryMeanSquares[blockIndex] > relativeGate)
+		{
+			sum += m_MomentaryMeanSquares[blockIndex];
+			++nbBlocks;
+		}
+	}
+
+	if (!nbBlocks)
+	{
+		return false;
+	}
+
+	outLoudness = ToLoudness(sum / nbBlocks);
+	return true;
+}
+
+bool LoudnessMeter::GetLoudnessRange(double& outLoudnessRange) const
+{
+	const double absoluteGate = ToMeanSquare(ABSOLUTE_GATE);
+	double sum = 0.0;
+	size_t nbBlocks = 0;
+	for (size_t blockIndex = 0; blockIndex < m_ShortTermMeanSquares.size(); ++blockIndex)
+	{
+		if (m_ShortTermMeanSquares[blockIndex] > absoluteGate)
+		{
+			sum += m_ShortTermMeanSquares[blockIndex];
+			++nbBlocks;
+		}
+	}
+
+	if (!nbBlocks)
+	{
+		return false;
+	}
+
+	const double relativeGate = std::max(absoluteGate, ToMeanSquare(ToLoudness(sum / nbBlocks) + RANGE_RELATIVE_GATE));
+	std::vector<double> loudnesses;
+	for (size_t blockIndex = 0; blockIndex < m_ShortTermMeanSquares.size(); ++blockIndex)
+	{
+		if (m_ShortTermMeanSquares[blockIndex] > relativeGate)
+		{
+			loudnesses.push_back(ToLoudness(m_ShortTermMeanSquares[blockIndex]));
+		}
+	}
+
+	if (loudnesses.empty())
+	{
+		return false;
+	}
+
+	std::sort(loudnesses.begin(), loudnesses.end());
+	const size_t lowIndex = static_cast<size_t>(0.10 * (loudnesses.size() - 1) + 0.5);
+	const size_t highIndex = static_cast<size_t>(0.95 * (loudnesses.size() - 1) + 0.5);
+	outLoudnessRange = loudnesses[highIndex] - loudnesses[lowIndex];
+	return true;
+}
+
+bool LoudnessMeter::GetMaxMomentaryLoudness(double& outLoudness) const
+{
+	if (m_MomentaryMeanSquares.empty())
+	{
+		return false;
+	}
+
+	outLoudness = ToLoudness(*std::max_element(m_MomentaryMeanSquares.begin(), m_MomentaryMeanSquares.end()));
+	return true;
+}
+
+bool LoudnessMeter::GetMaxShortTermLoudness(double& outLoudness) const
+{
+	if (m_ShortTermMeanSquares.empty())
+	{
+		return false;
+	}
+
+	outLoudness = ToLoudness(*std::max_element(m_ShortTermMeanSquares.begin(), m_ShortTermMeanSquares.end()));
+	return true;
+}
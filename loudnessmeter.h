@@ -0,0 +1,94 @@
+#ifndef LOUDNESSMETER_H_
+#define LOUDNESSMETER_H_
+
+#include <vector>
+
+#include "analysisgraph.h"
+
+/**
+ *	A LoudnessMeter measures the loudness of a clip as EBU R128 defines it, from the K-weighted
+ *	mean square of its channels (ITU-R BS.1770):
+ *	 - the integrated loudness, over 400 ms blocks overlapping by 75%, gated at -70 LUFS and
+ *	   10 LU below the loudness of the blocks above that
+ *	 - the loudness range, between the 10th and 95th percentiles of the 3 s short-term loudness
+ *	   taken every 100 ms, gated at -70 LUFS and 20 LU below
+ *	 - the maximum momentary (400 ms) and short-term (3 s) loudness
+ *	Channels are weighted as in BS.1770 for 6 channel sources, taken as 5.1 in the WAV order:
+ *	the LFE channel is left out and the surround channels count 1.41 times. All the channels
+ *	of other sources count once.
+ *	Only a few values are kept per 100 ms of audio, whatever the number of channels.
+ */
+class LoudnessMeter : public FeatureExtractor
+{
+public:
+	LoudnessMeter();
+
+	virtual void Reset(const AudioInfo& audioInfo);
+	virtual void Process(const float* interleavedSamples, const float* monoSamples, unsigned int nbFrames);
+	virtual void Finish();
+
+	// Loudnesses are in LUFS, and the loudness range in LU. They return false if the clip is
+	// too short or too quiet to measure them: all blocks gated out, or none long enough.
+	bool GetIntegratedLoudness(double& outLoudness) const;
+	bool GetLoudnessRange(double& outLoudnessRange) const;
+	bool GetMaxMomentaryLoudness(double& outLoudness) const;
+	bool GetMaxShortTermLoudness(double& outLoudness) const;
+
+private:
+	// Biquad filter of Direct Form I, one per channel and stage
+	struct Biquad
+	{
+		double	m_B0, m_B1, m_B2;
+		double	m_A1, m_A2;
+		double	m_X1, m_X2;
+		double	m_Y1, m_Y2;
+
+		double Process(double input)
+		{
+			// Adding and removing a tiny value flushes to 0 the denormal values the filter
+			// decays to in silences, which are very slow to compute with on x86
+			double output = m_B0 * input + m_B1 * m_X1 + m_B2 * m_X2 - m_A1 * m_Y1 - m_A2 * m_Y2;
+			output = (output + 1e-30) - 1e-30;
+			m_X2 = m_X1;
+			m_X1 = input;
+			m_Y2 = m_Y1;
+			m_Y1 = output;
+			return output;
+		}
+	};
+
+	unsigned int		m_SampleRate;
+	unsigned int		m_NbChannels;
+
+	// K-weighting of each channel: high shelf then high pass
+	std::vector<Biquad>	m_ShelfFilters;
+	std::vector<Biquad>	m_HighPassFilters;
+	std::vector<double>	m_ChannelWeights;
+
+	// 100 ms sub-block being accumulated
+	double				m_SubBlockSum;
+	unsigned long long	m_SubBlockStartFrame;
+	unsigned long long	m_SubBlockEndFrame;
+	unsigned long long	m_NbFrames;
+
+	// Weighted sum of squares of each completed sub-block, and its number of frames, which
+	// varies by one when the sample rate isn't a multiple of 10
+	std::vector<double>			m_SubBlockSums;
+	std::vector<unsigned int>	m_SubBlockNbFrames;
+
+	// Mean square of the momentary blocks, one per sub-block from the 4th one, and of the
+	// short-term blocks, one per sub-block from the 30th one
+	std::vector<double>	m_MomentaryMeanSquares;
+	std::vector<double>	m_ShortTermMeanSquares;
+
+	void ComputeFilters();
+	void CloseSubBlock();
+
+	// Mean square of the nbSubBlocks last sub-blocks
+	double GetMeanSquare(size_t nbSubBlocks) const;
+
+	static double ToLoudness(double meanSquare);
+	static double ToMeanSquare(double loudness);
+};
+
+#endif // LOUDNESSMETER_H_
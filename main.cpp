@@ -1,17 +1,30 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 
 #include "simplepeakdetector.h"
+#include "peakdetectorpipeline.h"
 #include "Clip.h"
 
 int main(int argc, char* argv[])
 {
+	// With --pipeline, peaks are detected by the compile-time specialized pipeline, which finds
+	// the same peaks as the default SimplePeakDetector
+	int argIndex = 1;
+	bool pipeline = false;
+	if (argIndex < argc && !strcmp(argv[argIndex], "--pipeline"))
+	{
+		pipeline = true;
+		++argIndex;
+	}
+
 	AClip myTestClip;
     
 	SimplePeakDetector simplePeakDetector;        
-	myTestClip.SetPeakDetector(&simplePeakDetector);		
+	BeatPeakDetector beatPeakDetector;
+	myTestClip.SetPeakDetector(pipeline ? static_cast<PeakDetector*>(&beatPeakDetector) : &simplePeakDetector);		
 
-	if (!argv[1] || !myTestClip.LoadDataFromFile(argv[1]))
+	if (argIndex >= argc || !myTestClip.LoadDataFromFile(argv[argIndex]))
     {
         return EXIT_FAILURE;
     }   	
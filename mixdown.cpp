@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mixdown.h"
+#include "cliprenderer.h"
+#include "session.h"
+#include "wavfilewriter.h"
+#include "Clip.h"
+
+// Number of blocks rendered at once by RenderToFile
+#define NB_BLOCKS_PER_PART 64
+
+// The sizes in the header of a WAV file are 32 bits
+#define MAX_WAV_NB_VALUES ((0xFFFFFFFFULL - 64) / sizeof(float))
+
+namespace
+{
+	struct PlayingClip
+	{
+		const AClip*		m_Clip;
+		const DecodedAudio*	m_DecodedAudio;
+		double				m_SetTime;			// Time of the set at which the clip starts
+		double				m_StartSetTime;		// Times of the set of its first and last warp markers
+		double				m_EndSetTime;
+	};
+}
+
+bool Mixdown::GetClipSetTimes(const Session& session, size_t clipIndex, double& outStartSetTime, double& outEndSetTime)
+{
+	std::vector<WarpMarker> warpMarkers;
+	session.GetClip(clipIndex)->GetWarpMarkers(warpMarkers);
+	if (warpMarkers.empty())
+	{
+		return false;
+	}
+
+	outStartSetTime	= session.GetClipSetTime(clipIndex) + warpMarkers.front().GetBeatTime();
+	outEndSetTime	= session.GetClipSetTime(clipIndex) + warpMarkers.back().GetBeatTime();
+	return true;
+}
+
+unsigned int Mixdown::GetNbChannels(const Session& session)
+{
+	unsigned int nbChannels = 1;
+	for (size_t clipIndex = 0; clipIndex < session.GetNbClips(); ++clipIndex)
+	{
+		nbChannels = std::max<unsigned int>(nbChannels, session.GetClip(clipIndex)->GetAudioInfo().m_NumChannels);
+	}
+
+	return nbChannels;
+}
+
+bool Mixdown::RenderSamples(Session& session, unsigned int outputRate, unsigned int nbChannels, double startSetTime, 
+							unsigned long long firstOutputIndex, unsigned int nbOutputSamples, float* outSamples)
+{
+	if (!outputRate || !nbChannels || (nbOutputSamples && !outSamples))
+	{
+		return false;
+	}
+
+	// Clips are culled one output sample early, and one late, so that rounding errors never
+	// drop their first or last sample
+	const double outputSampleDuration = 1.0 / outputRate;
+	double firstSetTime = startSetTime + static_cast<double>(firstOutputIndex) / outputRate;
+	double endSetTime = startSetTime + static_cast<double>(firstOutputIndex + nbOutputSamples) / outputRate;
+
+	// Acquire the clips playing in these samples, in the order of the session
+	std::vector<PlayingClip> playingClips;
+	bool acquired = true;
+	for (size_t clipIndex = 0; clipIndex < session.GetNbClips(); ++clipIndex)
+	{
+		PlayingClip playingClip;
+		if (!GetClipSetTimes(session, clipIndex, playingClip.m_StartSetTime, playingClip.m_EndSetTime) ||
+			playingClip.m_EndSetTime + outputSampleDuration < firstSetTime || playingClip.m_StartSetTime - outputSampleDuration >= endSetTime)
+		{
+			continue;
+		}
+
+		playingClip.m_Clip			= session.GetClip(clipIndex);
+		playingClip.m_SetTime		= session.GetClipSetTime(clipIndex);
+		playingClip.m_DecodedAudio	= session.AcquireDecodedAudio(clipIndex);
+		if (!playingClip.m_DecodedAudio)
+		{
+			acquired = false;
+			break;
+		}
+
+		playingClips.push_back(playingClip);
+		if (playingClip.m_DecodedAudio->m_AudioInfo.m_NbSamples < playingClip.m_Clip->GetAudioInfo().m_NbSamples)
+		{
+			acquired = false;
+			break;
+		}
+	}
+
+	// A block needs one partial sum, of all the channels, per bit of the number of clips
+	// playing in it, see the reduction below
+	size_t maxNbPartialSums = 1;
+	for (size_t nbClips = playingClips.size(); nbClips > 1; nbClips >>= 1)
+	{
+		++maxNbPartialSums;
+	}
+
+	const int nbBlocks = acquired ? static_cast<int>((nbOutputSamples + BLOCK_SIZE - 1) / BLOCK_SIZE) : 0;
+	int nbFailedBlocks = 0;
+
+	#pragma omp parallel if (nbBlocks > 1) reduction(+:nbFailedBlocks)
+	{
+		// Channels of a partial sum are one after the other, BLOCK_SIZE samples each
+		const size_t partialSumSize = static_cast<size_t>(nbChannels) * BLOCK_SIZE;
+		std::vector<float> partialSums(maxNbPartialSums * partialSumSize);
+		std::vector<unsigned int> partialSumLevels(maxNbPartialSums);
+
+		#pragma omp for schedule(dynamic)
+		for (int blockIndex = 0; blockIndex < nbBlocks; ++blockIndex)
+		{
+			unsigned int blockStart = static_cast<unsigned int>(blockIndex) * BLOCK_SIZE;
+			unsigned int blockSize = nbOutputSamples - blockStart < BLOCK_SIZE ? nbOutputSamples - blockStart : BLOCK_SIZE;
+			double blockSetTime = startSetTime + static_cast<double>(firstOutputIndex + blockStart) / outputRate;
+			double blockEndSetTime = startSetTime + static_cast<double>(firstOutputIndex + blockStart + blockSize) / outputRate;
+
+			// Partial sums are kept on a stack, each being the sum of 2^level clips, with levels
+			// decreasing from the bottom. The last two are summed as soon as they have the same
+			// level, which builds the same tree whatever the thread computing the block.
+			size_t nbPartialSums = 0;
+			std::vector<PlayingClip>::const_iterator itPlayingClips = playingClips.begin();
+			std::vector<PlayingClip>::const_iterator itPlayingClipsEnd = playingClips.end();
+			for (; itPlayingClips != itPlayingClipsEnd; ++itPlayingClips)
+			{
+				if (itPlayingClips->m_EndSetTime + outputSampleDuration < blockSetTime || 
+					itPlayingClips->m_StartSetTime - outputSampleDuration >= blockEndSetTime)
+				{
+					continue;
+				}
+
+				// Mono clips are rendered once, and copied to the other channels. Channels the
+				// clip doesn't have are silent.
+				const DecodedAudio* decodedAudio = itPlayingClips->m_DecodedAudio;
+				float* partialSum = &partialSums[nbPartialSums * partialSumSize];
+				bool rendered = true;
+				for (unsigned int channelIndex = 0; rendered && channelIndex < nbChannels; ++channelIndex)
+				{
+					float* channelSum = partialSum + channelIndex * BLOCK_SIZE;
+					if (decodedAudio->m_NbChannels == 1 && channelIndex)
+					{
+						std::copy(partialSum, partialSum + blockSize, channelSum);
+					}
+					else if (channelIndex >= decodedAudio->m_NbChannels)
+					{
+						std::fill(channelSum, channelSum + blockSize, 0.0f);
+					}
+					else
+					{
+						rendered = ClipRenderer::Render(*itPlayingClips->m_Clip, decodedAudio->GetChannel(channelIndex), outputRate, 
+														blockSetTime - itPlayingClips->m_SetTime, blockSize, channelSum);
+					}
+				}
+
+				if (!rendered)
+				{
+					++nbFailedBlocks;
+					continue;
+				}
+
+				partialSumLevels[nbPartialSums++] = 0;
+				while (nbPartialSums >= 2 && partialSumLevels[nbPartialSums - 1] == partialSumLevels[nbPartialSums - 2])
+				{
+					float* lowSum = &partialSums[(nbPartialSums - 2) * partialSumSize];
+					const float* highSum = lowSum + partialSumSize;
+					for (unsigned int channelIndex = 0; channelIndex < nbChannels; ++channelIndex)
+					{
+						float* lowChannelSum = lowSum + channelIndex * BLOCK_SIZE;
+						const float* highChannelSum = highSum + channelIndex * BLOCK_SIZE;
+						for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+						{
+							lowChannelSum[sampleIndex] += highChannelSum[sampleIndex];
+						}
+					}
+
+					++partialSumLevels[nbPartialSums - 2];
+					--nbPartialSums;
+				}
+			}
+
+			// Sum the partial sums left into the top of the stack, from the top, then interleave
+			// its channels
+			float* blockSamples = outSamples + static_cast<size_t>(blockStart) * nbChannels;
+			if (!nbPartialSums)
+			{
+				std::fill(blockSamples, blockSamples + static_cast<size_t>(blockSize) * nbChannels, 0.0f);
+				continue;
+			}
+
+			float* topSum = &partialSums[(nbPartialSums - 1) * partialSumSize];
+			for (size_t partialSumIndex = nbPartialSums - 1; partialSumIndex-- > 0;)
+			{
+				const float* partialSum = &partialSums[partialSumIndex * partialSumSize];
+				for (size_t valueIndex = 0; valueIndex < partialSumSize; ++valueIndex)
+				{
+					topSum[valueIndex] = partialSum[valueIndex] + topSum[valueIndex];
+				}
+			}
+
+			for (unsigned int channelIndex = 0; channelIndex < nbChannels; ++channelIndex)
+			{
+				const float* channelSum = topSum + channelIndex * BLOCK_SIZE;
+				float* channelSamples = blockSamples + channelIndex;
+				for (unsigned int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
+				{
+					channelSamples[sampleIndex * nbChannels] = channelSum[sampleIndex];
+				}
+			}
+		}
+	}
+
+	std::vector<PlayingClip>::const_iterator itPlayingClips = playingClips.begin();
+	std::vector<PlayingClip>::const_iterator itPlayingClipsEnd = playingClips.end();
+	for (; itPlayingClips != itPlayingClipsEnd; ++itPlayingClips)
+	{
+		session.ReleaseDecodedAudio(itPlayingClips->m_DecodedAudio);
+	}
+
+	return acquired && !nbFailedBlocks;
+}
+
+bool Mixdown::Render(	Session& session, unsigned int outputRate, unsigned int nbChannels, double startSetTime, unsigned int nbOutputSamples,
+						float* outSamples)
+{
+	return RenderSamples(session, outputRate, nbChannels, startSetTime, 0, nbOutputSamples, outSamples);
+}
+
+bool Mixdown::RenderToFile(Session& session, unsigned int outputRate, const std::string& filePath, double& outDuration)
+{
+	outDuration = 0.0;
+	if (!outputRate)
+	{
+		return false;
+	}
+
+	double endSetTime = 0.0;
+	for (size_t clipIndex = 0; clipIndex < session.GetNbClips(); ++clipIndex)
+	{
+		double clipStartSetTime = 0.0;
+		double clipEndSetTime = 0.0;
+		if (GetClipSetTimes(session, clipIndex, clipStartSetTime, clipEndSetTime))
+		{
+			endSetTime = std::max(endSetTime, clipEndSetTime);
+		}
+	}
+
+	// The last sample is the one played at the end of the last clip
+	const unsigned int nbChannels = GetNbChannels(session);
+	double nbOutputSamples = floor(endSetTime * outputRate) + 1.0;
+	if (!session.GetNbClips() || nbOutputSamples * nbChannels > MAX_WAV_NB_VALUES)
+	{
+		return false;
+	}
+
+	WavFileWriter wavFileWriter;
+	if (!wavFileWriter.Open(filePath, outputRate, static_cast<unsigned short>(nbChannels)))
+	{
+		return false;
+	}
+
+	const unsigned long long totalNbSamples = static_cast<unsigned long long>(nbOutputSamples);
+	const unsigned int nbSamplesPerPart = NB_BLOCKS_PER_PART * BLOCK_SIZE;
+	std::vector<float> partSamples(static_cast<size_t>(nbSamplesPerPart) * nbChannels);
+	bool rendered = true;
+	for (unsigned long long firstOutputIndex = 0; rendered && firstOutputIndex < totalNbSamples; firstOutputIndex += nbSamplesPerPart)
+	{
+		unsigned int nbPartSamples = static_cast<unsigned int>(std::min<unsigned long long>(nbSamplesPerPart, totalNbSamples - firstOutputIndex));
+		rendered =	RenderSamples(session, outputRate, nbChannels, 0.0, firstOutputIndex, nbPartSamples, &partSamples[0]) &&
+					wavFileWriter.WriteSamples(&partSamples[0], nbPartSamples);
+	}
+
+	if (!wavFileWriter.Close() || !rendered)
+	{
+		return false;
+	}
+
+	outDuration = static_cast<double>(totalNbSamples) / outputRate;
+	return true;
+}
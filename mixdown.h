@@ -0,0 +1,55 @@
+#ifndef MIXDOWN_H_
+#define MIXDOWN_H_
+
+#include <string>
+
+class Session;
+
+/**
+ *	A Mixdown renders all the clips of a Session, warped and converted to the sample rate of
+ *	the set, and sums them channel by channel. Each channel of a clip plays on the same channel
+ *	of the set, except mono clips, which play on all of them.
+ *	The output is cut in blocks of BLOCK_SIZE samples, rendered in parallel. In each block, the
+ *	clips playing are rendered one after the other, in the order of the session, and summed 
+ *	two by two in a fixed tree: the first two clips, then the next two, then both sums, and so
+ *	on. Every channel is summed in the same tree. The order of the additions never depends on
+ *	the number of threads, so the output is bit identical whatever the number of threads, and
+ *	the tree keeps the rounding errors low with many clips. Only log2(number of clips) partial
+ *	sums, of all the channels, are kept per thread.
+ */
+class Mixdown
+{
+public:
+	static const unsigned int BLOCK_SIZE = 16384;
+
+	// Number of channels of the set: the most channels of its clips, 1 if it has none
+	static unsigned int GetNbChannels(const Session& session);
+
+	// Renders nbOutputSamples samples of the set at outputRate, starting at startSetTime
+	// seconds, in outSamples, with nbChannels values per sample, interleaved. Channels of the
+	// clips past nbChannels are left out. The decoded samples of the clips playing during that
+	// time are acquired from the session for the duration of the call. Returns false if one of
+	// them couldn't be decoded.
+	static bool Render(	Session& session, unsigned int outputRate, unsigned int nbChannels, double startSetTime, unsigned int nbOutputSamples,
+						float* outSamples);
+
+	// Renders the whole set at outputRate, with GetNbChannels channels, from its start to the 
+	// end of its last clip, and writes it to a WAV file at filePath. Long sets are rendered in
+	// parts, so that only the clips playing in a part need to be decoded at once. Gets the 
+	// duration of the set, in seconds, in outDuration.
+	static bool RenderToFile(Session& session, unsigned int outputRate, const std::string& filePath, double& outDuration);
+
+private:
+	// Gets the times of the set, in seconds, between which the clip at clipIndex plays: the
+	// times of its first and last warp markers. Returns false if it has no warp markers.
+	static bool GetClipSetTimes(const Session& session, size_t clipIndex, double& outStartSetTime, double& outEndSetTime);
+
+	// Renders the output samples [firstOutputIndex, firstOutputIndex + nbOutputSamples) of the
+	// set starting at startSetTime. Output sample i plays at startSetTime + i / outputRate
+	// whatever part of the set is rendered, so rendering a set in parts gives the same samples
+	// as rendering it at once, as long as parts start on a block boundary.
+	static bool RenderSamples(	Session& session, unsigned int outputRate, unsigned int nbChannels, double startSetTime, 
+								unsigned long long firstOutputIndex, unsigned int nbOutputSamples, float* outSamples);
+};
+
+#endif // MIXDOWN_H_
@@ -6,10 +6,48 @@
 #include "audioformats.h"
 #include "soundfeatures.h"
 
+/**
+ *	A PeakSink receives peaks as soon as a PeakDetector finds them, so that detectors
+ *	don't have to build temporary containers that the caller would then copy from.
+ */
+class PeakSink
+{
+public:
+	virtual ~PeakSink() {}
+
+	virtual void AddPeak(const Peak& peak) = 0;
+};
+
+/**
+ *	PeakSink appending peaks to a std::vector owned by the caller. The caller is free
+ *	to reserve the vector's storage beforehand to avoid reallocations.
+ */
+class PeakVectorSink : public PeakSink
+{
+private:
+	std::vector<Peak>&	m_Peaks;
+
+public:
+	explicit PeakVectorSink(std::vector<Peak>& peaks) : m_Peaks(peaks) {}
+
+	virtual void AddPeak(const Peak& peak) { m_Peaks.push_back(peak); }
+};
+
 class PeakDetector
 {
 public:
-    virtual bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, std::vector<Peak>& outPeaks) = 0;	
+	virtual ~PeakDetector() {}
+
+	// Detects peaks in samples and writes them to outPeaks. The sample indices of the
+	// peaks are offset by sampleOffset, which is the position of samples[0] in the clip.
+	virtual bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, unsigned int sampleOffset, PeakSink& outPeaks) = 0;
+
+	// Convenience overload appending peaks, relative to samples[0], to outPeaks
+	bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, std::vector<Peak>& outPeaks)
+	{
+		PeakVectorSink peakSink(outPeaks);
+		return GetPeaks(samples, nbSamples, audioInfo, 0, peakSink);
+	}
 };
 
-#endif // PEAKDETECTOR_H_
\ No newline at end of file
+#endif // PEAKDETECTOR_H_
@@ -0,0 +1,28 @@
+#include "peakdetectorpipeline.h"
+
+// Returns true if parameters are the ones of a pipeline with the given template arguments
+static bool MatchesPipeline(const SimplePeakDetector::Parameters& parameters, unsigned int cutoffFrequency, unsigned int releaseTimeMs,
+							unsigned int onThreshold, unsigned int offThreshold)
+{
+	return	parameters.m_LowPassFrequency		== cutoffFrequency			&&
+			parameters.m_ReleaseTime			== releaseTimeMs / 1000.0	&&
+			parameters.m_TriggerOnThreshold		== onThreshold / 1000.0		&&
+			parameters.m_TriggerOffThreshold	== offThreshold / 1000.0	&&
+			parameters.m_Arithmetic				== SimplePeakDetector::ARITHMETIC_DOUBLE	&&
+			parameters.m_DecimationFactor		== 1;
+}
+
+PeakDetector* CreatePeakDetectorPipeline(const SimplePeakDetector::Parameters& parameters)
+{
+	if (MatchesPipeline(parameters, 150, 200, 500, 300))
+	{
+		return new BeatPeakDetector;
+	}
+
+	if (MatchesPipeline(parameters, 150, 50, 500, 300))
+	{
+		return new FastBeatPeakDetector;
+	}
+
+	return 0;
+}
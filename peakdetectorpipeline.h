@@ -0,0 +1,174 @@
+#ifndef PEAKDETECTORPIPELINE_H_
+#define PEAKDETECTORPIPELINE_H_
+
+#include <cmath>
+
+#include "peakdetector.h"
+#include "simplepeakdetector.h"
+
+// Stages of a PeakDetectorPipeline. Their parameters are template arguments so that each
+// configuration gets its own fully inlined inner loop. Since C++ doesn't allow floating point
+// template arguments, frequencies are given in Hz, times in milliseconds and levels in
+// thousandths of full scale. The coefficients are computed with the same expressions as
+// SimplePeakDetector's, so that a pipeline detects the same peaks as a SimplePeakDetector with
+// the same parameters in double at the full rate.
+
+/**
+ *	Filter stage: cascade of _Order identical one pole low pass filters with a cutoff frequency
+ *	of _CutoffFrequency Hz.
+ */
+template <unsigned int _Order, unsigned int _CutoffFrequency>
+class OnePoleLowPassCascade
+{
+private:
+	double	m_Coefficient;
+	double	m_Outputs[_Order];
+
+public:
+	void Reset(unsigned int sampleRate)
+	{
+		// M_PI may not be defined, <cmath> may have been included without _USE_MATH_DEFINES
+		const double pi = 3.14159265358979323846;
+		m_Coefficient = (2.0 * pi * _CutoffFrequency) / sampleRate;
+		for (unsigned int stageIndex = 0; stageIndex < _Order; ++stageIndex)
+		{
+			m_Outputs[stageIndex] = 0.0;
+		}
+	}
+
+	double Process(double input)
+	{
+		// _Order is a compile time constant, the compiler unrolls this loop
+		for (unsigned int stageIndex = 0; stageIndex < _Order; ++stageIndex)
+		{
+			m_Outputs[stageIndex] += m_Coefficient * (input - m_Outputs[stageIndex]);
+			input = m_Outputs[stageIndex];
+		}
+
+		return input;
+	}
+};
+
+/**
+ *	Envelope stage: peak follower with an instantaneous attack and an exponential release of
+ *	_ReleaseTimeMs milliseconds.
+ */
+template <unsigned int _ReleaseTimeMs>
+class ReleaseEnvelopeFollower
+{
+private:
+	double	m_Release;
+	double	m_Envelope;
+
+public:
+	void Reset(unsigned int sampleRate)
+	{
+		m_Release = exp(-1.0 / (sampleRate * (_ReleaseTimeMs / 1000.0)));
+		m_Envelope = 0.0;
+	}
+
+	double Process(double input)
+	{
+		double envelopeIn = fabs(input);
+		if (envelopeIn > m_Envelope)
+		{
+			m_Envelope = envelopeIn;
+		}
+		else
+		{
+			m_Envelope = m_Envelope * m_Release + (1.0 - m_Release) * envelopeIn;
+		}
+
+		return m_Envelope;
+	}
+};
+
+/**
+ *	Trigger stage: Schmitt trigger switching on above _OnThreshold and off below _OffThreshold,
+ *	in thousandths of full scale. Process returns true on rising edges only.
+ */
+template <unsigned int _OnThreshold, unsigned int _OffThreshold>
+class SchmittTrigger
+{
+private:
+	bool	m_Triggered;
+
+public:
+	void Reset(unsigned int /*sampleRate*/)
+	{
+		m_Triggered = false;
+	}
+
+	bool Process(double envelope)
+	{
+		if (!m_Triggered)
+		{
+			m_Triggered = envelope > _OnThreshold / 1000.0;
+			return m_Triggered;
+		}
+
+		m_Triggered = !(envelope < _OffThreshold / 1000.0);
+		return false;
+	}
+};
+
+/**
+ *	A PeakDetectorPipeline chains a filter, an envelope and a trigger stage. All the stages are
+ *	resolved at compile time, the only virtual call left is GetPeaks, once per window.
+ *	Like SimplePeakDetector, the state of the stages is reset for each window.
+ */
+template <typename _FilterStage, typename _EnvelopeStage, typename _TriggerStage>
+class PeakDetectorPipeline : public PeakDetector
+{
+public:
+	using PeakDetector::GetPeaks;
+
+	virtual bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, unsigned int sampleOffset, PeakSink& outPeaks)
+	{
+		if (!AudioInfo::CheckAudioInfo(audioInfo))
+		{
+			return false;
+		}
+
+		// Work on local copies so that the compiler can keep the whole state in registers
+		_FilterStage	filter;
+		_EnvelopeStage	envelope;
+		_TriggerStage	trigger;
+		filter.Reset(audioInfo.m_SampleRate);
+		envelope.Reset(audioInfo.m_SampleRate);
+		trigger.Reset(audioInfo.m_SampleRate);
+
+		for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+		{
+			if (trigger.Process(envelope.Process(filter.Process(samples[sampleIndex]))))
+			{
+				outPeaks.AddPeak(Peak(sampleOffset + sampleIndex, sampleOffset + sampleIndex));
+			}
+		}
+
+		return true;
+	}
+};
+
+// Same configuration as SimplePeakDetector's defaults: 2nd order 150 Hz low pass, 200 ms release,
+// triggering between 0.5 and 0.3
+typedef PeakDetectorPipeline<	OnePoleLowPassCascade<2, 150>,
+								ReleaseEnvelopeFollower<200>,
+								SchmittTrigger<500, 300> >		BeatPeakDetector;
+
+// Steeper 4th order low pass, less sensitive to bass lines and sustained low notes
+typedef PeakDetectorPipeline<	OnePoleLowPassCascade<4, 150>,
+								ReleaseEnvelopeFollower<200>,
+								SchmittTrigger<500, 300> >		SteepBeatPeakDetector;
+
+// Faster release for dense material such as drum loops with 16th notes
+typedef PeakDetectorPipeline<	OnePoleLowPassCascade<2, 150>,
+								ReleaseEnvelopeFollower<50>,
+								SchmittTrigger<500, 300> >		FastBeatPeakDetector;
+
+// Returns a new pipeline specialized at compile time for parameters, which the caller owns, or 0
+// if none is: only BeatPeakDetector's and FastBeatPeakDetector's parameters in double at the full
+// rate have one. The pipeline detects the same peaks as a SimplePeakDetector with parameters.
+PeakDetector* CreatePeakDetectorPipeline(const SimplePeakDetector::Parameters& parameters);
+
+#endif // PEAKDETECTORPIPELINE_H_
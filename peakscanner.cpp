@@ -0,0 +1,145 @@
+#include <cstring>
+#include <climits>
+
+#include "peakscanner.h"
+#include "simplepeakdetector.h"
+
+const unsigned int PeakScanner::WINDOW_SIZE		= SimplePeakDetector::INPUT_WINDOW_SIZE;
+const unsigned int PeakScanner::WINDOW_OFFSET	= SimplePeakDetector::INPUT_WINDOW_OFFSET;
+
+// Drops the peaks found in the part of a window that overlaps the previous one
+class OverlappingWindowPeakSink : public PeakSink
+{
+private:
+	PeakSink&		m_OutPeaks;
+	unsigned int	m_FirstNewSampleIndex;
+
+public:
+	OverlappingWindowPeakSink(PeakSink& outPeaks, unsigned int firstNewSampleIndex) 
+		: m_OutPeaks(outPeaks), m_FirstNewSampleIndex(firstNewSampleIndex) {}
+
+	virtual void AddPeak(const Peak& peak)
+	{
+		if (peak.GetPeakSampleIndex() >= m_FirstNewSampleIndex)
+		{
+			m_OutPeaks.AddPeak(peak);
+		}
+	}
+};
+
+PeakScanner::PeakScanner(PeakDetector* peakDetector, const AudioInfo& audioInfo, PeakSink& outPeaks, unsigned int firstWindowStartSampleIndex)
+	:	m_PeakDetector(peakDetector),
+		m_AudioInfo(audioInfo),
+		m_OutPeaks(outPeaks),
+		m_Window(WINDOW_SIZE, 0.0f),
+		m_NbSamplesInWindow(0),
+		m_WindowStartSampleIndex(firstWindowStartSampleIndex),
+		m_FirstWindowProcessed(false)
+{
+}
+
+void PeakScanner::ProcessWindow()
+{
+	if (m_NbSamplesInWindow < WINDOW_SIZE)
+	{
+		// Pad the window with 0 in case we have less than a full window		
+		memset(&m_Window[m_NbSamplesInWindow], 0, (WINDOW_SIZE - m_NbSamplesInWindow) * sizeof(float));
+	}
+
+	if (m_PeakDetector)
+	{
+		// Only the very first window of the clip has no overlap with a previous one
+		unsigned int firstNewSampleIndex = m_WindowStartSampleIndex ? m_WindowStartSampleIndex + WINDOW_OFFSET : 0;
+		OverlappingWindowPeakSink windowPeakSink(m_OutPeaks, firstNewSampleIndex);
+		m_PeakDetector->GetPeaks(&m_Window[0], WINDOW_SIZE, m_AudioInfo, m_WindowStartSampleIndex, windowPeakSink);
+	}
+
+	// Keep the end of the window as the start of the next one
+	memmove(&m_Window[0], &m_Window[WINDOW_SIZE - WINDOW_OFFSET], WINDOW_OFFSET * sizeof(float));
+	m_NbSamplesInWindow = WINDOW_OFFSET;
+	m_WindowStartSampleIndex += WINDOW_SIZE - WINDOW_OFFSET;
+	m_FirstWindowProcessed = true;
+}
+
+void PeakScanner::Process(const float* samples, unsigned int nbSamples)
+{
+	while (nbSamples)
+	{
+		unsigned int nbSamplesToCopy = WINDOW_SIZE - m_NbSamplesInWindow;
+		if (nbSamplesToCopy > nbSamples)
+		{
+			nbSamplesToCopy = nbSamples;
+		}
+
+		memcpy(&m_Window[m_NbSamplesInWindow], samples, nbSamplesToCopy * sizeof(float));
+		m_NbSamplesInWindow += nbSamplesToCopy;
+		samples += nbSamplesToCopy;
+		nbSamples -= nbSamplesToCopy;
+
+		if (m_NbSamplesInWindow == WINDOW_SIZE)
+		{
+			ProcessWindow();
+		}
+	}
+}
+
+void PeakScanner::Finish()
+{
+	// The first window is always analyzed, even for clips shorter than a window. Other windows
+	// only need to be analyzed if they contain samples that weren't part of the previous one.
+	if (!m_FirstWindowProcessed || m_NbSamplesInWindow > WINDOW_OFFSET)
+	{
+		ProcessWindow();
+	}
+}
+
+void PeakScanner::ScanSamples(PeakDetector* peakDetector, const AudioInfo& audioInfo, const float* samples, unsigned int nbSamples, PeakSink& outPeaks)
+{
+	PeakScanner peakScanner(peakDetector, audioInfo, outPeaks);
+	peakScanner.Process(samples, nbSamples);
+	peakScanner.Finish();
+}
+
+void PeakScanner::GetWindowsCoveringRange(	unsigned int firstSampleIndex, unsigned int endSampleIndex, unsigned int nbSamples,
+											unsigned int& outScanFirstSampleIndex, unsigned int& outScanEndSampleIndex,
+											unsigned int& outPeaksFirstSampleIndex, unsigned int& outPeaksEndSampleIndex)
+{
+	const unsigned int WINDOW_STEP = WINDOW_SIZE - WINDOW_OFFSET;
+
+	if (endSampleIndex > nbSamples)
+	{
+		endSampleIndex = nbSamples;
+	}
+
+	if (endSampleIndex <= firstSampleIndex)
+	{
+		endSampleIndex = firstSampleIndex + 1;
+	}
+
+	// Window k covers [k * WINDOW_STEP, k * WINDOW_STEP + WINDOW_SIZE). The last window is the
+	// last one containing samples that aren't part of the previous one.
+	unsigned int lastWindowIndex = nbSamples > WINDOW_SIZE ? (nbSamples - WINDOW_OFFSET - 1) / WINDOW_STEP : 0;
+	unsigned int firstWindowIndex = firstSampleIndex < WINDOW_SIZE ? 0 : (firstSampleIndex - WINDOW_SIZE) / WINDOW_STEP + 1;
+	unsigned int endWindowIndex = (endSampleIndex - 1) / WINDOW_STEP;
+	if (endWindowIndex > lastWindowIndex)
+	{
+		endWindowIndex = lastWindowIndex;
+	}
+
+	if (firstWindowIndex > endWindowIndex)
+	{
+		firstWindowIndex = endWindowIndex;
+	}
+
+	outScanFirstSampleIndex		= firstWindowIndex * WINDOW_STEP;
+	outScanEndSampleIndex		= endWindowIndex * WINDOW_STEP + WINDOW_SIZE;
+	if (outScanEndSampleIndex > nbSamples)
+	{
+		outScanEndSampleIndex = nbSamples;
+	}
+
+	// Each window reports the peaks found after its overlap with the previous one, and the
+	// last one also reports those found in the padding after the end of the clip
+	outPeaksFirstSampleIndex	= firstWindowIndex ? outScanFirstSampleIndex + WINDOW_OFFSET : 0;
+	outPeaksEndSampleIndex		= endWindowIndex == lastWindowIndex ? UINT_MAX : endWindowIndex * WINDOW_STEP + WINDOW_SIZE;
+}
@@ -0,0 +1,58 @@
+#ifndef PEAKSCANNER_H_
+#define PEAKSCANNER_H_
+
+#include <vector>
+
+#include "peakdetector.h"
+
+/**
+ *	A PeakScanner slides the analysis window of a peak detector over a stream of samples
+ *	fed in blocks of any size. Consecutive windows overlap by WINDOW_OFFSET samples, so that
+ *	we don't miss any peak that would have overlapped two adjacent windows. Peaks found in 
+ *	the overlapping part of a window were already reported by the previous one and are dropped.
+ *	The same scanner is used to analyze files while they're read and sample buffers already
+ *	in memory.
+ */
+class PeakScanner
+{
+private:
+	PeakDetector*		m_PeakDetector;
+	AudioInfo			m_AudioInfo;
+	PeakSink&			m_OutPeaks;
+
+	std::vector<float>	m_Window;
+	unsigned int		m_NbSamplesInWindow;
+	unsigned int		m_WindowStartSampleIndex;
+	bool				m_FirstWindowProcessed;
+
+	void ProcessWindow();
+
+public:
+	static const unsigned int WINDOW_SIZE;
+	static const unsigned int WINDOW_OFFSET;
+
+	// firstWindowStartSampleIndex is the position in the clip of the first sample that will be
+	// fed. To rescan part of a clip, it must be the start of one of the windows of a full scan,
+	// see GetWindowsCoveringRange.
+	PeakScanner(PeakDetector* peakDetector, const AudioInfo& audioInfo, PeakSink& outPeaks, unsigned int firstWindowStartSampleIndex = 0);
+
+	// Feeds the next nbSamples samples of the stream
+	void Process(const float* samples, unsigned int nbSamples);
+
+	// Analyzes the last, partial, window. Must be called once all samples have been fed.
+	void Finish();
+
+	// Analyzes a whole buffer of samples in one call
+	static void ScanSamples(PeakDetector* peakDetector, const AudioInfo& audioInfo, const float* samples, unsigned int nbSamples, PeakSink& outPeaks);
+
+	// Windows are reset by the detector, so a change of the samples in [firstSampleIndex, endSampleIndex)
+	// of a clip of nbSamples samples only changes the peaks reported by the windows covering them.
+	// Gets the samples those windows cover in [outScanFirstSampleIndex, outScanEndSampleIndex), and the
+	// peaks they report in [outPeaksFirstSampleIndex, outPeaksEndSampleIndex). Rescanning those samples
+	// gives exactly the peaks a full scan of the clip would give in that range.
+	static void GetWindowsCoveringRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, unsigned int nbSamples,
+										unsigned int& outScanFirstSampleIndex, unsigned int& outScanEndSampleIndex,
+										unsigned int& outPeaksFirstSampleIndex, unsigned int& outPeaksEndSampleIndex);
+};
+
+#endif // PEAKSCANNER_H_
@@ -0,0 +1,204 @@
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define RESAMPLER_USE_SSE
+#endif
+
+#include "resampler.h"
+
+// Number of zero crossings of the sinc on each side of its center, at the cutoff frequency
+#define RESAMPLER_NB_ZERO_CROSSINGS	16
+
+#define RESAMPLER_KAISER_BETA		9.0
+
+// Cutoff frequency at the lowest of the two Nyquist frequencies, so that the transition band
+// of the filter ends at the Nyquist frequency
+#define RESAMPLER_PASSBAND			0.91
+
+// Tables cover cutoffs in steps of 1/RESAMPLER_NB_STEPS_PER_OCTAVE octave
+#define RESAMPLER_NB_STEPS_PER_OCTAVE	16
+
+static const double PI = 3.14159265358979323846;
+
+// Filters are shared by all resamplers, see ResamplerFilter::GetForStep
+static std::map<unsigned int, const ResamplerFilter*>	s_Filters;
+
+// Modified Bessel function of the first kind, of order 0
+static double BesselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (unsigned int k = 1; k < 64 && term > sum * 1e-17; ++k)
+	{
+		double factor = x / (2.0 * k);
+		term *= factor * factor;
+		sum += term;
+	}
+
+	return sum;
+}
+
+// Weight of the input sample at distance samples from the output position
+static double WindowedSinc(double distance, double cutoff, double halfLength)
+{
+	double ratio = distance / halfLength;
+	if (ratio <= -1.0 || ratio >= 1.0)
+	{
+		return 0.0;
+	}
+
+	double x = PI * cutoff * distance;
+	double sinc = fabs(x) < 1e-12 ? 1.0 : sin(x) / x;
+	return cutoff * sinc * BesselI0(RESAMPLER_KAISER_BETA * sqrt(1.0 - ratio * ratio)) / BesselI0(RESAMPLER_KAISER_BETA);
+}
+
+static float DotProduct(const float* samples, const float* coefficients, unsigned int nbTaps)
+{
+#if defined(RESAMPLER_USE_SSE)
+	// coefficients are aligned on 16 bytes and nbTaps is a multiple of 4
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	unsigned int tapIndex = 0;
+	for (; tapIndex + 8 <= nbTaps; tapIndex += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + tapIndex), _mm_load_ps(coefficients + tapIndex)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(samples + tapIndex + 4), _mm_load_ps(coefficients + tapIndex + 4)));
+	}
+
+	if (tapIndex < nbTaps)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + tapIndex), _mm_load_ps(coefficients + tapIndex)));
+	}
+
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+#else
+	float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int tapIndex = 0; tapIndex < nbTaps; tapIndex += 4)
+	{
+		sums[0] += samples[tapIndex]		* coefficients[tapIndex];
+		sums[1] += samples[tapIndex + 1]	* coefficients[tapIndex + 1];
+		sums[2] += samples[tapIndex + 2]	* coefficients[tapIndex + 2];
+		sums[3] += samples[tapIndex + 3]	* coefficients[tapIndex + 3];
+	}
+
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+}
+
+ResamplerFilter::ResamplerFilter(double cutoff)
+	:	m_Cutoff(cutoff)
+{
+	// The filter is stretched as much as the cutoff is lowered, to keep the same steepness
+	unsigned int halfLength = static_cast<unsigned int>(ceil(RESAMPLER_NB_ZERO_CROSSINGS / cutoff));
+	m_NbTaps = (2 * halfLength + 3) / 4 * 4;
+	halfLength = m_NbTaps / 2;
+
+	// An extra phase, for a fraction of 1.0
+	const unsigned int nbRows = NB_PHASES + 1;
+	m_Coefficients.resize(nbRows * m_NbTaps + 3);
+	m_FirstCoefficientIndex = (16 - reinterpret_cast<size_t>(&m_Coefficients[0]) % 16) % 16 / sizeof(float);
+
+	std::vector<double> row(m_NbTaps);
+	for (unsigned int phaseIndex = 0; phaseIndex < nbRows; ++phaseIndex)
+	{
+		double fraction = static_cast<double>(phaseIndex) / NB_PHASES;
+		double sum = 0.0;
+		for (unsigned int tapIndex = 0; tapIndex < m_NbTaps; ++tapIndex)
+		{
+			row[tapIndex] = WindowedSinc(fraction + halfLength - 1.0 - tapIndex, cutoff, halfLength);
+			sum += row[tapIndex];
+		}
+
+		// Every phase has a gain of exactly 1.0 for a constant signal
+		float* coefficients = &m_Coefficients[m_FirstCoefficientIndex + phaseIndex * m_NbTaps];
+		for (unsigned int tapIndex = 0; tapIndex < m_NbTaps; ++tapIndex)
+		{
+			coefficients[tapIndex] = static_cast<float>(row[tapIndex] / sum);
+		}
+	}
+}
+
+const ResamplerFilter* ResamplerFilter::GetForStep(double inputStep)
+{
+	if (!(inputStep > 0.0))
+	{
+		return 0;
+	}
+
+	unsigned int cutoffIndex = inputStep <= 1.0 ? 0 : static_cast<unsigned int>(ceil(RESAMPLER_NB_STEPS_PER_OCTAVE * log(inputStep) / log(2.0) - 1e-9));
+
+	const ResamplerFilter* filter = 0;
+	#pragma omp critical (ResamplerFilters)
+	{
+		const ResamplerFilter*& stepFilter = s_Filters[cutoffIndex];
+		if (!stepFilter)
+		{
+			double cutoff = pow(2.0, -static_cast<double>(cutoffIndex) / RESAMPLER_NB_STEPS_PER_OCTAVE);
+			stepFilter = new ResamplerFilter(RESAMPLER_PASSBAND * cutoff);
+		}
+
+		filter = stepFilter;
+	}
+
+	return filter;
+}
+
+float ResamplerFilter::Apply(const float* samples, double fraction) const
+{
+	double phase = fraction * NB_PHASES;
+	unsigned int phaseIndex = std::min(static_cast<unsigned int>(phase), NB_PHASES - 1);
+	float weight = static_cast<float>(phase - phaseIndex);
+
+	float lowPhaseSample = DotProduct(samples, GetPhase(phaseIndex), m_NbTaps);
+	float highPhaseSample = DotProduct(samples, GetPhase(phaseIndex + 1), m_NbTaps);
+	return lowPhaseSample + weight * (highPhaseSample - lowPhaseSample);
+}
+
+void PolyphaseResampler::ResampleAtPositions(	const float* samples, unsigned int nbSamples, double firstPosition, double inputStep,
+												unsigned int nbOutputSamples, float* outSamples)
+{
+	const ResamplerFilter* filter = ResamplerFilter::GetForStep(inputStep);
+	if (!filter)
+	{
+		std::fill(outSamples, outSamples + nbOutputSamples, 0.0f);
+		return;
+	}
+
+	const unsigned int nbTaps = filter->GetNbTaps();
+	const double halfLength = nbTaps / 2;
+
+	// Taps of the output samples near the ends of the input, padded with silence
+	std::vector<float> edgeTaps(nbTaps);
+
+	for (unsigned int outputIndex = 0; outputIndex < nbOutputSamples; ++outputIndex)
+	{
+		double position = firstPosition + outputIndex * inputStep;
+		double integerPosition = floor(position);
+		double firstTap = integerPosition - halfLength + 1.0;
+		if (firstTap >= 0.0 && firstTap + nbTaps <= nbSamples)
+		{
+			outSamples[outputIndex] = filter->Apply(samples + static_cast<size_t>(firstTap), position - integerPosition);
+		}
+		else if (firstTap + nbTaps <= 0.0 || firstTap >= nbSamples)
+		{
+			outSamples[outputIndex] = 0.0f;
+		}
+		else
+		{
+			long long firstTapIndex = static_cast<long long>(firstTap);
+			for (unsigned int tapIndex = 0; tapIndex < nbTaps; ++tapIndex)
+			{
+				long long sampleIndex = firstTapIndex + tapIndex;
+				edgeTaps[tapIndex] = sampleIndex >= 0 && sampleIndex < nbSamples ? samples[sampleIndex] : 0.0f;
+			}
+
+			outSamples[outputIndex] = filter->Apply(&edgeTaps[0], position - integerPosition);
+		}
+	}
+}
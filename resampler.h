@@ -0,0 +1,69 @@
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ *	A ResamplerFilter is the table of a Kaiser windowed sinc low pass filter, split in NB_PHASES
+ *	phases, plus one: phase p gives the weights of the input samples around a position 
+ *	p / NB_PHASES of a sample after one of them. Weights are interpolated linearly between two
+ *	phases, so that the input can be read at any position. Tables are computed once and shared,
+ *	they're never modified.
+ *	The cutoff frequency is relative to the Nyquist frequency of the input, lower than 1.0 when
+ *	the input is read faster than one sample per output sample, to prevent aliasing. The number
+ *	of taps grows accordingly.
+ */
+class ResamplerFilter
+{
+public:
+	static const unsigned int NB_PHASES = 256;
+
+	// Returns the filter for reading the input with a step of inputStep samples per output
+	// sample. The cutoff is rounded down to the nearest 1/16th of an octave, so that a limited
+	// number of tables cover all steps. Filters are built on the first call for a cutoff, and 
+	// kept until the program exits. Can be called from several threads.
+	static const ResamplerFilter* GetForStep(double inputStep);
+
+	// All phases have the same number of taps, a multiple of 4. The output sample at position
+	// i + fraction of the input is computed from the input samples
+	// [i - GetNbTaps() / 2 + 1, i + GetNbTaps() / 2].
+	unsigned int GetNbTaps() const { return m_NbTaps; }
+
+	// Computes the output sample at fraction of a sample, in [0, 1]. samples are the 
+	// GetNbTaps() samples the output depends on.
+	float Apply(const float* samples, double fraction) const;
+
+private:
+	unsigned int		m_NbTaps;
+	double				m_Cutoff;
+
+	// Phases one after the other, each starting on a 16 bytes boundary, see GetPhase
+	std::vector<float>	m_Coefficients;
+	size_t				m_FirstCoefficientIndex;
+
+	explicit ResamplerFilter(double cutoff);
+
+	// Filters are shared, and point into their own coefficients, they can't be copied
+	ResamplerFilter(const ResamplerFilter&);
+	ResamplerFilter& operator=(const ResamplerFilter&);
+
+	const float* GetPhase(unsigned int phaseIndex) const { return &m_Coefficients[m_FirstCoefficientIndex + phaseIndex * m_NbTaps]; }
+};
+
+/**
+ *	A PolyphaseResampler reads mono samples in memory at arbitrary positions through a 
+ *	ResamplerFilter, which both converts between sample rates and changes the playback speed,
+ *	see ClipRenderer. Each output sample only depends on its position, so any range of output
+ *	samples can be computed independently, in parallel.
+ */
+class PolyphaseResampler
+{
+public:
+	// Resamples samples, taken as silent outside of [0, nbSamples), at nbOutputSamples positions
+	// starting at firstPosition and spaced by inputStep samples, in a single pass
+	static void ResampleAtPositions(const float* samples, unsigned int nbSamples, double firstPosition, double inputStep,
+									unsigned int nbOutputSamples, float* outSamples);
+};
+
+#endif // RESAMPLER_H_
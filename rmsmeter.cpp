@@ -0,0 +1,45 @@
+#include <cmath>
+
+#include "rmsmeter.h"
+
+RmsMeter::RmsMeter()
+	:	m_NbFrames(0)
+{
+}
+
+void RmsMeter::Reset(const AudioInfo& audioInfo)
+{
+	m_SumsOfSquares.assign(audioInfo.m_NumChannels, 0.0);
+	m_NbFrames = 0;
+}
+
+void RmsMeter::Process(const float* interleavedSamples, const float* /*monoSamples*/, unsigned int nbFrames)
+{
+	const unsigned int nbChannels = GetNbChannels();
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		for (unsigned int channelIndex = 0; channelIndex < nbChannels; ++channelIndex)
+		{
+			double sample = *interleavedSamples++;
+			m_SumsOfSquares[channelIndex] += sample * sample;
+		}
+	}
+
+	m_NbFrames += nbFrames;
+}
+
+double RmsMeter::GetRms(unsigned int channelIndex) const
+{
+	return m_NbFrames ? sqrt(m_SumsOfSquares[channelIndex] / m_NbFrames) : 0.0;
+}
+
+double RmsMeter::GetRms() const
+{
+	double sumOfSquares = 0.0;
+	for (unsigned int channelIndex = 0; channelIndex < GetNbChannels(); ++channelIndex)
+	{
+		sumOfSquares += m_SumsOfSquares[channelIndex];
+	}
+
+	return m_NbFrames && GetNbChannels() ? sqrt(sumOfSquares / (m_NbFrames * GetNbChannels())) : 0.0;
+}
@@ -0,0 +1,33 @@
+#ifndef RMSMETER_H_
+#define RMSMETER_H_
+
+#include <vector>
+
+#include "analysisgraph.h"
+
+/**
+ *	An RmsMeter measures the root mean square level of each channel of a clip, and of all its
+ *	channels together. Squares are summed in double precision, so that long clips don't lose
+ *	their quiet parts.
+ */
+class RmsMeter : public FeatureExtractor
+{
+public:
+	RmsMeter();
+
+	virtual void Reset(const AudioInfo& audioInfo);
+	virtual void Process(const float* interleavedSamples, const float* monoSamples, unsigned int nbFrames);
+	virtual void Finish() {}
+
+	unsigned int GetNbChannels() const { return static_cast<unsigned int>(m_SumsOfSquares.size()); }
+
+	// Linear values, 1.0 is the level of a full scale square wave. 0.0 for empty clips.
+	double GetRms(unsigned int channelIndex) const;
+	double GetRms() const;
+
+private:
+	std::vector<double>	m_SumsOfSquares;
+	unsigned long long	m_NbFrames;
+};
+
+#endif // RMSMETER_H_
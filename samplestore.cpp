@@ -0,0 +1,327 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SAMPLESTORE_USE_SSE2
+#endif
+
+#include "samplestore.h"
+
+// Largest 16 bits integer sample, mapped to 1.0
+#define INT16_SCALE		32767.0f
+
+// Number of samples converted at once by CopyFrom
+#define COPY_BLOCK_SIZE	4096
+
+static unsigned int GetFloatBits(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float GetFloat(unsigned int bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Rounds to the nearest half, ties to even. Values too large for a half become infinite.
+static unsigned short FloatToHalf(float value)
+{
+	unsigned int bits = GetFloatBits(value);
+	unsigned int sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	unsigned int halfBits = 0;
+	if (bits >= ((127 + 16) << 23))
+	{
+		// 65536 and above, infinite, or NaN
+		halfBits = bits > (255u << 23) ? 0x7E00 : 0x7C00;
+	}
+	else if (bits < (113 << 23))
+	{
+		// Denormal half: adding the magic value aligns the mantissa, and the FPU rounds it
+		const unsigned int denormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+		halfBits = GetFloatBits(GetFloat(bits) + GetFloat(denormalMagic)) - denormalMagic;
+	}
+	else
+	{
+		// Rebias the exponent and round the mantissa, a carry goes into the exponent
+		unsigned int mantissaIsOdd = (bits >> 13) & 1;
+		bits += (static_cast<unsigned int>(15 - 127) << 23) + 0xFFF + mantissaIsOdd;
+		halfBits = bits >> 13;
+	}
+
+	return static_cast<unsigned short>(halfBits | (sign >> 16));
+}
+
+// The exponent is rebiased by a multiplication, which also normalizes denormal halves
+static const unsigned int HALF_TO_FLOAT_MAGIC = (254 - 15) << 23;
+
+static float HalfToFloat(unsigned short half)
+{
+	float value = GetFloat((half & 0x7FFFu) << 13) * GetFloat(HALF_TO_FLOAT_MAGIC);
+	unsigned int bits = GetFloatBits(value);
+	if (value >= 65536.0f)
+	{
+		// Infinite or NaN
+		bits |= 255u << 23;
+	}
+
+	return GetFloat(bits | ((half & 0x8000u) << 16));
+}
+
+// Triangular dither of one sample, in (-1, 1) least significant bit. It only depends on the
+// position of the sample, so that storing a range again gives the same integers.
+static float GetDither(unsigned int sampleIndex)
+{
+	unsigned int hash = sampleIndex * 0x9E3779B1u;
+	hash ^= hash >> 15;
+	hash *= 0x85EBCA77u;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE3Du;
+	hash ^= hash >> 16;
+
+	return (static_cast<float>(hash & 0xFFFF) - static_cast<float>(hash >> 16)) * (1.0f / 65536.0f);
+}
+
+void SampleStore::ConvertToFloat16(const float* samples, unsigned int nbSamples, unsigned short* outHalves)
+{
+	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		outHalves[sampleIndex] = FloatToHalf(samples[sampleIndex]);
+	}
+}
+
+void SampleStore::ConvertFromFloat16(const unsigned short* halves, unsigned int nbSamples, float* outSamples)
+{
+	unsigned int sampleIndex = 0;
+
+#if defined(SAMPLESTORE_USE_SSE2)
+	const __m128i noSignMask = _mm_set1_epi32(0x7FFF);
+	const __m128i largestFiniteHalf = _mm_set1_epi32(0x7BFF);
+	const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(HALF_TO_FLOAT_MAGIC));
+	const __m128 infiniteExponent = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; sampleIndex + 8 <= nbSamples; sampleIndex += 8)
+	{
+		__m128i halves8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + sampleIndex));
+		__m128i halves4[2] = { _mm_unpacklo_epi16(halves8, zero), _mm_unpackhi_epi16(halves8, zero) };
+		for (int halfIndex = 0; halfIndex < 2; ++halfIndex)
+		{
+			__m128i exponentAndMantissa = _mm_and_si128(halves4[halfIndex], noSignMask);
+			__m128i sign = _mm_slli_epi32(_mm_xor_si128(halves4[halfIndex], exponentAndMantissa), 16);
+			__m128 value = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentAndMantissa, 13)), magic);
+			__m128 infiniteBits = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(exponentAndMantissa, largestFiniteHalf)), infiniteExponent);
+			_mm_storeu_ps(outSamples + sampleIndex + 4 * halfIndex, _mm_or_ps(value, _mm_or_ps(_mm_castsi128_ps(sign), infiniteBits)));
+		}
+	}
+#endif
+
+	for (; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		outSamples[sampleIndex] = HalfToFloat(halves[sampleIndex]);
+	}
+}
+
+void SampleStore::ConvertToInt16Dithered(const float* samples, unsigned int nbSamples, unsigned int firstSampleIndex, short* outIntegers)
+{
+	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		float value = floorf(samples[sampleIndex] * INT16_SCALE + GetDither(firstSampleIndex + sampleIndex) + 0.5f);
+
+		// Clipped symmetrically, so that -1.0 and 1.0 are both exact, NaN becoming 0
+		if (!(value >= -INT16_SCALE))
+		{
+			value = value < 0.0f ? -INT16_SCALE : 0.0f;
+		}
+		else if (value > INT16_SCALE)
+		{
+			value = INT16_SCALE;
+		}
+
+		outIntegers[sampleIndex] = static_cast<short>(value);
+	}
+}
+
+void SampleStore::ConvertFromInt16(const short* integers, unsigned int nbSamples, float* outSamples)
+{
+	const float scale = 1.0f / INT16_SCALE;
+	unsigned int sampleIndex = 0;
+
+#if defined(SAMPLESTORE_USE_SSE2)
+	const __m128 scale4 = _mm_set1_ps(scale);
+	for (; sampleIndex + 8 <= nbSamples; sampleIndex += 8)
+	{
+		// Each integer is moved to the high half of a 32 bits lane, and shifted back with its sign
+		__m128i integers8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(integers + sampleIndex));
+		__m128i lowIntegers = _mm_srai_epi32(_mm_unpacklo_epi16(integers8, integers8), 16);
+		__m128i highIntegers = _mm_srai_epi32(_mm_unpackhi_epi16(integers8, integers8), 16);
+		_mm_storeu_ps(outSamples + sampleIndex, _mm_mul_ps(_mm_cvtepi32_ps(lowIntegers), scale4));
+		_mm_storeu_ps(outSamples + sampleIndex + 4, _mm_mul_ps(_mm_cvtepi32_ps(highIntegers), scale4));
+	}
+#endif
+
+	for (; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		outSamples[sampleIndex] = integers[sampleIndex] * scale;
+	}
+}
+
+SampleStore::SampleStore()
+	:	m_Format(FORMAT_NONE),
+		m_NbSamples(0),
+		m_NbReservedSamples(0)
+{
+}
+
+void SampleStore::Reset(Format format, unsigned int nbSamples)
+{
+	m_Format = format;
+	m_NbSamples = 0;
+	m_NbReservedSamples = format == FORMAT_NONE ? 0 : nbSamples;
+
+	// Swapping with empty vectors releases the memory of the previous samples
+	std::vector<float>(m_Format == FORMAT_FLOAT32 ? m_NbReservedSamples : 0).swap(m_Float32Samples);
+	std::vector<unsigned short>(m_Format == FORMAT_FLOAT16 ? m_NbReservedSamples : 0).swap(m_Float16Samples);
+	std::vector<short>(m_Format == FORMAT_INT16_DITHERED ? m_NbReservedSamples : 0).swap(m_Int16Samples);
+}
+
+void SampleStore::Store(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples)
+{
+	switch (m_Format)
+	{
+	case FORMAT_FLOAT32:
+		std::copy(samples, samples + nbSamples, m_Float32Samples.begin() + firstSampleIndex);
+		break;
+
+	case FORMAT_FLOAT16:
+		ConvertToFloat16(samples, nbSamples, &m_Float16Samples[firstSampleIndex]);
+		break;
+
+	case FORMAT_INT16_DITHERED:
+		ConvertToInt16Dithered(samples, nbSamples, firstSampleIndex, &m_Int16Samples[firstSampleIndex]);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void SampleStore::Process(const float* samples, unsigned int nbSamples)
+{
+	if (m_Format == FORMAT_NONE || !nbSamples)
+	{
+		return;
+	}
+
+	// More samples than announced are stored all the same
+	if (m_NbSamples + nbSamples > m_NbReservedSamples)
+	{
+		m_NbReservedSamples = std::max(m_NbSamples + nbSamples, m_NbReservedSamples + m_NbReservedSamples / 2);
+		m_Float32Samples.resize(m_Format == FORMAT_FLOAT32 ? m_NbReservedSamples : 0);
+		m_Float16Samples.resize(m_Format == FORMAT_FLOAT16 ? m_NbReservedSamples : 0);
+		m_Int16Samples.resize(m_Format == FORMAT_INT16_DITHERED ? m_NbReservedSamples : 0);
+	}
+
+	Store(m_NbSamples, samples, nbSamples);
+	m_NbSamples += nbSamples;
+}
+
+bool SampleStore::Update(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples)
+{
+	if (firstSampleIndex > m_NbSamples || nbSamples > m_NbSamples - firstSampleIndex || (nbSamples && !samples))
+	{
+		return false;
+	}
+
+	Store(firstSampleIndex, samples, nbSamples);
+	return true;
+}
+
+bool SampleStore::Read(unsigned int firstSampleIndex, unsigned int nbSamples, float* outSamples) const
+{
+	if (firstSampleIndex > m_NbSamples || nbSamples > m_NbSamples - firstSampleIndex || (nbSamples && !outSamples))
+	{
+		return false;
+	}
+
+	if (!nbSamples)
+	{
+		return true;
+	}
+
+	switch (m_Format)
+	{
+	case FORMAT_FLOAT32:
+		std::copy(m_Float32Samples.begin() + firstSampleIndex, m_Float32Samples.begin() + firstSampleIndex + nbSamples, outSamples);
+		break;
+
+	case FORMAT_FLOAT16:
+		ConvertFromFloat16(&m_Float16Samples[firstSampleIndex], nbSamples, outSamples);
+		break;
+
+	case FORMAT_INT16_DITHERED:
+		ConvertFromInt16(&m_Int16Samples[firstSampleIndex], nbSamples, outSamples);
+		break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+void SampleStore::CopyFrom(const SampleStore& sampleStore)
+{
+	if (&sampleStore == this)
+	{
+		return;
+	}
+
+	Reset(m_Format, sampleStore.m_NbSamples);
+	if (m_Format == FORMAT_NONE || sampleStore.m_Format == FORMAT_NONE)
+	{
+		return;
+	}
+
+	if (m_Format == sampleStore.m_Format)
+	{
+		m_Float32Samples	= sampleStore.m_Float32Samples;
+		m_Float16Samples	= sampleStore.m_Float16Samples;
+		m_Int16Samples		= sampleStore.m_Int16Samples;
+		m_NbSamples			= sampleStore.m_NbSamples;
+		m_NbReservedSamples	= sampleStore.m_NbReservedSamples;
+		return;
+	}
+
+	float samples[COPY_BLOCK_SIZE];
+	for (unsigned int firstSampleIndex = 0; firstSampleIndex < sampleStore.m_NbSamples; firstSampleIndex += COPY_BLOCK_SIZE)
+	{
+		unsigned int nbSamples = std::min<unsigned int>(COPY_BLOCK_SIZE, sampleStore.m_NbSamples - firstSampleIndex);
+		sampleStore.Read(firstSampleIndex, nbSamples, samples);
+		Process(samples, nbSamples);
+	}
+}
+
+void SampleStore::Swap(SampleStore& sampleStore)
+{
+	std::swap(m_Format, sampleStore.m_Format);
+	std::swap(m_NbSamples, sampleStore.m_NbSamples);
+	std::swap(m_NbReservedSamples, sampleStore.m_NbReservedSamples);
+	m_Float32Samples.swap(sampleStore.m_Float32Samples);
+	m_Float16Samples.swap(sampleStore.m_Float16Samples);
+	m_Int16Samples.swap(sampleStore.m_Int16Samples);
+}
+
+size_t SampleStore::GetSize() const
+{
+	return	m_Float32Samples.size() * sizeof(float) + 
+			m_Float16Samples.size() * sizeof(unsigned short) + 
+			m_Int16Samples.size() * sizeof(short);
+}
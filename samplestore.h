@@ -0,0 +1,80 @@
+#ifndef SAMPLESTORE_H_
+#define SAMPLESTORE_H_
+
+#include <vector>
+
+/**
+ *	A SampleStore keeps the mono samples of a clip resident in memory, in one of several 
+ *	formats trading precision for size:
+ *	 - FORMAT_FLOAT32, the samples as decoded, 4 bytes per sample.
+ *	 - FORMAT_FLOAT16, IEEE 754 half precision, 2 bytes per sample. The relative error is
+ *	   below 2^-11 down to about -84 dBFS, where halves become denormal.
+ *	 - FORMAT_INT16_DITHERED, 16 bits integers with triangular dither, 2 bytes per sample. The
+ *	   error is uncorrelated noise 96 dB below full scale, samples are clipped to [-1, 1].
+ *	Like a WaveformOverview, the store is built incrementally while the samples are read. 
+ *	Samples are converted back to float when they're read, 8 at a time with SSE2, one 16
+ *	bytes load of halves or integers giving two vectors of 4 floats.
+ */
+class SampleStore
+{
+public:
+	enum Format
+	{
+		FORMAT_NONE,				// Nothing is stored
+		FORMAT_FLOAT32,
+		FORMAT_FLOAT16,
+		FORMAT_INT16_DITHERED
+	};
+
+	SampleStore();
+
+	// Empties the store and prepares it to store the next samples in format. nbSamples is the
+	// number of samples of the clip, allocated at once.
+	void Reset(Format format, unsigned int nbSamples);
+
+	// Appends the next nbSamples samples of the clip
+	void Process(const float* samples, unsigned int nbSamples);
+
+	// Stores again nbSamples samples starting at firstSampleIndex, after they were edited. 
+	// Gives the same result as storing the whole clip again.
+	bool Update(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples);
+
+	// Converts the samples [firstSampleIndex, firstSampleIndex + nbSamples) to float, in 
+	// outSamples. Can be called concurrently.
+	bool Read(unsigned int firstSampleIndex, unsigned int nbSamples, float* outSamples) const;
+
+	// Stores the samples of another store in the format of this one, without the precision
+	// lost by the format of the other one coming back
+	void CopyFrom(const SampleStore& sampleStore);
+
+	void Swap(SampleStore& sampleStore);
+
+	Format GetFormat() const { return m_Format; }
+	unsigned int GetNbSamples() const { return m_NbSamples; }
+	bool IsEmpty() const { return !m_NbSamples; }
+
+	// Number of bytes used by the samples
+	size_t GetSize() const;
+
+	// Conversions of the formats, exposed for the analysis of their precision. 
+	// firstSampleIndex is the position of samples[0] in the clip, the dither depends on it.
+	static void ConvertToFloat16(const float* samples, unsigned int nbSamples, unsigned short* outHalves);
+	static void ConvertFromFloat16(const unsigned short* halves, unsigned int nbSamples, float* outSamples);
+	static void ConvertToInt16Dithered(const float* samples, unsigned int nbSamples, unsigned int firstSampleIndex, short* outIntegers);
+	static void ConvertFromInt16(const short* integers, unsigned int nbSamples, float* outSamples);
+
+private:
+	Format						m_Format;
+	unsigned int				m_NbSamples;
+	unsigned int				m_NbReservedSamples;
+
+	// Only the vector of the format is used
+	std::vector<float>			m_Float32Samples;
+	std::vector<unsigned short>	m_Float16Samples;
+	std::vector<short>			m_Int16Samples;
+
+	// Converts and writes samples at firstSampleIndex, which must already be allocated
+	void Store(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples);
+};
+
+#endif // SAMPLESTORE_H_
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "seektable.h"
+#include "streamutils.h"
+
+#define SEEK_TABLE_MAGIC	"SBST"
+#define SEEK_TABLE_VERSION	1
+
+SeekTable::SeekTable(unsigned int minSeekPointSpacing)
+	:	m_MinSeekPointSpacing(minSeekPointSpacing),
+		m_SourceFileSize(0),
+		m_NbSamples(0)
+{
+}
+
+void SeekTable::Clear()
+{
+	m_SeekPoints.clear();
+	m_SourceFileSize = 0;
+	m_NbSamples = 0;
+}
+
+bool SeekTable::AddSeekPoint(SamplePosition sampleIndex, ByteOffset byteOffset)
+{
+	if (!m_SeekPoints.empty())
+	{
+		const SeekPoint& lastSeekPoint = m_SeekPoints.back();
+		if (sampleIndex <= lastSeekPoint.m_SampleIndex || byteOffset <= lastSeekPoint.m_ByteOffset)
+		{
+			return false;
+		}
+
+		if (sampleIndex - lastSeekPoint.m_SampleIndex < m_MinSeekPointSpacing)
+		{
+			return true;
+		}
+	}
+
+	SeekPoint seekPoint;
+	seekPoint.m_SampleIndex = sampleIndex;
+	seekPoint.m_ByteOffset = byteOffset;
+	m_SeekPoints.push_back(seekPoint);
+
+	return true;
+}
+
+void SeekTable::SetSource(ByteOffset sourceFileSize, SamplePosition nbSamples)
+{
+	m_SourceFileSize = sourceFileSize;
+	m_NbSamples = nbSamples;
+}
+
+static bool SeekPointIsBefore(SamplePosition sampleIndex, const SeekTable::SeekPoint& seekPoint)
+{
+	return sampleIndex < seekPoint.m_SampleIndex;
+}
+
+bool SeekTable::FindSeekPoint(SamplePosition sampleIndex, SeekPoint& outSeekPoint) const
+{
+	std::vector<SeekPoint>::const_iterator itSeekPoint = std::upper_bound(m_SeekPoints.begin(), m_SeekPoints.end(), sampleIndex, SeekPointIsBefore);
+	if (itSeekPoint == m_SeekPoints.begin())
+	{
+		return false;
+	}
+
+	outSeekPoint = *(--itSeekPoint);
+	return true;
+}
+
+bool SeekTable::Write(std::ostream& outputStream) const
+{
+	outputStream.write(SEEK_TABLE_MAGIC, 4);
+	StreamUtils::WriteUInt64(outputStream, SEEK_TABLE_VERSION);
+	StreamUtils::WriteUInt64(outputStream, m_SourceFileSize);
+	StreamUtils::WriteUInt64(outputStream, m_NbSamples);
+	StreamUtils::WriteUInt64(outputStream, m_SeekPoints.size());
+
+	std::vector<SeekPoint>::const_iterator itSeekPoints = m_SeekPoints.begin();
+	std::vector<SeekPoint>::const_iterator itSeekPointsEnd = m_SeekPoints.end();
+	for (; itSeekPoints != itSeekPointsEnd; ++itSeekPoints)
+	{
+		StreamUtils::WriteUInt64(outputStream, itSeekPoints->m_SampleIndex);
+		StreamUtils::WriteUInt64(outputStream, itSeekPoints->m_ByteOffset);
+	}
+
+	return outputStream.good();
+}
+
+bool SeekTable::Read(std::istream& inputStream, ByteOffset sourceFileSize)
+{
+	Clear();
+
+	char magicBuff[5];
+	inputStream.read(magicBuff, 4);
+	magicBuff[4] = '\0';
+	if (!inputStream || strcmp(magicBuff, SEEK_TABLE_MAGIC))
+	{
+		return false;
+	}
+
+	unsigned long long version = 0, nbSeekPoints = 0;
+	ByteOffset tableSourceFileSize = 0;
+	SamplePosition nbSamples = 0;
+	if (!StreamUtils::ReadUInt64(inputStream, version)				|| version != SEEK_TABLE_VERSION			||
+		!StreamUtils::ReadUInt64(inputStream, tableSourceFileSize)	|| tableSourceFileSize != sourceFileSize	||
+		!StreamUtils::ReadUInt64(inputStream, nbSamples)			||
+		!StreamUtils::ReadUInt64(inputStream, nbSeekPoints)			|| nbSeekPoints > sourceFileSize)
+	{
+		return false;
+	}
+
+	// Points are checked as they're added, so a corrupted table is rejected as a whole
+	unsigned int minSeekPointSpacing = m_MinSeekPointSpacing;
+	m_MinSeekPointSpacing = 0;
+	for (unsigned long long seekPointIndex = 0; seekPointIndex < nbSeekPoints; ++seekPointIndex)
+	{
+		SamplePosition sampleIndex = 0;
+		ByteOffset byteOffset = 0;
+		if (!StreamUtils::ReadUInt64(inputStream, sampleIndex)	|| sampleIndex >= nbSamples		||
+			!StreamUtils::ReadUInt64(inputStream, byteOffset)	|| byteOffset >= sourceFileSize	||
+			!AddSeekPoint(sampleIndex, byteOffset))
+		{
+			m_MinSeekPointSpacing = minSeekPointSpacing;
+			Clear();
+			return false;
+		}
+	}
+
+	m_MinSeekPointSpacing = minSeekPointSpacing;
+	SetSource(sourceFileSize, nbSamples);
+
+	return true;
+}
+
+std::string SeekTable::GetCacheFilePath(const std::string& cacheDirectory, const std::string& sourceFilePath)
+{
+	// 64 bits FNV-1a
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t charIndex = 0; charIndex < sourceFilePath.size(); ++charIndex)
+	{
+		hash = (hash ^ static_cast<unsigned char>(sourceFilePath[charIndex])) * 1099511628211ULL;
+	}
+
+	char fileName[32];
+	sprintf(fileName, "%016llx.sbseek", hash);
+
+	std::string cacheFilePath(cacheDirectory);
+	if (!cacheFilePath.empty() && cacheFilePath[cacheFilePath.size() - 1] != '/' && cacheFilePath[cacheFilePath.size() - 1] != '\\')
+	{
+		cacheFilePath += '/';
+	}
+
+	return cacheFilePath + fileName;
+}
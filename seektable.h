@@ -0,0 +1,71 @@
+#ifndef SEEKTABLE_H_
+#define SEEKTABLE_H_
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+#include "audioformats.h"
+
+/**
+ *	A SeekTable maps sample positions to byte offsets in a compressed audio file, for formats
+ *	where samples are coded in blocks that can only be decoded from their start. To decode a
+ *	range of samples, a source seeks to the last seek point before it and decodes forward from
+ *	there, so the cost only depends on the length of the range and on the spacing of the points.
+ *	The table is built while the file is scanned for the first time, and can be cached in a
+ *	directory so that the next opens don't scan it again. A cached table remembers the size of
+ *	the file it was built for, and is rejected if the file changed.
+ */
+class SeekTable
+{
+public:
+	static const unsigned int DEFAULT_MIN_SEEK_POINT_SPACING = 16384;
+
+	struct SeekPoint
+	{
+		SamplePosition	m_SampleIndex;	// First sample of the block
+		ByteOffset		m_ByteOffset;	// Position of the block in the file
+	};
+
+private:
+	std::vector<SeekPoint>	m_SeekPoints;
+	unsigned int			m_MinSeekPointSpacing;
+	ByteOffset				m_SourceFileSize;
+	SamplePosition			m_NbSamples;
+
+public:
+	// Seek points closer than minSeekPointSpacing samples to the previous one are dropped, to
+	// bound the size of the table
+	explicit SeekTable(unsigned int minSeekPointSpacing = DEFAULT_MIN_SEEK_POINT_SPACING);
+
+	void Clear();
+
+	// Seek points must be added in increasing sample position order, as blocks are scanned.
+	// Returns false if the point isn't after the previous one.
+	bool AddSeekPoint(SamplePosition sampleIndex, ByteOffset byteOffset);
+
+	// Size and number of samples of the file the table was built for, checked when a cached
+	// table is read back
+	void SetSource(ByteOffset sourceFileSize, SamplePosition nbSamples);
+
+	// Gets the last seek point at or before sampleIndex. Returns false if the table is empty.
+	bool FindSeekPoint(SamplePosition sampleIndex, SeekPoint& outSeekPoint) const;
+
+	bool IsEmpty() const { return m_SeekPoints.empty(); }
+	size_t GetNbSeekPoints() const { return m_SeekPoints.size(); }
+	const std::vector<SeekPoint>& GetSeekPoints() const { return m_SeekPoints; }
+	SamplePosition GetNbSamples() const { return m_NbSamples; }
+
+	bool Write(std::ostream& outputStream) const;
+
+	// Reads a table written by Write. Returns false if it's invalid, or if it was built for a
+	// file of another size than sourceFileSize.
+	bool Read(std::istream& inputStream, ByteOffset sourceFileSize);
+
+	// Path of the file caching, in cacheDirectory, the seek table of the file at sourceFilePath.
+	// Its name is a hash of sourceFilePath.
+	static std::string GetCacheFilePath(const std::string& cacheDirectory, const std::string& sourceFilePath);
+};
+
+#endif // SEEKTABLE_H_
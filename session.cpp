@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cctype>
+
+#include "session.h"
+#include "Clip.h"
+
+// Below this number of clips, a query isn't worth spreading over several threads
+#define PARALLEL_QUERY_MIN_NB_CLIPS 64
+
+Session::Session(PeakDetector* peakDetector, size_t decodedAudioBudget)
+	:	m_PeakDetector(peakDetector),
+		m_DecodedAudioCache(decodedAudioBudget, true)
+{
+}
+
+Session::~Session()
+{
+	std::vector<PlacedClip>::iterator itClips = m_Clips.begin();
+	std::vector<PlacedClip>::iterator itClipsEnd = m_Clips.end();
+	for (; itClips != itClipsEnd; ++itClips)
+	{
+		delete itClips->m_Clip;
+		itClips->m_Clip = 0;
+	}
+}
+
+std::string Session::GetSourceFileKey(const std::string& filePath)
+{
+	std::string key(filePath);
+	std::replace(key.begin(), key.end(), '\\', '/');
+
+	// Remove redundant "/" and "./" path components
+	std::string::size_type redundantPos;
+	while ((redundantPos = key.find("//", 1)) != std::string::npos)
+	{
+		key.erase(redundantPos, 1);
+	}
+
+	while ((redundantPos = key.find("/./")) != std::string::npos)
+	{
+		key.erase(redundantPos, 2);
+	}
+
+#ifdef _WIN32
+	// Windows file systems are case insensitive
+	std::transform(key.begin(), key.end(), key.begin(), tolower);
+#endif
+
+	return key;
+}
+
+int Session::AddClip(const std::string& filePath, double setTime)
+{
+	if (setTime < 0.0)
+	{
+		return -1;
+	}
+
+	std::string sourceFileKey = GetSourceFileKey(filePath);
+
+	AClip* clip = new AClip;
+	clip->SetPeakDetector(m_PeakDetector);
+
+	std::map<std::string, AClip*>::const_iterator itSourceClip = m_ClipBySourceFile.find(sourceFileKey);
+	if (itSourceClip != m_ClipBySourceFile.end())
+	{
+		// This file was already analyzed for another clip
+		clip->LoadDataFromClip(*itSourceClip->second);
+	}
+	else
+	{
+		// The cache keeps the channels of the file for the mixdown, the analysis works on them
+		// mixed down to mono
+		const DecodedAudio* decodedAudio = m_DecodedAudioCache.Acquire(sourceFileKey);
+		std::vector<float> monoSamples;
+		if (decodedAudio && decodedAudio->m_NbChannels > 1)
+		{
+			decodedAudio->MixDown(monoSamples);
+		}
+
+		bool loaded =	decodedAudio &&
+						clip->LoadDataFromSamples(	decodedAudio->m_AudioInfo,
+													monoSamples.empty() ? decodedAudio->GetChannel(0) : &monoSamples[0],
+													sourceFileKey);
+		m_DecodedAudioCache.Release(decodedAudio);
+
+		if (!loaded)
+		{
+			delete clip;
+			return -1;
+		}
+
+		m_ClipBySourceFile[sourceFileKey] = clip;
+	}
+
+	if (!clip->AddDefaultWarpMarkers())
+	{
+		if (m_ClipBySourceFile[sourceFileKey] == clip)
+		{
+			m_ClipBySourceFile.erase(sourceFileKey);
+		}
+
+		delete clip;
+		return -1;
+	}
+
+	PlacedClip placedClip;
+	placedClip.m_Clip		= clip;
+	placedClip.m_SetTime	= setTime;
+	m_Clips.push_back(placedClip);
+
+	return static_cast<int>(m_Clips.size() - 1);
+}
+
+int Session::AddClipFromSnapshot(const ClipSnapshot& snapshot, double setTime)
+{
+	AClip* clip = new AClip;
+	clip->SetPeakDetector(m_PeakDetector);
+	if (setTime < 0.0 || !clip->LoadDataFromSnapshot(snapshot))
+	{
+		delete clip;
+		return -1;
+	}
+
+	// The analysis of the source file can be shared by the clips added from it later on
+	if (!clip->GetFilePath().empty())
+	{
+		m_ClipBySourceFile.insert(std::make_pair(GetSourceFileKey(clip->GetFilePath()), clip));
+	}
+
+	PlacedClip placedClip;
+	placedClip.m_Clip		= clip;
+	placedClip.m_SetTime	= setTime;
+	m_Clips.push_back(placedClip);
+
+	return static_cast<int>(m_Clips.size() - 1);
+}
+
+void Session::GetSampleTimesAtSetTime(double setTime, std::vector<double>& outSampleTimes) const
+{
+	outSampleTimes.resize(m_Clips.size());
+
+	// Only the const, cache-free, conversions of AClip are used, so that any number of
+	// threads can query the same clips
+	const int nbClips = static_cast<int>(m_Clips.size());
+	#pragma omp parallel for if (nbClips >= PARALLEL_QUERY_MIN_NB_CLIPS)
+	for (int clipIndex = 0; clipIndex < nbClips; ++clipIndex)
+	{
+		const PlacedClip& placedClip = m_Clips[clipIndex];
+		double clipBeatTime = setTime - placedClip.m_SetTime;
+		double clipSampleTime = -1.0;
+		if (clipBeatTime < 0.0 || !placedClip.m_Clip->FindSampleTime(clipBeatTime, clipSampleTime))
+		{
+			clipSampleTime = -1.0;
+		}
+
+		outSampleTimes[clipIndex] = clipSampleTime;
+	}
+}
+
+const DecodedAudio* Session::AcquireDecodedAudio(size_t clipIndex)
+{
+	if (clipIndex >= m_Clips.size())
+	{
+		return 0;
+	}
+
+	return m_DecodedAudioCache.Acquire(m_Clips[clipIndex].m_Clip->GetFilePath());
+}
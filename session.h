@@ -0,0 +1,85 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "decodedaudiocache.h"
+
+class AClip;
+class ClipSnapshot;
+class PeakDetector;
+
+/**
+ *	A Session is the set the clips are played in. It owns its clips, each placed at a given
+ *	time of the set.
+ *	Clips using the same source file share its analysis, which is done only once, and its
+ *	decoded samples, which are kept with all their channels in a DecodedAudioCache shared by
+ *	all the clips.
+ */
+class Session
+{
+private:
+	struct PlacedClip
+	{
+		AClip*	m_Clip;
+		double	m_SetTime;		// Time of the set, in seconds, at which the clip starts
+	};
+
+	// this points to memory allocated by the user, do not handle its deallocation
+	PeakDetector*					m_PeakDetector;
+
+	DecodedAudioCache				m_DecodedAudioCache;
+	std::vector<PlacedClip>			m_Clips;
+
+	// First clip loaded from each source file, to share its analysis with the next ones
+	std::map<std::string, AClip*>	m_ClipBySourceFile;
+
+	// Sessions own their clips, they can't be copied
+	Session(const Session&);
+	Session& operator=(const Session&);
+
+public:
+	// decodedAudioBudget is the maximum number of bytes of decoded samples kept in memory
+	Session(PeakDetector* peakDetector, size_t decodedAudioBudget);
+	~Session();
+
+	// Returns the key under which the file at filePath is cached: backslashes become slashes,
+	// repeated slashes and "./" components inside the path are removed, and on Windows the
+	// path is lowercased. ".." components, symbolic links and relative against absolute paths
+	// aren't resolved, so two spellings of the same file can still get different keys.
+	static std::string GetSourceFileKey(const std::string& filePath);
+
+	// Adds a clip playing the file at filePath, starting at setTime seconds in the set. Its
+	// default warp markers are added. Returns the index of the new clip, or -1 if the file
+	// couldn't be loaded.
+	int AddClip(const std::string& filePath, double setTime);
+
+	// Adds a clip restored from a snapshot, with its warp markers, starting at setTime seconds
+	// in the set. Nothing is read from its source file. Returns the index of the new clip, or 
+	// -1 if the snapshot couldn't be loaded.
+	int AddClipFromSnapshot(const ClipSnapshot& snapshot, double setTime);
+
+	size_t GetNbClips() const { return m_Clips.size(); }
+	AClip* GetClip(size_t clipIndex) { return m_Clips[clipIndex].m_Clip; }
+	const AClip* GetClip(size_t clipIndex) const { return m_Clips[clipIndex].m_Clip; }
+	double GetClipSetTime(size_t clipIndex) const { return m_Clips[clipIndex].m_SetTime; }
+
+	// Number of different source files used by the clips
+	size_t GetNbSourceFiles() const { return m_ClipBySourceFile.size(); }
+
+	// For each clip, gets in outSampleTimes the time of the clip, in seconds, that plays at
+	// setTime in the set, or a negative value if the clip doesn't play at that time.
+	// Clips are processed in parallel, and the session can be queried concurrently as long as
+	// no clip or warp marker is added meanwhile.
+	void GetSampleTimesAtSetTime(double setTime, std::vector<double>& outSampleTimes) const;
+
+	// Gives access to the decoded samples of a clip, see DecodedAudioCache::Acquire
+	const DecodedAudio* AcquireDecodedAudio(size_t clipIndex);
+	void ReleaseDecodedAudio(const DecodedAudio* decodedAudio) { m_DecodedAudioCache.Release(decodedAudio); }
+
+	DecodedAudioCache& GetDecodedAudioCache() { return m_DecodedAudioCache; }
+};
+
+#endif // SESSION_H_
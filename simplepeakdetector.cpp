@@ -1,84 +1,427 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <cassert>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define SIMPLEPEAKDETECTOR_USE_SSE
+#endif
 
 #include "audioconfig.h"
 #include "simplepeakdetector.h"
 #include "Clip.h"
+#include "fixedpoint.h"
+
+#define FREQ_LP_BEAT			150.0		// Default low pass filter frequency, in Hz
+#define BEAT_RELEASE_TIME		0.2			// Default release time of envelope detector, in second
+#define TRIGGER_ON_THRESHOLD	0.5			// Default Schmitt trigger thresholds
+#define TRIGGER_OFF_THRESHOLD	0.3
+
+// Number of samples the full rate filters are run over, before a peak found at a decimated
+// rate, to refine its position. Must be longer than the rise time of the filters, see
+// DetectPeaksDecimated.
+#define DECIMATED_REFINE_NB_SAMPLES	1024
+
+// Part of the lowest decimated to full rate envelope ratio computed for the low pass frequency
+// that peak candidates are looked for above, see GetDecimatedEnvelopeRatio
+#define DECIMATED_ENVELOPE_MARGIN	0.9
 
-#define FREQ_LP_BEAT		150.0f								// Low Pass filter frequency, in HZ
-#define T_FILTER			1.0f / (2.0f * M_PI * FREQ_LP_BEAT)	// Low Pass filter time constant
-#define BEAT_RELEASE_TIME	0.2f								// Release time of envelope detector, in second
+// Below this ratio, the decimated envelope is too far from the full rate one for the trigger
+// to switch off at about the same time, and the detector runs at the full rate
+#define MIN_DECIMATED_ENVELOPE_RATIO	0.5
+
+#define MIN_DECIMATION_FACTOR		4
+#define MAX_DECIMATION_FACTOR		256
+
+SimplePeakDetector::Parameters::Parameters()
+	:	m_LowPassFrequency(FREQ_LP_BEAT),
+		m_ReleaseTime(BEAT_RELEASE_TIME),
+		m_TriggerOnThreshold(TRIGGER_ON_THRESHOLD),
+		m_TriggerOffThreshold(TRIGGER_OFF_THRESHOLD),
+		m_Arithmetic(ARITHMETIC_DOUBLE),
+		m_DecimationFactor(1)
+{
+}
+
+bool SimplePeakDetector::Parameters::IsValid() const
+{
+	return	m_LowPassFrequency		> 0.0	&& 
+			m_ReleaseTime			> 0.0	&&
+			m_TriggerOffThreshold	>= 0.0	&&
+			m_TriggerOffThreshold	< m_TriggerOnThreshold	&&
+			m_Arithmetic			>= ARITHMETIC_DOUBLE	&&
+			m_Arithmetic			<= ARITHMETIC_FIXED_POINT	&&
+			(m_DecimationFactor == 1 || (m_DecimationFactor >= MIN_DECIMATION_FACTOR && m_DecimationFactor <= MAX_DECIMATION_FACTOR && 
+										 !(m_DecimationFactor & (m_DecimationFactor - 1))));
+}
 
 SimplePeakDetector::SimplePeakDetector()
 {
-	Reset();
+	Reset(DEFAULT_SAMPLE_RATE);
 }
 
-void SimplePeakDetector::Reset()
+SimplePeakDetector::SimplePeakDetector(const Parameters& parameters)
 {
-	m_Filter1Out		= .0;
-    m_Filter2Out		= .0;
-    m_EnvelopePeak		= .0;
-    m_PeakTrigger		= false;
-    m_PrevPeakPulse		= false;
+	SetParameters(parameters);
+	Reset(DEFAULT_SAMPLE_RATE);
+}
 
-	m_PeakFilter = 1.0 / (DEFAULT_SAMPLE_RATE * T_FILTER);
-    m_PeakRelease = exp(-1.0f / (DEFAULT_SAMPLE_RATE * BEAT_RELEASE_TIME));
+bool SimplePeakDetector::SetParameters(const Parameters& parameters)
+{
+	if (!parameters.IsValid())
+	{
+		return false;
+	}
+
+	m_Parameters = parameters;
+	return true;
 }
 
-void SimplePeakDetector::ProcessAudio(const float* inputSamples, unsigned int nbSamples, std::vector<Peak>& outPeaks)
+// Q3.28: the filters gain is 1, so the state stays within the range of the samples
+typedef FixedPoint<28> DetectorFixedPoint;
+
+template <typename Real>
+static inline Real ConvertSample(float sample)
 {
-    assert(nbSamples == INPUT_WINDOW_SIZE);
-	
-	Reset();
+	return Real(sample);
+}
 
-	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+// In silences, the float filters state decays to denormal numbers after a few thousand 
+// samples, and computing with them is about 20 times slower. A tiny offset, far below the 
+// trigger thresholds, keeps it in the normal range.
+template <>
+inline float ConvertSample<float>(float sample)
+{
+	return sample + 1e-20f;
+}
+
+// Scaling the samples is enough to convert them, only their bits below 2^-28 are dropped.
+// They are clipped to [-7.99, 7.99] first, since 8.0 doesn't fit in Q3.28.
+template <>
+inline DetectorFixedPoint ConvertSample<DetectorFixedPoint>(float sample)
+{
+	const float maxSample = 7.99f;
+	sample = sample > maxSample ? maxSample : (sample < -maxSample ? -maxSample : sample);
+	return DetectorFixedPoint::FromRaw(static_cast<int>(sample * (1 << 28)));
+}
+
+// Coefficients of the filters and of the envelope follower, in Real
+template <typename Real>
+struct DetectorCoefficients
+{
+	Real	m_Filter;
+	Real	m_Release;
+	Real	m_Attack;
+
+	DetectorCoefficients(double peakFilter, double peakRelease) : m_Filter(peakFilter), m_Release(peakRelease), m_Attack(1.0 - peakRelease) {}
+};
+
+// State of the filters and of the envelope follower, in Real
+template <typename Real>
+struct DetectorState
+{
+	Real	m_Filter1Out;
+	Real	m_Filter2Out;
+	Real	m_EnvelopePeak;
+
+	DetectorState() : m_Filter1Out(0.0), m_Filter2Out(0.0), m_EnvelopePeak(0.0) {}
+
+	// Filters the next sample, and returns the envelope
+	Real Process(Real sample, const DetectorCoefficients<Real>& coefficients)
 	{
-		double envelopeIn;
+		using std::fabs;
 
 		// Filter data
-		m_Filter1Out = m_Filter1Out + (m_PeakFilter * (inputSamples[sampleIndex] - m_Filter1Out));
-		m_Filter2Out = m_Filter2Out + (m_PeakFilter * (m_Filter1Out - m_Filter2Out));
+		m_Filter1Out = m_Filter1Out + (coefficients.m_Filter * (sample - m_Filter1Out));
+		m_Filter2Out = m_Filter2Out + (coefficients.m_Filter * (m_Filter1Out - m_Filter2Out));
 
 		// Envelope follower
-		envelopeIn = fabs(m_Filter2Out);
+		Real envelopeIn = fabs(m_Filter2Out);
 		if (envelopeIn > m_EnvelopePeak) 
 		{
 			m_EnvelopePeak = envelopeIn; // Attack time = 0
 		}
 		else
 		{
-			m_EnvelopePeak *= m_PeakRelease;
-			m_EnvelopePeak += (1.0 - m_PeakRelease) * envelopeIn;
+			m_EnvelopePeak *= coefficients.m_Release;
+			m_EnvelopePeak += coefficients.m_Attack * envelopeIn;
 		}
 
+		return m_EnvelopePeak;
+	}
+};
+
+// Runs the filters, the envelope follower and the Schmitt trigger over the samples, computing 
+// in Real, and adds a peak at each rising edge of the trigger
+template <typename Real>
+static void DetectPeaks(const float* inputSamples, unsigned int nbSamples, double peakFilter, double peakRelease, 
+						double triggerOnThreshold, double triggerOffThreshold, unsigned int sampleOffset, PeakSink& outPeaks)
+{
+	const DetectorCoefficients<Real> coefficients(peakFilter, peakRelease);
+	const Real triggerOn(triggerOnThreshold);
+	const Real triggerOff(triggerOffThreshold);
+
+	DetectorState<Real>	state;
+	bool	peakTrigger		= false;	// Schmitt trigger output
+	bool	prevPeakPulse	= false;	// Rising edge memory
+
+	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		Real envelopePeak = state.Process(ConvertSample<Real>(inputSamples[sampleIndex]), coefficients);
+
 		// Peak detector
-		if (!m_PeakTrigger)
+		if (!peakTrigger)
 		{
-			if (m_EnvelopePeak > .5)
+			if (envelopePeak > triggerOn)
 			{
-				m_PeakTrigger = true;
+				peakTrigger = true;
 			}
 		}
 		else
 		{
-			if (m_EnvelopePeak < .3) 
+			if (envelopePeak < triggerOff)
 			{
-				m_PeakTrigger = false;
+				peakTrigger = false;
 			}
 		}
 
-		if ((m_PeakTrigger) && (!m_PrevPeakPulse))
+		if ((peakTrigger) && (!prevPeakPulse))
 		{			
-			outPeaks.push_back(Peak(sampleIndex, sampleIndex));
+			outPeaks.AddPeak(Peak(sampleOffset + sampleIndex, sampleOffset + sampleIndex));
+		}
+
+		prevPeakPulse = peakTrigger;
+	}
+}
+
+// Sums of the samples of a block, and of the samples weighted by their index in the block,
+// with 4 independent accumulators each, so that consecutive additions don't wait for each other.
+// The SSE and plain versions add the samples in the same order and give the same sums.
+static void SumBlock(const float* samples, unsigned int blockSize, float& outSum, float& outWeightedSum)
+{
+	float sums[4];
+	float weightedSums[4];
+
+#if defined(SIMPLEPEAKDETECTOR_USE_SSE)
+	__m128 sum = _mm_setzero_ps();
+	__m128 weightedSum = _mm_setzero_ps();
+	__m128 weight = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 weightStep = _mm_set1_ps(4.0f);
+	for (unsigned int sampleIndex = 0; sampleIndex < blockSize; sampleIndex += 4)
+	{
+		__m128 sample = _mm_loadu_ps(samples + sampleIndex);
+		sum = _mm_add_ps(sum, sample);
+		weightedSum = _mm_add_ps(weightedSum, _mm_mul_ps(weight, sample));
+		weight = _mm_add_ps(weight, weightStep);
+	}
+
+	_mm_storeu_ps(sums, sum);
+	_mm_storeu_ps(weightedSums, weightedSum);
+#else
+	float weights[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	for (unsigned int laneIndex = 0; laneIndex < 4; ++laneIndex)
+	{
+		sums[laneIndex] = 0.0f;
+		weightedSums[laneIndex] = 0.0f;
+	}
+
+	for (unsigned int sampleIndex = 0; sampleIndex < blockSize; sampleIndex += 4)
+	{
+		for (unsigned int laneIndex = 0; laneIndex < 4; ++laneIndex)
+		{
+			float sample = samples[sampleIndex + laneIndex];
+			sums[laneIndex] += sample;
+			weightedSums[laneIndex] += weights[laneIndex] * sample;
+			weights[laneIndex] += 4.0f;
 		}
+	}
+#endif
+
+	outSum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+	outWeightedSum = (weightedSums[0] + weightedSums[1]) + (weightedSums[2] + weightedSums[3]);
+}
+
+// Lowest ratio between the decimated and the full rate envelopes, for a sine at the low pass
+// frequency, whose relative frequency is peakFilter / (2 * PI): the CIC filter attenuates it,
+// and the decimated samples can fall up to half a decimated period away from its maximums.
+// DECIMATED_ENVELOPE_MARGIN leaves some room for content above the low pass frequency.
+static double GetDecimatedEnvelopeRatio(double peakFilter, unsigned int decimationFactor)
+{
+	const double halfPhaseStep = peakFilter / 2.0;
+	const double cicGain = sin(halfPhaseStep * decimationFactor) / (decimationFactor * sin(halfPhaseStep));
+	const double ratio = cicGain * cicGain * cos(halfPhaseStep * decimationFactor) * DECIMATED_ENVELOPE_MARGIN;
+
+	return ratio > 0.0 ? ratio : 0.0;
+}
+
+// Same as DetectPeaks, with the filters, the envelope follower and the Schmitt trigger running
+// on the samples decimated by decimationFactor, a power of two from 4 dividing nbSamples.
+// The samples are decimated by a second order CIC filter: each decimated sample is the average 
+// of the 2 * decimationFactor - 1 samples around it, weighted by a triangle, computed from the
+// plain and weighted sums of each block of decimationFactor samples. Decimated sample k is 
+// centered on sample k * decimationFactor - 1.
+// The decimated envelope is lower than the full rate one, so it only makes peak candidates, 
+// above the on threshold lowered by GetDecimatedEnvelopeRatio. From a candidate on, the full 
+// rate filters are run, from the decimated state DECIMATED_REFINE_NB_SAMPLES before, early 
+// enough for the onset to come after it, and for the difference between the two states to 
+// have faded out when the threshold is crossed. The first sample whose full rate envelope is
+// above the on threshold is the peak, and switches the trigger on. If the decimated envelope
+// falls back below the lowered threshold first, the full rate one never reached the on 
+// threshold, and the candidate is dropped. The trigger switches off when the decimated 
+// envelope falls below the off threshold.
+template <typename Real>
+static void DetectPeaksDecimated(	const float* inputSamples, unsigned int nbSamples, unsigned int decimationFactor, 
+									double peakFilter, double peakRelease, double decimatedPeakFilter, double decimatedPeakRelease, 
+									double triggerOnThreshold, double triggerOffThreshold, unsigned int sampleOffset, PeakSink& outPeaks)
+{
+	const DetectorCoefficients<Real> coefficients(peakFilter, peakRelease);
+	const DetectorCoefficients<Real> decimatedCoefficients(decimatedPeakFilter, decimatedPeakRelease);
+	const Real triggerOn(triggerOnThreshold);
+	const Real triggerOff(triggerOffThreshold);
+	const Real candidateThreshold(triggerOnThreshold * GetDecimatedEnvelopeRatio(peakFilter, decimationFactor));
+	const float scale = 1.0f / (static_cast<float>(decimationFactor) * decimationFactor);
+	const float lastWeight = static_cast<float>(decimationFactor - 1);
+
+	// States before each of the last decimated samples, to restart the full rate filters from.
+	// decimationFactor is a power of two, and so is nbKeptStates.
+	DetectorState<Real>	previousStates[DECIMATED_REFINE_NB_SAMPLES / MIN_DECIMATION_FACTOR];
+	const unsigned int nbKeptStates = DECIMATED_REFINE_NB_SAMPLES / decimationFactor;
+
+	DetectorState<Real>	state;
+	bool	peakTrigger		= false;	// Schmitt trigger output
+	bool	peakCandidate	= false;	// The full rate filters look for the on threshold crossing
+	float	previousSum		= 0.0f;
+	float	previousWeightedSum = 0.0f;
+
+	// Full rate filters, and the next sample they process
+	DetectorState<Real>	refineState;
+	unsigned int		refineSampleIndex = 0;
+
+	// Sample around which the trigger last switched off. The full rate filters can restart 
+	// from before it, where they would find the previous peak again.
+	unsigned int triggerOffSampleIndex = 0;
+
+	const unsigned int nbBlocks = nbSamples / decimationFactor;
+	for (unsigned int blockIndex = 0; blockIndex < nbBlocks; ++blockIndex)
+	{
+		float sum, weightedSum;
+		SumBlock(inputSamples + blockIndex * decimationFactor, decimationFactor, sum, weightedSum);
+		float decimatedSample = (previousSum + previousWeightedSum + lastWeight * sum - weightedSum) * scale;
+		previousSum = sum;
+		previousWeightedSum = weightedSum;
+
+		previousStates[blockIndex & (nbKeptStates - 1)] = state;
+		Real envelopePeak = state.Process(ConvertSample<Real>(decimatedSample), decimatedCoefficients);
+
+		// Peak detector
+		if (peakTrigger)
+		{
+			if (envelopePeak < triggerOff)
+			{
+				peakTrigger = false;
+				triggerOffSampleIndex = blockIndex * decimationFactor;
+			}
+
+			continue;
+		}
+
+		if (!peakCandidate && envelopePeak > candidateThreshold)
+		{
+			// The state before decimated sample k is the one after sample (k - 1) * decimationFactor - 1.
+			// The full rate filters carry on instead if they stopped after that.
+			unsigned int refineFirstBlockIndex = blockIndex >= nbKeptStates - 1 ? blockIndex - (nbKeptStates - 1) : 0;
+			unsigned int refineFirstSampleIndex = refineFirstBlockIndex ? (refineFirstBlockIndex - 1) * decimationFactor : 0;
+			if (refineFirstSampleIndex > refineSampleIndex)
+			{
+				refineState = previousStates[refineFirstBlockIndex & (nbKeptStates - 1)];
+				refineSampleIndex = refineFirstSampleIndex;
+			}
+
+			peakCandidate = true;
+		}
+
+		if (peakCandidate)
+		{
+			// Up to the end of the next block, which the decimated sample already depends on
+			const unsigned int refineEndSampleIndex = std::min(nbSamples, (blockIndex + 2) * decimationFactor);
+			while (refineSampleIndex < refineEndSampleIndex && !peakTrigger)
+			{
+				if (refineState.Process(ConvertSample<Real>(inputSamples[refineSampleIndex]), coefficients) > triggerOn && refineSampleIndex >= triggerOffSampleIndex)
+				{
+					outPeaks.AddPeak(Peak(sampleOffset + refineSampleIndex, sampleOffset + refineSampleIndex));
+					peakTrigger = true;
+				}
+
+				++refineSampleIndex;
+			}
+
+			peakCandidate = !peakTrigger && envelopePeak > candidateThreshold;
+		}
+	}
+}
+
+// Runs DetectPeaks, or DetectPeaksDecimated when decimationFactor is above 1, and the decimated
+// rate is high enough for the low pass frequency
+template <typename Real>
+static void RunDetector(const float* inputSamples, unsigned int nbSamples, unsigned int decimationFactor, 
+						double peakFilter, double peakRelease, double decimatedPeakFilter, double decimatedPeakRelease, 
+						double triggerOnThreshold, double triggerOffThreshold, unsigned int sampleOffset, PeakSink& outPeaks)
+{
+	if (decimationFactor > 1 && GetDecimatedEnvelopeRatio(peakFilter, decimationFactor) >= MIN_DECIMATED_ENVELOPE_RATIO)
+	{
+		DetectPeaksDecimated<Real>(	inputSamples, nbSamples, decimationFactor, peakFilter, peakRelease, decimatedPeakFilter, decimatedPeakRelease, 
+									triggerOnThreshold, triggerOffThreshold, sampleOffset, outPeaks);
+	}
+	else
+	{
+		DetectPeaks<Real>(inputSamples, nbSamples, peakFilter, peakRelease, triggerOnThreshold, triggerOffThreshold, sampleOffset, outPeaks);
+	}
+}
+
+void SimplePeakDetector::Reset(unsigned int sampleRate)
+{
+	// Low pass filter time constant is 1 / (2 * PI * frequency)
+	m_PeakFilter = (2.0 * M_PI * m_Parameters.m_LowPassFrequency) / sampleRate;
+    m_PeakRelease = exp(-1.0 / (sampleRate * m_Parameters.m_ReleaseTime));
+
+	// At the decimated rate, the filters and the envelope decay as much in one sample as they 
+	// do in decimationFactor samples at the full rate
+	const double decimationFactor = m_Parameters.m_DecimationFactor;
+	m_DecimatedPeakFilter = 1.0 - pow(1.0 - m_PeakFilter, decimationFactor);
+	m_DecimatedPeakRelease = pow(m_PeakRelease, decimationFactor);
+}
+
+void SimplePeakDetector::ProcessAudio(const float* inputSamples, unsigned int nbSamples, unsigned int sampleRate, unsigned int sampleOffset, PeakSink& outPeaks)
+{
+    assert(nbSamples == INPUT_WINDOW_SIZE);
+	
+	Reset(sampleRate);
+
+	const double triggerOnThreshold = m_Parameters.m_TriggerOnThreshold;
+	const double triggerOffThreshold = m_Parameters.m_TriggerOffThreshold;
+	const unsigned int decimationFactor = m_Parameters.m_DecimationFactor;
+
+	switch (m_Parameters.m_Arithmetic)
+	{
+	case ARITHMETIC_FLOAT:
+		RunDetector<float>(	inputSamples, nbSamples, decimationFactor, m_PeakFilter, m_PeakRelease, m_DecimatedPeakFilter, m_DecimatedPeakRelease, 
+							triggerOnThreshold, triggerOffThreshold, sampleOffset, outPeaks);
+		break;
+
+	case ARITHMETIC_FIXED_POINT:
+		RunDetector<DetectorFixedPoint>(inputSamples, nbSamples, decimationFactor, m_PeakFilter, m_PeakRelease, m_DecimatedPeakFilter, m_DecimatedPeakRelease, 
+										triggerOnThreshold, triggerOffThreshold, sampleOffset, outPeaks);
+		break;
 
-		m_PrevPeakPulse = m_PeakTrigger;
+	default:
+		RunDetector<double>(inputSamples, nbSamples, decimationFactor, m_PeakFilter, m_PeakRelease, m_DecimatedPeakFilter, m_DecimatedPeakRelease, 
+							triggerOnThreshold, triggerOffThreshold, sampleOffset, outPeaks);
+		break;
 	}
 }
 
-bool SimplePeakDetector::GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, std::vector<Peak>& outPeaks)
+bool SimplePeakDetector::GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, unsigned int sampleOffset, PeakSink& outPeaks)
 {    
     if (!AudioInfo::CheckAudioInfo(audioInfo))
     {
@@ -90,7 +433,7 @@ bool SimplePeakDetector::GetPeaks(const float* samples, unsigned int nbSamples,
 		return false;
 	}
 
-    ProcessAudio(samples, nbSamples, outPeaks);    
+    ProcessAudio(samples, nbSamples, audioInfo.m_SampleRate, sampleOffset, outPeaks);    
 
     return true;
 }
\ No newline at end of file
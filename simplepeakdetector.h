@@ -9,19 +9,54 @@ class Peak;
 
 class SimplePeakDetector : public PeakDetector
 {
+public:
+	// Arithmetic the filters and the envelope follower are computed with. Double is the 
+	// reference, float halves the size of the state and fixed point runs on targets without 
+	// a floating point unit. They can detect slightly different peaks.
+	enum Arithmetic
+	{
+		ARITHMETIC_DOUBLE,
+		ARITHMETIC_FLOAT,
+		ARITHMETIC_FIXED_POINT		// Q3.28, samples are clipped to [-7.99, 7.99]
+	};
+
+	// Tuning parameters of the detector, which can be changed without recompiling
+	struct Parameters
+	{
+		double	m_LowPassFrequency;			// Low pass filter frequency, in Hz
+		double	m_ReleaseTime;				// Release time of envelope detector, in second
+		double	m_TriggerOnThreshold;		// Envelope level above which the Schmitt trigger switches on
+		double	m_TriggerOffThreshold;		// Envelope level below which the Schmitt trigger switches off
+		Arithmetic	m_Arithmetic;
+
+		// The filters, the envelope follower and the Schmitt trigger can run on the samples
+		// decimated by this factor, 1 or a power of two from 4 to 256, which divides their cost
+		// by as much, leaving the cost of summing the samples. Peak candidates are then checked
+		// at the full rate, and peaks are found at the same samples as at the full rate, unless
+		// the envelope stays close to the off threshold, where the trigger can switch off at
+		// another time. Factors leaving the decimated rate too close to the low pass frequency
+		// run at the full rate.
+		unsigned int	m_DecimationFactor;
+
+		Parameters();
+
+		// Returns true if the parameters can be used by a detector
+		bool IsValid() const;
+	};
+
 private:
+	Parameters	m_Parameters;
+
     double  m_PeakFilter;				// Filter coefficient
-    double  m_Filter1Out, m_Filter2Out;
     double  m_PeakRelease;              // Release time coefficient
-    double  m_EnvelopePeak;             // Envelope follower
-    bool    m_PeakTrigger;              // Schmitt trigger output
-    bool    m_PrevPeakPulse;            // Rising edge memory
-    
-    bool    m_PeakPulse;                // Peak detector output
-        
-	void Reset();	
+	double	m_DecimatedPeakFilter;		// Same coefficients at the decimated rate
+	double	m_DecimatedPeakRelease;
+
+	// Computes the coefficients for sampleRate. The filters state lives in ProcessAudio, in 
+	// the arithmetic of the parameters.
+	void Reset(unsigned int sampleRate);	
 
-	virtual void    ProcessAudio(const float* inputSamples, unsigned int nbSamples, std::vector<Peak>& outPeaks);
+	virtual void    ProcessAudio(const float* inputSamples, unsigned int nbSamples, unsigned int sampleRate, unsigned int sampleOffset, PeakSink& outPeaks);
 
 public:
 	
@@ -29,8 +64,15 @@ public:
 	static const unsigned int INPUT_WINDOW_OFFSET	= 4096;	
 
 	SimplePeakDetector();
+	explicit SimplePeakDetector(const Parameters& parameters);
+
+	// Returns false, keeping the current parameters, if parameters aren't valid
+	bool SetParameters(const Parameters& parameters);
+	const Parameters& GetParameters() const { return m_Parameters; }
         
-    virtual bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, std::vector<Peak>& outPeaks);
+	using PeakDetector::GetPeaks;
+
+    virtual bool GetPeaks(const float* samples, unsigned int nbSamples, const AudioInfo& audioInfo, unsigned int sampleOffset, PeakSink& outPeaks);
 };
 
-#endif // SIMPLEPEAKDETECTOR_H
\ No newline at end of file
+#endif // SIMPLEPEAKDETECTOR_H
@@ -0,0 +1,379 @@
+#include <new>
+#include <memory>
+#include <algorithm>
+
+#include "soundbox_c.h"
+#include "audiosource.h"
+#include "simplepeakdetector.h"
+#include "Clip.h"
+
+struct SoundBoxClip
+{
+	SimplePeakDetector	m_PeakDetector;
+	AClip				m_Clip;
+	bool				m_Analyzed;
+
+	explicit SoundBoxClip(const SimplePeakDetector::Parameters& parameters)
+		:	m_PeakDetector(parameters),
+			m_Analyzed(false)
+	{
+		m_Clip.SetPeakDetector(&m_PeakDetector);
+	}
+};
+
+// Interleaved samples held by the caller, read in place
+class MemoryAudioSource : public AudioSource
+{
+private:
+	AudioInfo		m_AudioInfo;
+	const float*	m_Samples;
+
+public:
+	MemoryAudioSource(const AudioInfo& audioInfo, const float* samples) : m_AudioInfo(audioInfo), m_Samples(samples) {}
+
+	virtual const AudioInfo& GetAudioInfo() const { return m_AudioInfo; }
+
+	virtual bool ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+	{
+		if (firstSampleIndex >= endSampleIndex || endSampleIndex > m_AudioInfo.m_NbSamples)
+		{
+			return false;
+		}
+
+		std::copy(	m_Samples + static_cast<size_t>(firstSampleIndex) * m_AudioInfo.m_NumChannels,
+					m_Samples + static_cast<size_t>(endSampleIndex) * m_AudioInfo.m_NumChannels, outSamples);
+		return true;
+	}
+};
+
+// Samples read from a callback of the caller
+class CallbackAudioSource : public AudioSource
+{
+private:
+	AudioInfo				m_AudioInfo;
+	SoundBoxReadCallback	m_ReadCallback;
+	void*					m_UserData;
+
+public:
+	CallbackAudioSource(const AudioInfo& audioInfo, SoundBoxReadCallback readCallback, void* userData)
+		:	m_AudioInfo(audioInfo),
+			m_ReadCallback(readCallback),
+			m_UserData(userData)
+	{
+	}
+
+	virtual const AudioInfo& GetAudioInfo() const { return m_AudioInfo; }
+
+	virtual bool ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+	{
+		if (firstSampleIndex >= endSampleIndex || endSampleIndex > m_AudioInfo.m_NbSamples)
+		{
+			return false;
+		}
+
+		return m_ReadCallback(m_UserData, firstSampleIndex, endSampleIndex - firstSampleIndex, outSamples) != 0;
+	}
+};
+
+static bool GetAudioInfo(unsigned int nbFrames, unsigned int numChannels, unsigned int sampleRate, AudioInfo& outAudioInfo)
+{
+	if (!nbFrames || !numChannels || numChannels > 0xFFFF || !sampleRate)
+	{
+		return false;
+	}
+
+	outAudioInfo.m_SampleRate		= sampleRate;
+	outAudioInfo.m_BitsPerSample	= 32;
+	outAudioInfo.m_NumChannels		= static_cast<unsigned short>(numChannels);
+	outAudioInfo.m_NbSamples		= nbFrames;
+	return true;
+}
+
+// Replaces the warp markers of a clip that was just analyzed by its default ones
+static SoundBoxStatus FinishAnalysis(SoundBoxClip* clip, bool analyzed)
+{
+	clip->m_Clip.ClearWarpMarkers();
+	clip->m_Analyzed = analyzed && clip->m_Clip.AddDefaultWarpMarkers();
+	return clip->m_Analyzed ? SOUNDBOX_OK : SOUNDBOX_ERROR_READ;
+}
+
+unsigned int soundbox_get_api_version(void)
+{
+	return SOUNDBOX_API_VERSION;
+}
+
+void soundbox_get_default_detector_parameters(SoundBoxDetectorParameters* outParameters)
+{
+	if (!outParameters)
+	{
+		return;
+	}
+
+	SimplePeakDetector::Parameters parameters;
+	outParameters->lowPassFrequency		= parameters.m_LowPassFrequency;
+	outParameters->releaseTime			= parameters.m_ReleaseTime;
+	outParameters->triggerOnThreshold	= parameters.m_TriggerOnThreshold;
+	outParameters->triggerOffThreshold	= parameters.m_TriggerOffThreshold;
+	outParameters->decimationFactor		= parameters.m_DecimationFactor;
+}
+
+SoundBoxClip* soundbox_clip_create(const SoundBoxDetectorParameters* parameters)
+{
+	SimplePeakDetector::Parameters detectorParameters;
+	if (parameters)
+	{
+		detectorParameters.m_LowPassFrequency		= parameters->lowPassFrequency;
+		detectorParameters.m_ReleaseTime			= parameters->releaseTime;
+		detectorParameters.m_TriggerOnThreshold		= parameters->triggerOnThreshold;
+		detectorParameters.m_TriggerOffThreshold	= parameters->triggerOffThreshold;
+		detectorParameters.m_DecimationFactor		= parameters->decimationFactor;
+	}
+
+	if (!detectorParameters.IsValid())
+	{
+		return 0;
+	}
+
+	return new (std::nothrow) SoundBoxClip(detectorParameters);
+}
+
+void soundbox_clip_destroy(SoundBoxClip* clip)
+{
+	delete clip;
+}
+
+// Exceptions must not cross the C interface, the only one thrown is std::bad_alloc
+SoundBoxStatus soundbox_clip_analyze_samples(SoundBoxClip* clip, const float* samples, unsigned int nbFrames, unsigned int numChannels, unsigned int sampleRate)
+{
+	AudioInfo audioInfo;
+	if (!clip || !samples || !GetAudioInfo(nbFrames, numChannels, sampleRate, audioInfo))
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		if (numChannels == 1)
+		{
+			return FinishAnalysis(clip, clip->m_Clip.LoadDataFromSamples(audioInfo, samples));
+		}
+
+		MemoryAudioSource audioSource(audioInfo, samples);
+		return FinishAnalysis(clip, clip->m_Clip.LoadDataFromSource(audioSource));
+	}
+	catch (const std::bad_alloc&)
+	{
+		clip->m_Analyzed = false;
+		return SOUNDBOX_ERROR_OUT_OF_MEMORY;
+	}
+}
+
+SoundBoxStatus soundbox_clip_analyze_callback(	SoundBoxClip* clip, SoundBoxReadCallback readCallback, void* userData,
+												unsigned int nbFrames, unsigned int numChannels, unsigned int sampleRate)
+{
+	AudioInfo audioInfo;
+	if (!clip || !readCallback || !GetAudioInfo(nbFrames, numChannels, sampleRate, audioInfo))
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		CallbackAudioSource audioSource(audioInfo, readCallback, userData);
+		return FinishAnalysis(clip, clip->m_Clip.LoadDataFromSource(audioSource));
+	}
+	catch (const std::bad_alloc&)
+	{
+		clip->m_Analyzed = false;
+		return SOUNDBOX_ERROR_OUT_OF_MEMORY;
+	}
+}
+
+SoundBoxStatus soundbox_clip_analyze_file(SoundBoxClip* clip, const char* filePath)
+{
+	if (!clip || !filePath)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		// Owned, so that it's deleted if the analysis runs out of memory
+		std::auto_ptr<AudioSource> audioSource(AudioSource::Open(filePath));
+		if (!audioSource.get())
+		{
+			clip->m_Analyzed = false;
+			return SOUNDBOX_ERROR_READ;
+		}
+
+		return FinishAnalysis(clip, clip->m_Clip.LoadDataFromSource(*audioSource, filePath));
+	}
+	catch (const std::bad_alloc&)
+	{
+		clip->m_Analyzed = false;
+		return SOUNDBOX_ERROR_OUT_OF_MEMORY;
+	}
+}
+
+SoundBoxStatus soundbox_clip_get_duration(const SoundBoxClip* clip, double* outDuration)
+{
+	if (!clip || !outDuration)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	*outDuration = clip->m_Clip.GetDuration();
+	return SOUNDBOX_OK;
+}
+
+SoundBoxStatus soundbox_clip_get_nb_peaks(const SoundBoxClip* clip, size_t* outNbPeaks)
+{
+	if (!clip || !outNbPeaks)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	*outNbPeaks = clip->m_Clip.GetPeaks().size();
+	return SOUNDBOX_OK;
+}
+
+SoundBoxStatus soundbox_clip_get_peaks(const SoundBoxClip* clip, size_t firstPeakIndex, size_t nbPeaks, SoundBoxPeak* outPeaks)
+{
+	if (!clip || (nbPeaks && !outPeaks))
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	const std::vector<Peak>& peaks = clip->m_Clip.GetPeaks();
+	if (firstPeakIndex > peaks.size() || nbPeaks > peaks.size() - firstPeakIndex)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	for (size_t peakIndex = 0; peakIndex < nbPeaks; ++peakIndex)
+	{
+		const Peak& peak = peaks[firstPeakIndex + peakIndex];
+		outPeaks[peakIndex].peakFrame	= peak.GetPeakSampleIndex();
+		outPeaks[peakIndex].attackFrame	= peak.GetAttackSampleIndex();
+	}
+
+	return SOUNDBOX_OK;
+}
+
+SoundBoxStatus soundbox_clip_get_bpm(SoundBoxClip* clip, double* outBpm)
+{
+	if (!clip || !outBpm)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	double bpm = 0.0;
+	if (!clip->m_Clip.GetBPM(bpm))
+	{
+		return SOUNDBOX_ERROR_NO_BPM;
+	}
+
+	*outBpm = bpm;
+	return SOUNDBOX_OK;
+}
+
+SoundBoxStatus soundbox_clip_add_warp_marker(SoundBoxClip* clip, double sampleTime, double beatTime)
+{
+	if (!clip)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	try
+	{
+		return clip->m_Clip.AddWarpMarker(sampleTime, beatTime) ? SOUNDBOX_OK : SOUNDBOX_ERROR_WARP_MARKER;
+	}
+	catch (const std::bad_alloc&)
+	{
+		return SOUNDBOX_ERROR_OUT_OF_MEMORY;
+	}
+}
+
+SoundBoxStatus soundbox_clip_reset_warp_markers(SoundBoxClip* clip)
+{
+	if (!clip)
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	try
+	{
+		return FinishAnalysis(clip, true);
+	}
+	catch (const std::bad_alloc&)
+	{
+		clip->m_Analyzed = false;
+		return SOUNDBOX_ERROR_OUT_OF_MEMORY;
+	}
+}
+
+// Converts times with the const, cache-free, conversions of AClip
+static SoundBoxStatus ConvertTimes(const SoundBoxClip* clip, const double* times, size_t nbTimes, double* outTimes, bool beatToSampleTime)
+{
+	if (!clip || (nbTimes && (!times || !outTimes)))
+	{
+		return SOUNDBOX_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!clip->m_Analyzed)
+	{
+		return SOUNDBOX_ERROR_NOT_ANALYZED;
+	}
+
+	const AClip& analyzedClip = clip->m_Clip;
+	for (size_t timeIndex = 0; timeIndex < nbTimes; ++timeIndex)
+	{
+		double convertedTime = -1.0;
+		bool converted =	beatToSampleTime ?
+							analyzedClip.FindSampleTime(times[timeIndex], convertedTime) :
+							analyzedClip.FindBeatTime(times[timeIndex], convertedTime);
+		outTimes[timeIndex] = converted ? convertedTime : -1.0;
+	}
+
+	return SOUNDBOX_OK;
+}
+
+SoundBoxStatus soundbox_clip_beat_to_sample_times(const SoundBoxClip* clip, const double* beatTimes, size_t nbTimes, double* outSampleTimes)
+{
+	return ConvertTimes(clip, beatTimes, nbTimes, outSampleTimes, true);
+}
+
+SoundBoxStatus soundbox_clip_sample_to_beat_times(const SoundBoxClip* clip, const double* sampleTimes, size_t nbTimes, double* outBeatTimes)
+{
+	return ConvertTimes(clip, sampleTimes, nbTimes, outBeatTimes, false);
+}
@@ -0,0 +1,129 @@
+#ifndef SOUNDBOX_C_H_
+#define SOUNDBOX_C_H_
+
+/*
+ *	C interface of the clip analysis and warping, for hosts that embed SoundBox without
+ *	using its C++ classes. The interface only uses C types, and its structures only grow at
+ *	their end, so that it stays binary compatible from one version to the next: check
+ *	soundbox_get_api_version against SOUNDBOX_API_VERSION.
+ *
+ *	Audio is given as 32 bits float samples, channels interleaved, either in a buffer owned
+ *	by the caller, which is read in place and isn't kept, or through a read callback. Results
+ *	are written into arrays owned by the caller, nothing is allocated for them.
+ *	Positions are in frames: a frame holds one sample of each channel. Times are in seconds.
+ *
+ *	A clip handle can be used by one thread at a time, except for the const functions, which
+ *	any number of threads can call at the same time while the clip isn't modified.
+ *	Functions return SOUNDBOX_OK on success, and leave their outputs unchanged otherwise.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SoundBox builds as an executable. Hosts that build these sources into a DLL of their own
+   define SOUNDBOX_C_EXPORTS when building it, and SOUNDBOX_C_IMPORTS when using it. */
+#if defined(_WIN32) && defined(SOUNDBOX_C_EXPORTS)
+#define SOUNDBOX_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(SOUNDBOX_C_IMPORTS)
+#define SOUNDBOX_API __declspec(dllimport)
+#else
+#define SOUNDBOX_API
+#endif
+
+#define SOUNDBOX_API_VERSION	1
+
+typedef enum SoundBoxStatus
+{
+	SOUNDBOX_OK						= 0,
+	SOUNDBOX_ERROR_INVALID_ARGUMENT	= 1,	/* Null pointer, empty or inconsistent audio format */
+	SOUNDBOX_ERROR_READ				= 2,	/* The file or the read callback failed */
+	SOUNDBOX_ERROR_NOT_ANALYZED		= 3,	/* Nothing was analyzed by the clip yet */
+	SOUNDBOX_ERROR_WARP_MARKER		= 4,	/* The warp marker isn't consistent with the others */
+	SOUNDBOX_ERROR_NO_BPM			= 5,
+	SOUNDBOX_ERROR_OUT_OF_MEMORY	= 6
+} SoundBoxStatus;
+
+typedef struct SoundBoxClip SoundBoxClip;
+
+/* Parameters of the onset detector, see SimplePeakDetector::Parameters */
+typedef struct SoundBoxDetectorParameters
+{
+	double			lowPassFrequency;		/* Hz */
+	double			releaseTime;			/* Seconds */
+	double			triggerOnThreshold;
+	double			triggerOffThreshold;
+	unsigned int	decimationFactor;		/* 1, or a power of two from 4 to 256 */
+} SoundBoxDetectorParameters;
+
+typedef struct SoundBoxPeak
+{
+	unsigned int	peakFrame;
+	unsigned int	attackFrame;
+} SoundBoxPeak;
+
+/*
+ *	Reads nbFrames frames starting at frame firstFrame, interleaved, in outSamples, which has
+ *	room for nbFrames * numChannels samples. Returns non zero on success. Frames are read in
+ *	increasing order, one block at a time.
+ */
+typedef int (*SoundBoxReadCallback)(void* userData, unsigned int firstFrame, unsigned int nbFrames, float* outSamples);
+
+SOUNDBOX_API unsigned int soundbox_get_api_version(void);
+
+/* Fills parameters with the default parameters of the detector */
+SOUNDBOX_API void soundbox_get_default_detector_parameters(SoundBoxDetectorParameters* outParameters);
+
+/* Creates a clip analyzed with parameters, or the default ones if parameters is null. Returns
+   null if the parameters aren't valid. */
+SOUNDBOX_API SoundBoxClip* soundbox_clip_create(const SoundBoxDetectorParameters* parameters);
+SOUNDBOX_API void soundbox_clip_destroy(SoundBoxClip* clip);
+
+/*
+ *	Analyzes audio, replacing what the clip held before. The clip then has its default warp
+ *	markers, at its first frame and after its last one.
+ *	 - from samples, nbFrames frames of numChannels interleaved channels. Mono samples are
+ *	   analyzed in place, other ones are mixed down block by block.
+ *	 - from a read callback, called with userData
+ *	 - from a WAV or FLAC file
+ */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_analyze_samples(	SoundBoxClip* clip, const float* samples, unsigned int nbFrames,
+															unsigned int numChannels, unsigned int sampleRate);
+SOUNDBOX_API SoundBoxStatus soundbox_clip_analyze_callback(	SoundBoxClip* clip, SoundBoxReadCallback readCallback, void* userData,
+															unsigned int nbFrames, unsigned int numChannels, unsigned int sampleRate);
+SOUNDBOX_API SoundBoxStatus soundbox_clip_analyze_file(SoundBoxClip* clip, const char* filePath);
+
+/* const. Duration of the clip, in seconds */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_get_duration(const SoundBoxClip* clip, double* outDuration);
+
+/* const. Number of onsets found by the analysis */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_get_nb_peaks(const SoundBoxClip* clip, size_t* outNbPeaks);
+
+/* const. Copies the onsets [firstPeakIndex, firstPeakIndex + nbPeaks) in outPeaks, sorted by
+   frame, so that they can be read in blocks of any size */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_get_peaks(const SoundBoxClip* clip, size_t firstPeakIndex, size_t nbPeaks, SoundBoxPeak* outPeaks);
+
+SOUNDBOX_API SoundBoxStatus soundbox_clip_get_bpm(SoundBoxClip* clip, double* outBpm);
+
+/* Warps the frame at sampleTime in the clip to beatTime. Warp markers must be in the same
+   order in both times. */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_add_warp_marker(SoundBoxClip* clip, double sampleTime, double beatTime);
+
+/* Removes all the warp markers but the default ones */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_reset_warp_markers(SoundBoxClip* clip);
+
+/*
+ *	const. Converts nbTimes times at once, from beat times to sample times or the other way
+ *	round. Times outside of the warp markers are converted to -1. times and outTimes can be
+ *	the same array.
+ */
+SOUNDBOX_API SoundBoxStatus soundbox_clip_beat_to_sample_times(const SoundBoxClip* clip, const double* beatTimes, size_t nbTimes, double* outSampleTimes);
+SOUNDBOX_API SoundBoxStatus soundbox_clip_sample_to_beat_times(const SoundBoxClip* clip, const double* sampleTimes, size_t nbTimes, double* outBeatTimes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOUNDBOX_C_H_ */
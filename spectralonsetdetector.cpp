@@ -0,0 +1,97 @@
+#include <cmath>
+#include <algorithm>
+
+#include "spectralonsetdetector.h"
+
+// Magnitudes are compressed as log(1 + MAGNITUDE_COMPRESSION * magnitude), so that the flux
+// follows the quiet bins as well as the loud ones
+#define MAGNITUDE_COMPRESSION		1000.0f
+
+// Frames on each side within which an onset must be the highest flux peak
+#define NB_PEAK_FRAMES				3
+
+// Frames on each side of the mean flux a peak is compared to
+#define NB_MEAN_FRAMES				16
+
+// Part of the highest flux of the clip a peak must be above the mean flux around it
+#define THRESHOLD					0.1
+
+bool SpectralOnsetDetector::Detect(StftFrameCache& frameCache, const StftConfiguration& configuration)
+{
+	m_Onsets.clear();
+
+	const StftFrames* frames = frameCache.Acquire(configuration);
+	if (!frames)
+	{
+		return false;
+	}
+
+	const unsigned int nbFrames = frames->GetNbFrames();
+	const unsigned int nbBins = frames->GetNbBins();
+	std::vector<float> magnitudes(nbBins);
+	std::vector<float> previousMagnitudes(nbBins, 0.0f);
+	std::vector<double> fluxes(nbFrames);
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		frames->GetMagnitudes(frameIndex, &magnitudes[0]);
+
+		double flux = 0.0;
+		for (unsigned int binIndex = 0; binIndex < nbBins; ++binIndex)
+		{
+			magnitudes[binIndex] = logf(1.0f + MAGNITUDE_COMPRESSION * magnitudes[binIndex]);
+			flux += std::max(magnitudes[binIndex] - previousMagnitudes[binIndex], 0.0f);
+		}
+
+		fluxes[frameIndex] = flux;
+		magnitudes.swap(previousMagnitudes);
+	}
+
+	const StftConfiguration frameConfiguration = frames->GetConfiguration();
+	frameCache.Release(frames);
+
+	if (!nbFrames)
+	{
+		return true;
+	}
+
+	const double threshold = THRESHOLD * *std::max_element(fluxes.begin(), fluxes.end());
+	if (threshold <= 0.0)
+	{
+		return true;
+	}
+
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		const double flux = fluxes[frameIndex];
+		unsigned int firstPeakFrameIndex = frameIndex > NB_PEAK_FRAMES ? frameIndex - NB_PEAK_FRAMES : 0;
+		unsigned int endPeakFrameIndex = std::min(frameIndex + NB_PEAK_FRAMES + 1, nbFrames);
+
+		// Equal fluxes are a single peak, at the first of them
+		bool isPeak = true;
+		for (unsigned int peakFrameIndex = firstPeakFrameIndex; peakFrameIndex < endPeakFrameIndex && isPeak; ++peakFrameIndex)
+		{
+			isPeak = peakFrameIndex < frameIndex ? fluxes[peakFrameIndex] < flux : fluxes[peakFrameIndex] <= flux;
+		}
+
+		if (!isPeak)
+		{
+			continue;
+		}
+
+		unsigned int firstMeanFrameIndex = frameIndex > NB_MEAN_FRAMES ? frameIndex - NB_MEAN_FRAMES : 0;
+		unsigned int endMeanFrameIndex = std::min(frameIndex + NB_MEAN_FRAMES + 1, nbFrames);
+		double meanFlux = 0.0;
+		for (unsigned int meanFrameIndex = firstMeanFrameIndex; meanFrameIndex < endMeanFrameIndex; ++meanFrameIndex)
+		{
+			meanFlux += fluxes[meanFrameIndex];
+		}
+
+		meanFlux /= endMeanFrameIndex - firstMeanFrameIndex;
+		if (flux > meanFlux + threshold)
+		{
+			m_Onsets.push_back(frameIndex * frameConfiguration.m_HopSize + frameConfiguration.m_WindowSize / 2);
+		}
+	}
+
+	return true;
+}
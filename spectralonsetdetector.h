@@ -0,0 +1,31 @@
+#ifndef SPECTRALONSETDETECTOR_H_
+#define SPECTRALONSETDETECTOR_H_
+
+#include <vector>
+
+#include "stftframecache.h"
+
+/**
+ *	A SpectralOnsetDetector finds the onsets of a clip in its spectral flux: the sum over the
+ *	bins of the increases of their log compressed magnitude from one frame to the next. Flux
+ *	peaks that are the highest within 3 frames and above the mean flux around them by a
+ *	tenth of the highest flux of the clip are onsets.
+ *	Unlike the peak detectors, which follow the level of the samples, it finds the notes that
+ *	start without getting louder, at the resolution of the hop size. Frames come from a
+ *	StftFrameCache, so the detector shares its transform with the other spectral features of
+ *	the clip.
+ */
+class SpectralOnsetDetector
+{
+public:
+	// Returns false if the frames can't be computed, see StftFrameCache::Acquire
+	bool Detect(StftFrameCache& frameCache, const StftConfiguration& configuration = StftConfiguration());
+
+	// Sample index of each onset, at the center of the frame it was found in, sorted
+	const std::vector<unsigned int>& GetOnsets() const { return m_Onsets; }
+
+private:
+	std::vector<unsigned int>	m_Onsets;
+};
+
+#endif // SPECTRALONSETDETECTOR_H_
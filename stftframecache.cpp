@@ -0,0 +1,318 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "stftframecache.h"
+#include "audiosource.h"
+#include "fft.h"
+#include "samplestore.h"
+#include "Clip.h"
+
+#define DEFAULT_WINDOW_SIZE		4096
+#define DEFAULT_HOP_SIZE		1024
+#define NB_FRAMES_PER_CHUNK		64
+#define PHASE_SCALE				32767.0
+
+StftConfiguration::StftConfiguration()
+	:	m_WindowSize(DEFAULT_WINDOW_SIZE),
+		m_HopSize(DEFAULT_HOP_SIZE)
+{
+}
+
+bool StftConfiguration::IsValid() const
+{
+	return Fft::IsValidSize(m_WindowSize) && m_HopSize > 0;
+}
+
+bool StftConfiguration::operator<(const StftConfiguration& other) const
+{
+	if (m_WindowSize != other.m_WindowSize)
+	{
+		return m_WindowSize < other.m_WindowSize;
+	}
+
+	return m_HopSize < other.m_HopSize;
+}
+
+void StftFrames::GetMagnitudes(unsigned int frameIndex, float* outMagnitudes) const
+{
+	SampleStore::ConvertFromFloat16(&m_Magnitudes[static_cast<size_t>(frameIndex) * m_NbBins], m_NbBins, outMagnitudes);
+}
+
+void StftFrames::GetPhases(unsigned int frameIndex, float* outPhases) const
+{
+	const short* phases = &m_Phases[static_cast<size_t>(frameIndex) * m_NbBins];
+	for (unsigned int binIndex = 0; binIndex < m_NbBins; ++binIndex)
+	{
+		outPhases[binIndex] = static_cast<float>(phases[binIndex] * (M_PI / PHASE_SCALE));
+	}
+}
+
+// Reads the mono samples of a clip, from its resident samples if it keeps them, otherwise
+// from the file it was loaded from
+class ClipSampleReader
+{
+private:
+	const SampleStore&	m_ResidentSamples;
+	AudioSource*		m_AudioSource;
+
+public:
+	explicit ClipSampleReader(const AClip& clip)
+		:	m_ResidentSamples(clip.GetResidentSamples()),
+			m_AudioSource(0)
+	{
+		if (m_ResidentSamples.IsEmpty() && !clip.GetFilePath().empty())
+		{
+			m_AudioSource = AudioSource::Open(clip.GetFilePath());
+
+			// The file must still be the one the clip was loaded from
+			if (m_AudioSource && m_AudioSource->GetAudioInfo().m_NbSamples != clip.GetAudioInfo().m_NbSamples)
+			{
+				delete m_AudioSource;
+				m_AudioSource = 0;
+			}
+		}
+	}
+
+	~ClipSampleReader()
+	{
+		delete m_AudioSource;
+	}
+
+	bool Read(unsigned int firstSampleIndex, unsigned int nbSamples, float* outSamples)
+	{
+		if (m_AudioSource)
+		{
+			return m_AudioSource->ReadMonoRange(firstSampleIndex, firstSampleIndex + nbSamples, outSamples);
+		}
+
+		return m_ResidentSamples.Read(firstSampleIndex, nbSamples, outSamples);
+	}
+};
+
+bool StftFrameCache::ComputeFrames(const StftConfiguration& configuration, StftFrames& outFrames) const
+{
+	const AudioInfo& audioInfo = m_Clip.GetAudioInfo();
+	const unsigned int nbSamples = audioInfo.m_NbSamples;
+	const unsigned int windowSize = configuration.m_WindowSize;
+	const unsigned int hopSize = configuration.m_HopSize;
+
+	outFrames.m_Configuration = configuration;
+	outFrames.m_SampleRate = audioInfo.m_SampleRate;
+	outFrames.m_NbFrames = nbSamples ? (nbSamples - 1) / hopSize + 1 : 0;
+	outFrames.m_NbBins = windowSize / 2 + 1;
+	outFrames.m_Magnitudes.resize(static_cast<size_t>(outFrames.m_NbFrames) * outFrames.m_NbBins);
+	outFrames.m_Phases.resize(outFrames.m_Magnitudes.size());
+	if (!outFrames.m_NbFrames)
+	{
+		return true;
+	}
+
+	ClipSampleReader sampleReader(m_Clip);
+	const Fft fft(windowSize);
+
+	// Periodic Hann window, and the scale giving a magnitude of 1.0 to a full scale sine
+	std::vector<float> window(windowSize);
+	for (unsigned int sampleIndex = 0; sampleIndex < windowSize; ++sampleIndex)
+	{
+		window[sampleIndex] = static_cast<float>(0.5 - 0.5 * cos(2.0 * M_PI * sampleIndex / windowSize));
+	}
+
+	const float magnitudeScale = 4.0f / windowSize;
+	const unsigned int nbBins = outFrames.m_NbBins;
+
+	// Frames are transformed by chunks, whose samples are read at once
+	std::vector<float> chunkSamples(static_cast<size_t>(NB_FRAMES_PER_CHUNK - 1) * hopSize + windowSize);
+	for (unsigned int firstFrameIndex = 0; firstFrameIndex < outFrames.m_NbFrames; firstFrameIndex += NB_FRAMES_PER_CHUNK)
+	{
+		const int nbChunkFrames = static_cast<int>(std::min<unsigned int>(NB_FRAMES_PER_CHUNK, outFrames.m_NbFrames - firstFrameIndex));
+		const unsigned int firstSampleIndex = firstFrameIndex * hopSize;
+		const unsigned int nbChunkSamples = (nbChunkFrames - 1) * hopSize + windowSize;
+		const unsigned int nbSamplesToRead = std::min(nbChunkSamples, nbSamples - firstSampleIndex);
+		if (!sampleReader.Read(firstSampleIndex, nbSamplesToRead, &chunkSamples[0]))
+		{
+			return false;
+		}
+
+		std::fill(chunkSamples.begin() + nbSamplesToRead, chunkSamples.begin() + nbChunkSamples, 0.0f);
+
+		#pragma omp parallel if (nbChunkFrames > 1)
+		{
+			std::vector<float> windowedSamples(windowSize);
+			std::vector<float> real(nbBins);
+			std::vector<float> imaginary(nbBins);
+			std::vector<float> magnitudes(nbBins);
+
+			#pragma omp for schedule(static)
+			for (int chunkFrameIndex = 0; chunkFrameIndex < nbChunkFrames; ++chunkFrameIndex)
+			{
+				const float* frameSamples = &chunkSamples[chunkFrameIndex * hopSize];
+				for (unsigned int sampleIndex = 0; sampleIndex < windowSize; ++sampleIndex)
+				{
+					windowedSamples[sampleIndex] = frameSamples[sampleIndex] * window[sampleIndex];
+				}
+
+				fft.Forward(&windowedSamples[0], &real[0], &imaginary[0]);
+
+				const size_t firstValueIndex = static_cast<size_t>(firstFrameIndex + chunkFrameIndex) * nbBins;
+				short* phases = &outFrames.m_Phases[firstValueIndex];
+				for (unsigned int binIndex = 0; binIndex < nbBins; ++binIndex)
+				{
+					magnitudes[binIndex] = magnitudeScale * sqrtf(real[binIndex] * real[binIndex] + imaginary[binIndex] * imaginary[binIndex]);
+					phases[binIndex] = static_cast<short>(floor(atan2(imaginary[binIndex], real[binIndex]) * (PHASE_SCALE / M_PI) + 0.5));
+				}
+
+				SampleStore::ConvertToFloat16(&magnitudes[0], nbBins, &outFrames.m_Magnitudes[firstValueIndex]);
+			}
+		}
+	}
+
+	return true;
+}
+
+StftFrameCache::StftFrameCache(const AClip& clip, size_t budget)
+	:	m_Clip(clip),
+		m_Budget(budget),
+		m_Size(0),
+		m_NbTransforms(0)
+{
+}
+
+StftFrameCache::~StftFrameCache()
+{
+	Clear();
+
+	// Users must release what they acquire before the clip is deleted
+	assert(m_ClearedFrames.empty());
+	std::map<const StftFrames*, unsigned int>::iterator itClearedFrames = m_ClearedFrames.begin();
+	for (; itClearedFrames != m_ClearedFrames.end(); ++itClearedFrames)
+	{
+		delete itClearedFrames->first;
+	}
+}
+
+const StftFrames* StftFrameCache::Acquire(const StftConfiguration& configuration)
+{
+	CacheEntries::iterator itEntry = m_Entries.find(configuration);
+	if (itEntry != m_Entries.end())
+	{
+		// Move the configuration at the most recently used end of the list
+		m_LeastRecentlyUsed.splice(m_LeastRecentlyUsed.end(), m_LeastRecentlyUsed, itEntry->second.m_ItLeastRecentlyUsed);
+		++itEntry->second.m_NbAcquisitions;
+		return itEntry->second.m_Frames;
+	}
+
+	if (!configuration.IsValid())
+	{
+		return 0;
+	}
+
+	StftFrames* frames = new StftFrames;
+	if (!ComputeFrames(configuration, *frames))
+	{
+		delete frames;
+		return 0;
+	}
+
+	++m_NbTransforms;
+
+	CacheEntry entry;
+	entry.m_Frames					= frames;
+	entry.m_NbAcquisitions			= 1;
+	entry.m_ItLeastRecentlyUsed		= m_LeastRecentlyUsed.insert(m_LeastRecentlyUsed.end(), configuration);
+	m_Entries[configuration] = entry;
+
+	m_Size += frames->GetSize();
+	EvictUntilWithinBudget();
+
+	return frames;
+}
+
+void StftFrameCache::Release(const StftFrames* frames)
+{
+	if (!frames)
+	{
+		return;
+	}
+
+	CacheEntries::iterator itEntry = m_Entries.find(frames->GetConfiguration());
+	if (itEntry == m_Entries.end() || itEntry->second.m_Frames != frames)
+	{
+		// Frames acquired before the cache was cleared
+		std::map<const StftFrames*, unsigned int>::iterator itClearedFrames = m_ClearedFrames.find(frames);
+		if (itClearedFrames == m_ClearedFrames.end())
+		{
+			assert(false);
+			return;
+		}
+
+		if (!--itClearedFrames->second)
+		{
+			delete frames;
+			m_ClearedFrames.erase(itClearedFrames);
+		}
+
+		return;
+	}
+
+	if (!itEntry->second.m_NbAcquisitions)
+	{
+		assert(false);
+		return;
+	}
+
+	--itEntry->second.m_NbAcquisitions;
+
+	// The cache may have been over budget because these frames were in use
+	EvictUntilWithinBudget();
+}
+
+void StftFrameCache::Clear()
+{
+	CacheEntries::iterator itEntries = m_Entries.begin();
+	CacheEntries::iterator itEntriesEnd = m_Entries.end();
+	for (; itEntries != itEntriesEnd; ++itEntries)
+	{
+		// Frames still in use are deleted when they're released
+		if (itEntries->second.m_NbAcquisitions)
+		{
+			m_ClearedFrames[itEntries->second.m_Frames] = itEntries->second.m_NbAcquisitions;
+			continue;
+		}
+
+		delete itEntries->second.m_Frames;
+	}
+
+	m_Entries.clear();
+	m_LeastRecentlyUsed.clear();
+	m_Size = 0;
+}
+
+void StftFrameCache::SetBudget(size_t budget)
+{
+	m_Budget = budget;
+	EvictUntilWithinBudget();
+}
+
+void StftFrameCache::EvictUntilWithinBudget()
+{
+	std::list<StftConfiguration>::iterator itLeastRecentlyUsed = m_LeastRecentlyUsed.begin();
+	while (m_Size > m_Budget && itLeastRecentlyUsed != m_LeastRecentlyUsed.end())
+	{
+		CacheEntries::iterator itEntry = m_Entries.find(*itLeastRecentlyUsed);
+		assert(itEntry != m_Entries.end());
+
+		if (itEntry->second.m_NbAcquisitions)
+		{
+			// In use, try the next least recently used configuration
+			++itLeastRecentlyUsed;
+			continue;
+		}
+
+		m_Size -= itEntry->second.m_Frames->GetSize();
+		delete itEntry->second.m_Frames;
+		m_Entries.erase(itEntry);
+		itLeastRecentlyUsed = m_LeastRecentlyUsed.erase(itLeastRecentlyUsed);
+	}
+}
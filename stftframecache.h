@@ -0,0 +1,140 @@
+#ifndef STFTFRAMECACHE_H_
+#define STFTFRAMECACHE_H_
+
+#include <vector>
+#include <map>
+#include <list>
+
+class AClip;
+
+/**
+ *	Configuration of a short time Fourier transform: frames of m_WindowSize samples, a power of
+ *	two, weighted by a Hann window, one every m_HopSize samples.
+ */
+struct StftConfiguration
+{
+	unsigned int	m_WindowSize;
+	unsigned int	m_HopSize;
+
+	// 4096 samples every 1024 samples, which the spectral features of the library share
+	StftConfiguration();
+	StftConfiguration(unsigned int windowSize, unsigned int hopSize) : m_WindowSize(windowSize), m_HopSize(hopSize) {}
+
+	bool IsValid() const;
+
+	bool operator<(const StftConfiguration& other) const;
+};
+
+/**
+ *	Frames of the short time Fourier transform of a clip, mixed down to mono. Frame i covers
+ *	the samples [i * m_HopSize, i * m_HopSize + m_WindowSize), padded with 0 past the end of the
+ *	clip, and there are as many frames as needed for every sample to start one hop.
+ *	Bins are kept in 4 bytes instead of the 8 of a complex float:
+ *	 - the magnitude as a half float, scaled so that a full scale sine centered on a bin has a
+ *	   magnitude of 1.0. Its relative error is below 2^-11 down to about -84 dB.
+ *	 - the phase quantized on 16 bits, an error below 5e-5 radian
+ */
+class StftFrames
+{
+public:
+	StftFrames() : m_SampleRate(0), m_NbFrames(0), m_NbBins(0) {}
+
+	const StftConfiguration& GetConfiguration() const { return m_Configuration; }
+	unsigned int GetSampleRate() const { return m_SampleRate; }
+	unsigned int GetNbFrames() const { return m_NbFrames; }
+
+	// m_WindowSize / 2 + 1 bins per frame, from 0 to the Nyquist frequency
+	unsigned int GetNbBins() const { return m_NbBins; }
+	double GetBinFrequency(unsigned int binIndex) const { return static_cast<double>(binIndex) * m_SampleRate / m_Configuration.m_WindowSize; }
+
+	// Position in the clip of the first sample of a frame
+	unsigned int GetFrameSampleIndex(unsigned int frameIndex) const { return frameIndex * m_Configuration.m_HopSize; }
+
+	// Gets the GetNbBins() magnitudes or phases, in radians in [-pi, pi], of a frame
+	void GetMagnitudes(unsigned int frameIndex, float* outMagnitudes) const;
+	void GetPhases(unsigned int frameIndex, float* outPhases) const;
+
+	// Number of bytes used by the frames
+	size_t GetSize() const { return m_Magnitudes.size() * sizeof(unsigned short) + m_Phases.size() * sizeof(short); }
+
+private:
+	friend class StftFrameCache;
+
+	StftConfiguration			m_Configuration;
+	unsigned int				m_SampleRate;
+	unsigned int				m_NbFrames;
+	unsigned int				m_NbBins;
+
+	// m_NbBins values per frame
+	std::vector<unsigned short>	m_Magnitudes;
+	std::vector<short>			m_Phases;
+};
+
+/**
+ *	A StftFrameCache computes the frames of the short time Fourier transform of a clip once
+ *	per configuration, and keeps them within a budget in bytes, so that the spectral features
+ *	of the clip using the same configuration share a single transform.
+ *	Frames are computed from the resident samples of the clip if it keeps them, see
+ *	AClip::SetResidentSampleFormat, otherwise from the file it was loaded from. Chunks of frames
+ *	are transformed in parallel.
+ *	Like a DecodedAudioCache, the least recently used frames are evicted first, and frames that
+ *	are acquired can't be evicted until they're released. A StftFrameCache isn't thread safe.
+ */
+class StftFrameCache
+{
+public:
+	static const size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+	explicit StftFrameCache(const AClip& clip, size_t budget = DEFAULT_BUDGET);
+	~StftFrameCache();
+
+	// Returns the frames of the clip for configuration, computing them if they aren't in the
+	// cache yet. Returns 0 if the configuration isn't valid or the samples of the clip can't be
+	// read. Every successful call must be matched by a call to Release.
+	const StftFrames* Acquire(const StftConfiguration& configuration);
+	void Release(const StftFrames* frames);
+
+	// Forgets all the frames, after the samples of the clip changed. Acquired frames are no
+	// longer returned by Acquire, and are deleted when they're released for the last time.
+	void Clear();
+
+	// Changing the budget evicts frames immediately if needed
+	void SetBudget(size_t budget);
+	size_t GetBudget() const { return m_Budget; }
+
+	// Number of bytes of frames currently in the cache
+	size_t GetSize() const { return m_Size; }
+
+	// Number of transforms computed since the cache was created
+	unsigned int GetNbTransforms() const { return m_NbTransforms; }
+
+private:
+	struct CacheEntry
+	{
+		StftFrames*									m_Frames;
+		unsigned int								m_NbAcquisitions;
+		std::list<StftConfiguration>::iterator		m_ItLeastRecentlyUsed;
+	};
+
+	typedef std::map<StftConfiguration, CacheEntry> CacheEntries;
+
+	const AClip&					m_Clip;
+	size_t							m_Budget;
+	size_t							m_Size;
+	unsigned int					m_NbTransforms;
+	CacheEntries					m_Entries;
+
+	// Keys of m_Entries, least recently used first
+	std::list<StftConfiguration>	m_LeastRecentlyUsed;
+
+	// Frames acquired when the cache was cleared, with their number of acquisitions. They
+	// aren't counted in m_Size.
+	std::map<const StftFrames*, unsigned int>	m_ClearedFrames;
+
+	void EvictUntilWithinBudget();
+
+	// Transforms the samples of the clip
+	bool ComputeFrames(const StftConfiguration& configuration, StftFrames& outFrames) const;
+};
+
+#endif // STFTFRAMECACHE_H_
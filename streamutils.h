@@ -0,0 +1,80 @@
+#ifndef STREAMUTILS_H_
+#define STREAMUTILS_H_
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/**
+ *	Helpers shared by the binary file formats: fixed size little endian integers, and reads
+ *	of sizes found in the file itself, which can't be trusted.
+ */
+class StreamUtils
+{
+public:
+	static void WriteUInt64(std::ostream& outputStream, unsigned long long value)
+	{
+		unsigned char bytes[8];
+		for (unsigned int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		{
+			bytes[byteIndex] = static_cast<unsigned char>(value >> (byteIndex * 8));
+		}
+
+		outputStream.write(reinterpret_cast<const char*>(bytes), 8);
+	}
+
+	static bool ReadUInt64(std::istream& inputStream, unsigned long long& outValue)
+	{
+		unsigned char bytes[8];
+		inputStream.read(reinterpret_cast<char*>(bytes), 8);
+		if (!inputStream)
+		{
+			return false;
+		}
+
+		outValue = 0;
+		for (unsigned int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		{
+			outValue |= static_cast<unsigned long long>(bytes[byteIndex]) << (byteIndex * 8);
+		}
+
+		return true;
+	}
+
+	// Reads size bytes in outBytes. Sizes larger than what's left in a seekable stream are
+	// rejected before anything is allocated, and other streams are read by blocks, so that a
+	// corrupted size never allocates more than the data actually there.
+	static bool ReadBytes(std::istream& inputStream, unsigned long long size, std::vector<unsigned char>& outBytes)
+	{
+		outBytes.clear();
+
+		std::istream::pos_type position = inputStream.tellg();
+		if (position != std::istream::pos_type(-1))
+		{
+			inputStream.seekg(0, std::ios::end);
+			std::istream::pos_type endPosition = inputStream.tellg();
+			inputStream.seekg(position);
+			if (!inputStream || endPosition < position || size > static_cast<unsigned long long>(endPosition - position))
+			{
+				return false;
+			}
+		}
+
+		const unsigned long long blockSize = 1 << 16;
+		while (static_cast<unsigned long long>(outBytes.size()) < size)
+		{
+			const size_t nbReadBytes = static_cast<size_t>(size - outBytes.size() < blockSize ? size - outBytes.size() : blockSize);
+			outBytes.resize(outBytes.size() + nbReadBytes);
+			inputStream.read(reinterpret_cast<char*>(&outBytes[outBytes.size() - nbReadBytes]), static_cast<std::streamsize>(nbReadBytes));
+			if (!inputStream)
+			{
+				outBytes.clear();
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+#endif // STREAMUTILS_H_
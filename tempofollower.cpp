@@ -0,0 +1,145 @@
+#include <cmath>
+
+#include "tempofollower.h"
+#include "mathutils.h"
+
+#define DEFAULT_TEMPO_SMOOTHING		0.5
+
+// Beyond this time, beat positions don't fit in a BeatPosition anymore
+#define MAX_BEAT_TIME				(9.2e18 / WarpMarker::BEAT_POSITIONS_PER_SECOND)
+
+TempoFollower::Options::Options()
+	:	m_BPM(0.0),
+		m_TempoSmoothing(DEFAULT_TEMPO_SMOOTHING)
+{
+}
+
+TempoFollower::TempoFollower()
+	:	m_Clip(0),
+		m_TempoSmoothing(DEFAULT_TEMPO_SMOOTHING),
+		m_FirstBeatSamplePosition(0.0),
+		m_NbSamplesPerBeat(0.0),
+		m_NbBeats(0),
+		m_BeatDuration(0.0),
+		m_HasPredictedWarpMarker(false)
+{
+}
+
+bool TempoFollower::Start(AClip& clip, const Options& options)
+{
+	m_Clip = 0;
+
+	const AudioInfo& audioInfo = clip.GetAudioInfo();
+	if (!AudioInfo::CheckAudioInfo(audioInfo) || !audioInfo.m_NbSamples || !(options.m_TempoSmoothing >= 0.0 && options.m_TempoSmoothing < 1.0))
+	{
+		return false;
+	}
+
+	double bpm = options.m_BPM;
+	if (bpm <= 0.0 && (!clip.GetBPM(bpm) || bpm <= 0.0))
+	{
+		return false;
+	}
+
+	// Beats must be at least a sample apart, so that their warp markers are in order
+	double nbSamplesPerBeat = 60.0 * audioInfo.m_SampleRate / bpm;
+	if (nbSamplesPerBeat < 1.0)
+	{
+		return false;
+	}
+
+	// The grid starts at the first onset, like the one of ClipSlicer
+	const std::vector<Peak>& peaks = clip.GetPeaks();
+	double firstBeatSamplePosition = peaks.empty() ? 0.0 : static_cast<double>(peaks.front().GetPeakSampleIndex());
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+	if (!warpMarkers.empty() && warpMarkers.back().GetSamplePosition() >= firstBeatSamplePosition)
+	{
+		return false;
+	}
+
+	m_Clip						= &clip;
+	m_TempoSmoothing			= options.m_TempoSmoothing;
+	m_FirstBeatSamplePosition	= firstBeatSamplePosition;
+	m_NbSamplesPerBeat			= nbSamplesPerBeat;
+	m_NbBeats					= 0;
+	m_LastBeatWarpMarker		= WarpMarker();
+	m_HasPredictedWarpMarker	= false;
+
+	// Until the second event, the clip plays at its own tempo
+	m_BeatDuration = nbSamplesPerBeat / audioInfo.m_SampleRate * WarpMarker::BEAT_POSITIONS_PER_SECOND;
+
+	return true;
+}
+
+SamplePosition TempoFollower::GetBeatSamplePosition(unsigned int beatIndex) const
+{
+	return static_cast<SamplePosition>(floor(m_FirstBeatSamplePosition + beatIndex * m_NbSamplesPerBeat + 0.5));
+}
+
+bool TempoFollower::GetPredictedWarpMarker(WarpMarker& outPredictedWarpMarker) const
+{
+	SamplePosition nbSamples = m_Clip->GetAudioInfo().m_NbSamples;
+	if (m_LastBeatWarpMarker.GetSamplePosition() >= nbSamples)
+	{
+		return false;
+	}
+
+	double nbBeatsLeft = static_cast<double>(nbSamples - m_LastBeatWarpMarker.GetSamplePosition()) / m_NbSamplesPerBeat;
+	double predictedBeatPosition = floor(static_cast<double>(m_LastBeatWarpMarker.GetBeatPosition()) + nbBeatsLeft * m_BeatDuration + 0.5);
+	if (!(predictedBeatPosition < 9.2e18))
+	{
+		return false;
+	}
+
+	BeatPosition beatPosition = static_cast<BeatPosition>(predictedBeatPosition);
+	if (beatPosition <= m_LastBeatWarpMarker.GetBeatPosition())
+	{
+		beatPosition = m_LastBeatWarpMarker.GetBeatPosition() + 1;
+	}
+
+	outPredictedWarpMarker = WarpMarker(nbSamples, beatPosition);
+	return true;
+}
+
+bool TempoFollower::OnBeat(double beatTime)
+{
+	if (!m_Clip || !MathUtils::IsValidTime(beatTime) || !(beatTime >= 0.0 && beatTime < MAX_BEAT_TIME))
+	{
+		return false;
+	}
+
+	WarpMarker beatWarpMarker(GetBeatSamplePosition(m_NbBeats), WarpMarker::ToBeatPosition(beatTime));
+	if (beatWarpMarker.GetSamplePosition() > m_Clip->GetAudioInfo().m_NbSamples ||
+		(m_NbBeats && beatWarpMarker.GetBeatPosition() <= m_LastBeatWarpMarker.GetBeatPosition()))
+	{
+		return false;
+	}
+
+	// The predicted warp marker is replaced by the one of the beat, then by a new prediction.
+	// Past the first beat, the beat is always after the warp markers left.
+	if (m_HasPredictedWarpMarker)
+	{
+		m_Clip->RemoveLastWarpMarker();
+		m_HasPredictedWarpMarker = false;
+	}
+
+	if (!m_Clip->AppendWarpMarker(beatWarpMarker))
+	{
+		return false;
+	}
+
+	if (m_NbBeats)
+	{
+		double beatDuration = static_cast<double>(beatWarpMarker.GetBeatPosition() - m_LastBeatWarpMarker.GetBeatPosition());
+		m_BeatDuration = m_NbBeats == 1 ? beatDuration : m_TempoSmoothing * m_BeatDuration + (1.0 - m_TempoSmoothing) * beatDuration;
+	}
+
+	m_LastBeatWarpMarker = beatWarpMarker;
+	++m_NbBeats;
+
+	WarpMarker predictedWarpMarker;
+	m_HasPredictedWarpMarker = GetPredictedWarpMarker(predictedWarpMarker) && m_Clip->AppendWarpMarker(predictedWarpMarker);
+	return true;
+}
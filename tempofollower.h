@@ -0,0 +1,72 @@
+#ifndef TEMPOFOLLOWER_H_
+#define TEMPOFOLLOWER_H_
+
+#include "Clip.h"
+
+/**
+ *	A TempoFollower drives the warp markers of a clip live, from a stream of beat events: the
+ *	times of the set at which beats are played, by a conductor, a drummer or another device.
+ *	The clip's own beats are laid out on a grid, starting at its first detected peak, and each
+ *	event matches the next beat of the grid with the time of the event. 
+ *	Past the last event, the clip keeps playing at the tempo of the events, estimated from 
+ *	their intervals: a predicted warp marker at the end of the clip is kept after the last
+ *	beat, and replaced at each event. Warp markers are only appended or removed at the end of
+ *	the clip, so each event costs the same amortized constant time, however long the clip has
+ *	been followed, and the clip can be queried with SampleToBeatTime or BeatToSampleTime 
+ *	between events.
+ *	AClip isn't thread safe, events and queries must come from the same thread, or be 
+ *	serialized by the caller.
+ */
+class TempoFollower
+{
+public:
+	struct Options
+	{
+		double	m_BPM;					// Tempo of the clip, 0 uses the tempo detected in the clip
+		double	m_TempoSmoothing;		// Weight of the previous tempo in the estimated one, in [0, 1). 0 follows the last interval only.
+
+		Options();
+	};
+
+	TempoFollower();
+
+	// Starts following beat events with clip, which must be loaded. The warp markers already 
+	// in the clip are kept, they must all be before its first beat, and are followed by the 
+	// warp markers of the events.
+	bool Start(AClip& clip, const Options& options);
+
+	// Matches the next beat of the clip with beatTime seconds in the set. Fails, without 
+	// changing anything, if beatTime isn't after the previous event, or if the clip has no
+	// beats left.
+	bool OnBeat(double beatTime);
+
+	// Number of events matched with beats of the clip since Start
+	unsigned int GetNbBeats() const { return m_NbBeats; }
+
+	// Warp marker of the last beat matched with an event
+	const WarpMarker& GetLastBeatWarpMarker() const { return m_LastBeatWarpMarker; }
+
+	// Current estimate of the duration of a beat of the set, in seconds
+	double GetBeatDuration() const { return static_cast<double>(m_BeatDuration) / WarpMarker::BEAT_POSITIONS_PER_SECOND; }
+
+private:
+	AClip*			m_Clip;
+	double			m_TempoSmoothing;
+
+	// Grid of the clip's beats, in samples
+	double			m_FirstBeatSamplePosition;
+	double			m_NbSamplesPerBeat;
+
+	unsigned int	m_NbBeats;
+	WarpMarker		m_LastBeatWarpMarker;
+	double			m_BeatDuration;				// in beat positions
+	bool			m_HasPredictedWarpMarker;
+
+	// Sample position of the beat at beatIndex in the grid
+	SamplePosition GetBeatSamplePosition(unsigned int beatIndex) const;
+
+	// Predicts the warp marker of the end of the clip from the last beat and the estimated tempo
+	bool GetPredictedWarpMarker(WarpMarker& outPredictedWarpMarker) const;
+};
+
+#endif // TEMPOFOLLOWER_H_
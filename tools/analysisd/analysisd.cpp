@@ -0,0 +1,153 @@
+//****************************************************************************************
+// File:    analysisd.cpp
+//
+// Analysis daemon: answers analysis requests from other processes over a local socket, so
+// that the files they ask about are decoded and analyzed only once, see AnalysisService for
+// what is kept and AnalysisProtocol for the requests.
+//
+// Usage: analysisd [options] <socket address>
+//
+// The socket address is the path of a Unix domain socket, or a TCP port of the loopback
+// interface on Windows, see LocalSocket.
+//
+// Options
+//   --threads    number of connections served at the same time, all the cores by default
+//   --cache      maximum size of the decoded audio kept in memory, in MB, 1024 by default
+//   --analyses   maximum number of analyses kept, 1024 by default, the least recently used
+//                ones are evicted first
+//   --seek-cache directory where the seek tables of FLAC files are cached between runs,
+//                none by default
+//
+// Each thread serves one connection at a time, until the client closes it, and its
+// requests are handled on that thread. Connections beyond the number of threads wait to
+// be accepted. The daemon runs until a client sends REQUEST_SHUTDOWN.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysisprotocol.h"
+#include "analysisservice.h"
+#include "flacaudiosource.h"
+#include "localsocket.h"
+
+#define DEFAULT_CACHE_SIZE		1024 // in MB
+#define DEFAULT_MAX_NB_ANALYSES	1024
+#define LISTEN_BACKLOG			128
+
+// Wakes up the threads waiting for connections once the service is shut down, by connecting
+// to the daemon once per thread
+static void WakeUpThreads(const std::string& address, int nbThreads)
+{
+	for (int threadIndex = 0; threadIndex < nbThreads; ++threadIndex)
+	{
+		LocalSocket connection;
+		connection.Connect(address);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int cacheSize = DEFAULT_CACHE_SIZE;
+	int maxNbAnalyses = DEFAULT_MAX_NB_ANALYSES;
+	int nbThreads = 1;
+#ifdef _OPENMP
+	nbThreads = omp_get_num_procs();
+#endif
+
+	int argIndex = 1;
+	for (; argIndex + 1 < argc && !strncmp(argv[argIndex], "--", 2); argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--cache"))			optionOk = (cacheSize = atoi(value)) > 0;
+		else if (!strcmp(option, "--analyses"))	optionOk = (maxNbAnalyses = atoi(value)) > 0;
+		else if (!strcmp(option, "--threads"))	optionOk = (nbThreads = atoi(value)) > 0;
+		else if (!strcmp(option, "--seek-cache"))
+		{
+			FlacAudioSource::SetSeekTableCacheDirectory(value);
+			optionOk = *value != '\0';
+		}
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argIndex + 1 != argc)
+	{
+		std::cerr << "Usage: analysisd [--threads n] [--cache MB] [--analyses n] [--seek-cache directory] <socket address>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const std::string address = argv[argIndex];
+	LocalSocket listener;
+	if (!listener.Listen(address, LISTEN_BACKLOG))
+	{
+		LocalSocket connection;
+		if (connection.Connect(address))
+		{
+			std::cerr << address << " is already in use by another daemon" << std::endl;
+		}
+		else
+		{
+			std::cerr << "Couldn't listen at " << address << std::endl;
+		}
+
+		return EXIT_FAILURE;
+	}
+
+	AnalysisService service(static_cast<size_t>(cacheSize) * 1024 * 1024, static_cast<size_t>(maxNbAnalyses));
+	printf("Listening at %s with %d threads\n", address.c_str(), nbThreads);
+	fflush(stdout);
+
+	int nbConnections = 0;
+	int nbRequests = 0;
+	#pragma omp parallel num_threads(nbThreads) reduction(+:nbConnections, nbRequests)
+	{
+		LocalSocket connection;
+		std::vector<char> request;
+		std::vector<char> response;
+		while (!service.IsShutdownRequested())
+		{
+			if (!listener.Accept(connection) || service.IsShutdownRequested())
+			{
+				continue;
+			}
+
+			++nbConnections;
+			while (connection.ReadMessage(request, AnalysisProtocol::MAX_MESSAGE_SIZE))
+			{
+				service.HandleRequest(request, response);
+				++nbRequests;
+				if (!connection.WriteMessage(response))
+				{
+					break;
+				}
+
+				if (service.IsShutdownRequested())
+				{
+					WakeUpThreads(address, nbThreads);
+					break;
+				}
+			}
+
+			connection.Close();
+		}
+	}
+
+	printf(	"%d connections, %d requests served, %u analyses kept, %.1f MB of decoded audio\n", nbConnections, nbRequests,
+			static_cast<unsigned int>(service.GetNbAnalyses()), service.GetDecodedAudioSize() / (1024.0 * 1024.0));
+
+	return EXIT_SUCCESS;
+}
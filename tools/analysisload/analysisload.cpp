@@ -0,0 +1,272 @@
+//****************************************************************************************
+// File:    analysisload.cpp
+//
+// Load generator for the analysis daemon: sends requests from several connections at once,
+// and reports the throughput and the latency of the requests.
+//
+// Usage: analysisload [options] <socket address> <audio file>...
+//        analysisload --shutdown <socket address>
+//
+// The files are first analyzed once, from a single connection, which is timed separately as
+// the cold analysis. Then each connection sends its requests one after the other, cycling
+// through the files, and through REQUEST_ANALYZE, REQUEST_GET_BPM and REQUEST_CONVERT_TIMES.
+// Conversions add a warp marker in the middle of the clip, and convert times spread over it.
+// With --shutdown, the daemon is asked to stop instead.
+//
+// Options
+//   --connections  number of connections sending requests at the same time, 4 by default
+//   --requests     number of requests sent on each connection, 10000 by default
+//   --times        number of times converted by each conversion request, 64 by default
+//
+// The latency of a request is the time from the start of its sending to the end of the
+// reception of its response.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysisprotocol.h"
+#include "localsocket.h"
+
+#define DEFAULT_NB_CONNECTIONS		4
+#define DEFAULT_NB_REQUESTS			10000
+#define DEFAULT_NB_TIMES			64
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// Value below which fraction of the sorted values are
+static double GetPercentile(const std::vector<double>& sortedValues, double fraction)
+{
+	if (sortedValues.empty())
+	{
+		return 0.0;
+	}
+
+	size_t index = static_cast<size_t>(fraction * (sortedValues.size() - 1) + 0.5);
+	return sortedValues[index];
+}
+
+// Sends a request and waits for its response, returns false if the connection failed
+static bool SendRequest(LocalSocket& connection, const std::vector<char>& request, std::vector<char>& outResponse)
+{
+	return	connection.WriteMessage(request) &&
+			connection.ReadMessage(outResponse, AnalysisProtocol::MAX_MESSAGE_SIZE);
+}
+
+static void WriteAnalyzeRequest(std::vector<char>& outRequest, AnalysisProtocol::RequestType requestType, const std::string& filePath)
+{
+	MessageWriter request(outRequest);
+	request.WriteUInt8(requestType);
+	request.WriteString(filePath);
+	request.WriteUInt8(0);	// Default detector parameters
+	if (requestType == AnalysisProtocol::REQUEST_ANALYZE)
+	{
+		request.WriteUInt8(0);	// Without the peaks
+	}
+}
+
+static void WriteConvertTimesRequest(std::vector<char>& outRequest, const std::string& filePath, double duration, unsigned int nbTimes)
+{
+	MessageWriter request(outRequest);
+	request.WriteUInt8(AnalysisProtocol::REQUEST_CONVERT_TIMES);
+	request.WriteString(filePath);
+	request.WriteUInt8(AnalysisProtocol::BEAT_TO_SAMPLE_TIME);
+	request.WriteUInt32(1);
+	request.WriteDouble(duration * 0.5);
+	request.WriteDouble(duration * 0.45);
+	request.WriteUInt32(nbTimes);
+	for (unsigned int timeIndex = 0; timeIndex < nbTimes; ++timeIndex)
+	{
+		request.WriteDouble(duration * 0.9 * timeIndex / nbTimes);
+	}
+}
+
+// Returns the status of a response, or STATUS_INVALID_REQUEST if it is empty
+static unsigned int GetStatus(const std::vector<char>& response)
+{
+	MessageReader reader(response);
+	unsigned int status = AnalysisProtocol::STATUS_INVALID_REQUEST;
+	reader.ReadUInt8(status);
+	return status;
+}
+
+// Analyzes a file, and gets its duration in seconds
+static bool AnalyzeFile(LocalSocket& connection, const std::string& filePath, double& outDuration)
+{
+	std::vector<char> request, response;
+	WriteAnalyzeRequest(request, AnalysisProtocol::REQUEST_ANALYZE, filePath);
+	if (!SendRequest(connection, request, response))
+	{
+		return false;
+	}
+
+	MessageReader reader(response);
+	unsigned int status = 0, sampleRate = 0, nbSamples = 0;
+	return	reader.ReadUInt8(status) && status == AnalysisProtocol::STATUS_OK &&
+			reader.ReadUInt32(sampleRate) && reader.ReadUInt32(nbSamples) && reader.ReadDouble(outDuration);
+}
+
+static int Shutdown(const std::string& address)
+{
+	LocalSocket connection;
+	std::vector<char> request, response;
+	MessageWriter(request).WriteUInt8(AnalysisProtocol::REQUEST_SHUTDOWN);
+	if (!connection.Connect(address) || !SendRequest(connection, request, response) || GetStatus(response) != AnalysisProtocol::STATUS_OK)
+	{
+		std::cerr << "Couldn't shut down the daemon at " << address << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 3 && !strcmp(argv[1], "--shutdown"))
+	{
+		return Shutdown(argv[2]);
+	}
+
+	int nbConnections = DEFAULT_NB_CONNECTIONS;
+	int nbRequests = DEFAULT_NB_REQUESTS;
+	int nbTimes = DEFAULT_NB_TIMES;
+
+	int argIndex = 1;
+	for (; argIndex + 1 < argc && !strncmp(argv[argIndex], "--", 2); argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--connections"))	optionOk = (nbConnections = atoi(value)) > 0;
+		else if (!strcmp(option, "--requests"))	optionOk = (nbRequests = atoi(value)) > 0;
+		else if (!strcmp(option, "--times"))	optionOk = (nbTimes = atoi(value)) > 0;
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argIndex + 2 > argc)
+	{
+		std::cerr << "Usage: analysisload [--connections n] [--requests n] [--times n] <socket address> <audio file>..." << std::endl;
+		std::cerr << "       analysisload --shutdown <socket address>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const std::string address = argv[argIndex];
+	const std::vector<std::string> filePaths(argv + argIndex + 1, argv + argc);
+
+	// First analysis of all the files, cold unless the daemon already analyzed them, which
+	// also gives their durations
+	std::vector<double> durations(filePaths.size());
+	double coldStartTime = GetWallClockTime();
+	{
+		LocalSocket connection;
+		if (!connection.Connect(address))
+		{
+			std::cerr << "Couldn't connect to " << address << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		for (size_t fileIndex = 0; fileIndex < filePaths.size(); ++fileIndex)
+		{
+			if (!AnalyzeFile(connection, filePaths[fileIndex], durations[fileIndex]))
+			{
+				std::cerr << "Couldn't analyze " << filePaths[fileIndex] << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	double coldTime = GetWallClockTime() - coldStartTime;
+	printf("%u files analyzed in %.3f s before the load\n", static_cast<unsigned int>(filePaths.size()), coldTime);
+
+	std::vector<double> latencies(static_cast<size_t>(nbConnections) * nbRequests);
+	int nbFailedRequests = 0;
+	int nbFailedConnections = 0;
+	double startTime = GetWallClockTime();
+
+	#pragma omp parallel for num_threads(nbConnections) schedule(static, 1) reduction(+:nbFailedRequests, nbFailedConnections)
+	for (int connectionIndex = 0; connectionIndex < nbConnections; ++connectionIndex)
+	{
+		LocalSocket connection;
+		if (!connection.Connect(address))
+		{
+			++nbFailedConnections;
+			continue;
+		}
+
+		std::vector<char> request, response;
+		for (int requestIndex = 0; requestIndex < nbRequests; ++requestIndex)
+		{
+			size_t fileIndex = (requestIndex / 3 + connectionIndex) % filePaths.size();
+			switch (requestIndex % 3)
+			{
+			case 0:		WriteAnalyzeRequest(request, AnalysisProtocol::REQUEST_ANALYZE, filePaths[fileIndex]);					break;
+			case 1:		WriteAnalyzeRequest(request, AnalysisProtocol::REQUEST_GET_BPM, filePaths[fileIndex]);					break;
+			default:	WriteConvertTimesRequest(request, filePaths[fileIndex], durations[fileIndex], nbTimes);	break;
+			}
+
+			double requestStartTime = GetWallClockTime();
+			bool sent = SendRequest(connection, request, response);
+			latencies[static_cast<size_t>(connectionIndex) * nbRequests + requestIndex] = GetWallClockTime() - requestStartTime;
+
+			unsigned int status = AnalysisProtocol::STATUS_INVALID_REQUEST;
+			if (sent)
+			{
+				status = GetStatus(response);
+			}
+
+			if (status != AnalysisProtocol::STATUS_OK && status != AnalysisProtocol::STATUS_NO_BPM)
+			{
+				++nbFailedRequests;
+			}
+
+			if (!sent)
+			{
+				++nbFailedConnections;
+				break;
+			}
+		}
+	}
+
+	double totalTime = GetWallClockTime() - startTime;
+	if (nbFailedConnections)
+	{
+		std::cerr << nbFailedConnections << " connections failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<double> sortedLatencies(latencies);
+	std::sort(sortedLatencies.begin(), sortedLatencies.end());
+	double latencySum = 0.0;
+	for (size_t requestIndex = 0; requestIndex < latencies.size(); ++requestIndex)
+	{
+		latencySum += latencies[requestIndex];
+	}
+
+	printf("%u requests on %d connections in %.3f s, %.0f requests/s, %d failed\n", static_cast<unsigned int>(latencies.size()), nbConnections,
+			totalTime, totalTime > 0.0 ? latencies.size() / totalTime : 0.0, nbFailedRequests);
+	printf("latency: mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n", latencySum / latencies.size() * 1e6,
+			GetPercentile(sortedLatencies, 0.5) * 1e6, GetPercentile(sortedLatencies, 0.99) * 1e6, sortedLatencies.back() * 1e6);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+//****************************************************************************************
+// File:    beatreplay.cpp
+//
+// Replays a stream of beat events through a TempoFollower, and measures how long each event
+// takes to affect the warp markers of the clip, while the clip is queried between events
+// like a player would.
+//
+// Usage: beatreplay [options] <audio file> <beats file>
+//
+// The beats file contains one beat time of the set, in seconds, per line. Lines starting with
+// '#' are ignored. With "-" as the beats file, beats are read from the standard input as
+// they come, so that another program can pipe them live.
+//
+// Options
+//   --bpm        tempo of the clip, detected in the clip by default
+//   --smoothing  weight of the previous tempo in the estimated one, see TempoFollower
+//   --queries    number of conversions queried between two events, 256 by default
+//
+// The latency of an event is the time from the call to TempoFollower::OnBeat to the first
+// BeatToSampleTime query of the beat returning the sample of the beat.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Clip.h"
+#include "simplepeakdetector.h"
+#include "tempofollower.h"
+
+#define DEFAULT_NB_QUERIES_PER_BEAT 256
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// Value below which fraction of the sorted values are
+static double GetPercentile(const std::vector<double>& sortedValues, double fraction)
+{
+	if (sortedValues.empty())
+	{
+		return 0.0;
+	}
+
+	size_t index = static_cast<size_t>(fraction * (sortedValues.size() - 1) + 0.5);
+	return sortedValues[index];
+}
+
+static double GetMean(std::vector<double>::const_iterator itBegin, std::vector<double>::const_iterator itEnd)
+{
+	double sum = 0.0;
+	size_t nbValues = 0;
+	for (; itBegin != itEnd; ++itBegin, ++nbValues)
+	{
+		sum += *itBegin;
+	}
+
+	return nbValues ? sum / nbValues : 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+	TempoFollower::Options options;
+	int nbQueriesPerBeat = DEFAULT_NB_QUERIES_PER_BEAT;
+
+	int argIndex = 1;
+	for (; argIndex + 1 < argc && !strncmp(argv[argIndex], "--", 2); argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--bpm"))				optionOk = (options.m_BPM = atof(value)) > 0.0;
+		else if (!strcmp(option, "--smoothing"))	optionOk = (options.m_TempoSmoothing = atof(value)) >= 0.0 && options.m_TempoSmoothing < 1.0;
+		else if (!strcmp(option, "--queries"))		optionOk = (nbQueriesPerBeat = atoi(value)) >= 0;
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argIndex + 2 != argc)
+	{
+		std::cerr << "Usage: beatreplay [--bpm bpm] [--smoothing weight] [--queries n] <audio file> <beats file | ->" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	SimplePeakDetector peakDetector;
+	AClip clip;
+	clip.SetPeakDetector(&peakDetector);
+	TempoFollower tempoFollower;
+	if (!clip.LoadDataFromFile(argv[argIndex]) || !tempoFollower.Start(clip, options))
+	{
+		std::cerr << "Couldn't follow " << argv[argIndex] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream beatsFileStream;
+	bool fromStandardInput = !strcmp(argv[argIndex + 1], "-");
+	if (!fromStandardInput)
+	{
+		beatsFileStream.open(argv[argIndex + 1]);
+		if (!beatsFileStream)
+		{
+			std::cerr << "Couldn't open beats file " << argv[argIndex + 1] << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::istream& beatsStream = fromStandardInput ? std::cin : beatsFileStream;
+
+	const unsigned int sampleRate = clip.GetAudioInfo().m_SampleRate;
+	std::vector<double> latencies;
+	unsigned int nbEvents = 0;
+	unsigned int nbQueries = 0;
+	double queriesTime = 0.0;
+	double checksum = 0.0;
+	double previousBeatTime = 0.0;
+
+	std::string line;
+	while (std::getline(beatsStream, line))
+	{
+		std::istringstream lineStream(line);
+		double beatTime = 0.0;
+		if (line.empty() || line[0] == '#' || !(lineStream >> beatTime))
+		{
+			continue;
+		}
+
+		++nbEvents;
+		unsigned int beatIndex = tempoFollower.GetNbBeats();
+
+		double startTime = GetWallClockTime();
+		if (!tempoFollower.OnBeat(beatTime))
+		{
+			continue;
+		}
+
+		// The beat takes effect when the clip plays its sample at the time of the event
+		double beatSampleTime = clip.BeatToSampleTime(beatTime);
+		double latency = GetWallClockTime() - startTime;
+
+		double expectedSamplePosition = static_cast<double>(tempoFollower.GetLastBeatWarpMarker().GetSamplePosition());
+		if (fabs(beatSampleTime * sampleRate - expectedSamplePosition) > 1e-3)
+		{
+			std::cerr << "Beat " << beatIndex << " at " << beatTime << " s didn't take effect" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		latencies.push_back(latency);
+
+		// Queries of a player, around the beat just received
+		startTime = GetWallClockTime();
+		for (int queryIndex = 0; queryIndex < nbQueriesPerBeat; ++queryIndex)
+		{
+			double queryBeatTime = previousBeatTime + (beatTime - previousBeatTime) * queryIndex / nbQueriesPerBeat;
+			checksum += clip.SampleToBeatTime(clip.BeatToSampleTime(queryBeatTime));
+		}
+
+		queriesTime += GetWallClockTime() - startTime;
+		nbQueries += 2 * nbQueriesPerBeat;
+		previousBeatTime = beatTime;
+	}
+
+	if (latencies.empty())
+	{
+		std::cerr << "No beat could be followed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<WarpMarker> warpMarkers;
+	clip.GetWarpMarkers(warpMarkers);
+
+	// The first and last tenths of the events show whether the cost grows with the warp markers
+	size_t nbTenthEvents = std::max<size_t>(latencies.size() / 10, 1);
+	double firstTenthLatency = GetMean(latencies.begin(), latencies.begin() + nbTenthEvents);
+	double lastTenthLatency = GetMean(latencies.end() - nbTenthEvents, latencies.end());
+
+	std::vector<double> sortedLatencies(latencies);
+	std::sort(sortedLatencies.begin(), sortedLatencies.end());
+
+	printf("%u events, %u beats followed, %u warp markers, tempo %.2f BPM\n", nbEvents, tempoFollower.GetNbBeats(),
+			static_cast<unsigned int>(warpMarkers.size()), 60.0 / tempoFollower.GetBeatDuration());
+	printf("event to effect latency: mean %.2f us, median %.2f us, p99 %.2f us, max %.2f us\n", 
+			GetMean(latencies.begin(), latencies.end()) * 1e6, GetPercentile(sortedLatencies, 0.5) * 1e6, 
+			GetPercentile(sortedLatencies, 0.99) * 1e6, sortedLatencies.back() * 1e6);
+	printf("mean latency of the first tenth of the events %.2f us, of the last tenth %.2f us\n", firstTenthLatency * 1e6, lastTenthLatency * 1e6);
+	printf("%u queries between events, %.1f ns per query (checksum %g)\n", nbQueries, nbQueries ? queriesTime / nbQueries * 1e9 : 0.0, checksum);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+//****************************************************************************************
+// File:    beatslicer.cpp
+//
+// Cuts audio files at their beats, or bars, and writes each slice to its own WAV file, to
+// build sample packs.
+//
+// Usage: beatslicer [options] <output directory> <audio file>...
+//
+// Options
+//   --beats      number of beats per slice, 1 by default, 4 for bars of 4/4
+//   --bpm        tempo of the files, detected in each file by default
+//   --snap       maximum distance a cut is moved to meet a detected onset, in seconds
+//
+// Slices of <name>.wav are written to <output directory>/<name>_<slice index>.wav. Each file
+// is analyzed with the default SimplePeakDetector parameters and default warp markers, then
+// all files are sliced in parallel, each read once.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Clip.h"
+#include "clipslicer.h"
+#include "simplepeakdetector.h"
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// Returns the name of the file at filePath, without its directory and extension
+static std::string GetBaseName(const std::string& filePath)
+{
+	std::string::size_type separatorPos = filePath.find_last_of("/\\");
+	std::string fileName = separatorPos == std::string::npos ? filePath : filePath.substr(separatorPos + 1);
+
+	std::string::size_type extensionPos = fileName.find_last_of('.');
+	return extensionPos == std::string::npos ? fileName : fileName.substr(0, extensionPos);
+}
+
+int main(int argc, char* argv[])
+{
+	ClipSlicer::Options options;
+
+	int argIndex = 1;
+	for (; argIndex + 1 < argc && !strncmp(argv[argIndex], "--", 2); argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--beats"))			optionOk = (options.m_NbBeatsPerSlice = atoi(value)) > 0;
+		else if (!strcmp(option, "--bpm"))		optionOk = (options.m_BPM = atof(value)) > 0.0;
+		else if (!strcmp(option, "--snap"))		optionOk = (options.m_PeakSnapTolerance = atof(value)) >= 0.0;
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argIndex + 2 > argc)
+	{
+		std::cerr << "Usage: beatslicer [--beats n] [--bpm bpm] [--snap seconds] <output directory> <audio file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string outputDirectory(argv[argIndex++]);
+	if (outputDirectory.find_last_of("/\\") != outputDirectory.length() - 1)
+	{
+		outputDirectory += "/";
+	}
+
+	// Analyze all files first...
+	SimplePeakDetector peakDetector;
+	std::vector<AClip*> clips;
+	std::vector<std::string> outputPathPrefixes;
+	for (; argIndex < argc; ++argIndex)
+	{
+		AClip* clip = new AClip;
+		clip->SetPeakDetector(&peakDetector);
+		if (!clip->LoadDataFromFile(argv[argIndex]) || !clip->AddDefaultWarpMarkers())
+		{
+			std::cerr << "Couldn't load " << argv[argIndex] << ", skipping it." << std::endl;
+			delete clip;
+			continue;
+		}
+
+		clips.push_back(clip);
+		outputPathPrefixes.push_back(outputDirectory + GetBaseName(argv[argIndex]));
+	}
+
+	// ... then slice them all at once
+	double startTime = GetWallClockTime();
+	std::vector<unsigned int> nbSlices;
+	bool exported = ClipSlicer::ExportClips(clips, options, outputPathPrefixes, nbSlices);
+	double exportTime = GetWallClockTime() - startTime;
+
+	unsigned int totalNbSlices = 0;
+	double totalDuration = 0.0;
+	for (size_t clipIndex = 0; clipIndex < clips.size(); ++clipIndex)
+	{
+		if (!nbSlices[clipIndex])
+		{
+			std::cerr << "Couldn't slice " << clips[clipIndex]->GetFilePath() << std::endl;
+		}
+
+		totalNbSlices += nbSlices[clipIndex];
+		totalDuration += clips[clipIndex]->GetDuration();
+		delete clips[clipIndex];
+	}
+
+	printf("%u files, %.1f s of audio, cut in %u slices in %.2f s\n", static_cast<unsigned int>(clips.size()), totalDuration, totalNbSlices, exportTime);
+
+	return exported && !clips.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,257 @@
+//****************************************************************************************
+// File:    clipmeter.cpp
+//
+// Measures audio files in a single read: their onsets and BPM, their EBU R128 loudness,
+// their true peak and their RMS level, see AnalysisGraph.
+//
+// Usage: clipmeter [--separate] <audio file>...
+//
+// Options
+//   --separate   also measures each file the way it was done before the analysis graph, one
+//                read for the clip and one more for each meter, checks that both ways give
+//                the same results, and reports how long each way takes.
+//
+// Levels are in dB relative to full scale: dBTP for the true peak, dBFS for the RMS level.
+// Values that can't be measured, like the loudness of a clip shorter than 400 ms, are "-".
+//****************************************************************************************
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysisgraph.h"
+#include "audiosource.h"
+#include "loudnessmeter.h"
+#include "rmsmeter.h"
+#include "simplepeakdetector.h"
+#include "truepeakmeter.h"
+#include "Clip.h"
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+static double ToDecibels(double level)
+{
+	return 20.0 * log10(level);
+}
+
+// Measures of a file, with everything that can be compared between both ways of measuring
+struct Measures
+{
+	double			m_Duration;
+	size_t			m_NbPeaks;
+	bool			m_HasBpm;
+	double			m_Bpm;
+	bool			m_HasLoudness[4];
+	double			m_Loudness[4];	// Integrated, range, max momentary, max short-term
+	float			m_TruePeak;
+	float			m_SamplePeak;
+	double			m_Rms;
+
+	Measures()
+		:	m_Duration(0.0), m_NbPeaks(0), m_HasBpm(false), m_Bpm(0.0),
+			m_TruePeak(0.0f), m_SamplePeak(0.0f), m_Rms(0.0)
+	{
+		for (unsigned int loudnessIndex = 0; loudnessIndex < 4; ++loudnessIndex)
+		{
+			m_HasLoudness[loudnessIndex] = false;
+			m_Loudness[loudnessIndex] = 0.0;
+		}
+	}
+
+	bool operator==(const Measures& rhs) const
+	{
+		for (unsigned int loudnessIndex = 0; loudnessIndex < 4; ++loudnessIndex)
+		{
+			if (m_HasLoudness[loudnessIndex] != rhs.m_HasLoudness[loudnessIndex] || m_Loudness[loudnessIndex] != rhs.m_Loudness[loudnessIndex])
+			{
+				return false;
+			}
+		}
+
+		return	m_Duration == rhs.m_Duration && m_NbPeaks == rhs.m_NbPeaks && m_HasBpm == rhs.m_HasBpm && m_Bpm == rhs.m_Bpm &&
+				m_TruePeak == rhs.m_TruePeak && m_SamplePeak == rhs.m_SamplePeak && m_Rms == rhs.m_Rms;
+	}
+};
+
+static void GetMeasures(AClip& clip, const LoudnessMeter& loudnessMeter, const TruePeakMeter& truePeakMeter, const RmsMeter& rmsMeter, Measures& outMeasures)
+{
+	outMeasures.m_Duration = clip.GetDuration();
+	outMeasures.m_NbPeaks = clip.GetPeaks().size();
+	outMeasures.m_HasBpm = clip.GetBPM(outMeasures.m_Bpm);
+	outMeasures.m_HasLoudness[0] = loudnessMeter.GetIntegratedLoudness(outMeasures.m_Loudness[0]);
+	outMeasures.m_HasLoudness[1] = loudnessMeter.GetLoudnessRange(outMeasures.m_Loudness[1]);
+	outMeasures.m_HasLoudness[2] = loudnessMeter.GetMaxMomentaryLoudness(outMeasures.m_Loudness[2]);
+	outMeasures.m_HasLoudness[3] = loudnessMeter.GetMaxShortTermLoudness(outMeasures.m_Loudness[3]);
+	outMeasures.m_TruePeak = truePeakMeter.GetTruePeak();
+	outMeasures.m_SamplePeak = truePeakMeter.GetSamplePeak();
+	outMeasures.m_Rms = rmsMeter.GetRms();
+}
+
+// Measures a file in a single read
+static bool MeasureFile(const std::string& filePath, Measures& outMeasures)
+{
+	SimplePeakDetector peakDetector;
+	LoudnessMeter loudnessMeter;
+	TruePeakMeter truePeakMeter;
+	RmsMeter rmsMeter;
+
+	AClip clip;
+	clip.SetPeakDetector(&peakDetector);
+	clip.AddFeatureExtractor(&loudnessMeter);
+	clip.AddFeatureExtractor(&truePeakMeter);
+	clip.AddFeatureExtractor(&rmsMeter);
+
+	AudioSource* audioSource = AudioSource::Open(filePath);
+	bool loaded = audioSource && clip.LoadDataFromSource(*audioSource, filePath);
+	delete audioSource;
+	if (!loaded)
+	{
+		return false;
+	}
+
+	GetMeasures(clip, loudnessMeter, truePeakMeter, rmsMeter, outMeasures);
+	return true;
+}
+
+// Runs a single extractor over a file, decoding it again
+static bool RunExtractor(const std::string& filePath, FeatureExtractor& featureExtractor)
+{
+	AudioSource* audioSource = AudioSource::Open(filePath);
+	if (!audioSource)
+	{
+		return false;
+	}
+
+	AnalysisGraph analysisGraph;
+	analysisGraph.AddExtractor(&featureExtractor);
+	bool extracted = analysisGraph.Run(*audioSource);
+	delete audioSource;
+
+	return extracted;
+}
+
+// Measures a file with one read per measure
+static bool MeasureFileSeparately(const std::string& filePath, Measures& outMeasures)
+{
+	SimplePeakDetector peakDetector;
+	LoudnessMeter loudnessMeter;
+	TruePeakMeter truePeakMeter;
+	RmsMeter rmsMeter;
+
+	AClip clip;
+	clip.SetPeakDetector(&peakDetector);
+
+	AudioSource* audioSource = AudioSource::Open(filePath);
+	bool loaded = audioSource && clip.LoadDataFromSource(*audioSource, filePath);
+	delete audioSource;
+	if (!loaded || !RunExtractor(filePath, loudnessMeter) || !RunExtractor(filePath, truePeakMeter) || !RunExtractor(filePath, rmsMeter))
+	{
+		return false;
+	}
+
+	GetMeasures(clip, loudnessMeter, truePeakMeter, rmsMeter, outMeasures);
+	return true;
+}
+
+static void PrintValue(bool hasValue, double value, const char* unit)
+{
+	if (hasValue)
+	{
+		printf(" %7.2f %s", value, unit);
+	}
+	else
+	{
+		printf("       - %s", unit);
+	}
+}
+
+static void PrintMeasures(const std::string& filePath, const Measures& measures)
+{
+	printf("%s: %.2f s, %u peaks,", filePath.c_str(), measures.m_Duration, static_cast<unsigned int>(measures.m_NbPeaks));
+	PrintValue(measures.m_HasBpm, measures.m_Bpm, "BPM,");
+	PrintValue(measures.m_HasLoudness[0], measures.m_Loudness[0], "LUFS integrated,");
+	PrintValue(measures.m_HasLoudness[1], measures.m_Loudness[1], "LU range,");
+	PrintValue(measures.m_HasLoudness[2], measures.m_Loudness[2], "LUFS max momentary,");
+	PrintValue(measures.m_HasLoudness[3], measures.m_Loudness[3], "LUFS max short-term,");
+	PrintValue(measures.m_TruePeak > 0.0f, ToDecibels(measures.m_TruePeak), "dBTP,");
+	PrintValue(measures.m_SamplePeak > 0.0f, ToDecibels(measures.m_SamplePeak), "dBFS sample peak,");
+	PrintValue(measures.m_Rms > 0.0, ToDecibels(measures.m_Rms), "dBFS RMS");
+	printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+	bool separate = false;
+	int argIndex = 1;
+	if (argIndex < argc && !strcmp(argv[argIndex], "--separate"))
+	{
+		separate = true;
+		++argIndex;
+	}
+
+	if (argIndex >= argc)
+	{
+		std::cerr << "Usage: clipmeter [--separate] <audio file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int nbFailedFiles = 0;
+	double singleReadTime = 0.0;
+	double separateReadsTime = 0.0;
+	for (; argIndex < argc; ++argIndex)
+	{
+		const std::string filePath = argv[argIndex];
+		Measures measures;
+		double startTime = GetWallClockTime();
+		if (!MeasureFile(filePath, measures))
+		{
+			std::cerr << "Couldn't read " << filePath << std::endl;
+			++nbFailedFiles;
+			continue;
+		}
+
+		singleReadTime += GetWallClockTime() - startTime;
+		PrintMeasures(filePath, measures);
+
+		if (separate)
+		{
+			Measures separateMeasures;
+			startTime = GetWallClockTime();
+			if (!MeasureFileSeparately(filePath, separateMeasures))
+			{
+				std::cerr << "Couldn't read " << filePath << " again" << std::endl;
+				++nbFailedFiles;
+				continue;
+			}
+
+			separateReadsTime += GetWallClockTime() - startTime;
+			if (!(separateMeasures == measures))
+			{
+				std::cerr << "Measuring " << filePath << " in separate reads gives other results" << std::endl;
+				++nbFailedFiles;
+			}
+		}
+	}
+
+	if (separate)
+	{
+		printf("single read: %.3f s, separate reads: %.3f s\n", singleReadTime, separateReadsTime);
+	}
+
+	return nbFailedFiles ? EXIT_FAILURE : EXIT_SUCCESS;
+}
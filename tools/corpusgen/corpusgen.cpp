@@ -0,0 +1,404 @@
+//****************************************************************************************
+// File:    corpusgen.cpp
+//
+// Writes a corpus of synthetic WAV files whose onsets and tempos are known, for the accuracy
+// and throughput benchmarks, along with a manifest that peaktuner reads.
+//
+// Usage: corpusgen <output directory> [options]
+//
+// Options
+//   --long       duration of the very long file, in seconds, 3600 by default. 0 leaves it out.
+//   --metadata   size of the metadata chunk of the files that have one, in bytes, 16 MB by
+//                default
+//   --seed       seed of the noise of the corpus, 1 by default
+//
+// Files are click tracks, at steady tempos, along tempo ramps, swung, over noise floors, with
+// several channels, in float and 16 and 24 bits integer formats, and with a large "LIST" chunk
+// of metadata before the samples. Clicks are a 60 Hz triangle wave fading out in 30 ms, that
+// the default SimplePeakDetector finds, starting with a 5 ms noise burst for the spectral
+// features. Samples are computed with integers, so that the same options write the same bytes
+// on every platform.
+//
+// The manifest, manifest.txt, lists one file per line: the audio file followed by its onsets
+// file, as peaktuner expects, then the tempo at the start and at the end of the file in BPM,
+// the format of the samples, the sample rate, the number of channels and the duration in
+// seconds. Onsets files contain the time of the first sample of each click in seconds, one
+// per line. Paths are relative to the output directory, which must exist.
+//****************************************************************************************
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "wavfilewriter.h"
+
+#define DEFAULT_LONG_DURATION	3600.0				// in seconds
+#define DEFAULT_METADATA_SIZE	(16 * 1024 * 1024)	// in bytes
+#define DEFAULT_SEED			1
+
+// Samples are computed as 24 bits integers, full scale being 1 << 23, and converted to floats
+// exactly
+#define FULL_SCALE				(1 << 23)
+
+// The default SimplePeakDetector's envelope peaks at 0.58 of full scale on these clicks, 15 %
+// above its 0.5 on threshold, so that decimation and noise don't make clicks miss it. It then
+// releases to 0.27 before the closest swung click, 0.167 s later, 11 % below its 0.3 off
+// threshold: longer or louder clicks would merge swung pairs. The noise burst on top of the
+// first quarter period stays below full scale.
+#define CLICK_DURATION			0.03				// in seconds
+#define CLICK_FREQUENCY			60					// in Hz
+#define CLICK_AMPLITUDE			(FULL_SCALE / 10 * 9)
+#define CLICK_NOISE_DURATION	0.005				// in seconds
+#define CLICK_NOISE_AMPLITUDE	(FULL_SCALE / 8)
+
+#define NB_BLOCK_SAMPLES		65536
+
+// Description of a file of the corpus
+struct CorpusFile
+{
+	const char*				m_Name;
+	WavFileWriter::Format	m_Format;
+	unsigned int			m_SampleRate;
+	unsigned short			m_NumChannels;
+	double					m_Duration;			// in seconds, 0.0 for the very long duration
+	double					m_StartTempo;		// in BPM, the tempo changes linearly with time
+	double					m_EndTempo;
+	double					m_Swing;			// position of the off-beat clicks in the beat, 0.0 for none
+	double					m_NoiseFloor;		// RMS level of the noise in dBFS, 0.0 for none
+	bool					m_HasMetadata;
+};
+
+static const CorpusFile CORPUS_FILES[] =
+{
+	{ "click_120_float32",				WavFileWriter::FORMAT_FLOAT32,	44100, 1,  30.0, 120.0, 120.0, 0.0,        0.0, false },
+	{ "click_90_pcm16",					WavFileWriter::FORMAT_PCM16,	44100, 1,  30.0,  90.0,  90.0, 0.0,        0.0, false },
+	{ "click_140_pcm24_48k_stereo",		WavFileWriter::FORMAT_PCM24,	48000, 2,  30.0, 140.0, 140.0, 0.0,        0.0, false },
+	{ "click_174_float32_96k",			WavFileWriter::FORMAT_FLOAT32,	96000, 1,  20.0, 174.0, 174.0, 0.0,        0.0, false },
+	{ "ramp_100_140_float32",			WavFileWriter::FORMAT_FLOAT32,	44100, 1,  60.0, 100.0, 140.0, 0.0,        0.0, false },
+	{ "ramp_128_96_float32",			WavFileWriter::FORMAT_FLOAT32,	44100, 1,  60.0, 128.0,  96.0, 0.0,        0.0, false },
+	{ "swing_120_float32",				WavFileWriter::FORMAT_FLOAT32,	44100, 1,  30.0, 120.0, 120.0, 2.0 / 3.0,  0.0, false },
+	{ "noise_120_m50_float32",			WavFileWriter::FORMAT_FLOAT32,	44100, 1,  30.0, 120.0, 120.0, 0.0,      -50.0, false },
+	{ "noise_120_m30_float32",			WavFileWriter::FORMAT_FLOAT32,	44100, 1,  30.0, 120.0, 120.0, 0.0,      -30.0, false },
+	{ "noise_120_m20_pcm16",			WavFileWriter::FORMAT_PCM16,	44100, 1,  30.0, 120.0, 120.0, 0.0,      -20.0, false },
+	{ "surround_128_float32",			WavFileWriter::FORMAT_FLOAT32,	48000, 6,  30.0, 128.0, 128.0, 0.0,      -60.0, false },
+	{ "metadata_120_float32",			WavFileWriter::FORMAT_FLOAT32,	44100, 2,  30.0, 120.0, 120.0, 0.0,        0.0, true },
+	{ "metadata_120_pcm16",				WavFileWriter::FORMAT_PCM16,	44100, 2,  30.0, 120.0, 120.0, 0.0,        0.0, true },
+	{ "long_125_float32",				WavFileWriter::FORMAT_FLOAT32,	44100, 1,   0.0, 125.0, 125.0, 0.0,      -60.0, false }
+};
+
+static const char* GetFormatName(WavFileWriter::Format format)
+{
+	switch (format)
+	{
+	case WavFileWriter::FORMAT_PCM16:
+		return "pcm16";
+	case WavFileWriter::FORMAT_PCM24:
+		return "pcm24";
+	default:
+		return "float32";
+	}
+}
+
+// Xorshift generator, whose sequence is the same everywhere, unlike rand's
+class NoiseGenerator
+{
+private:
+	unsigned int	m_State;
+
+public:
+	explicit NoiseGenerator(unsigned int seed) : m_State(seed ? seed : 1) {}
+
+	// Uniform in [-FULL_SCALE, FULL_SCALE)
+	int GetNext()
+	{
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 17;
+		m_State ^= m_State << 5;
+		return static_cast<int>(m_State >> 8) - FULL_SCALE;
+	}
+};
+
+// Time in seconds of beat beatIndex, the tempo going linearly from startTempo to endTempo
+// in duration seconds
+static double GetBeatTime(double beatIndex, double startTempo, double endTempo, double duration)
+{
+	// The number of beats after t seconds is (startTempo t + (endTempo - startTempo) t^2 / 2 duration) / 60
+	double a = (endTempo - startTempo) / (2.0 * duration * 60.0);
+	double b = startTempo / 60.0;
+	if (fabs(a) < 1e-12)
+	{
+		return beatIndex / b;
+	}
+
+	// A slowing tempo that would reach 0 never gets to the last beats
+	double discriminant = b * b + 4.0 * a * beatIndex;
+	if (discriminant < 0.0)
+	{
+		return HUGE_VAL;
+	}
+
+	return (sqrt(discriminant) - b) / (2.0 * a);
+}
+
+// Sample index of the first sample of each click
+static void GetOnsets(const CorpusFile& corpusFile, double duration, unsigned int nbSamples, std::vector<unsigned int>& outOnsets)
+{
+	outOnsets.clear();
+
+	for (unsigned int beatIndex = 0; ; ++beatIndex)
+	{
+		double beatTime = GetBeatTime(beatIndex, corpusFile.m_StartTempo, corpusFile.m_EndTempo, duration);
+		if (beatTime >= duration)
+		{
+			break;
+		}
+
+		unsigned int beatSampleIndex = static_cast<unsigned int>(floor(beatTime * corpusFile.m_SampleRate + 0.5));
+		if (beatSampleIndex >= nbSamples)
+		{
+			break;
+		}
+
+		outOnsets.push_back(beatSampleIndex);
+
+		if (corpusFile.m_Swing > 0.0)
+		{
+			double offBeatTime = GetBeatTime(beatIndex + corpusFile.m_Swing, corpusFile.m_StartTempo, corpusFile.m_EndTempo, duration);
+			unsigned int offBeatSampleIndex = offBeatTime < duration ? static_cast<unsigned int>(floor(offBeatTime * corpusFile.m_SampleRate + 0.5)) : nbSamples;
+			if (offBeatSampleIndex < nbSamples)
+			{
+				outOnsets.push_back(offBeatSampleIndex);
+			}
+		}
+	}
+}
+
+// Metadata chunk of the files that have one: an INFO list holding a comment of about
+// metadataSize bytes
+static void GetMetadata(const std::string& description, unsigned int metadataSize, std::vector<char>& outMetadata)
+{
+	std::string comment;
+	while (comment.size() + description.size() + 1 < metadataSize)
+	{
+		comment += description + "\n";
+	}
+
+	comment.resize(comment.size() + 1, '\0');
+
+	unsigned int commentSize = static_cast<unsigned int>(comment.size());
+	outMetadata.clear();
+	outMetadata.insert(outMetadata.end(), "INFOICMT", "INFOICMT" + 8);
+	for (unsigned int byteIndex = 0; byteIndex < 4; ++byteIndex)
+	{
+		outMetadata.push_back(static_cast<char>((commentSize >> (8 * byteIndex)) & 0xFF));
+	}
+
+	outMetadata.insert(outMetadata.end(), comment.begin(), comment.end());
+	if (commentSize & 1)
+	{
+		outMetadata.push_back('\0');
+	}
+}
+
+static bool WriteCorpusFile(const std::string& directory, const CorpusFile& corpusFile, double longDuration, unsigned int metadataSize, unsigned int seed, std::ofstream& manifestStream)
+{
+	const double duration = corpusFile.m_Duration > 0.0 ? corpusFile.m_Duration : longDuration;
+	const unsigned int nbSamples = static_cast<unsigned int>(floor(duration * corpusFile.m_SampleRate + 0.5));
+	const unsigned int numChannels = corpusFile.m_NumChannels;
+	const std::string audioFileName = std::string(corpusFile.m_Name) + ".wav";
+	const std::string onsetsFileName = std::string(corpusFile.m_Name) + ".onsets";
+
+	std::vector<unsigned int> onsets;
+	GetOnsets(corpusFile, duration, nbSamples, onsets);
+
+	// Every click is the same, fading out linearly. The triangle wave starts at 0, rising.
+	NoiseGenerator noiseGenerator(seed);
+	const long long period = corpusFile.m_SampleRate / CLICK_FREQUENCY;
+	const long long nbClickSamples = static_cast<long long>(CLICK_DURATION * corpusFile.m_SampleRate);
+	const long long nbNoiseSamples = static_cast<long long>(CLICK_NOISE_DURATION * corpusFile.m_SampleRate);
+	std::vector<int> click(static_cast<size_t>(nbClickSamples));
+	for (long long sampleIndex = 0; sampleIndex < nbClickSamples; ++sampleIndex)
+	{
+		long long phase = (sampleIndex + period / 4) % period;
+		long long value = phase < period / 2 ? 4 * CLICK_AMPLITUDE * phase / period - CLICK_AMPLITUDE : 3 * CLICK_AMPLITUDE - 4 * CLICK_AMPLITUDE * phase / period;
+		if (sampleIndex < nbNoiseSamples)
+		{
+			value += noiseGenerator.GetNext() * static_cast<long long>(CLICK_NOISE_AMPLITUDE) / FULL_SCALE;
+		}
+
+		click[static_cast<size_t>(sampleIndex)] = static_cast<int>(value * (nbClickSamples - sampleIndex) / nbClickSamples);
+	}
+
+	// Uniform noise of amplitude a has an RMS level of a / sqrt(3), scaled in 1 / 65536 units
+	const long long noiseScale = corpusFile.m_NoiseFloor < 0.0 ? static_cast<long long>(floor(pow(10.0, corpusFile.m_NoiseFloor / 20.0) * sqrt(3.0) * 65536.0 + 0.5)) : 0;
+
+	WavFileWriter wavFileWriter;
+	if (!wavFileWriter.Open(directory + audioFileName, corpusFile.m_SampleRate, corpusFile.m_NumChannels, corpusFile.m_Format))
+	{
+		return false;
+	}
+
+	if (corpusFile.m_HasMetadata)
+	{
+		std::vector<char> metadata;
+		GetMetadata(std::string("Synthetic click track ") + corpusFile.m_Name + ", written by corpusgen", metadataSize, metadata);
+		if (!wavFileWriter.WriteChunk("LIST", &metadata[0], static_cast<unsigned int>(metadata.size())))
+		{
+			return false;
+		}
+	}
+
+	std::vector<float> block(static_cast<size_t>(NB_BLOCK_SAMPLES) * numChannels);
+	size_t nextClickIndex = 0;
+	for (unsigned int firstSampleIndex = 0; firstSampleIndex < nbSamples; firstSampleIndex += NB_BLOCK_SAMPLES)
+	{
+		const unsigned int nbBlockSamples = nbSamples - firstSampleIndex < NB_BLOCK_SAMPLES ? nbSamples - firstSampleIndex : NB_BLOCK_SAMPLES;
+		const unsigned int endSampleIndex = firstSampleIndex + nbBlockSamples;
+
+		// Clicks ending before the block are done with
+		while (nextClickIndex < onsets.size() && onsets[nextClickIndex] + click.size() <= firstSampleIndex)
+		{
+			++nextClickIndex;
+		}
+
+		for (unsigned int sampleIndex = firstSampleIndex; sampleIndex < endSampleIndex; ++sampleIndex)
+		{
+			long long clickValue = 0;
+			for (size_t clickIndex = nextClickIndex; clickIndex < onsets.size() && onsets[clickIndex] <= sampleIndex; ++clickIndex)
+			{
+				unsigned int clickSampleIndex = sampleIndex - onsets[clickIndex];
+				if (clickSampleIndex < click.size())
+				{
+					clickValue += click[clickSampleIndex];
+				}
+			}
+
+			// Every channel has the clicks, with a noise of its own
+			float* blockSamples = &block[static_cast<size_t>(sampleIndex - firstSampleIndex) * numChannels];
+			for (unsigned int channelIndex = 0; channelIndex < numChannels; ++channelIndex)
+			{
+				long long value = clickValue;
+				if (noiseScale)
+				{
+					value += noiseGenerator.GetNext() * noiseScale / 65536;
+				}
+
+				value = value < -FULL_SCALE ? -FULL_SCALE : (value > FULL_SCALE - 1 ? FULL_SCALE - 1 : value);
+				blockSamples[channelIndex] = static_cast<float>(value) / FULL_SCALE;
+			}
+		}
+
+		if (!wavFileWriter.WriteSamples(&block[0], nbBlockSamples))
+		{
+			return false;
+		}
+	}
+
+	if (!wavFileWriter.Close())
+	{
+		return false;
+	}
+
+	std::ofstream onsetsStream((directory + onsetsFileName).c_str());
+	for (size_t onsetIndex = 0; onsetIndex < onsets.size(); ++onsetIndex)
+	{
+		char onsetTime[32];
+		sprintf(onsetTime, "%.6f", static_cast<double>(onsets[onsetIndex]) / corpusFile.m_SampleRate);
+		onsetsStream << onsetTime << "\n";
+	}
+
+	if (!onsetsStream)
+	{
+		return false;
+	}
+
+	char description[128];
+	sprintf(description, " %.3f %.3f %s %u %u %.3f", corpusFile.m_StartTempo, corpusFile.m_EndTempo, GetFormatName(corpusFile.m_Format), corpusFile.m_SampleRate, numChannels, duration);
+	manifestStream << audioFileName << " " << onsetsFileName << description << "\n";
+
+	printf("%s: %u onsets, %.0f s\n", audioFileName.c_str(), static_cast<unsigned int>(onsets.size()), duration);
+	return !manifestStream.fail();
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: corpusgen <output directory> [--long seconds] [--metadata bytes] [--seed n]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::string directory = argv[1];
+	if (!directory.empty() && directory[directory.size() - 1] != '/' && directory[directory.size() - 1] != '\\')
+	{
+		directory += "/";
+	}
+
+	double longDuration = DEFAULT_LONG_DURATION;
+	unsigned int metadataSize = DEFAULT_METADATA_SIZE;
+	unsigned int seed = DEFAULT_SEED;
+	for (int argIndex = 2; argIndex < argc; argIndex += 2)
+	{
+		if (argIndex + 1 == argc)
+		{
+			std::cerr << "Missing value for option " << argv[argIndex] << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		if (!strcmp(argv[argIndex], "--long"))
+		{
+			longDuration = atof(argv[argIndex + 1]);
+		}
+		else if (!strcmp(argv[argIndex], "--metadata"))
+		{
+			metadataSize = static_cast<unsigned int>(strtoul(argv[argIndex + 1], 0, 10));
+		}
+		else if (!strcmp(argv[argIndex], "--seed"))
+		{
+			seed = static_cast<unsigned int>(strtoul(argv[argIndex + 1], 0, 10));
+		}
+		else
+		{
+			std::cerr << "Unknown option " << argv[argIndex] << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::ofstream manifestStream((directory + "manifest.txt").c_str());
+	if (!manifestStream)
+	{
+		std::cerr << "Couldn't create " << directory << "manifest.txt" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	manifestStream << "# audio file, onsets file, start tempo, end tempo (BPM), format, sample rate, channels, duration (s)\n";
+
+	const unsigned int nbCorpusFiles = sizeof(CORPUS_FILES) / sizeof(CORPUS_FILES[0]);
+	for (unsigned int corpusFileIndex = 0; corpusFileIndex < nbCorpusFiles; ++corpusFileIndex)
+	{
+		const CorpusFile& corpusFile = CORPUS_FILES[corpusFileIndex];
+		if (corpusFile.m_Duration <= 0.0 && longDuration <= 0.0)
+		{
+			continue;
+		}
+
+		// Each file has noise of its own
+		if (!WriteCorpusFile(directory, corpusFile, longDuration, metadataSize, seed + corpusFileIndex, manifestStream))
+		{
+			std::cerr << "Couldn't write " << corpusFile.m_Name << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
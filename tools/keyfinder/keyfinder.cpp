@@ -0,0 +1,193 @@
+//****************************************************************************************
+// File:    keyfinder.cpp
+//
+// Estimates the key of audio files and finds their spectral onsets, both features sharing
+// the short time Fourier transform of the clip, see StftFrameCache.
+//
+// Usage: keyfinder [--separate] <audio file>...
+//
+// Options
+//   --separate   also computes each feature from its own transform, the way it would be
+//                done without a shared cache, checks that both ways give the same results,
+//                and reports how long each way takes.
+//
+// Times don't include loading the files, whose samples are kept in memory for the transforms.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "audiosource.h"
+#include "chromakeyestimator.h"
+#include "simplepeakdetector.h"
+#include "spectralonsetdetector.h"
+#include "stftframecache.h"
+#include "Clip.h"
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// Results of the spectral features of a file
+struct SpectralFeatures
+{
+	std::vector<double>			m_Chroma;
+	std::string					m_KeyName;
+	double						m_KeyCorrelation;
+	std::vector<unsigned int>	m_Onsets;
+	unsigned int				m_NbTransforms;
+
+	SpectralFeatures() : m_KeyCorrelation(0.0), m_NbTransforms(0) {}
+
+	bool operator==(const SpectralFeatures& rhs) const
+	{
+		return	m_Chroma == rhs.m_Chroma && m_KeyName == rhs.m_KeyName && m_KeyCorrelation == rhs.m_KeyCorrelation &&
+				m_Onsets == rhs.m_Onsets;
+	}
+};
+
+static void GetSpectralFeatures(const ChromaKeyEstimator& chromaKeyEstimator, const SpectralOnsetDetector& spectralOnsetDetector, SpectralFeatures& outFeatures)
+{
+	const double* chroma = chromaKeyEstimator.GetChroma();
+	outFeatures.m_Chroma.assign(chroma, chroma + ChromaKeyEstimator::NB_PITCH_CLASSES);
+	outFeatures.m_KeyName = chromaKeyEstimator.GetKeyName();
+	outFeatures.m_KeyCorrelation = chromaKeyEstimator.GetKeyCorrelation();
+	outFeatures.m_Onsets = spectralOnsetDetector.GetOnsets();
+}
+
+// Both features from the transform cached by the clip
+static bool ComputeSharedFeatures(AClip& clip, SpectralFeatures& outFeatures)
+{
+	ChromaKeyEstimator chromaKeyEstimator;
+	SpectralOnsetDetector spectralOnsetDetector;
+	StftFrameCache& frameCache = clip.GetStftFrameCache();
+	if (!chromaKeyEstimator.Estimate(frameCache) || !spectralOnsetDetector.Detect(frameCache))
+	{
+		return false;
+	}
+
+	GetSpectralFeatures(chromaKeyEstimator, spectralOnsetDetector, outFeatures);
+	outFeatures.m_NbTransforms = frameCache.GetNbTransforms();
+	return true;
+}
+
+// Each feature from a transform of its own
+static bool ComputeSeparateFeatures(const AClip& clip, SpectralFeatures& outFeatures)
+{
+	ChromaKeyEstimator chromaKeyEstimator;
+	SpectralOnsetDetector spectralOnsetDetector;
+	StftFrameCache chromaFrameCache(clip);
+	StftFrameCache onsetFrameCache(clip);
+	if (!chromaKeyEstimator.Estimate(chromaFrameCache) || !spectralOnsetDetector.Detect(onsetFrameCache))
+	{
+		return false;
+	}
+
+	GetSpectralFeatures(chromaKeyEstimator, spectralOnsetDetector, outFeatures);
+	outFeatures.m_NbTransforms = chromaFrameCache.GetNbTransforms() + onsetFrameCache.GetNbTransforms();
+	return true;
+}
+
+static void PrintSpectralFeatures(const std::string& filePath, const AClip& clip, const SpectralFeatures& features)
+{
+	printf("%s: %.2f s, %s (correlation %.3f), %u spectral onsets, chroma",
+		filePath.c_str(), clip.GetDuration(), features.m_KeyName.c_str(), features.m_KeyCorrelation, static_cast<unsigned int>(features.m_Onsets.size()));
+
+	for (size_t pitchClass = 0; pitchClass < features.m_Chroma.size(); ++pitchClass)
+	{
+		printf(" %.2f", features.m_Chroma[pitchClass]);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+	bool separate = false;
+	int argIndex = 1;
+	if (argIndex < argc && !strcmp(argv[argIndex], "--separate"))
+	{
+		separate = true;
+		++argIndex;
+	}
+
+	if (argIndex >= argc)
+	{
+		std::cerr << "Usage: keyfinder [--separate] <audio file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int nbFailedFiles = 0;
+	unsigned int nbSharedTransforms = 0;
+	unsigned int nbSeparateTransforms = 0;
+	double sharedTime = 0.0;
+	double separateTime = 0.0;
+	for (; argIndex < argc; ++argIndex)
+	{
+		const std::string filePath = argv[argIndex];
+
+		SimplePeakDetector peakDetector;
+		AClip clip;
+		clip.SetPeakDetector(&peakDetector);
+		clip.SetResidentSampleFormat(SampleStore::FORMAT_FLOAT32);
+		if (!clip.LoadDataFromFile(filePath))
+		{
+			std::cerr << "Couldn't read " << filePath << std::endl;
+			++nbFailedFiles;
+			continue;
+		}
+
+		SpectralFeatures features;
+		double startTime = GetWallClockTime();
+		if (!ComputeSharedFeatures(clip, features))
+		{
+			std::cerr << "Couldn't transform " << filePath << std::endl;
+			++nbFailedFiles;
+			continue;
+		}
+
+		sharedTime += GetWallClockTime() - startTime;
+		nbSharedTransforms += features.m_NbTransforms;
+		PrintSpectralFeatures(filePath, clip, features);
+
+		if (separate)
+		{
+			SpectralFeatures separateFeatures;
+			startTime = GetWallClockTime();
+			if (!ComputeSeparateFeatures(clip, separateFeatures))
+			{
+				std::cerr << "Couldn't transform " << filePath << " again" << std::endl;
+				++nbFailedFiles;
+				continue;
+			}
+
+			separateTime += GetWallClockTime() - startTime;
+			nbSeparateTransforms += separateFeatures.m_NbTransforms;
+			if (!(separateFeatures == features))
+			{
+				std::cerr << "Computing the features of " << filePath << " from separate transforms gives other results" << std::endl;
+				++nbFailedFiles;
+			}
+		}
+	}
+
+	if (separate)
+	{
+		printf("shared transform: %.3f s, %u transforms, separate transforms: %.3f s, %u transforms\n", sharedTime, nbSharedTransforms, separateTime, nbSeparateTransforms);
+	}
+
+	return nbFailedFiles ? EXIT_FAILURE : EXIT_SUCCESS;
+}
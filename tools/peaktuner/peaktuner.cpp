@@ -0,0 +1,620 @@
+//****************************************************************************************
+// File:    peaktuner.cpp
+//
+// Evaluates a grid of SimplePeakDetector parameter sets against a corpus of audio files
+// annotated with their onsets, and reports the F-measure of each parameter set.
+//
+// Usage: peaktuner <corpus manifest> [options]
+//
+// The manifest lists one annotated file per line, the audio file (WAV or FLAC) followed by its onsets
+// file, both relative to the manifest's directory. Lines starting with '#' are ignored.
+// Onsets files contain one onset time in seconds per line.
+//
+// Options, ranges are given as from:to:step
+//   --lowpass    range of low pass frequencies, in Hz
+//   --release    range of envelope release times, in seconds
+//   --on         range of trigger on thresholds
+//   --off        range of trigger off thresholds
+//   --tolerance  maximum distance between a detected onset and an annotated one, in seconds
+//   --arithmetic arithmetic of the detector: double (default), float or fixed
+//   --decimation decimation factor of the detector, 1 (default) runs it at the full rate
+//   --compare    double, float or fixed: instead of scoring the parameter sets, runs each of
+//                them in double at the full rate, and in the given arithmetic with the given
+//                decimation factor, and reports how far the peaks detected that way are from
+//                the reference ones. Peaks further apart than the tolerance are counted as 
+//                missing and extra peaks.
+//                pipeline: same, with the compile-time specialized PeakDetectorPipeline of
+//                each parameter set instead, the parameter sets without one being left out.
+//
+// Each file is decoded once and analyzed by all the parameter sets in parallel.
+//****************************************************************************************
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "audiosource.h"
+#include "simplepeakdetector.h"
+#include "peakdetectorpipeline.h"
+#include "peakscanner.h"
+
+#define DEFAULT_ONSET_TOLERANCE 0.05 // in seconds
+
+struct AnnotatedFile
+{
+	std::string			m_AudioFilePath;
+	std::vector<double>	m_Onsets;
+};
+
+struct ParameterRange
+{
+	double	m_From;
+	double	m_To;
+	double	m_Step;
+
+	ParameterRange(double from, double to, double step) : m_From(from), m_To(to), m_Step(step) {}
+
+	// Appends all values of the range to outValues
+	void GetValues(std::vector<double>& outValues) const
+	{
+		if (m_Step <= 0.0)
+		{
+			outValues.push_back(m_From);
+			return;
+		}
+
+		// Use an integer counter so that rounding errors don't drop the last value
+		unsigned int nbSteps = static_cast<unsigned int>((m_To - m_From) / m_Step + 0.5);
+		for (unsigned int stepIndex = 0; stepIndex <= nbSteps; ++stepIndex)
+		{
+			outValues.push_back(m_From + stepIndex * m_Step);
+		}
+	}
+};
+
+// Detection counts of a parameter set over the whole corpus
+struct Score
+{
+	unsigned int	m_NbTruePositives;
+	unsigned int	m_NbFalsePositives;
+	unsigned int	m_NbFalseNegatives;
+
+	Score() : m_NbTruePositives(0), m_NbFalsePositives(0), m_NbFalseNegatives(0) {}
+
+	double GetPrecision() const	{ return m_NbTruePositives ? static_cast<double>(m_NbTruePositives) / (m_NbTruePositives + m_NbFalsePositives) : 0.0; }
+	double GetRecall() const	{ return m_NbTruePositives ? static_cast<double>(m_NbTruePositives) / (m_NbTruePositives + m_NbFalseNegatives) : 0.0; }
+
+	double GetFMeasure() const
+	{
+		double precision = GetPrecision();
+		double recall = GetRecall();
+		if (precision + recall == 0.0)
+		{
+			return 0.0;
+		}
+
+		return 2.0 * precision * recall / (precision + recall);
+	}
+};
+
+// Differences between the peaks detected in an arithmetic and the reference, double, ones
+struct PeakDifferences
+{
+	unsigned int		m_NbReferencePeaks;
+	unsigned int		m_NbPeaks;
+	unsigned int		m_NbIdenticalPeaks;		// At the same sample as a reference peak
+	unsigned int		m_NbShiftedPeaks;		// Within the tolerance of a reference peak
+	unsigned long long	m_SumOfShifts;			// In samples, over the shifted peaks
+	unsigned int		m_MaxShift;				// In samples
+
+	PeakDifferences() : m_NbReferencePeaks(0), m_NbPeaks(0), m_NbIdenticalPeaks(0), m_NbShiftedPeaks(0), m_SumOfShifts(0), m_MaxShift(0) {}
+
+	unsigned int GetNbMatchedPeaks() const	{ return m_NbIdenticalPeaks + m_NbShiftedPeaks; }
+	unsigned int GetNbMissingPeaks() const	{ return m_NbReferencePeaks - GetNbMatchedPeaks(); }
+	unsigned int GetNbExtraPeaks() const	{ return m_NbPeaks - GetNbMatchedPeaks(); }
+	double GetMeanShift() const				{ return m_NbShiftedPeaks ? static_cast<double>(m_SumOfShifts) / m_NbShiftedPeaks : 0.0; }
+
+	void Add(const PeakDifferences& differences)
+	{
+		m_NbReferencePeaks	+= differences.m_NbReferencePeaks;
+		m_NbPeaks			+= differences.m_NbPeaks;
+		m_NbIdenticalPeaks	+= differences.m_NbIdenticalPeaks;
+		m_NbShiftedPeaks	+= differences.m_NbShiftedPeaks;
+		m_SumOfShifts		+= differences.m_SumOfShifts;
+		m_MaxShift			= std::max(m_MaxShift, differences.m_MaxShift);
+	}
+};
+
+struct RankedParameters
+{
+	const SimplePeakDetector::Parameters*	m_Parameters;
+	const Score*							m_Score;
+
+	bool operator<(const RankedParameters& rhs) const { return m_Score->GetFMeasure() > rhs.m_Score->GetFMeasure(); }
+};
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+static bool ParseArithmetic(const char* arithmeticString, SimplePeakDetector::Arithmetic& outArithmetic)
+{
+	if (!strcmp(arithmeticString, "double"))		outArithmetic = SimplePeakDetector::ARITHMETIC_DOUBLE;
+	else if (!strcmp(arithmeticString, "float"))	outArithmetic = SimplePeakDetector::ARITHMETIC_FLOAT;
+	else if (!strcmp(arithmeticString, "fixed"))	outArithmetic = SimplePeakDetector::ARITHMETIC_FIXED_POINT;
+	else											return false;
+
+	return true;
+}
+
+static bool ParseRange(const char* rangeString, ParameterRange& outRange)
+{
+	double from = 0.0, to = 0.0, step = 0.0;
+	int nbValuesParsed = sscanf(rangeString, "%lf:%lf:%lf", &from, &to, &step);
+	if (nbValuesParsed == 1)
+	{
+		outRange = ParameterRange(from, from, 0.0);
+		return true;
+	}
+
+	if (nbValuesParsed != 3 || to < from || step <= 0.0)
+	{
+		return false;
+	}
+
+	outRange = ParameterRange(from, to, step);
+	return true;
+}
+
+static std::string GetDirectory(const std::string& filePath)
+{
+	std::string::size_type separatorPos = filePath.find_last_of("/\\");
+	if (separatorPos == std::string::npos)
+	{
+		return std::string();
+	}
+
+	return filePath.substr(0, separatorPos + 1);
+}
+
+static bool ReadOnsets(const std::string& onsetsFilePath, std::vector<double>& outOnsets)
+{
+	std::ifstream onsetsStream(onsetsFilePath.c_str());
+	if (!onsetsStream)
+	{
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(onsetsStream, line))
+	{
+		std::istringstream lineStream(line);
+		double onsetTime = 0.0;
+		if (!line.empty() && line[0] != '#' && lineStream >> onsetTime)
+		{
+			outOnsets.push_back(onsetTime);
+		}
+	}
+
+	std::sort(outOnsets.begin(), outOnsets.end());
+	return true;
+}
+
+static bool ReadManifest(const std::string& manifestPath, std::vector<AnnotatedFile>& outFiles)
+{
+	std::ifstream manifestStream(manifestPath.c_str());
+	if (!manifestStream)
+	{
+		return false;
+	}
+
+	std::string baseDirectory = GetDirectory(manifestPath);
+	std::string line;
+	while (std::getline(manifestStream, line))
+	{
+		std::istringstream lineStream(line);
+		std::string audioFileName, onsetsFileName;
+		if (line.empty() || line[0] == '#' || !(lineStream >> audioFileName >> onsetsFileName))
+		{
+			continue;
+		}
+
+		AnnotatedFile annotatedFile;
+		annotatedFile.m_AudioFilePath = baseDirectory + audioFileName;
+		if (!ReadOnsets(baseDirectory + onsetsFileName, annotatedFile.m_Onsets))
+		{
+			std::cerr << "Couldn't read onsets file " << onsetsFileName << std::endl;
+			return false;
+		}
+
+		outFiles.push_back(annotatedFile);
+	}
+
+	return true;
+}
+
+// Matches detected peaks with annotated onsets, both sorted, in a single pass. Each onset
+// can only be matched by one peak.
+static void ScorePeaks(const std::vector<Peak>& peaks, unsigned int sampleRate, const std::vector<double>& onsets, double tolerance, Score& inOutScore)
+{
+	unsigned int nbMatches = 0;
+	std::vector<double>::const_iterator itOnsets = onsets.begin();
+	std::vector<Peak>::const_iterator itPeaks = peaks.begin();
+	for (; itPeaks != peaks.end(); ++itPeaks)
+	{
+		double peakTime = static_cast<double>(itPeaks->GetPeakSampleIndex()) / sampleRate;
+		while (itOnsets != onsets.end() && *itOnsets < peakTime - tolerance)
+		{
+			++itOnsets;
+		}
+
+		if (itOnsets != onsets.end() && *itOnsets <= peakTime + tolerance)
+		{
+			++nbMatches;
+			++itOnsets;
+		}
+	}
+
+	inOutScore.m_NbTruePositives	+= nbMatches;
+	inOutScore.m_NbFalsePositives	+= static_cast<unsigned int>(peaks.size()) - nbMatches;
+	inOutScore.m_NbFalseNegatives	+= static_cast<unsigned int>(onsets.size()) - nbMatches;
+}
+
+// Matches peaks with reference peaks, both sorted, in a single pass, the same way ScorePeaks
+// does. Each reference peak can only be matched by one peak.
+static void ComparePeaks(const std::vector<Peak>& referencePeaks, const std::vector<Peak>& peaks, unsigned int toleranceNbSamples, PeakDifferences& inOutDifferences)
+{
+	PeakDifferences differences;
+	differences.m_NbReferencePeaks	= static_cast<unsigned int>(referencePeaks.size());
+	differences.m_NbPeaks			= static_cast<unsigned int>(peaks.size());
+
+	std::vector<Peak>::const_iterator itReferencePeaks = referencePeaks.begin();
+	std::vector<Peak>::const_iterator itPeaks = peaks.begin();
+	for (; itPeaks != peaks.end(); ++itPeaks)
+	{
+		unsigned int peakSampleIndex = itPeaks->GetPeakSampleIndex();
+		while (itReferencePeaks != referencePeaks.end() && itReferencePeaks->GetPeakSampleIndex() + toleranceNbSamples < peakSampleIndex)
+		{
+			++itReferencePeaks;
+		}
+
+		if (itReferencePeaks != referencePeaks.end() && itReferencePeaks->GetPeakSampleIndex() <= peakSampleIndex + toleranceNbSamples)
+		{
+			unsigned int referenceSampleIndex = itReferencePeaks->GetPeakSampleIndex();
+			unsigned int shift = referenceSampleIndex > peakSampleIndex ? referenceSampleIndex - peakSampleIndex : peakSampleIndex - referenceSampleIndex;
+			if (!shift)
+			{
+				++differences.m_NbIdenticalPeaks;
+			}
+			else
+			{
+				++differences.m_NbShiftedPeaks;
+				differences.m_SumOfShifts += shift;
+				differences.m_MaxShift = std::max(differences.m_MaxShift, shift);
+			}
+
+			++itReferencePeaks;
+		}
+	}
+
+	inOutDifferences.Add(differences);
+}
+
+// Analyzes samples with all the parameter sets, in arithmetic and decimated by decimationFactor, or
+// with their PeakDetectorPipeline if pipeline is true, in parallel
+static void DetectPeaks(const std::vector<SimplePeakDetector::Parameters>& parameterSets, SimplePeakDetector::Arithmetic arithmetic, unsigned int decimationFactor,
+						bool pipeline, const AudioInfo& audioInfo, const std::vector<float>& samples, std::vector<std::vector<Peak> >& outPeaks)
+{
+	outPeaks.resize(parameterSets.size());
+
+	const float* sharedSamples = samples.empty() ? 0 : &samples[0];
+	const int nbParameterSets = static_cast<int>(parameterSets.size());
+
+	// Each parameter set only touches its own detector and peaks
+	#pragma omp parallel for schedule(dynamic)
+	for (int parameterSetIndex = 0; parameterSetIndex < nbParameterSets; ++parameterSetIndex)
+	{
+		SimplePeakDetector::Parameters parameters = parameterSets[parameterSetIndex];
+		parameters.m_Arithmetic = arithmetic;
+		parameters.m_DecimationFactor = decimationFactor;
+
+		SimplePeakDetector simplePeakDetector(parameters);
+		std::auto_ptr<PeakDetector> pipelinePeakDetector(pipeline ? CreatePeakDetectorPipeline(parameterSets[parameterSetIndex]) : 0);
+		PeakDetector* peakDetector = pipelinePeakDetector.get() ? pipelinePeakDetector.get() : &simplePeakDetector;
+
+		outPeaks[parameterSetIndex].clear();
+		PeakVectorSink peakSink(outPeaks[parameterSetIndex]);
+		PeakScanner::ScanSamples(peakDetector, audioInfo, sharedSamples, static_cast<unsigned int>(samples.size()), peakSink);
+	}
+}
+
+// Runs each parameter set in double at the full rate, and in arithmetic decimated by 
+// decimationFactor or with its PeakDetectorPipeline, on the corpus, and prints the differences
+static int CompareArithmetic(const std::vector<SimplePeakDetector::Parameters>& parameterSets, SimplePeakDetector::Arithmetic arithmetic,
+							 unsigned int decimationFactor, bool pipeline, const std::vector<AnnotatedFile>& corpus, double tolerance)
+{
+	std::vector<PeakDifferences> differences(parameterSets.size());
+	double analyzedAudioDuration = 0.0;
+	double referenceAnalysisTime = 0.0;
+	double analysisTime = 0.0;
+
+	for (size_t fileIndex = 0; fileIndex < corpus.size(); ++fileIndex)
+	{
+		AudioInfo audioInfo;
+		std::vector<float> samples;
+		if (!AudioSource::ReadFile(corpus[fileIndex].m_AudioFilePath, audioInfo, samples))
+		{
+			std::cerr << "Couldn't decode " << corpus[fileIndex].m_AudioFilePath << ", skipping it." << std::endl;
+			continue;
+		}
+
+		std::vector<std::vector<Peak> > referencePeaks, peaks;
+
+		double startTime = GetWallClockTime();
+		DetectPeaks(parameterSets, SimplePeakDetector::ARITHMETIC_DOUBLE, 1, false, audioInfo, samples, referencePeaks);
+		double referenceEndTime = GetWallClockTime();
+		DetectPeaks(parameterSets, arithmetic, decimationFactor, pipeline, audioInfo, samples, peaks);
+		double endTime = GetWallClockTime();
+
+		referenceAnalysisTime += referenceEndTime - startTime;
+		analysisTime += endTime - referenceEndTime;
+		analyzedAudioDuration += static_cast<double>(samples.size()) / audioInfo.m_SampleRate * parameterSets.size();
+
+		unsigned int toleranceNbSamples = static_cast<unsigned int>(tolerance * audioInfo.m_SampleRate + 0.5);
+		for (size_t parameterSetIndex = 0; parameterSetIndex < parameterSets.size(); ++parameterSetIndex)
+		{
+			ComparePeaks(referencePeaks[parameterSetIndex], peaks[parameterSetIndex], toleranceNbSamples, differences[parameterSetIndex]);
+		}
+	}
+
+	// List the parameter sets whose peaks differ, then the totals
+	PeakDifferences totalDifferences;
+	unsigned int nbDifferentParameterSets = 0;
+	printf("%10s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "lowpass", "release", "on", "off", "reference", "identical", "shifted", "mean", "max", "missing", "extra");
+	for (size_t parameterSetIndex = 0; parameterSetIndex < parameterSets.size(); ++parameterSetIndex)
+	{
+		const PeakDifferences& parameterSetDifferences = differences[parameterSetIndex];
+		totalDifferences.Add(parameterSetDifferences);
+		if (parameterSetDifferences.m_NbIdenticalPeaks == parameterSetDifferences.m_NbReferencePeaks && parameterSetDifferences.m_NbPeaks == parameterSetDifferences.m_NbReferencePeaks)
+		{
+			continue;
+		}
+
+		const SimplePeakDetector::Parameters& parameters = parameterSets[parameterSetIndex];
+		printf("%10.1f %10.3f %10.3f %10.3f %10u %10u %10u %10.2f %10u %10u %10u\n",
+			parameters.m_LowPassFrequency, parameters.m_ReleaseTime, parameters.m_TriggerOnThreshold, parameters.m_TriggerOffThreshold,
+			parameterSetDifferences.m_NbReferencePeaks, parameterSetDifferences.m_NbIdenticalPeaks, parameterSetDifferences.m_NbShiftedPeaks,
+			parameterSetDifferences.GetMeanShift(), parameterSetDifferences.m_MaxShift,
+			parameterSetDifferences.GetNbMissingPeaks(), parameterSetDifferences.GetNbExtraPeaks());
+		++nbDifferentParameterSets;
+	}
+
+	printf("\n%u of %u parameter sets detect different peaks\n", nbDifferentParameterSets, static_cast<unsigned int>(parameterSets.size()));
+	printf("%u reference peaks, %u peaks: %u identical, %u shifted by %.2f samples on average and %u at most, %u missing, %u extra\n",
+		totalDifferences.m_NbReferencePeaks, totalDifferences.m_NbPeaks, totalDifferences.m_NbIdenticalPeaks, totalDifferences.m_NbShiftedPeaks,
+		totalDifferences.GetMeanShift(), totalDifferences.m_MaxShift, totalDifferences.GetNbMissingPeaks(), totalDifferences.GetNbExtraPeaks());
+
+	if (referenceAnalysisTime > 0.0 && analysisTime > 0.0)
+	{
+		printf("%.1f s of audio analyzed in %.2f s in double (%.0fx real time), in %.2f s in the compared mode (%.0fx real time)\n",
+			analyzedAudioDuration, referenceAnalysisTime, analyzedAudioDuration / referenceAnalysisTime, analysisTime, analyzedAudioDuration / analysisTime);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: peaktuner <corpus manifest> [--lowpass from:to:step] [--release from:to:step] "
+				 "[--on from:to:step] [--off from:to:step] [--tolerance seconds] "
+				 "[--arithmetic double|float|fixed] [--decimation factor] [--compare double|float|fixed|pipeline]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	ParameterRange lowPassRange(100.0, 200.0, 25.0);
+	ParameterRange releaseRange(0.05, 0.3, 0.05);
+	ParameterRange onRange(0.3, 0.6, 0.1);
+	ParameterRange offRange(0.1, 0.4, 0.1);
+	double tolerance = DEFAULT_ONSET_TOLERANCE;
+	SimplePeakDetector::Arithmetic arithmetic = SimplePeakDetector::ARITHMETIC_DOUBLE;
+	SimplePeakDetector::Arithmetic comparedArithmetic = SimplePeakDetector::ARITHMETIC_DOUBLE;
+	unsigned int decimationFactor = 1;
+	bool compare = false;
+	bool comparePipeline = false;
+
+	for (int argIndex = 2; argIndex < argc; argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		if (argIndex + 1 == argc)
+		{
+			std::cerr << "Missing value for option " << option << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--lowpass"))			optionOk = ParseRange(value, lowPassRange);
+		else if (!strcmp(option, "--release"))		optionOk = ParseRange(value, releaseRange);
+		else if (!strcmp(option, "--on"))			optionOk = ParseRange(value, onRange);
+		else if (!strcmp(option, "--off"))			optionOk = ParseRange(value, offRange);
+		else if (!strcmp(option, "--tolerance"))	optionOk = (tolerance = atof(value)) > 0.0;
+		else if (!strcmp(option, "--arithmetic"))	optionOk = ParseArithmetic(value, arithmetic);
+		else if (!strcmp(option, "--decimation"))	optionOk = (decimationFactor = atoi(value)) > 0;
+		else if (!strcmp(option, "--compare"))		optionOk = compare = (comparePipeline = !strcmp(value, "pipeline")) || ParseArithmetic(value, comparedArithmetic);
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Build the grid of parameter sets
+	std::vector<double> lowPassValues, releaseValues, onValues, offValues;
+	lowPassRange.GetValues(lowPassValues);
+	releaseRange.GetValues(releaseValues);
+	onRange.GetValues(onValues);
+	offRange.GetValues(offValues);
+
+	std::vector<SimplePeakDetector::Parameters> parameterSets;
+	for (size_t lowPassIndex = 0; lowPassIndex < lowPassValues.size(); ++lowPassIndex)
+	for (size_t releaseIndex = 0; releaseIndex < releaseValues.size(); ++releaseIndex)
+	for (size_t onIndex = 0; onIndex < onValues.size(); ++onIndex)
+	for (size_t offIndex = 0; offIndex < offValues.size(); ++offIndex)
+	{
+		SimplePeakDetector::Parameters parameters;
+		parameters.m_LowPassFrequency		= lowPassValues[lowPassIndex];
+		parameters.m_ReleaseTime			= releaseValues[releaseIndex];
+		parameters.m_TriggerOnThreshold		= onValues[onIndex];
+		parameters.m_TriggerOffThreshold	= offValues[offIndex];
+		parameters.m_Arithmetic				= arithmetic;
+		parameters.m_DecimationFactor		= decimationFactor;
+		if (parameters.IsValid())
+		{
+			parameterSets.push_back(parameters);
+		}
+	}
+
+	std::vector<AnnotatedFile> corpus;
+	if (!ReadManifest(argv[1], corpus) || corpus.empty() || parameterSets.empty())
+	{
+		std::cerr << "Nothing to evaluate." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (compare)
+	{
+		if (comparePipeline)
+		{
+			// Pipelines are specialized for parameters in double at the full rate, in whole Hz,
+			// milliseconds and thousandths, which drops the rounding errors of the ranges
+			std::vector<SimplePeakDetector::Parameters> pipelineParameterSets;
+			for (size_t parameterSetIndex = 0; parameterSetIndex < parameterSets.size(); ++parameterSetIndex)
+			{
+				SimplePeakDetector::Parameters parameters = parameterSets[parameterSetIndex];
+				parameters.m_LowPassFrequency = floor(parameters.m_LowPassFrequency + 0.5);
+				parameters.m_ReleaseTime = floor(parameters.m_ReleaseTime * 1000.0 + 0.5) / 1000.0;
+				parameters.m_TriggerOnThreshold = floor(parameters.m_TriggerOnThreshold * 1000.0 + 0.5) / 1000.0;
+				parameters.m_TriggerOffThreshold = floor(parameters.m_TriggerOffThreshold * 1000.0 + 0.5) / 1000.0;
+				parameters.m_Arithmetic = SimplePeakDetector::ARITHMETIC_DOUBLE;
+				parameters.m_DecimationFactor = 1;
+				std::auto_ptr<PeakDetector> pipelinePeakDetector(CreatePeakDetectorPipeline(parameters));
+				if (pipelinePeakDetector.get())
+				{
+					pipelineParameterSets.push_back(parameters);
+				}
+			}
+
+			if (pipelineParameterSets.empty())
+			{
+				std::cerr << "None of the parameter sets has a pipeline." << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			return CompareArithmetic(pipelineParameterSets, SimplePeakDetector::ARITHMETIC_DOUBLE, 1, true, corpus, tolerance);
+		}
+
+		if (comparedArithmetic == SimplePeakDetector::ARITHMETIC_DOUBLE && decimationFactor == 1)
+		{
+			std::cerr << "Nothing to compare the reference with." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		return CompareArithmetic(parameterSets, comparedArithmetic, decimationFactor, false, corpus, tolerance);
+	}
+
+	std::vector<Score> scores(parameterSets.size());
+	unsigned int nbAnalyzedFiles = 0;
+	double analyzedAudioDuration = 0.0;
+	double analysisTime = 0.0;
+
+	for (size_t fileIndex = 0; fileIndex < corpus.size(); ++fileIndex)
+	{
+		// Decode once...
+		AudioInfo audioInfo;
+		std::vector<float> samples;
+		if (!AudioSource::ReadFile(corpus[fileIndex].m_AudioFilePath, audioInfo, samples))
+		{
+			std::cerr << "Couldn't decode " << corpus[fileIndex].m_AudioFilePath << ", skipping it." << std::endl;
+			continue;
+		}
+
+		const float* sharedSamples = samples.empty() ? 0 : &samples[0];
+		const int nbParameterSets = static_cast<int>(parameterSets.size());
+		double startTime = GetWallClockTime();
+
+		// ... analyze many. Each parameter set only touches its own detector and score.
+		#pragma omp parallel for schedule(dynamic)
+		for (int parameterSetIndex = 0; parameterSetIndex < nbParameterSets; ++parameterSetIndex)
+		{
+			SimplePeakDetector peakDetector(parameterSets[parameterSetIndex]);
+			std::vector<Peak> peaks;
+			PeakVectorSink peakSink(peaks);
+			PeakScanner::ScanSamples(&peakDetector, audioInfo, sharedSamples, static_cast<unsigned int>(samples.size()), peakSink);
+			ScorePeaks(peaks, audioInfo.m_SampleRate, corpus[fileIndex].m_Onsets, tolerance, scores[parameterSetIndex]);
+		}
+
+		analysisTime += GetWallClockTime() - startTime;
+		analyzedAudioDuration += static_cast<double>(samples.size()) / audioInfo.m_SampleRate * parameterSets.size();
+		++nbAnalyzedFiles;
+	}
+
+	if (!nbAnalyzedFiles)
+	{
+		std::cerr << "None of the files could be decoded." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<RankedParameters> rankedParameters(parameterSets.size());
+	for (size_t parameterSetIndex = 0; parameterSetIndex < parameterSets.size(); ++parameterSetIndex)
+	{
+		rankedParameters[parameterSetIndex].m_Parameters = &parameterSets[parameterSetIndex];
+		rankedParameters[parameterSetIndex].m_Score = &scores[parameterSetIndex];
+	}
+
+	std::stable_sort(rankedParameters.begin(), rankedParameters.end());
+
+	printf("%10s %10s %10s %10s %10s %10s %10s\n", "lowpass", "release", "on", "off", "precision", "recall", "F");
+	for (size_t rankIndex = 0; rankIndex < rankedParameters.size(); ++rankIndex)
+	{
+		const SimplePeakDetector::Parameters& parameters = *rankedParameters[rankIndex].m_Parameters;
+		const Score& score = *rankedParameters[rankIndex].m_Score;
+		printf("%10.1f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+			parameters.m_LowPassFrequency, parameters.m_ReleaseTime, parameters.m_TriggerOnThreshold, parameters.m_TriggerOffThreshold,
+			score.GetPrecision(), score.GetRecall(), score.GetFMeasure());
+	}
+
+	if (analysisTime > 0.0)
+	{
+		printf("\n%u files, %u parameter sets, %.1f s of audio analyzed in %.2f s (%.0fx real time)\n",
+			nbAnalyzedFiles, static_cast<unsigned int>(parameterSets.size()),
+			analyzedAudioDuration, analysisTime, analyzedAudioDuration / analysisTime);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+//****************************************************************************************
+// File:    setbouncer.cpp
+//
+// Renders a whole set of warped clips offline, and writes its mixdown to a WAV file, with as
+// many channels as the clip with the most. Mono clips play on all of them.
+//
+// Usage: setbouncer [options] <set file> <output WAV file>
+//
+// The set file lists one clip per line: the time of the set at which it starts, in seconds,
+// then its audio file (WAV or FLAC), relative to the set file's directory, then optionally
+// warp markers added to its default ones, each as <sample time>:<beat time> in seconds.
+// Lines starting with '#' are ignored.
+//
+// Options
+//   --rate       sample rate of the output, 44100 by default
+//   --threads    number of threads rendering the set, all the cores by default
+//   --cache      maximum size of the decoded audio kept in memory, in MB, 1024 by default
+//
+// The output doesn't depend on the number of threads, see Mixdown.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Clip.h"
+#include "mixdown.h"
+#include "session.h"
+#include "simplepeakdetector.h"
+
+#define DEFAULT_OUTPUT_RATE		44100
+#define DEFAULT_CACHE_SIZE		1024 // in MB
+
+static double GetWallClockTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+static std::string GetDirectory(const std::string& filePath)
+{
+	std::string::size_type separatorPos = filePath.find_last_of("/\\");
+	if (separatorPos == std::string::npos)
+	{
+		return std::string();
+	}
+
+	return filePath.substr(0, separatorPos + 1);
+}
+
+static bool ReadSet(const std::string& setFilePath, Session& session)
+{
+	std::ifstream setStream(setFilePath.c_str());
+	if (!setStream)
+	{
+		return false;
+	}
+
+	std::string baseDirectory = GetDirectory(setFilePath);
+	std::string line;
+	while (std::getline(setStream, line))
+	{
+		std::istringstream lineStream(line);
+		double setTime = 0.0;
+		std::string audioFileName;
+		if (line.empty() || line[0] == '#' || !(lineStream >> setTime >> audioFileName))
+		{
+			continue;
+		}
+
+		int clipIndex = session.AddClip(baseDirectory + audioFileName, setTime);
+		if (clipIndex < 0)
+		{
+			std::cerr << "Couldn't load " << audioFileName << std::endl;
+			return false;
+		}
+
+		std::string warpMarker;
+		while (lineStream >> warpMarker)
+		{
+			double sampleTime = 0.0, beatTime = 0.0;
+			if (sscanf(warpMarker.c_str(), "%lf:%lf", &sampleTime, &beatTime) != 2 ||
+				!session.GetClip(clipIndex)->AddWarpMarker(sampleTime, beatTime))
+			{
+				std::cerr << "Couldn't add warp marker " << warpMarker << " to " << audioFileName << std::endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int outputRate = DEFAULT_OUTPUT_RATE;
+	int cacheSize = DEFAULT_CACHE_SIZE;
+
+	int argIndex = 1;
+	for (; argIndex + 1 < argc && !strncmp(argv[argIndex], "--", 2); argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--rate"))			optionOk = (outputRate = atoi(value)) > 0;
+		else if (!strcmp(option, "--cache"))	optionOk = (cacheSize = atoi(value)) > 0;
+		else if (!strcmp(option, "--threads"))
+		{
+			int nbThreads = atoi(value);
+			optionOk = nbThreads > 0;
+#ifdef _OPENMP
+			if (optionOk)
+			{
+				omp_set_num_threads(nbThreads);
+			}
+#endif
+		}
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argIndex + 2 != argc)
+	{
+		std::cerr << "Usage: setbouncer [--rate Hz] [--threads n] [--cache MB] <set file> <output WAV file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	SimplePeakDetector peakDetector;
+	Session session(&peakDetector, static_cast<size_t>(cacheSize) * 1024 * 1024);
+
+	double startTime = GetWallClockTime();
+	if (!ReadSet(argv[argIndex], session) || !session.GetNbClips())
+	{
+		std::cerr << "Couldn't read set file " << argv[argIndex] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	double loadTime = GetWallClockTime() - startTime;
+
+	startTime = GetWallClockTime();
+	double setDuration = 0.0;
+	if (!Mixdown::RenderToFile(session, outputRate, argv[argIndex + 1], setDuration))
+	{
+		std::cerr << "Couldn't render the set to " << argv[argIndex + 1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	double renderTime = GetWallClockTime() - startTime;
+
+	printf(	"%u clips from %u files loaded in %.2f s, %.1f s of set rendered on %u channels in %.2f s, %.1fx real time\n", 
+			static_cast<unsigned int>(session.GetNbClips()), static_cast<unsigned int>(session.GetNbSourceFiles()), loadTime, 
+			setDuration, Mixdown::GetNbChannels(session), renderTime, renderTime > 0.0 ? setDuration / renderTime : 0.0);
+
+	return EXIT_SUCCESS;
+}
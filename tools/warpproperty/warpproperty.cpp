@@ -0,0 +1,482 @@
+//****************************************************************************************
+// File:    warpproperty.cpp
+//
+// Property based test of the warp markers of AClip. Each run loads a silent clip of random
+// length and sample rate, then applies a random sequence of operations to its warp markers:
+// adds at exact positions and at times, appends and removals of the last warp marker. Most
+// of the warp markers tried are close to existing ones: on the same sample or beat position,
+// one position away, or crossing a neighbour, which are the cases the checks get wrong.
+//
+// After each operation, it checks that:
+// - the warp marker was accepted if and only if a plain list of warp markers, the model,
+//   accepts it: within the clip, not on the sample or beat position of another warp marker
+//   and crossing none of them,
+// - the warp markers of the clip are the ones of the model, in increasing sample and beat
+//   positions,
+// - times between the first and the last warp markers are converted, the others aren't,
+// - conversions match the interpolation between the warp markers of the model bounding them,
+// - sample to beat time is monotonic, and beat to sample time gives back the sample time,
+// - the conversions using the bounding warp markers cache give the same times as the others.
+//
+// Usage: warpproperty [options]
+//
+// Options
+//   --runs       number of clips, 2000 by default
+//   --markers    number of operations on the warp markers of each clip, 60 by default
+//   --queries    number of sample and of beat times converted after each operation, 100 by
+//                default
+//   --seed       seed of the random operations, 1 by default
+//
+// The same options always run the same operations. The failures are counted per property,
+// the first ones are described, and the exit code is non zero if there is any.
+//****************************************************************************************
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include "Clip.h"
+#include "peakdetector.h"
+
+#define DEFAULT_NB_RUNS			2000
+#define DEFAULT_NB_OPERATIONS	60
+#define DEFAULT_NB_QUERIES		100
+#define DEFAULT_SEED			1
+
+#define MIN_CLIP_DURATION		0.5			// in seconds
+#define MAX_CLIP_DURATION		30.0		// in seconds
+
+// Conversions are computed in double, from positions of up to about 10^11 units
+#define TIME_TOLERANCE			1e-9		// in seconds
+
+// Relative error of the positions computed from times. Through a steep segment between warp
+// markers, it is an error of many positions on the other side.
+#define POSITION_RELATIVE_ERROR	(8 * DBL_EPSILON)
+
+// Number of failures described for each property
+#define MAX_NB_DESCRIBED_FAILURES	5
+
+static const unsigned int SAMPLE_RATES[] = { 22050, 44100, 48000, 88200, 96000 };
+
+// The peaks of the silent clips don't matter, nothing is analyzed
+class NoPeakDetector : public PeakDetector
+{
+public:
+	using PeakDetector::GetPeaks;
+
+	virtual bool GetPeaks(const float* /*samples*/, unsigned int /*nbSamples*/, const AudioInfo& /*audioInfo*/, unsigned int /*sampleOffset*/, PeakSink& /*outPeaks*/) { return true; }
+};
+
+// Xorshift generator, whose sequence is the same everywhere, unlike rand's
+class OperationGenerator
+{
+private:
+	unsigned int	m_State;
+
+public:
+	explicit OperationGenerator(unsigned int seed) : m_State(seed ? seed : 1) {}
+
+	unsigned int GetNext()
+	{
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 17;
+		m_State ^= m_State << 5;
+		return m_State;
+	}
+
+	// Uniform in [0, nbValues), nbValues must not be 0
+	unsigned int GetNext(unsigned int nbValues) { return GetNext() % nbValues; }
+
+	// Uniform in [0, nbValues), nbValues must not be 0
+	long long GetNextPosition(long long nbValues) { return static_cast<long long>(((static_cast<unsigned long long>(GetNext()) << 32) | GetNext()) % nbValues); }
+
+	// Uniform in [0.0, 1.0)
+	double GetNextUnit() { return GetNext() / 4294967296.0; }
+};
+
+enum Property
+{
+	PROPERTY_ACCEPT_DECISION,
+	PROPERTY_WARP_MARKERS,
+	PROPERTY_CONVERTED_RANGE,
+	PROPERTY_INTERPOLATION,
+	PROPERTY_MONOTONIC,
+	PROPERTY_INVERTIBLE,
+	PROPERTY_CACHE,
+	NB_PROPERTIES
+};
+
+static const char* PROPERTY_NAMES[NB_PROPERTIES] =
+{
+	"wrong accept decisions",
+	"warp markers differing from the model",
+	"times wrongly converted or not",
+	"conversions off the interpolation",
+	"non monotonic conversions",
+	"non invertible conversions",
+	"conversions differing with the cache"
+};
+
+struct Failures
+{
+	unsigned int	m_NbFailures[NB_PROPERTIES];
+
+	Failures() { std::fill(m_NbFailures, m_NbFailures + NB_PROPERTIES, 0); }
+
+	unsigned int GetTotal() const
+	{
+		unsigned int nbFailures = 0;
+		for (unsigned int property = 0; property < NB_PROPERTIES; ++property)
+		{
+			nbFailures += m_NbFailures[property];
+		}
+
+		return nbFailures;
+	}
+
+	// Counts a failure of property if condition is false, and describes the first ones
+	void Check(bool condition, Property property, unsigned int runIndex, const char* description, double value = 0.0)
+	{
+		if (condition)
+		{
+			return;
+		}
+
+		if (m_NbFailures[property]++ < MAX_NB_DESCRIBED_FAILURES)
+		{
+			std::cerr << "Run " << runIndex << ": " << description << " (" << value << ")" << std::endl;
+		}
+	}
+};
+
+// Warp markers the clip should have, in sample order
+typedef std::vector<WarpMarker> WarpMarkerModel;
+
+static bool IsAcceptedByModel(const WarpMarkerModel& model, const WarpMarker& warpMarker, SamplePosition nbSamples)
+{
+	if (warpMarker.GetSamplePosition() > nbSamples || warpMarker.GetBeatPosition() < 0)
+	{
+		return false;
+	}
+
+	for (size_t warpMarkerIndex = 0; warpMarkerIndex < model.size(); ++warpMarkerIndex)
+	{
+		const WarpMarker& modelWarpMarker = model[warpMarkerIndex];
+		if (modelWarpMarker.GetSamplePosition() == warpMarker.GetSamplePosition() || modelWarpMarker.GetBeatPosition() == warpMarker.GetBeatPosition() ||
+			(modelWarpMarker.GetSamplePosition() < warpMarker.GetSamplePosition()) != (modelWarpMarker.GetBeatPosition() < warpMarker.GetBeatPosition()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void AddToModel(WarpMarkerModel& inOutModel, const WarpMarker& warpMarker)
+{
+	WarpMarkerModel::iterator itWarpMarkers = inOutModel.begin();
+	while (itWarpMarkers != inOutModel.end() && itWarpMarkers->GetSamplePosition() < warpMarker.GetSamplePosition())
+	{
+		++itWarpMarkers;
+	}
+
+	inOutModel.insert(itWarpMarkers, warpMarker);
+}
+
+// Beat position of the sample position, interpolated between the warp markers of the model
+// bounding it, which has at least 2 of them. outSlope is the number of beat positions per
+// sample position between them.
+static double GetModelBeatPosition(const WarpMarkerModel& model, double samplePosition, double& outSlope)
+{
+	size_t highBoundIndex = 1;
+	while (highBoundIndex + 1 < model.size() && model[highBoundIndex].GetSamplePosition() <= samplePosition)
+	{
+		++highBoundIndex;
+	}
+
+	const WarpMarker& lowBound = model[highBoundIndex - 1];
+	const WarpMarker& highBound = model[highBoundIndex];
+	outSlope = (highBound.GetBeatPosition() - lowBound.GetBeatPosition()) / (static_cast<double>(highBound.GetSamplePosition()) - lowBound.GetSamplePosition());
+	return lowBound.GetBeatPosition() + (samplePosition - lowBound.GetSamplePosition()) * outSlope;
+}
+
+// A warp marker close to the existing ones, most of the time, or anywhere
+static WarpMarker GetCandidateWarpMarker(OperationGenerator& generator, const WarpMarkerModel& model, SamplePosition nbSamples, unsigned int sampleRate)
+{
+	const BeatPosition beatPositionsPerSample = WarpMarker::BEAT_POSITIONS_PER_SECOND / sampleRate;
+	const BeatPosition maxBeatPosition = static_cast<BeatPosition>(2 * nbSamples) * beatPositionsPerSample;
+	const unsigned int kind = model.empty() ? 2 : generator.GetNext(5);
+
+	if (kind <= 1)
+	{
+		// On, or one position or one sample away from, an existing warp marker
+		static const long long beatOffsets[] = { 0, -1, 1, -1, 1 };
+		const WarpMarker& nearWarpMarker = model[generator.GetNext(static_cast<unsigned int>(model.size()))];
+		long long sampleOffset = static_cast<long long>(generator.GetNext(3)) - 1;
+		long long beatOffset = beatOffsets[generator.GetNext(5)] * (generator.GetNext(2) ? 1 : beatPositionsPerSample);
+		SamplePosition samplePosition = sampleOffset < 0 && !nearWarpMarker.GetSamplePosition() ? 0 : nearWarpMarker.GetSamplePosition() + sampleOffset;
+		return WarpMarker(samplePosition, nearWarpMarker.GetBeatPosition() + beatOffset);
+	}
+
+	if (kind == 2 && model.size() >= 2)
+	{
+		// Between two neighbours in sample order, and before, on or after them in beat order
+		size_t lowBoundIndex = generator.GetNext(static_cast<unsigned int>(model.size() - 1));
+		const WarpMarker& lowBound = model[lowBoundIndex];
+		const WarpMarker& highBound = model[lowBoundIndex + 1];
+		SamplePosition samplePosition = lowBound.GetSamplePosition() + generator.GetNextPosition(static_cast<long long>(highBound.GetSamplePosition() - lowBound.GetSamplePosition()) + 1);
+		BeatPosition beatPositions[] = { lowBound.GetBeatPosition() - 1, lowBound.GetBeatPosition(), highBound.GetBeatPosition(), highBound.GetBeatPosition() + 1,
+										 lowBound.GetBeatPosition() + generator.GetNextPosition(highBound.GetBeatPosition() - lowBound.GetBeatPosition() + 1) };
+		return WarpMarker(samplePosition, beatPositions[generator.GetNext(5)]);
+	}
+
+	// Anywhere, a few of them past the end of the clip
+	return WarpMarker(generator.GetNextPosition(static_cast<long long>(nbSamples + nbSamples / 20) + 1), generator.GetNextPosition(maxBeatPosition + 1));
+}
+
+// Converts queries sample and beat times between the first and the last warp markers of the
+// model, and a few outside, and checks the conversions
+static void CheckConversions(OperationGenerator& generator, AClip& clip, const WarpMarkerModel& model, unsigned int nbQueries, unsigned int runIndex, Failures& inOutFailures)
+{
+	const unsigned int sampleRate = clip.GetAudioInfo().m_SampleRate;
+	const double beatPositionsPerSecond = static_cast<double>(WarpMarker::BEAT_POSITIONS_PER_SECOND);
+	double sampleTime, beatTime;
+
+	if (model.size() < 2)
+	{
+		inOutFailures.Check(!clip.FindBeatTime(0.0, beatTime) && !clip.FindSampleTime(0.0, sampleTime), PROPERTY_CONVERTED_RANGE, runIndex, "converted without 2 warp markers");
+		return;
+	}
+
+	const WarpMarker& firstWarpMarker = model.front();
+	const WarpMarker& lastWarpMarker = model.back();
+
+	// Outside of the warp markers, times aren't converted
+	if (firstWarpMarker.GetSamplePosition())
+	{
+		double beforeSampleTime = (firstWarpMarker.GetSamplePosition() - 0.5) / sampleRate;
+		inOutFailures.Check(!clip.FindBeatTime(beforeSampleTime, beatTime), PROPERTY_CONVERTED_RANGE, runIndex, "converted a sample time before the first warp marker", beforeSampleTime);
+	}
+
+	double afterSampleTime = (lastWarpMarker.GetSamplePosition() + 1.0) / sampleRate;
+	inOutFailures.Check(!clip.FindBeatTime(afterSampleTime, beatTime), PROPERTY_CONVERTED_RANGE, runIndex, "converted a sample time after the last warp marker", afterSampleTime);
+
+	double afterBeatTime = (lastWarpMarker.GetBeatPosition() + 1.0) / beatPositionsPerSecond;
+	inOutFailures.Check(!clip.FindSampleTime(afterBeatTime, sampleTime), PROPERTY_CONVERTED_RANGE, runIndex, "converted a beat time after the last warp marker", afterBeatTime);
+
+	// Sorted sample times, ends included, whose beat times must be sorted too
+	std::vector<double> sampleTimes(nbQueries);
+	const double firstSampleTime = static_cast<double>(firstWarpMarker.GetSamplePosition()) / sampleRate;
+	const double lastSampleTime = static_cast<double>(lastWarpMarker.GetSamplePosition()) / sampleRate;
+	for (unsigned int queryIndex = 0; queryIndex < nbQueries; ++queryIndex)
+	{
+		sampleTimes[queryIndex] = queryIndex ? firstSampleTime + (lastSampleTime - firstSampleTime) * generator.GetNextUnit() : lastSampleTime;
+	}
+
+	sampleTimes.push_back(firstSampleTime);
+	std::sort(sampleTimes.begin(), sampleTimes.end());
+
+	double previousBeatTime = -1.0;
+	for (size_t queryIndex = 0; queryIndex < sampleTimes.size(); ++queryIndex)
+	{
+		const double queriedSampleTime = sampleTimes[queryIndex];
+		if (!clip.FindBeatTime(queriedSampleTime, beatTime))
+		{
+			inOutFailures.Check(false, PROPERTY_CONVERTED_RANGE, runIndex, "didn't convert a sample time between the warp markers", queriedSampleTime);
+			continue;
+		}
+
+		// The error of the sample position, times the slope, and the error of the beat position
+		double slope;
+		const double samplePosition = queriedSampleTime * sampleRate;
+		const double modelBeatTime = GetModelBeatPosition(model, samplePosition, slope) / beatPositionsPerSecond;
+		const double beatTimeTolerance = TIME_TOLERANCE + POSITION_RELATIVE_ERROR * (samplePosition * slope / beatPositionsPerSecond + modelBeatTime);
+		inOutFailures.Check(fabs(beatTime - modelBeatTime) <= beatTimeTolerance, PROPERTY_INTERPOLATION, runIndex, "beat time off the interpolation", beatTime - modelBeatTime);
+		inOutFailures.Check(beatTime >= previousBeatTime - beatTimeTolerance, PROPERTY_MONOTONIC, runIndex, "beat time before the previous one", beatTime - previousBeatTime);
+		inOutFailures.Check(fabs(clip.SampleToBeatTime(queriedSampleTime) - beatTime) <= beatTimeTolerance, PROPERTY_CACHE, runIndex, "cached sample to beat time differs", queriedSampleTime);
+		previousBeatTime = beatTime;
+
+		// A sample time rounded just before the first warp marker gives, through a steep
+		// segment, a beat time before it as well, which isn't converted back
+		if (beatTime < firstWarpMarker.GetBeatTime() || beatTime > lastWarpMarker.GetBeatTime())
+		{
+			continue;
+		}
+
+		if (clip.FindSampleTime(beatTime, sampleTime))
+		{
+			// The error of the beat time, through the inverse slope, and the one of the sample position
+			const double sampleTimeTolerance = TIME_TOLERANCE + (beatTimeTolerance * beatPositionsPerSecond / slope + POSITION_RELATIVE_ERROR * samplePosition) / sampleRate;
+			inOutFailures.Check(fabs(sampleTime - queriedSampleTime) <= sampleTimeTolerance, PROPERTY_INVERTIBLE, runIndex, "beat time gives another sample time", sampleTime - queriedSampleTime);
+			inOutFailures.Check(fabs(clip.BeatToSampleTime(beatTime) - sampleTime) <= sampleTimeTolerance, PROPERTY_CACHE, runIndex, "cached beat to sample time differs", beatTime);
+		}
+		else
+		{
+			inOutFailures.Check(false, PROPERTY_INVERTIBLE, runIndex, "didn't convert the beat time of a sample time back", beatTime);
+		}
+	}
+}
+
+// Loads a silent clip of random length and sample rate, applies nbOperations random operations
+// to its warp markers, and checks the clip against the model after each of them
+static void Run(OperationGenerator& generator, unsigned int nbOperations, unsigned int nbQueries, unsigned int runIndex, const std::vector<float>& silence,
+				unsigned int& inOutNbAccepted, unsigned int& inOutNbRejected, Failures& inOutFailures)
+{
+	AudioInfo audioInfo;
+	audioInfo.m_SampleRate = SAMPLE_RATES[generator.GetNext(sizeof(SAMPLE_RATES) / sizeof(SAMPLE_RATES[0]))];
+	audioInfo.m_NumChannels = 1;
+	audioInfo.m_BitsPerSample = 32;
+	audioInfo.m_NbSamples = static_cast<unsigned int>((MIN_CLIP_DURATION + (MAX_CLIP_DURATION - MIN_CLIP_DURATION) * generator.GetNextUnit()) * audioInfo.m_SampleRate);
+
+	NoPeakDetector peakDetector;
+	AClip clip;
+	clip.SetPeakDetector(&peakDetector);
+	if (!clip.LoadDataFromSamples(audioInfo, &silence[0]))
+	{
+		std::cerr << "Run " << runIndex << ": couldn't load the clip" << std::endl;
+		inOutFailures.Check(false, PROPERTY_WARP_MARKERS, runIndex, "no clip");
+		return;
+	}
+
+	const SamplePosition nbSamples = audioInfo.m_NbSamples;
+	WarpMarkerModel model;
+	if (generator.GetNext(2))
+	{
+		clip.AddDefaultWarpMarkers();
+		model.push_back(WarpMarker(0, 0));
+		model.push_back(WarpMarker(nbSamples, static_cast<BeatPosition>(nbSamples) * WarpMarker::BEAT_POSITIONS_PER_SECOND / audioInfo.m_SampleRate));
+	}
+
+	for (unsigned int operationIndex = 0; operationIndex < nbOperations; ++operationIndex)
+	{
+		const unsigned int operation = generator.GetNext(10);
+		bool accepted = false;
+		bool acceptedByModel = false;
+		if (operation < 6)
+		{
+			WarpMarker warpMarker = GetCandidateWarpMarker(generator, model, nbSamples, audioInfo.m_SampleRate);
+			accepted = clip.AddWarpMarker(warpMarker);
+			acceptedByModel = IsAcceptedByModel(model, warpMarker, nbSamples);
+			if (acceptedByModel)
+			{
+				AddToModel(model, warpMarker);
+			}
+		}
+		else if (operation < 8)
+		{
+			// Times are rounded to the nearest positions
+			double sampleTime = (nbSamples + nbSamples / 20) * generator.GetNextUnit() / audioInfo.m_SampleRate;
+			double beatTime = 2.0 * nbSamples * generator.GetNextUnit() / audioInfo.m_SampleRate;
+			WarpMarker warpMarker(static_cast<SamplePosition>(floor(sampleTime * audioInfo.m_SampleRate + 0.5)), WarpMarker::ToBeatPosition(beatTime));
+			accepted = clip.AddWarpMarker(sampleTime, beatTime);
+			acceptedByModel = IsAcceptedByModel(model, warpMarker, nbSamples);
+			if (acceptedByModel)
+			{
+				AddToModel(model, warpMarker);
+			}
+		}
+		else if (operation < 9)
+		{
+			WarpMarker warpMarker = GetCandidateWarpMarker(generator, model, nbSamples, audioInfo.m_SampleRate);
+			if (!model.empty() && generator.GetNext(2))
+			{
+				// Just after the last one
+				warpMarker = WarpMarker(model.back().GetSamplePosition() + generator.GetNext(2), model.back().GetBeatPosition() + generator.GetNext(2));
+			}
+
+			accepted = clip.AppendWarpMarker(warpMarker);
+			acceptedByModel =	warpMarker.GetSamplePosition() <= nbSamples && warpMarker.GetBeatPosition() >= 0 &&
+								(model.empty() || (warpMarker.GetSamplePosition() > model.back().GetSamplePosition() && warpMarker.GetBeatPosition() > model.back().GetBeatPosition()));
+			if (acceptedByModel)
+			{
+				model.push_back(warpMarker);
+			}
+		}
+		else
+		{
+			accepted = clip.RemoveLastWarpMarker();
+			acceptedByModel = !model.empty();
+			if (acceptedByModel)
+			{
+				model.pop_back();
+			}
+		}
+
+		inOutFailures.Check(accepted == acceptedByModel, PROPERTY_ACCEPT_DECISION, runIndex, accepted ? "accepted an operation the model rejects" : "rejected an operation the model accepts", operation);
+		++(accepted ? inOutNbAccepted : inOutNbRejected);
+
+		std::vector<WarpMarker> warpMarkers;
+		clip.GetWarpMarkers(warpMarkers);
+		inOutFailures.Check(warpMarkers == model, PROPERTY_WARP_MARKERS, runIndex, "warp markers differ from the model", static_cast<double>(warpMarkers.size()));
+
+		CheckConversions(generator, clip, model, nbQueries, runIndex, inOutFailures);
+	}
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: warpproperty [--runs n] [--markers n] [--queries n] [--seed n]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int nbRuns = DEFAULT_NB_RUNS;
+	unsigned int nbOperations = DEFAULT_NB_OPERATIONS;
+	unsigned int nbQueries = DEFAULT_NB_QUERIES;
+	unsigned int seed = DEFAULT_SEED;
+
+	for (int argIndex = 1; argIndex < argc; argIndex += 2)
+	{
+		const char* option = argv[argIndex];
+		if (argIndex + 1 == argc)
+		{
+			std::cerr << "Missing value for option " << option << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[argIndex + 1];
+		bool optionOk = false;
+		if (!strcmp(option, "--runs"))				optionOk = (nbRuns = atoi(value)) > 0;
+		else if (!strcmp(option, "--markers"))		optionOk = (nbOperations = atoi(value)) > 0;
+		else if (!strcmp(option, "--queries"))		optionOk = (nbQueries = atoi(value)) > 0;
+		else if (!strcmp(option, "--seed"))			optionOk = (seed = atoi(value)) > 0;
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << option << " " << value << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	const unsigned int maxSampleRate = *std::max_element(SAMPLE_RATES, SAMPLE_RATES + sizeof(SAMPLE_RATES) / sizeof(SAMPLE_RATES[0]));
+	const std::vector<float> silence(static_cast<size_t>(MAX_CLIP_DURATION * maxSampleRate) + 1, 0.0f);
+
+	OperationGenerator generator(seed);
+	Failures failures;
+	unsigned int nbAccepted = 0;
+	unsigned int nbRejected = 0;
+
+	const clock_t startTime = clock();
+	for (unsigned int runIndex = 0; runIndex < nbRuns; ++runIndex)
+	{
+		Run(generator, nbOperations, nbQueries, runIndex, silence, nbAccepted, nbRejected, failures);
+	}
+
+	const double elapsedTime = static_cast<double>(clock() - startTime) / CLOCKS_PER_SEC;
+
+	printf("%u runs, %u operations on warp markers: %u accepted, %u rejected, %u conversions checked after each, in %.2f s\n",
+		nbRuns, nbRuns * nbOperations, nbAccepted, nbRejected, 2 * nbQueries, elapsedTime);
+	for (unsigned int property = 0; property < NB_PROPERTIES; ++property)
+	{
+		printf("%10u %s\n", failures.m_NbFailures[property], PROPERTY_NAMES[property]);
+	}
+
+	return failures.GetTotal() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
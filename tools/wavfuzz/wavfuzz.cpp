@@ -0,0 +1,506 @@
+//****************************************************************************************
+// File:    wavfuzz.cpp
+//
+// Fuzzes WavFileReader. LLVMFuzzerTestOneInput reads any input as a WAV file, with ReadFormat
+// then ReadSamples block by block, and aborts when the reader accepts a header that doesn't
+// agree with the input: a format it can't decode, or samples past the end of the input.
+//
+// Built with clang -fsanitize=fuzzer,address,undefined -DWAVFUZZ_LIBFUZZER, this file is a
+// libFuzzer target, which is given the seed corpus directory:
+//   wavfuzz tools/wavfuzz/corpus
+//
+// Built without WAVFUZZ_LIBFUZZER, it runs its own mutation loop, which only needs the
+// compiler, and reports how fast inputs are read, so that it doubles as a benchmark of the
+// parser.
+//
+// Usage: wavfuzz [options] [seed file]...
+//
+// Options
+//   --runs         number of mutated inputs, 1000000 by default
+//   --seed         seed of the mutations, 1 by default
+//   --write-seeds  writes the seed corpus to the given directory, which must exist, and exits
+//
+// Without seed files, the mutations start from the seed corpus, built in. Each input is a
+// seed with 1 to 4 mutations: bits flipped, bytes, 16 and 32 bits fields set to values that
+// are often mishandled, ranges inserted, erased or duplicated, and truncations. The same
+// options always give the same inputs. An input failing a check is written to
+// wavfuzz_failure.wav in the current directory.
+//****************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "wavfilereader.h"
+#include "audioformats.h"
+
+#define DEFAULT_NB_RUNS			1000000
+#define DEFAULT_SEED			1
+
+#define MAX_NB_MUTATIONS		4
+
+// Samples are read by blocks of this number of samples per channel, as AudioSource does
+#define NB_BLOCK_SAMPLES		4096
+
+#define FAILURE_FILE_NAME		"wavfuzz_failure.wav"
+
+// Input being read by the mutation loop, written to FAILURE_FILE_NAME when a check fails
+static const std::string* s_CurrentInput = 0;
+
+static void CheckInput(bool condition, const char* message)
+{
+	if (condition)
+	{
+		return;
+	}
+
+	std::cerr << "WavFileReader " << message << std::endl;
+	if (s_CurrentInput)
+	{
+		std::ofstream failureStream(FAILURE_FILE_NAME, std::ios::binary);
+		failureStream.write(s_CurrentInput->data(), static_cast<std::streamsize>(s_CurrentInput->size()));
+		std::cerr << "Input written to " << FAILURE_FILE_NAME << std::endl;
+	}
+
+	abort();
+}
+
+// Returns 1 if the input was read as a WAV file, 0 otherwise. libFuzzer ignores the result.
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size)
+{
+	std::istringstream inputStream(std::string(reinterpret_cast<const char*>(data), size), std::ios::in | std::ios::binary);
+	AudioInfo audioInfo;
+	if (!WavFileReader::ReadFormat(inputStream, audioInfo))
+	{
+		return 0;
+	}
+
+	CheckInput(audioInfo.m_NumChannels && audioInfo.m_SampleRate && audioInfo.m_BitsPerSample == 32, "accepted a format it can't decode");
+
+	// The samples it announces must all be in the input, after the header
+	const std::istringstream::pos_type dataStart = inputStream.tellg();
+	CheckInput(dataStart != std::istringstream::pos_type(-1) && static_cast<size_t>(dataStart) <= size, "lost its position in the input");
+
+	const unsigned long long bytesPerSample = static_cast<unsigned long long>(audioInfo.m_NumChannels) * sizeof(float);
+	CheckInput(audioInfo.m_NbSamples && audioInfo.m_NbSamples * bytesPerSample <= size - static_cast<size_t>(dataStart), "announced samples past the end of the input");
+
+	std::vector<float> samples(static_cast<size_t>(NB_BLOCK_SAMPLES) * audioInfo.m_NumChannels);
+	for (unsigned int firstSampleIndex = 0; firstSampleIndex < audioInfo.m_NbSamples; firstSampleIndex += NB_BLOCK_SAMPLES)
+	{
+		unsigned int nbSamplesToRead = audioInfo.m_NbSamples - firstSampleIndex < NB_BLOCK_SAMPLES ? audioInfo.m_NbSamples - firstSampleIndex : NB_BLOCK_SAMPLES;
+		unsigned int nbSamplesRead = 0;
+		bool samplesRead = WavFileReader::ReadSamples(inputStream, audioInfo, nbSamplesToRead, &samples[0], nbSamplesRead);
+		CheckInput(samplesRead && nbSamplesRead == nbSamplesToRead, "couldn't read the samples it announced");
+	}
+
+	return 1;
+}
+
+#ifndef WAVFUZZ_LIBFUZZER
+
+// Xorshift generator, whose sequence is the same everywhere, unlike rand's
+class MutationGenerator
+{
+private:
+	unsigned int	m_State;
+
+public:
+	explicit MutationGenerator(unsigned int seed) : m_State(seed ? seed : 1) {}
+
+	unsigned int GetNext()
+	{
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 17;
+		m_State ^= m_State << 5;
+		return m_State;
+	}
+
+	// Uniform in [0, nbValues), nbValues must not be 0
+	unsigned int GetNext(unsigned int nbValues) { return GetNext() % nbValues; }
+};
+
+static double GetWallClockTime()
+{
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+//----------------------------------------------------------------------------------------
+// Seed corpus
+
+static void AppendUInt16(std::string& outBytes, unsigned int value)
+{
+	outBytes += static_cast<char>(value & 0xFF);
+	outBytes += static_cast<char>((value >> 8) & 0xFF);
+}
+
+static void AppendUInt32(std::string& outBytes, unsigned int value)
+{
+	AppendUInt16(outBytes, value & 0xFFFF);
+	AppendUInt16(outBytes, value >> 16);
+}
+
+// Appends a chunk whose header gives chunkSize, padded to an even size when data is all there
+static void AppendChunk(std::string& outBytes, const char chunkID[4], const std::string& data, unsigned int chunkSize)
+{
+	outBytes.append(chunkID, 4);
+	AppendUInt32(outBytes, chunkSize);
+	outBytes += data;
+	if ((data.size() & 1) && data.size() == chunkSize)
+	{
+		outBytes += '\0';
+	}
+}
+
+static void AppendChunk(std::string& outBytes, const char chunkID[4], const std::string& data)
+{
+	AppendChunk(outBytes, chunkID, data, static_cast<unsigned int>(data.size()));
+}
+
+// "fmt " chunk data of 32 bits floats. extensionSize is 0 for the 16 bytes base format, 2 for
+// the 18 bytes one with an empty extension, and 24 for WAVE_FORMAT_EXTENSIBLE.
+static std::string GetFormatData(unsigned int sampleRate, unsigned int numChannels, unsigned int extensionSize)
+{
+	std::string data;
+	AppendUInt16(data, extensionSize == 24 ? 0xFFFE : 0x0003);
+	AppendUInt16(data, numChannels);
+	AppendUInt32(data, sampleRate);
+	AppendUInt32(data, sampleRate * numChannels * 4);
+	AppendUInt16(data, numChannels * 4);
+	AppendUInt16(data, 32);
+	if (extensionSize)
+	{
+		AppendUInt16(data, extensionSize - 2);
+	}
+
+	if (extensionSize == 24)
+	{
+		// Valid bits per sample, channel mask and the KSDATAFORMAT_SUBTYPE_IEEE_FLOAT GUID
+		static const unsigned char floatSubFormat[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+		AppendUInt16(data, 32);
+		AppendUInt32(data, numChannels == 2 ? 0x3 : 0x4);
+		data.append(reinterpret_cast<const char*>(floatSubFormat), sizeof(floatSubFormat));
+	}
+
+	return data;
+}
+
+// nbSamples samples per channel of a ramp, interleaved
+static std::string GetSamplesData(unsigned int nbSamples, unsigned int numChannels)
+{
+	std::vector<float> samples(nbSamples * numChannels);
+	for (size_t valueIndex = 0; valueIndex < samples.size(); ++valueIndex)
+	{
+		samples[valueIndex] = static_cast<float>(valueIndex % 64) / 32.0f - 1.0f;
+	}
+
+	return std::string(reinterpret_cast<const char*>(&samples[0]), samples.size() * sizeof(float));
+}
+
+static std::string GetFactData(unsigned int nbSamples)
+{
+	std::string data;
+	AppendUInt32(data, nbSamples);
+	return data;
+}
+
+// RIFF header around chunks, its size being the size of what follows it
+static std::string GetRiffFile(const std::string& chunks)
+{
+	std::string bytes("RIFF");
+	AppendUInt32(bytes, static_cast<unsigned int>(chunks.size() + 4));
+	bytes += "WAVE";
+	bytes += chunks;
+	return bytes;
+}
+
+struct Seed
+{
+	std::string	m_Name;
+	std::string	m_Bytes;
+
+	Seed(const std::string& name, const std::string& bytes) : m_Name(name), m_Bytes(bytes) {}
+};
+
+// Layouts found in real files, each of which the reader must accept
+static void GetSeeds(std::vector<Seed>& outSeeds)
+{
+	const unsigned int nbSamples = 64;
+	std::string chunks;
+
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("mono", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(48000, 2, 0));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 2));
+	outSeeds.push_back(Seed("stereo", GetRiffFile(chunks)));
+
+	// Metadata full of 'd', which used to be taken for the start of the "data" chunk
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "LIST", std::string("INFOIART") + std::string("\x0B\x00\x00\x00", 4) + "dddd data d");
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("list", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "JUNK", std::string(28, '\0'));
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("junk", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 2));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("format18", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(96000, 2, 24));
+	AppendChunk(chunks, "fact", GetFactData(nbSamples));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 2));
+	outSeeds.push_back(Seed("extensible", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("nofact", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "note", "odd");
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1));
+	outSeeds.push_back(Seed("oddchunk", GetRiffFile(chunks)));
+
+	// Interrupted recordings: the data size is larger than the samples written, or was
+	// never filled in
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 1, 0));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 1), nbSamples * 16);
+	outSeeds.push_back(Seed("truncated", GetRiffFile(chunks)));
+
+	chunks.clear();
+	AppendChunk(chunks, "fmt ", GetFormatData(44100, 2, 0));
+	AppendChunk(chunks, "data", GetSamplesData(nbSamples, 2), 0xFFFFFFFF);
+	outSeeds.push_back(Seed("unfinished", GetRiffFile(chunks)));
+}
+
+static bool WriteSeeds(const std::string& directory)
+{
+	std::vector<Seed> seeds;
+	GetSeeds(seeds);
+	for (size_t seedIndex = 0; seedIndex < seeds.size(); ++seedIndex)
+	{
+		const std::string filePath = directory + "/" + seeds[seedIndex].m_Name + ".wav";
+		std::ofstream seedStream(filePath.c_str(), std::ios::binary);
+		seedStream.write(seeds[seedIndex].m_Bytes.data(), static_cast<std::streamsize>(seeds[seedIndex].m_Bytes.size()));
+		if (!seedStream)
+		{
+			std::cerr << "Couldn't write " << filePath << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------------------
+// Mutations
+
+static void Mutate(MutationGenerator& generator, std::string& inOutBytes)
+{
+	static const unsigned int interestingUInt16[] = { 0, 1, 2, 3, 8, 16, 24, 32, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF };
+	static const unsigned int interestingUInt32[] = { 0, 1, 4, 16, 18, 40, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF };
+	static const unsigned char interestingBytes[] = { 0, 1, 0x7F, 0x80, 0xFF, 'd' };
+
+	if (inOutBytes.empty())
+	{
+		inOutBytes.assign(1, static_cast<char>(generator.GetNext(256)));
+		return;
+	}
+
+	const unsigned int size = static_cast<unsigned int>(inOutBytes.size());
+	const unsigned int position = generator.GetNext(size);
+	switch (generator.GetNext(8))
+	{
+	case 0:
+		inOutBytes[position] ^= static_cast<char>(1 << generator.GetNext(8));
+		break;
+
+	case 1:
+		inOutBytes[position] = static_cast<char>(interestingBytes[generator.GetNext(sizeof(interestingBytes))]);
+		break;
+
+	case 2:
+		// Fields of the header are little endian, at even positions
+		if (size >= 2)
+		{
+			std::string value;
+			AppendUInt16(value, interestingUInt16[generator.GetNext(sizeof(interestingUInt16) / sizeof(interestingUInt16[0]))]);
+			inOutBytes.replace(generator.GetNext(size / 2) * 2, 2, value);
+		}
+		break;
+
+	case 3:
+		if (size >= 4)
+		{
+			// Sizes around the size of the input are the most likely to slip through
+			unsigned int valueIndex = generator.GetNext(sizeof(interestingUInt32) / sizeof(interestingUInt32[0]) + 2);
+			unsigned int fieldValue = valueIndex < sizeof(interestingUInt32) / sizeof(interestingUInt32[0]) ? interestingUInt32[valueIndex] : size - 8 + generator.GetNext(17);
+			std::string value;
+			AppendUInt32(value, fieldValue);
+			inOutBytes.replace(generator.GetNext(size / 2 - 1) * 2, 4, value);
+		}
+		break;
+
+	case 4:
+		{
+			std::string insertedBytes;
+			for (unsigned int byteIndex = generator.GetNext(16) + 1; byteIndex; --byteIndex)
+			{
+				insertedBytes += static_cast<char>(generator.GetNext(256));
+			}
+
+			inOutBytes.insert(position, insertedBytes);
+		}
+		break;
+
+	case 5:
+		inOutBytes.erase(position, generator.GetNext(size - position) + 1);
+		break;
+
+	case 6:
+		inOutBytes.insert(generator.GetNext(size + 1), inOutBytes.substr(position, generator.GetNext(size - position) + 1));
+		break;
+
+	default:
+		inOutBytes.resize(position);
+		break;
+	}
+}
+
+static bool ReadSeedFile(const std::string& filePath, std::vector<Seed>& outSeeds)
+{
+	std::ifstream seedStream(filePath.c_str(), std::ios::binary);
+	if (!seedStream)
+	{
+		return false;
+	}
+
+	std::ostringstream bytesStream;
+	bytesStream << seedStream.rdbuf();
+	outSeeds.push_back(Seed(filePath, bytesStream.str()));
+	return true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: wavfuzz [--runs n] [--seed n] [--write-seeds directory] [seed file]..." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int nbRuns = DEFAULT_NB_RUNS;
+	unsigned int seed = DEFAULT_SEED;
+	std::vector<Seed> seeds;
+
+	for (int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		const char* argument = argv[argIndex];
+		if (strncmp(argument, "--", 2))
+		{
+			if (!ReadSeedFile(argument, seeds))
+			{
+				std::cerr << "Couldn't read " << argument << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			continue;
+		}
+
+		if (argIndex + 1 == argc)
+		{
+			std::cerr << "Missing value for option " << argument << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[++argIndex];
+		bool optionOk = false;
+		if (!strcmp(argument, "--runs"))			optionOk = (nbRuns = atoi(value)) > 0;
+		else if (!strcmp(argument, "--seed"))		optionOk = (seed = atoi(value)) > 0;
+		else if (!strcmp(argument, "--write-seeds"))
+		{
+			return WriteSeeds(value) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		if (!optionOk)
+		{
+			std::cerr << "Invalid option " << argument << " " << value << std::endl;
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (seeds.empty())
+	{
+		GetSeeds(seeds);
+	}
+
+	// Seeds are valid files, which must all be read
+	unsigned int nbAcceptedSeeds = 0;
+	for (size_t seedIndex = 0; seedIndex < seeds.size(); ++seedIndex)
+	{
+		const std::string& bytes = seeds[seedIndex].m_Bytes;
+		s_CurrentInput = &bytes;
+		if (LLVMFuzzerTestOneInput(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()))
+		{
+			++nbAcceptedSeeds;
+		}
+		else
+		{
+			std::cerr << "Seed " << seeds[seedIndex].m_Name << " isn't read as a WAV file" << std::endl;
+		}
+	}
+
+	MutationGenerator generator(seed);
+	unsigned int nbAcceptedInputs = 0;
+	unsigned long long nbInputBytes = 0;
+	std::string input;
+	s_CurrentInput = &input;
+
+	double startTime = GetWallClockTime();
+	for (unsigned int runIndex = 0; runIndex < nbRuns; ++runIndex)
+	{
+		input = seeds[generator.GetNext(static_cast<unsigned int>(seeds.size()))].m_Bytes;
+		for (unsigned int mutationIndex = generator.GetNext(MAX_NB_MUTATIONS) + 1; mutationIndex; --mutationIndex)
+		{
+			Mutate(generator, input);
+		}
+
+		nbAcceptedInputs += LLVMFuzzerTestOneInput(reinterpret_cast<const unsigned char*>(input.data()), input.size());
+		nbInputBytes += input.size();
+	}
+
+	double elapsedTime = GetWallClockTime() - startTime;
+
+	printf("%u of %u seeds read, %u of %u mutated inputs accepted, none inconsistent\n",
+		nbAcceptedSeeds, static_cast<unsigned int>(seeds.size()), nbAcceptedInputs, nbRuns);
+	if (elapsedTime > 0.0)
+	{
+		printf("%u inputs, %.1f MB, read in %.2f s (%.0f inputs/s)\n", nbRuns, nbInputBytes / 1048576.0, elapsedTime, nbRuns / elapsedTime);
+	}
+
+	return nbAcceptedSeeds == seeds.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // WAVFUZZ_LIBFUZZER
@@ -0,0 +1,148 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define TRUEPEAKMETER_USE_SSE
+#endif
+
+#include "truepeakmeter.h"
+
+TruePeakMeter::TruePeakMeter()
+	:	m_NbChannels(0),
+		m_OversamplingFactor(1),
+		m_HistoryPosition(0)
+{
+}
+
+void TruePeakMeter::ComputeTaps()
+{
+	// The whole interpolation filter has NB_TAPS_PER_PHASE taps per phase, centered on a tap
+	// of phase 0, which is where the other taps of that phase cross zero
+	const unsigned int nbTapsPerPhase = NB_TAPS_PER_PHASE;
+	const unsigned int nbTaps = nbTapsPerPhase * m_OversamplingFactor;
+	const unsigned int centerTapIndex = nbTaps / 2;
+
+	m_Taps.assign(nbTapsPerPhase * MAX_OVERSAMPLING_FACTOR, 0.0f);
+	for (unsigned int phaseIndex = 0; phaseIndex < m_OversamplingFactor; ++phaseIndex)
+	{
+		double phaseTaps[NB_TAPS_PER_PHASE];
+		double phaseSum = 0.0;
+		for (unsigned int phaseTapIndex = 0; phaseTapIndex < nbTapsPerPhase; ++phaseTapIndex)
+		{
+			unsigned int tapIndex = phaseIndex + phaseTapIndex * m_OversamplingFactor;
+			double x = (static_cast<double>(tapIndex) - centerTapIndex) / m_OversamplingFactor;
+			double sinc = tapIndex == centerTapIndex ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			double window = 0.5 - 0.5 * cos(2.0 * M_PI * tapIndex / nbTaps);
+			phaseTaps[phaseTapIndex] = sinc * window;
+			phaseSum += phaseTaps[phaseTapIndex];
+		}
+
+		// Tap phaseTapIndex applies to the sample phaseTapIndex samples before the newest one,
+		// which is the last of the history
+		for (unsigned int phaseTapIndex = 0; phaseTapIndex < nbTapsPerPhase; ++phaseTapIndex)
+		{
+			unsigned int historyIndex = nbTapsPerPhase - 1 - phaseTapIndex;
+			m_Taps[historyIndex * MAX_OVERSAMPLING_FACTOR + phaseIndex] = static_cast<float>(phaseTaps[phaseTapIndex] / phaseSum);
+		}
+	}
+}
+
+void TruePeakMeter::Reset(const AudioInfo& audioInfo)
+{
+	m_NbChannels = audioInfo.m_NumChannels;
+	m_OversamplingFactor = audioInfo.m_SampleRate < 96000 ? 4 : (audioInfo.m_SampleRate < 192000 ? 2 : 1);
+	ComputeTaps();
+
+	m_Histories.assign(static_cast<size_t>(m_NbChannels) * 2 * NB_TAPS_PER_PHASE, 0.0f);
+	m_HistoryPosition = 0;
+	m_PhasePeaks.assign(static_cast<size_t>(m_NbChannels) * MAX_OVERSAMPLING_FACTOR, 0.0f);
+	m_SamplePeaks.assign(m_NbChannels, 0.0f);
+	m_TruePeaks.assign(m_NbChannels, 0.0f);
+}
+
+// The SSE and plain versions add the products in the same order and give the same peaks
+void TruePeakMeter::ProcessSample(unsigned int channelIndex, float sample)
+{
+	const unsigned int nbTapsPerPhase = NB_TAPS_PER_PHASE;
+	float* history = &m_Histories[channelIndex * 2 * nbTapsPerPhase];
+	history[m_HistoryPosition] = sample;
+	history[m_HistoryPosition + nbTapsPerPhase] = sample;
+
+	// The sample just stored is the newest one, the last of the window
+	const float* window = history + m_HistoryPosition + 1;
+	const float* taps = &m_Taps[0];
+	float* phasePeaks = &m_PhasePeaks[channelIndex * MAX_OVERSAMPLING_FACTOR];
+
+#if defined(TRUEPEAKMETER_USE_SSE)
+	__m128 interpolated = _mm_setzero_ps();
+	for (unsigned int historyIndex = 0; historyIndex < nbTapsPerPhase; ++historyIndex)
+	{
+		interpolated = _mm_add_ps(interpolated, _mm_mul_ps(_mm_set1_ps(window[historyIndex]), _mm_loadu_ps(taps + historyIndex * MAX_OVERSAMPLING_FACTOR)));
+	}
+
+	// Clearing the sign bits gives the absolute values
+	interpolated = _mm_andnot_ps(_mm_set1_ps(-0.0f), interpolated);
+	_mm_storeu_ps(phasePeaks, _mm_max_ps(_mm_loadu_ps(phasePeaks), interpolated));
+#else
+	float interpolated[MAX_OVERSAMPLING_FACTOR] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int historyIndex = 0; historyIndex < nbTapsPerPhase; ++historyIndex)
+	{
+		for (unsigned int phaseIndex = 0; phaseIndex < MAX_OVERSAMPLING_FACTOR; ++phaseIndex)
+		{
+			interpolated[phaseIndex] += window[historyIndex] * taps[historyIndex * MAX_OVERSAMPLING_FACTOR + phaseIndex];
+		}
+	}
+
+	for (unsigned int phaseIndex = 0; phaseIndex < MAX_OVERSAMPLING_FACTOR; ++phaseIndex)
+	{
+		phasePeaks[phaseIndex] = std::max(phasePeaks[phaseIndex], fabsf(interpolated[phaseIndex]));
+	}
+#endif
+
+	m_SamplePeaks[channelIndex] = std::max(m_SamplePeaks[channelIndex], fabsf(sample));
+}
+
+void TruePeakMeter::Process(const float* interleavedSamples, const float* /*monoSamples*/, unsigned int nbFrames)
+{
+	for (unsigned int frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+	{
+		for (unsigned int channelIndex = 0; channelIndex < m_NbChannels; ++channelIndex)
+		{
+			ProcessSample(channelIndex, *interleavedSamples++);
+		}
+
+		m_HistoryPosition = m_HistoryPosition + 1 < NB_TAPS_PER_PHASE ? m_HistoryPosition + 1 : 0;
+	}
+}
+
+void TruePeakMeter::Finish()
+{
+	// Flushes the last samples out of the interpolator
+	for (unsigned int frameIndex = 0; frameIndex < NB_TAPS_PER_PHASE; ++frameIndex)
+	{
+		for (unsigned int channelIndex = 0; channelIndex < m_NbChannels; ++channelIndex)
+		{
+			ProcessSample(channelIndex, 0.0f);
+		}
+
+		m_HistoryPosition = m_HistoryPosition + 1 < NB_TAPS_PER_PHASE ? m_HistoryPosition + 1 : 0;
+	}
+
+	for (unsigned int channelIndex = 0; channelIndex < m_NbChannels; ++channelIndex)
+	{
+		const float* phasePeaks = &m_PhasePeaks[channelIndex * MAX_OVERSAMPLING_FACTOR];
+		m_TruePeaks[channelIndex] = *std::max_element(phasePeaks, phasePeaks + MAX_OVERSAMPLING_FACTOR);
+	}
+}
+
+float TruePeakMeter::GetSamplePeak() const
+{
+	return m_SamplePeaks.empty() ? 0.0f : *std::max_element(m_SamplePeaks.begin(), m_SamplePeaks.end());
+}
+
+float TruePeakMeter::GetTruePeak() const
+{
+	return m_TruePeaks.empty() ? 0.0f : *std::max_element(m_TruePeaks.begin(), m_TruePeaks.end());
+}
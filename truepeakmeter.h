@@ -0,0 +1,65 @@
+#ifndef TRUEPEAKMETER_H_
+#define TRUEPEAKMETER_H_
+
+#include <vector>
+
+#include "analysisgraph.h"
+
+/**
+ *	A TruePeakMeter measures the maximum absolute value of each channel of a clip, both of its
+ *	samples and of the signal between them, its true peak, as in ITU-R BS.1770 annex 2.
+ *	The signal is oversampled 4 times below 96 kHz, twice below 192 kHz, with a polyphase
+ *	interpolator of NB_TAPS_PER_PHASE taps per phase: a Hann windowed sinc, normalized so that
+ *	each phase has a unity gain at DC. One of the phases is the samples themselves, so the true
+ *	peak is never below the sample peak.
+ *	All the phases of a sample are computed at once, as the 4 lanes of an SSE register.
+ */
+class TruePeakMeter : public FeatureExtractor
+{
+public:
+	static const unsigned int NB_TAPS_PER_PHASE = 12;
+	static const unsigned int MAX_OVERSAMPLING_FACTOR = 4;
+
+	TruePeakMeter();
+
+	virtual void Reset(const AudioInfo& audioInfo);
+	virtual void Process(const float* interleavedSamples, const float* monoSamples, unsigned int nbFrames);
+	virtual void Finish();
+
+	unsigned int GetNbChannels() const { return m_NbChannels; }
+
+	// Linear values, 1.0 is full scale, once the extractor is finished. Without a channel index,
+	// the maximum of all channels.
+	float GetSamplePeak(unsigned int channelIndex) const { return m_SamplePeaks[channelIndex]; }
+	float GetTruePeak(unsigned int channelIndex) const { return m_TruePeaks[channelIndex]; }
+	float GetSamplePeak() const;
+	float GetTruePeak() const;
+
+	unsigned int GetOversamplingFactor() const { return m_OversamplingFactor; }
+
+private:
+	unsigned int		m_NbChannels;
+	unsigned int		m_OversamplingFactor;
+
+	// MAX_OVERSAMPLING_FACTOR taps, one per phase, for each of the NB_TAPS_PER_PHASE samples
+	// of the history, from the oldest one. Phases past the oversampling factor are 0.
+	std::vector<float>	m_Taps;
+
+	// Last NB_TAPS_PER_PHASE samples of each channel, stored twice in a row so that they can be
+	// read as a contiguous array from any position
+	std::vector<float>	m_Histories;
+	unsigned int		m_HistoryPosition;
+
+	// Peaks of each phase of each channel, MAX_OVERSAMPLING_FACTOR per channel, which give
+	// the true peaks when the extractor is finished
+	std::vector<float>	m_PhasePeaks;
+	std::vector<float>	m_SamplePeaks;
+	std::vector<float>	m_TruePeaks;
+
+	void ComputeTaps();
+
+	// Adds the next sample of a channel to its history and updates its peaks
+	void ProcessSample(unsigned int channelIndex, float sample);
+};
+
+#endif // TRUEPEAKMETER_H_
@@ -0,0 +1,57 @@
+#include "wavaudiosource.h"
+#include "wavfilereader.h"
+
+WavAudioSource::WavAudioSource()
+	:	m_DataOffset(0)
+{
+}
+
+bool WavAudioSource::Open(const std::string& filePath)
+{
+	Close();
+
+	m_InputStream.open(filePath.c_str(), std::ifstream::in | std::ios::binary);
+	if (!m_InputStream)
+	{
+		return false;
+	}
+
+	// The format ends with the header of the data chunk, samples start right after it
+	if (!WavFileReader::ReadFormat(m_InputStream, m_AudioInfo) || m_AudioInfo.m_BitsPerSample != 32)
+	{
+		Close();
+		return false;
+	}
+
+	m_DataOffset = m_InputStream.tellg();
+	return true;
+}
+
+void WavAudioSource::Close()
+{
+	if (m_InputStream.is_open())
+	{
+		m_InputStream.close();
+	}
+
+	m_InputStream.clear();
+	m_AudioInfo = AudioInfo();
+	m_DataOffset = 0;
+}
+
+bool WavAudioSource::ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples)
+{
+	if (!m_InputStream.is_open() || !outSamples || firstSampleIndex >= endSampleIndex || endSampleIndex > m_AudioInfo.m_NbSamples)
+	{
+		return false;
+	}
+
+	std::streamoff bytesPerSample = static_cast<std::streamoff>(m_AudioInfo.m_NumChannels) * (m_AudioInfo.m_BitsPerSample / 8);
+
+	// A previous read may have hit the end of a truncated file
+	m_InputStream.clear();
+	m_InputStream.seekg(m_DataOffset + firstSampleIndex * bytesPerSample);
+	m_InputStream.read(reinterpret_cast<char*>(outSamples), static_cast<std::streamsize>((endSampleIndex - firstSampleIndex) * bytesPerSample));
+
+	return m_InputStream.good();
+}
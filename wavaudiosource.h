@@ -0,0 +1,36 @@
+#ifndef WAVAUDIOSOURCE_H_
+#define WAVAUDIOSOURCE_H_
+
+#include <fstream>
+
+#include "audiosource.h"
+
+/**
+ *	A WavAudioSource reads a WAV file. Samples are stored uncompressed one after the other in
+ *	the data chunk, so the position of any sample in the file is computed directly from the
+ *	position of the data chunk, and reading a range is a single seek and a single read.
+ */
+class WavAudioSource : public AudioSource
+{
+private:
+	std::ifstream	m_InputStream;
+	AudioInfo		m_AudioInfo;
+
+	// Position of the first sample in the file
+	std::streamoff	m_DataOffset;
+
+	// Sources own their file stream, they can't be copied
+	WavAudioSource(const WavAudioSource&);
+	WavAudioSource& operator=(const WavAudioSource&);
+
+public:
+	WavAudioSource();
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	virtual const AudioInfo& GetAudioInfo() const { return m_AudioInfo; }
+	virtual bool ReadRange(unsigned int firstSampleIndex, unsigned int endSampleIndex, float* outSamples);
+};
+
+#endif // WAVAUDIOSOURCE_H_
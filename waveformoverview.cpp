@@ -0,0 +1,275 @@
+#include <cmath>
+#include <algorithm>
+
+#include "waveformoverview.h"
+
+// std::min takes its arguments by reference, which needs the constant defined
+const unsigned int WaveformOverview::BASE_BIN_SIZE;
+
+static short QuantizeSample(float value)
+{
+	if (value >= 1.0f)
+	{
+		return 32767;
+	}
+
+	if (value <= -1.0f)
+	{
+		return -32767;
+	}
+
+	return static_cast<short>(floor(value * 32767.0f + 0.5f));
+}
+
+static unsigned short QuantizeRms(double value)
+{
+	if (value >= 1.0)
+	{
+		return 65535;
+	}
+
+	return static_cast<unsigned short>(floor(value * 65535.0 + 0.5));
+}
+
+WaveformOverview::WaveformOverview()
+{
+	Reset(0);
+}
+
+void WaveformOverview::Reset(unsigned int sampleRate)
+{
+	m_SampleRate = sampleRate;
+	m_Levels.assign(1, std::vector<Bin>());
+
+	m_CurrentMin			= 0.0f;
+	m_CurrentMax			= 0.0f;
+	m_CurrentSumOfSquares	= 0.0;
+	m_CurrentNbSamples		= 0;
+}
+
+void WaveformOverview::Process(const float* samples, unsigned int nbSamples)
+{
+	for (unsigned int sampleIndex = 0; sampleIndex < nbSamples; ++sampleIndex)
+	{
+		float sample = samples[sampleIndex];
+		if (!m_CurrentNbSamples)
+		{
+			m_CurrentMin = sample;
+			m_CurrentMax = sample;
+		}
+		else
+		{
+			m_CurrentMin = std::min(m_CurrentMin, sample);
+			m_CurrentMax = std::max(m_CurrentMax, sample);
+		}
+
+		m_CurrentSumOfSquares += static_cast<double>(sample) * sample;
+
+		if (++m_CurrentNbSamples == BASE_BIN_SIZE)
+		{
+			FlushCurrentBin();
+			CombineBins(0, LEVEL_FACTOR);
+		}
+	}
+}
+
+void WaveformOverview::Finish()
+{
+	if (m_CurrentNbSamples)
+	{
+		FlushCurrentBin();
+	}
+
+	CombineBins(0, 1);
+}
+
+void WaveformOverview::FlushCurrentBin()
+{
+	Bin bin;
+	bin.m_Min	= QuantizeSample(m_CurrentMin);
+	bin.m_Max	= QuantizeSample(m_CurrentMax);
+	bin.m_Rms	= QuantizeRms(sqrt(m_CurrentSumOfSquares / m_CurrentNbSamples));
+	m_Levels[0].push_back(bin);
+
+	m_CurrentSumOfSquares	= 0.0;
+	m_CurrentNbSamples		= 0;
+}
+
+void WaveformOverview::CombineBins(unsigned int levelIndex, unsigned int minNbBins)
+{
+	if (m_Levels[levelIndex].size() <= 1)
+	{
+		return;
+	}
+
+	if (levelIndex + 1 == m_Levels.size())
+	{
+		m_Levels.push_back(std::vector<Bin>());
+	}
+
+	std::vector<Bin>& level = m_Levels[levelIndex];
+	std::vector<Bin>& nextLevel = m_Levels[levelIndex + 1];
+
+	size_t firstBinIndex = nextLevel.size() * LEVEL_FACTOR;
+	while (firstBinIndex < level.size() && level.size() - firstBinIndex >= minNbBins)
+	{
+		size_t endBinIndex = std::min(firstBinIndex + LEVEL_FACTOR, level.size());
+		nextLevel.push_back(CombineBinRange(level, firstBinIndex, endBinIndex));
+
+		firstBinIndex = endBinIndex;
+	}
+
+	CombineBins(levelIndex + 1, minNbBins);
+}
+
+WaveformOverview::Bin WaveformOverview::CombineBinRange(const std::vector<Bin>& level, size_t firstBinIndex, size_t endBinIndex)
+{
+	Bin combinedBin = level[firstBinIndex];
+	double sumOfSquares = 0.0;
+	for (size_t binIndex = firstBinIndex; binIndex < endBinIndex; ++binIndex)
+	{
+		combinedBin.m_Min = std::min(combinedBin.m_Min, level[binIndex].m_Min);
+		combinedBin.m_Max = std::max(combinedBin.m_Max, level[binIndex].m_Max);
+
+		double rms = level[binIndex].m_Rms / 65535.0;
+		sumOfSquares += rms * rms;
+	}
+
+	combinedBin.m_Rms = QuantizeRms(sqrt(sumOfSquares / (endBinIndex - firstBinIndex)));
+	return combinedBin;
+}
+
+bool WaveformOverview::Update(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples)
+{
+	if (firstSampleIndex % BASE_BIN_SIZE || !nbSamples)
+	{
+		return false;
+	}
+
+	size_t firstBinIndex = firstSampleIndex / BASE_BIN_SIZE;
+	size_t endBinIndex = std::min(firstBinIndex + (nbSamples + BASE_BIN_SIZE - 1) / BASE_BIN_SIZE, m_Levels[0].size());
+	if (firstBinIndex >= endBinIndex)
+	{
+		return false;
+	}
+
+	// Recompute the bins of level 0 from the samples...
+	for (size_t binIndex = firstBinIndex; binIndex < endBinIndex; ++binIndex)
+	{
+		const float* binSamples = samples + (binIndex - firstBinIndex) * BASE_BIN_SIZE;
+		unsigned int nbBinSamples = std::min(BASE_BIN_SIZE, static_cast<unsigned int>(nbSamples - (binIndex - firstBinIndex) * BASE_BIN_SIZE));
+
+		m_CurrentMin			= binSamples[0];
+		m_CurrentMax			= binSamples[0];
+		m_CurrentSumOfSquares	= 0.0;
+		for (unsigned int sampleIndex = 0; sampleIndex < nbBinSamples; ++sampleIndex)
+		{
+			m_CurrentMin = std::min(m_CurrentMin, binSamples[sampleIndex]);
+			m_CurrentMax = std::max(m_CurrentMax, binSamples[sampleIndex]);
+			m_CurrentSumOfSquares += static_cast<double>(binSamples[sampleIndex]) * binSamples[sampleIndex];
+		}
+
+		m_CurrentNbSamples = nbBinSamples;
+		FlushCurrentBin();
+
+		// FlushCurrentBin appends, move the new bin where it belongs
+		m_Levels[0][binIndex] = m_Levels[0].back();
+		m_Levels[0].pop_back();
+	}
+
+	// ... then the bins of the next levels covering them
+	for (unsigned int levelIndex = 1; levelIndex < m_Levels.size(); ++levelIndex)
+	{
+		const std::vector<Bin>& previousLevel = m_Levels[levelIndex - 1];
+		std::vector<Bin>& level = m_Levels[levelIndex];
+
+		firstBinIndex = firstBinIndex / LEVEL_FACTOR;
+		endBinIndex = std::min((endBinIndex + LEVEL_FACTOR - 1) / LEVEL_FACTOR, level.size());
+		for (size_t binIndex = firstBinIndex; binIndex < endBinIndex; ++binIndex)
+		{
+			size_t firstPreviousBinIndex = binIndex * LEVEL_FACTOR;
+			level[binIndex] = CombineBinRange(previousLevel, firstPreviousBinIndex, std::min(firstPreviousBinIndex + LEVEL_FACTOR, previousLevel.size()));
+		}
+	}
+
+	return true;
+}
+
+SamplePosition WaveformOverview::GetBinSize(unsigned int levelIndex) const
+{
+	SamplePosition binSize = BASE_BIN_SIZE;
+	for (unsigned int level = 0; level < levelIndex; ++level)
+	{
+		binSize *= LEVEL_FACTOR;
+	}
+
+	return binSize;
+}
+
+size_t WaveformOverview::GetSize() const
+{
+	size_t size = 0;
+	for (unsigned int levelIndex = 0; levelIndex < m_Levels.size(); ++levelIndex)
+	{
+		size += m_Levels[levelIndex].size() * sizeof(Bin);
+	}
+
+	return size;
+}
+
+bool WaveformOverview::GetColumns(double startTime, double endTime, unsigned int nbColumns, std::vector<Column>& outColumns) const
+{
+	outColumns.clear();
+	if (!m_SampleRate || IsEmpty() || startTime < 0.0 || endTime <= startTime || !nbColumns)
+	{
+		return false;
+	}
+
+	double startSample = startTime * m_SampleRate;
+	double samplesPerColumn = (endTime - startTime) * m_SampleRate / nbColumns;
+
+	unsigned int levelIndex = 0;
+	while (levelIndex + 1 < m_Levels.size() && GetBinSize(levelIndex + 1) <= samplesPerColumn)
+	{
+		++levelIndex;
+	}
+
+	const std::vector<Bin>& level = m_Levels[levelIndex];
+	double binSize = static_cast<double>(GetBinSize(levelIndex));
+
+	outColumns.resize(nbColumns);
+	for (unsigned int columnIndex = 0; columnIndex < nbColumns; ++columnIndex)
+	{
+		double columnStartSample = startSample + columnIndex * samplesPerColumn;
+		size_t firstBinIndex = static_cast<size_t>(columnStartSample / binSize);
+		size_t endBinIndex = static_cast<size_t>(ceil((columnStartSample + samplesPerColumn) / binSize));
+		endBinIndex = std::min(std::max(endBinIndex, firstBinIndex + 1), level.size());
+
+		Column& column = outColumns[columnIndex];
+		column.m_Min = 0.0f;
+		column.m_Max = 0.0f;
+		column.m_Rms = 0.0f;
+		if (firstBinIndex >= endBinIndex)
+		{
+			continue;
+		}
+
+		short minValue = level[firstBinIndex].m_Min;
+		short maxValue = level[firstBinIndex].m_Max;
+		double sumOfSquares = 0.0;
+		for (size_t binIndex = firstBinIndex; binIndex < endBinIndex; ++binIndex)
+		{
+			minValue = std::min(minValue, level[binIndex].m_Min);
+			maxValue = std::max(maxValue, level[binIndex].m_Max);
+
+			double rms = level[binIndex].m_Rms / 65535.0;
+			sumOfSquares += rms * rms;
+		}
+
+		column.m_Min = minValue / 32767.0f;
+		column.m_Max = maxValue / 32767.0f;
+		column.m_Rms = static_cast<float>(sqrt(sumOfSquares / (endBinIndex - firstBinIndex)));
+	}
+
+	return true;
+}
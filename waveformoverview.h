@@ -0,0 +1,94 @@
+#ifndef WAVEFORMOVERVIEW_H_
+#define WAVEFORMOVERVIEW_H_
+
+#include <vector>
+
+#include "audioformats.h"
+
+/**
+ *	A WaveformOverview summarizes the samples of a clip for display, as a pyramid of levels
+ *	of bins. Each bin of level 0 covers BASE_BIN_SIZE samples, and each bin of the next levels
+ *	covers LEVEL_FACTOR bins of the previous one: 256, 1024, 4096... samples per bin. Levels are
+ *	added until a single bin covers the whole clip, so that any view of it finds a level with
+ *	about one bin per column.
+ *	Bins hold the minimum, maximum and RMS value of the samples they cover, quantized on 16
+ *	bits. That's 6 bytes per bin, about 2% of the size of the float samples for all levels.
+ *	The overview is built incrementally while the samples are read, in a single pass.
+ */
+class WaveformOverview
+{
+public:
+	static const unsigned int BASE_BIN_SIZE	= 256;
+	static const unsigned int LEVEL_FACTOR	= 4;
+
+	struct Bin
+	{
+		short			m_Min;
+		short			m_Max;
+		unsigned short	m_Rms;
+	};
+
+	// One column of a view of the overview, values are in [-1.0, 1.0]
+	struct Column
+	{
+		float	m_Min;
+		float	m_Max;
+		float	m_Rms;
+	};
+
+	WaveformOverview();
+
+	// Empties the overview and prepares it to be built from samples at sampleRate
+	void Reset(unsigned int sampleRate);
+
+	// Adds the next nbSamples samples of the clip
+	void Process(const float* samples, unsigned int nbSamples);
+
+	// Flushes the last, partial, bins. Must be called once all samples have been added.
+	void Finish();
+
+	bool IsEmpty() const { return m_Levels[0].empty(); }
+
+	// Recomputes the bins covering nbSamples samples starting at firstSampleIndex, after they
+	// were edited. firstSampleIndex must be a multiple of BASE_BIN_SIZE, and so must nbSamples
+	// unless the samples go up to the end of the clip. The length of the clip can't change.
+	bool Update(unsigned int firstSampleIndex, const float* samples, unsigned int nbSamples);
+
+	// Summarizes the time range [startTime, endTime), in seconds, in nbColumns columns,
+	// using the coarsest level that still has at least one bin per column. Each column then
+	// combines at most LEVEL_FACTOR + 1 bins, so the cost is proportional to nbColumns, not
+	// to the length of the time range.
+	// Columns located after the end of the clip are silent.
+	bool GetColumns(double startTime, double endTime, unsigned int nbColumns, std::vector<Column>& outColumns) const;
+
+	// Number of bytes used by the bins of all levels
+	size_t GetSize() const;
+
+	unsigned int GetNbLevels() const { return static_cast<unsigned int>(m_Levels.size()); }
+	SamplePosition GetBinSize(unsigned int levelIndex) const;
+	const std::vector<Bin>& GetLevel(unsigned int levelIndex) const { return m_Levels[levelIndex]; }
+
+private:
+	unsigned int					m_SampleRate;
+
+	// Level 0 always exists, the next ones are added as the previous one grows
+	std::vector<std::vector<Bin> >	m_Levels;
+
+	// Bin of level 0 being accumulated
+	float				m_CurrentMin;
+	float				m_CurrentMax;
+	double				m_CurrentSumOfSquares;
+	unsigned int		m_CurrentNbSamples;
+
+	void FlushCurrentBin();
+
+	// Combines the bins [firstBinIndex, endBinIndex) of a level in a single bin
+	static Bin CombineBinRange(const std::vector<Bin>& level, size_t firstBinIndex, size_t endBinIndex);
+
+	// Combines the bins of levelIndex that aren't covered by a bin of the next level yet, as
+	// long as there are at least minNbBins of them. The next level is added when levelIndex
+	// holds more than one bin.
+	void CombineBins(unsigned int levelIndex, unsigned int minNbBins);
+};
+
+#endif // WAVEFORMOVERVIEW_H_
@@ -1,10 +1,16 @@
 #include <fstream>
 #include <iostream>
+#include <cstring>
 
 #include "wavfilereader.h"
 #include "audioformats.h"
 
-#define WAV_FORMAT_CODE_IEEE_FLOAT 0x0003
+#define WAV_FORMAT_CODE_IEEE_FLOAT			0x0003
+#define WAV_FORMAT_CODE_EXTENSIBLE			0xFFFE
+
+// Sizes of the "fmt " chunk, for the base format and for WAVE_FORMAT_EXTENSIBLE
+#define WAV_FORMAT_CHUNK_MIN_SIZE			16
+#define WAV_FORMAT_CHUNK_EXTENSIBLE_SIZE	40
 
 bool WavFileReader::ReadFormat(std::istream& inputStream, AudioInfo& outAudioInfo)
 {   
@@ -28,15 +34,36 @@ bool WavFileReader::ReadSamples(std::istream& inputStream,  const AudioInfo& aud
 		return false;
 	}
 	
-	inputStream.read(reinterpret_cast<char*>(outSamples), nbSamplesToRead * (audioInfo.m_BitsPerSample / 8));
-		
-	if (!inputStream && (inputStream.gcount() / (audioInfo.m_BitsPerSample / 8)) != audioInfo.m_NbSamples)
-	{		
+	// Samples of all channels are interleaved
+	std::streamsize bytesPerSample = static_cast<std::streamsize>(audioInfo.m_NumChannels) * (audioInfo.m_BitsPerSample / 8);
+	if (!bytesPerSample || nbSamplesToRead > audioInfo.m_NbSamples)
+	{
 		return false;
 	}
 
-	outNbSamplesRead = nbSamplesToRead;
-	return true;
+	inputStream.read(reinterpret_cast<char*>(outSamples), nbSamplesToRead * bytesPerSample);
+
+	outNbSamplesRead = static_cast<unsigned int>(inputStream.gcount() / bytesPerSample);
+	return outNbSamplesRead == nbSamplesToRead;
+}
+
+bool WavFileReader::ReadFile(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples)
+{
+    std::ifstream wavInputStream(filePath.c_str(), std::ifstream::in | std::ios::binary);
+    if (!wavInputStream || !ReadFormat(wavInputStream, outAudioInfo))
+    {
+        return false;
+    }
+
+    outSamples.resize(static_cast<size_t>(outAudioInfo.m_NbSamples) * outAudioInfo.m_NumChannels);
+
+    unsigned int nbSamplesRead = 0;
+    if (outAudioInfo.m_NbSamples && !ReadSamples(wavInputStream, outAudioInfo, outAudioInfo.m_NbSamples, &outSamples[0], nbSamplesRead))
+    {
+        return false;
+    }
+
+    return true;
 }
 
 bool WavFileReader::CheckFirstFormatBlock(std::istream& inputStream)
@@ -81,187 +108,140 @@ bool WavFileReader::CheckFirstFormatBlock(std::istream& inputStream)
     return true;
 }
 
-bool WavFileReader::CheckAudioFormatBlock(std::istream& inputStream, AudioInfo& outAudioInfo)
+bool WavFileReader::ReadChunkHeader(std::istream& inputStream, char outChunkID[5], unsigned int& outChunkSize)
 {
-    if (!inputStream)
-    {
-        return false;
-    }
+    inputStream.read(outChunkID, 4);
+    outChunkID[4] = '\0';
+    inputStream.read(reinterpret_cast<char*>(&outChunkSize), 4);
 
-    char fromatBlockIDBuff[5];
-    inputStream.read(fromatBlockIDBuff, 4);
-    fromatBlockIDBuff[4] = '\0';
-    if (strcmp(fromatBlockIDBuff, "fmt "))
-    {
-        return false;
-    }
-
-    if (!inputStream)
-    {
-        return false;
-    }
+    return inputStream.good();
+}
 
-    unsigned int blockSize = 0;
-    inputStream.read(reinterpret_cast<char*>(&blockSize), 4);
-    if (blockSize != 0x10)
-    {
-        return false;
-    }
+bool WavFileReader::SkipChunkData(std::istream& inputStream, std::streamoff nbBytesToSkip)
+{
+    // Large chunks of metadata are skipped without reading them
+    inputStream.seekg(nbBytesToSkip, std::ios::cur);
+    return inputStream.good();
+}
 
-    if (!inputStream)
+bool WavFileReader::CheckFormatChunk(std::istream& inputStream, unsigned int chunkSize, AudioInfo& outAudioInfo)
+{
+    if (chunkSize < WAV_FORMAT_CHUNK_MIN_SIZE)
     {
         return false;
     }
 
-
     unsigned short audioFormat = 0;
+    unsigned int bytesPerSec = 0;
+    unsigned short bytesPerBlock = 0;
     inputStream.read(reinterpret_cast<char*>(&audioFormat), 2);
-    if (audioFormat != WAV_FORMAT_CODE_IEEE_FLOAT)
-    {
-        // we currently support only floating point samples in our 
-        // beat detection code
-        return false;
-    }
-
-
-    if (!inputStream)
-    {
-        return false;
-    }
-
     inputStream.read(reinterpret_cast<char*>(&outAudioInfo.m_NumChannels), 2);
-    if (outAudioInfo.m_NumChannels == 0)
-    {
-        return false;
-    }    
-
-    if (!inputStream)
-    {
-        return false;
-    }
-    
     inputStream.read(reinterpret_cast<char*>(&outAudioInfo.m_SampleRate), 4);
-    if (outAudioInfo.m_SampleRate == 0)
-    {
-        return false;
-    }
-
+    inputStream.read(reinterpret_cast<char*>(&bytesPerSec), 4);
+    inputStream.read(reinterpret_cast<char*>(&bytesPerBlock), 2);
+    inputStream.read(reinterpret_cast<char*>(&outAudioInfo.m_BitsPerSample), 2);
     if (!inputStream)
     {
         return false;
     }
 
-    unsigned int bytesPerSec = 0;
-    inputStream.read(reinterpret_cast<char*>(&bytesPerSec), 4);
-    if (bytesPerSec == 0)
+    unsigned int nbBytesRead = WAV_FORMAT_CHUNK_MIN_SIZE;
+    if (audioFormat == WAV_FORMAT_CODE_EXTENSIBLE && chunkSize >= WAV_FORMAT_CHUNK_EXTENSIBLE_SIZE)
     {
-        return false;
-    }
+        // The actual format is given by the first 2 bytes of the sub format GUID, after the
+        // extension size, the valid bits per sample and the channel mask
+        char extension[10];
+        inputStream.read(extension, sizeof(extension));
+        if (!inputStream)
+        {
+            return false;
+        }
 
-    if (!inputStream)
-    {
-        return false;
+        memcpy(&audioFormat, extension + 8, 2);
+        nbBytesRead += sizeof(extension);
     }
 
-    unsigned short bytesPerBlock = 0;
-    inputStream.read(reinterpret_cast<char*>(&bytesPerBlock), 2);
-    if (bytesPerBlock == 0)
+    if (audioFormat != WAV_FORMAT_CODE_IEEE_FLOAT)
     {
+        // we currently support only floating point samples in our 
+        // beat detection code
         return false;
     }
 
-    if (!inputStream)
-    {
-        return false;
-    }
-    
-    inputStream.read(reinterpret_cast<char*>(&outAudioInfo.m_BitsPerSample), 2);
-    if (outAudioInfo.m_BitsPerSample    != 8    && 
-        outAudioInfo.m_BitsPerSample    != 16   && 
-        outAudioInfo.m_BitsPerSample    != 24   && 
-        outAudioInfo.m_BitsPerSample    != 32)
+    // Samples are 32 bits floats, and every other field must agree with the size of a sample:
+    // they are used to compute the number of samples and their positions in the file
+    if (outAudioInfo.m_NumChannels == 0 || outAudioInfo.m_SampleRate == 0 || bytesPerSec == 0 || outAudioInfo.m_BitsPerSample != 32)
     {
         return false;
     }
 
-    if (!inputStream)
+    if (bytesPerBlock != outAudioInfo.m_NumChannels * (outAudioInfo.m_BitsPerSample / 8))
     {
         return false;
     }
 
+    return SkipChunkData(inputStream, static_cast<std::streamoff>(chunkSize) - nbBytesRead + (chunkSize & 1));
+}
 
-    char factIDBuff[5];
-    inputStream.read(factIDBuff, 4);
-    factIDBuff[4] = '\0';
-    if (strcmp(factIDBuff, "fact"))
-    {
-        return false;
-    }
-
+bool WavFileReader::CheckAudioFormatBlock(std::istream& inputStream, AudioInfo& outAudioInfo)
+{
     if (!inputStream)
     {
         return false;
     }
 
+    // Chunks are walked using their size, chunks other than "fmt " and "data" (such as "fact", 
+    // "LIST" or "JUNK") are skipped, whatever their content
+    bool formatChunkFound = false;
+    char chunkID[5];
     unsigned int chunkSize = 0;
-    inputStream.read(reinterpret_cast<char*>(&chunkSize), 4);
-    if (chunkSize < 4)
+    while (ReadChunkHeader(inputStream, chunkID, chunkSize))
     {
-        return false;
-    }
+        if (!strcmp(chunkID, "fmt "))
+        {
+            if (formatChunkFound || !CheckFormatChunk(inputStream, chunkSize, outAudioInfo))
+            {
+                return false;
+            }
 
-    if (!inputStream)
-    {
-        return false;
+            formatChunkFound = true;
+        }
+        else if (!strcmp(chunkID, "data"))
+        {
+            break;
+        }
+        else if (!SkipChunkData(inputStream, static_cast<std::streamoff>(chunkSize) + (chunkSize & 1)))
+        {
+            return false;
+        }
     }
 
-    unsigned int nbSamplesPerChannel = 0;
-    inputStream.read(reinterpret_cast<char*>(&nbSamplesPerChannel), 4);
-    if (nbSamplesPerChannel == 0)
+    if (!inputStream || !formatChunkFound)
     {
         return false;
     }
 
-    if (!inputStream)
-    {
-        return false;
-    }
-
-    // Skipping bytes until we get to the start of the "data" ID,
-    // where data starts. We don't care about the rest of the metadata for now
-    char c = inputStream.peek();
-    while (inputStream && c != 'd')
-    {
-        inputStream.ignore();
-        c = inputStream.peek();        
-    }    
-    
-    if (!inputStream)
-    {
-        return false;
-    }    
-    
-    char dataIDBuff[5];
-    inputStream.read(dataIDBuff, 4);
-    dataIDBuff[4] = '\0';
-    if (strcmp(dataIDBuff, "data"))
-    {
-        return false;
-    }
+    unsigned int bytesPerSample = outAudioInfo.m_NumChannels * (outAudioInfo.m_BitsPerSample / 8);
+    outAudioInfo.m_NbSamples = chunkSize / bytesPerSample;
 
-    if (!inputStream)
+    // Files whose recording was interrupted have a data size larger than the actual data, or 
+    // left to 0xFFFFFFFF. Only the samples actually found in the file are read.
+    std::streampos dataStart = inputStream.tellg();
+    if (dataStart != std::streampos(-1))
     {
-        return false;
-    }
+        inputStream.seekg(0, std::ios::end);
+        std::streamoff nbAvailableBytes = inputStream.tellg() - dataStart;
+        inputStream.seekg(dataStart);
+        if (!inputStream)
+        {
+            return false;
+        }
 
-    unsigned int dataSize = 0;
-    inputStream.read(reinterpret_cast<char*>(&dataSize), 4);
-    if (dataSize == 0)
-    {
-        return false;
+        if (nbAvailableBytes / bytesPerSample < outAudioInfo.m_NbSamples)
+        {
+            outAudioInfo.m_NbSamples = static_cast<unsigned int>(nbAvailableBytes / bytesPerSample);
+        }
     }
 
-    outAudioInfo.m_NbSamples = dataSize / (outAudioInfo.m_NumChannels * (outAudioInfo.m_BitsPerSample / 8));
-
-    return true;
-}
\ No newline at end of file
+    return outAudioInfo.m_NbSamples != 0;
+}
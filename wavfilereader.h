@@ -7,16 +7,34 @@
 
 #include "audioformats.h"
 
+/**
+ *	WavFileReader reads WAV files of 32 bits float samples. Chunks are found using their size,
+ *	and none of the fields of the header are trusted: they must be consistent with each other 
+ *	and with the size of the file.
+ */
 class WavFileReader
 {
 
 private:
     static bool CheckFirstFormatBlock(std::istream& inputFileStream);
     static bool CheckAudioFormatBlock(std::istream& inputFileStream, AudioInfo& outAudioInfo);
+    static bool CheckFormatChunk(std::istream& inputStream, unsigned int chunkSize, AudioInfo& outAudioInfo);
+
+    static bool ReadChunkHeader(std::istream& inputStream, char outChunkID[5], unsigned int& outChunkSize);
+    static bool SkipChunkData(std::istream& inputStream, std::streamoff nbBytesToSkip);
 
 public:   
+	// Reads the header of the file, up to the start of its samples. m_NbSamples is the number 
+	// of samples of each channel actually in the file, which is less than the size of the data 
+	// chunk says when the file is truncated.
     static bool ReadFormat(std::istream& inputStream, AudioInfo& outAudioInfo);
+
+	// Reads nbSamplesToRead samples of each channel, interleaved, from the current position.
+	// Returns false if fewer samples could be read, outNbSamplesRead is the number read.
 	static bool ReadSamples(std::istream& inputStream,  const AudioInfo& audioInfo, unsigned int nbSamplesToRead, float* outSamples, unsigned int& outNbSamplesRead);
+
+	// Reads the format and all the samples of a file at once
+	static bool ReadFile(const std::string& filePath, AudioInfo& outAudioInfo, std::vector<float>& outSamples);
 }; 
 
 #endif // WAVFILEREADER_H_
\ No newline at end of file
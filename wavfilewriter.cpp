@@ -0,0 +1,211 @@
+#include <cmath>
+
+#include "wavfilewriter.h"
+
+#define WAV_FORMAT_CODE_PCM			0x0001
+#define WAV_FORMAT_CODE_IEEE_FLOAT	0x0003
+
+// Offsets of the sizes filled in when the file is closed
+#define WAV_RIFF_SIZE_OFFSET		4
+#define WAV_FACT_NB_SAMPLES_OFFSET	44
+
+// Largest size the 32 bits sizes of the RIFF header can describe
+#define WAV_MAX_FILE_SIZE			0xFFFFFFFFull
+
+// Number of samples converted to integers at once
+#define NB_CONVERTED_VALUES			4096
+
+WavFileWriter::WavFileWriter()
+	:	m_NumChannels(0),
+		m_Format(FORMAT_FLOAT32),
+		m_NbSamples(0),
+		m_DataSizeOffset(0)
+{
+}
+
+unsigned int WavFileWriter::GetBytesPerSample() const
+{
+	switch (m_Format)
+	{
+	case FORMAT_PCM16:
+		return 2;
+	case FORMAT_PCM24:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+bool WavFileWriter::Open(const std::string& filePath, unsigned int sampleRate, unsigned short numChannels, Format format)
+{
+	Close();
+
+	if (!sampleRate || !numChannels)
+	{
+		return false;
+	}
+
+	m_OutputStream.open(filePath.c_str(), std::ofstream::out | std::ios::binary | std::ios::trunc);
+	if (!m_OutputStream)
+	{
+		return false;
+	}
+
+	m_NumChannels		= numChannels;
+	m_Format			= format;
+	m_NbSamples			= 0;
+	m_DataSizeOffset	= 0;
+
+	return WriteHeader(sampleRate);
+}
+
+bool WavFileWriter::WriteHeader(unsigned int sampleRate)
+{
+	unsigned int	zeroSize		= 0;
+	unsigned int	formatBlockSize	= 0x10;
+	unsigned short	audioFormat		= m_Format == FORMAT_FLOAT32 ? WAV_FORMAT_CODE_IEEE_FLOAT : WAV_FORMAT_CODE_PCM;
+	unsigned short	bytesPerBlock	= static_cast<unsigned short>(m_NumChannels * GetBytesPerSample());
+	unsigned int	bytesPerSec		= sampleRate * bytesPerBlock;
+	unsigned short	bitsPerSample	= static_cast<unsigned short>(GetBytesPerSample() * 8);
+	unsigned int	factChunkSize	= 4;
+
+	m_OutputStream.write("RIFF", 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&zeroSize), 4);
+	m_OutputStream.write("WAVE", 4);
+
+	m_OutputStream.write("fmt ", 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&formatBlockSize), 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&audioFormat), 2);
+	m_OutputStream.write(reinterpret_cast<const char*>(&m_NumChannels), 2);
+	m_OutputStream.write(reinterpret_cast<const char*>(&sampleRate), 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&bytesPerSec), 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&bytesPerBlock), 2);
+	m_OutputStream.write(reinterpret_cast<const char*>(&bitsPerSample), 2);
+
+	// Float files need a "fact" chunk holding their number of samples per channel
+	if (m_Format == FORMAT_FLOAT32)
+	{
+		m_OutputStream.write("fact", 4);
+		m_OutputStream.write(reinterpret_cast<const char*>(&factChunkSize), 4);
+		m_OutputStream.write(reinterpret_cast<const char*>(&zeroSize), 4);
+	}
+
+	return !m_OutputStream.fail();
+}
+
+bool WavFileWriter::WriteChunk(const char chunkID[4], const char* data, unsigned int size)
+{
+	if (!IsOpen() || m_DataSizeOffset)
+	{
+		return false;
+	}
+
+	m_OutputStream.write(chunkID, 4);
+	m_OutputStream.write(reinterpret_cast<const char*>(&size), 4);
+	m_OutputStream.write(data, size);
+	if (size & 1)
+	{
+		m_OutputStream.put('\0');
+	}
+
+	return !m_OutputStream.fail();
+}
+
+bool WavFileWriter::WriteDataChunkHeader()
+{
+	unsigned int zeroSize = 0;
+
+	m_OutputStream.write("data", 4);
+	m_DataSizeOffset = m_OutputStream.tellp();
+	m_OutputStream.write(reinterpret_cast<const char*>(&zeroSize), 4);
+
+	return !m_OutputStream.fail();
+}
+
+bool WavFileWriter::WriteSamples(const float* samples, unsigned int nbSamples)
+{
+	if (!IsOpen() || (!m_DataSizeOffset && !WriteDataChunkHeader()))
+	{
+		return false;
+	}
+
+	const unsigned int bytesPerSample = GetBytesPerSample();
+	const unsigned long long nbValues = static_cast<unsigned long long>(nbSamples) * m_NumChannels;
+	if (static_cast<unsigned long long>(m_DataSizeOffset) + 4 + (static_cast<unsigned long long>(m_NbSamples) * m_NumChannels + nbValues) * bytesPerSample + 1 > WAV_MAX_FILE_SIZE)
+	{
+		return false;
+	}
+
+	if (m_Format == FORMAT_FLOAT32)
+	{
+		m_OutputStream.write(reinterpret_cast<const char*>(samples), static_cast<std::streamsize>(nbValues * sizeof(float)));
+		m_NbSamples += nbSamples;
+
+		return !m_OutputStream.fail();
+	}
+
+	// Integers are little endian, and full scale is 1.0 as for floats
+	const double scale = m_Format == FORMAT_PCM16 ? 32768.0 : 8388608.0;
+	m_ConvertedSamples.resize(NB_CONVERTED_VALUES * bytesPerSample);
+	for (unsigned long long firstValueIndex = 0; firstValueIndex < nbValues; firstValueIndex += NB_CONVERTED_VALUES)
+	{
+		const unsigned int nbConvertedValues = static_cast<unsigned int>(nbValues - firstValueIndex < NB_CONVERTED_VALUES ? nbValues - firstValueIndex : NB_CONVERTED_VALUES);
+		char* convertedSample = &m_ConvertedSamples[0];
+		for (unsigned int valueIndex = 0; valueIndex < nbConvertedValues; ++valueIndex)
+		{
+			double value = floor(samples[firstValueIndex + valueIndex] * scale + 0.5);
+			value = value < -scale ? -scale : (value > scale - 1.0 ? scale - 1.0 : value);
+
+			// Two's complement bytes, lowest first
+			unsigned int integerValue = static_cast<unsigned int>(static_cast<int>(value));
+			for (unsigned int byteIndex = 0; byteIndex < bytesPerSample; ++byteIndex)
+			{
+				*convertedSample++ = static_cast<char>((integerValue >> (8 * byteIndex)) & 0xFF);
+			}
+		}
+
+		m_OutputStream.write(&m_ConvertedSamples[0], static_cast<std::streamsize>(nbConvertedValues) * bytesPerSample);
+	}
+
+	m_NbSamples += nbSamples;
+
+	return !m_OutputStream.fail();
+}
+
+bool WavFileWriter::Close()
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	// Files without samples still have an empty data chunk
+	if (!m_DataSizeOffset)
+	{
+		WriteDataChunkHeader();
+	}
+
+	unsigned int dataSize = m_NbSamples * m_NumChannels * GetBytesPerSample();
+	if (dataSize & 1)
+	{
+		m_OutputStream.put('\0');
+	}
+
+	unsigned int riffSize = static_cast<unsigned int>(m_OutputStream.tellp()) - 8;
+
+	m_OutputStream.seekp(WAV_RIFF_SIZE_OFFSET);
+	m_OutputStream.write(reinterpret_cast<const char*>(&riffSize), 4);
+	if (m_Format == FORMAT_FLOAT32)
+	{
+		m_OutputStream.seekp(WAV_FACT_NB_SAMPLES_OFFSET);
+		m_OutputStream.write(reinterpret_cast<const char*>(&m_NbSamples), 4);
+	}
+
+	m_OutputStream.seekp(m_DataSizeOffset);
+	m_OutputStream.write(reinterpret_cast<const char*>(&dataSize), 4);
+
+	bool written = !m_OutputStream.fail();
+	m_OutputStream.close();
+
+	return written;
+}
@@ -0,0 +1,67 @@
+#ifndef WAVFILEWRITER_H_
+#define WAVFILEWRITER_H_
+
+#include <string>
+#include <fstream>
+#include <vector>
+
+/**
+ *	A WavFileWriter writes samples to a WAV file, as 32 bits floats in the layout WavFileReader
+ *	reads: "fmt ", "fact" and "data" chunks, or as 16 or 24 bits integers, which have no "fact"
+ *	chunk. Other chunks, such as metadata, can be written between the format and the samples.
+ *	Samples can be written in any number of blocks, the sizes in the header are filled in when
+ *	the file is closed.
+ */
+class WavFileWriter
+{
+public:
+	enum Format
+	{
+		FORMAT_FLOAT32,
+		FORMAT_PCM16,		// Samples are rounded to the nearest integer and clipped
+		FORMAT_PCM24
+	};
+
+	WavFileWriter();
+	~WavFileWriter() { Close(); }
+
+	// Creates the file at filePath, replacing any existing one, and writes its header
+	bool Open(const std::string& filePath, unsigned int sampleRate, unsigned short numChannels, Format format = FORMAT_FLOAT32);
+
+	// Writes a chunk of size bytes, padded to an even size. Chunks can only be written before
+	// the first samples.
+	bool WriteChunk(const char chunkID[4], const char* data, unsigned int size);
+
+	// Appends nbSamples samples, the values of all channels being interleaved. Fails without
+	// writing anything if the file would grow past the 4 GB that WAV sizes can describe.
+	bool WriteSamples(const float* samples, unsigned int nbSamples);
+
+	// Fills in the sizes in the header and closes the file. Returns false if anything couldn't
+	// be written since the file was opened.
+	bool Close();
+
+	bool IsOpen() const { return m_OutputStream.is_open(); }
+
+private:
+	std::ofstream		m_OutputStream;
+	unsigned short		m_NumChannels;
+	Format				m_Format;
+	unsigned int		m_NbSamples;
+
+	// Position of the size of the data chunk, 0 until its header is written
+	std::streamoff		m_DataSizeOffset;
+
+	// Samples converted to integers before they're written
+	std::vector<char>	m_ConvertedSamples;
+
+	// Writers own their file stream, they can't be copied
+	WavFileWriter(const WavFileWriter&);
+	WavFileWriter& operator=(const WavFileWriter&);
+
+	bool WriteHeader(unsigned int sampleRate);
+	bool WriteDataChunkHeader();
+
+	unsigned int GetBytesPerSample() const;
+};
+
+#endif // WAVFILEWRITER_H_